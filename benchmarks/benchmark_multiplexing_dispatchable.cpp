@@ -18,6 +18,8 @@
 
 #include "mir/dispatch/multiplexing_dispatchable.h"
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <vector>
 #include <memory>
@@ -72,6 +74,48 @@ private:
 
 thread_local uint64_t TestDispatchable::dispatch_count = 0;
 
+/// Stays readable, so it is ready again as soon as it is re-armed
+class AlwaysReadyDispatchable : public md::Dispatchable
+{
+public:
+    AlwaysReadyDispatchable(std::atomic<uint64_t>& dispatch_count)
+        : dispatch_count(dispatch_count)
+    {
+        int pipefds[2];
+        if (pipe(pipefds) < 0)
+        {
+            throw std::system_error{errno, std::system_category(), "Failed to create pipe"};
+        }
+
+        read_fd = mir::Fd{pipefds[0]};
+        write_fd = mir::Fd{pipefds[1]};
+
+        char dummy{0};
+        if (::write(write_fd, &dummy, sizeof(dummy)) != sizeof(dummy))
+        {
+            throw std::system_error{errno, std::system_category(), "Failed to mark dispatchable"};
+        }
+    }
+
+    mir::Fd watch_fd() const override
+    {
+        return read_fd;
+    }
+    bool dispatch(md::FdEvents) override
+    {
+        dispatch_count.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    md::FdEvents relevant_events() const override
+    {
+        return md::FdEvent::readable;
+    }
+
+private:
+    std::atomic<uint64_t>& dispatch_count;
+    mir::Fd read_fd, write_fd;
+};
+
 bool fd_is_readable(int fd)
 {
     struct pollfd poller {
@@ -82,17 +126,80 @@ bool fd_is_readable(int fd)
     return poll(&poller, 1, 0);
 }
 
+/// Dispatch many fds that are all ready at once, reporting throughput and the latency of each dispatch()
+void benchmark_ready_fds(int thread_count, uint64_t dispatch_count, int fd_count, int events_per_dispatch)
+{
+    using namespace std::chrono;
+
+    std::atomic<uint64_t> dispatched{0};
+    auto dispatcher = std::make_shared<md::MultiplexingDispatchable>(events_per_dispatch);
+    for (int i = 0; i < fd_count; ++i)
+    {
+        dispatcher->add_watch(std::make_shared<AlwaysReadyDispatchable>(dispatched));
+    }
+
+    std::vector<std::vector<nanoseconds>> latencies(thread_count);
+
+    auto start = steady_clock::now();
+
+    std::vector<std::thread> thread_loops;
+    for (int i = 0; i < thread_count; ++i)
+    {
+        thread_loops.emplace_back([&, i]()
+        {
+            while (dispatched.load(std::memory_order_relaxed) < dispatch_count)
+            {
+                auto const before = steady_clock::now();
+                dispatcher->dispatch(md::FdEvent::readable);
+                latencies[i].push_back(steady_clock::now() - before);
+            }
+        });
+    }
+
+    for (auto& thread : thread_loops)
+    {
+        thread.join();
+    }
+
+    auto const duration = duration_cast<nanoseconds>(steady_clock::now() - start);
+
+    std::vector<nanoseconds> all_latencies;
+    for (auto const& thread_latencies : latencies)
+    {
+        all_latencies.insert(all_latencies.end(), thread_latencies.begin(), thread_latencies.end());
+    }
+    std::sort(all_latencies.begin(), all_latencies.end());
+
+    auto const percentile = [&all_latencies](double p)
+        {
+            return all_latencies[std::min(all_latencies.size() - 1, static_cast<size_t>(p * all_latencies.size()))].count();
+        };
+
+    std::cout<<"Dispatching "<<dispatched<<" events from "<<fd_count<<" ready fds, "
+             <<events_per_dispatch<<" per dispatch, took "<<duration.count()<<"ns"<<std::endl;
+    std::cout<<"Throughput: "<<(dispatched * 1e9 / duration.count())<<" events/s over "
+             <<all_latencies.size()<<" dispatch() calls"<<std::endl;
+    std::cout<<"dispatch() latency: median "<<percentile(0.5)<<"ns, 99th percentile "<<percentile(0.99)
+             <<"ns, 99.9th percentile "<<percentile(0.999)<<"ns, max "<<all_latencies.back().count()<<"ns"<<std::endl;
+}
+
 int main(int argc, char** argv)
 {
-    if (argc != 3)
+    if (argc != 3 && argc != 5)
     {
-        std::cout<<"Usage: "<<argv[0]<<" <number of threads> <dispatch count>"<<std::endl;
+        std::cout<<"Usage: "<<argv[0]<<" <number of threads> <dispatch count> [<ready fds> <events per dispatch>]"<<std::endl;
         exit(1);
     }
 
     int const thread_count = std::atoi(argv[1]);
     uint64_t const dispatch_count = std::atoll(argv[2]);
 
+    if (argc == 5)
+    {
+        benchmark_ready_fds(thread_count, dispatch_count, std::atoi(argv[3]), std::atoi(argv[4]));
+        exit(0);
+    }
+
     auto dispatcher = std::make_shared<md::MultiplexingDispatchable>();
     dispatcher->add_watch(std::make_shared<TestDispatchable>(dispatch_count / thread_count), md::DispatchReentrancy::reentrant);
 
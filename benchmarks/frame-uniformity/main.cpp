@@ -18,6 +18,7 @@
 
 #include "frame_uniformity_test.h"
 #include "mir_test_framework/executable_path.h"
+#include "mir_test_framework/temporary_environment_value.h"
 #include "mir/geometry/displacement.h"
 
 #include <assert.h>
@@ -105,25 +106,12 @@ Results compute_frame_uniformity(std::vector<TouchSamples::Sample> const& result
     return {average_pixel_offset, uniformity};
 }
 
-}
-
-// Main is inside a test to work around mir_test_framework 'issues' (e.g. mir_test_framework contains
-// a main function).
-TEST(FrameUniformity, average_frame_offset)
+Results measure_frame_uniformity(geom::Size screen_size, geom::Point touch_start_point, geom::Point touch_end_point,
+    std::chrono::milliseconds touch_duration)
 {
-    geom::Size const screen_size{1024, 1024};
-    geom::Point const touch_start_point{0, 0};
-    geom::Point const touch_end_point{1024, 1024};
-    std::chrono::milliseconds touch_duration{1000};
-    
     int const run_count = 1;
-    double average_lag = 0, average_uniformity = 0;
+    Results average{0, 0};
 
-    // Ensure we load the correct platform libraries
-    setenv("MIR_CLIENT_PLATFORM_PATH",
-           (mtf::library_path() + "/client-modules").c_str(),
-           true);
-    
     for (int i = 0; i < run_count; i++)
     {
         FrameUniformityTest t({screen_size, touch_start_point, touch_end_point, touch_duration});
@@ -138,14 +126,48 @@ TEST(FrameUniformity, average_frame_offset)
         auto results = compute_frame_uniformity(samples, touch_start_point, touch_end_point,
             touch_start_time, touch_end_time);
         
-        average_lag += results.average_pixel_offset;
-        average_uniformity += results.frame_uniformity;
+        average.average_pixel_offset += results.average_pixel_offset;
+        average.frame_uniformity += results.frame_uniformity;
     }
     
-    average_lag /= run_count;
-    average_uniformity /= run_count;
-    
-    std::cout << "Average pixel lag: " << average_lag << "px" << std::endl;
-    std::cout << "Frame Uniformity (smaller scores are more uniform): " << average_uniformity << "px per sample\n"
+    average.average_pixel_offset /= run_count;
+    average.frame_uniformity /= run_count;
+    return average;
+}
+
+void print(char const* title, Results const& results)
+{
+    std::cout << title << std::endl;
+    std::cout << "Average pixel lag: " << results.average_pixel_offset << "px" << std::endl;
+    std::cout << "Frame Uniformity (smaller scores are more uniform): " << results.frame_uniformity << "px per sample\n"
         << std::endl;
 }
+}
+
+// Main is inside a test to work around mir_test_framework 'issues' (e.g. mir_test_framework contains
+// a main function).
+TEST(FrameUniformity, average_frame_offset)
+{
+    geom::Size const screen_size{1024, 1024};
+    geom::Point const touch_start_point{0, 0};
+    geom::Point const touch_end_point{1024, 1024};
+    std::chrono::milliseconds touch_duration{1000};
+
+    // Ensure we load the correct platform libraries
+    setenv("MIR_CLIENT_PLATFORM_PATH",
+           (mtf::library_path() + "/client-modules").c_str(),
+           true);
+
+    Results raw_samples, resampled;
+    {
+        mtf::TemporaryEnvironmentValue resampling{"MIR_SERVER_INPUT_RESAMPLING", "off"};
+        raw_samples = measure_frame_uniformity(screen_size, touch_start_point, touch_end_point, touch_duration);
+    }
+    {
+        mtf::TemporaryEnvironmentValue resampling{"MIR_SERVER_INPUT_RESAMPLING", "touchscreens"};
+        resampled = measure_frame_uniformity(screen_size, touch_start_point, touch_end_point, touch_duration);
+    }
+
+    print("Raw touch samples:", raw_samples);
+    print("Touch resampled to each frame:", resampled);
+}
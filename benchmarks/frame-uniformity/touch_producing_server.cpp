@@ -65,9 +65,12 @@ std::shared_ptr<mg::Platform> TouchProducingServer::the_graphics_platform()
     return graphics_platform;
 }
 
-void TouchProducingServer::synthesize_event_at(geom::Point const& point)
+void TouchProducingServer::synthesize_event_at(geom::Point const& point, bool touch_down)
 {
-    touch_screen->emit_event(mis::a_touch_event().at_position(point));
+    // After touching down, the finger moves (which is what the server may resample)
+    touch_screen->emit_event(mis::a_touch_event()
+        .with_action(touch_down ? mis::TouchParameters::Action::Tap : mis::TouchParameters::Action::Move)
+        .at_position(point));
 }
 
 void TouchProducingServer::thread_function()
@@ -87,13 +90,14 @@ void TouchProducingServer::thread_function()
         std::this_thread::sleep_for(pause_between_events);
 
         now = std::chrono::high_resolution_clock::now();
-        if (touch_start_time == std::chrono::high_resolution_clock::time_point::min())
+        bool const touch_down = touch_start_time == std::chrono::high_resolution_clock::time_point::min();
+        if (touch_down)
             touch_start_time = now;
         touch_end_time = now;
         
         double alpha = (now.time_since_epoch().count()-start.time_since_epoch().count()) / static_cast<double>(end.time_since_epoch().count()-start.time_since_epoch().count());
         auto point = touch_start + alpha*(touch_end-touch_start);
-        synthesize_event_at(point);
+        synthesize_event_at(point, touch_down);
     }
 }
 
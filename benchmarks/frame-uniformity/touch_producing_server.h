@@ -58,7 +58,7 @@ private:
     
     std::shared_ptr<mir::graphics::Platform> graphics_platform;
     
-    void synthesize_event_at(mir::geometry::Point const& point);
+    void synthesize_event_at(mir::geometry::Point const& point, bool touch_down);
     void thread_function();
 
     std::unique_ptr<mir_test_framework::FakeInputDevice> const touch_screen;
@@ -36,7 +36,7 @@ struct StubDisplaySyncGroup : mg::DisplaySyncGroup
 {
     StubDisplaySyncGroup(geom::Size output_size, int vsync_rate_in_hz) :
         vsync_rate_in_hz(vsync_rate_in_hz),
-        last_sync(std::chrono::high_resolution_clock::now()),
+        last_sync(std::chrono::steady_clock::now()),
         buffer({{0, 0}, output_size})
     {
     }
@@ -48,8 +48,8 @@ struct StubDisplaySyncGroup : mg::DisplaySyncGroup
 
     void post() override
     {
-        auto now = std::chrono::high_resolution_clock::now();
-        auto next_sync = last_sync + std::chrono::seconds(1) / vsync_rate_in_hz;
+        auto now = std::chrono::steady_clock::now();
+        auto next_sync = last_sync + vsync_period();
         
         if (now < next_sync)
             std::this_thread::sleep_for(next_sync - now);
@@ -61,10 +61,21 @@ struct StubDisplaySyncGroup : mg::DisplaySyncGroup
     {
         return std::chrono::milliseconds::zero();
     }
+
+    auto next_frame_start() const -> std::chrono::steady_clock::time_point override
+    {
+        return last_sync + vsync_period();
+    }
+
+    auto vsync_period() const -> std::chrono::steady_clock::duration
+    {
+        return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::seconds(1) / vsync_rate_in_hz);
+    }
     
     double const vsync_rate_in_hz;
 
-    std::chrono::high_resolution_clock::time_point last_sync;
+    std::chrono::steady_clock::time_point last_sync;
 
     mtd::StubDisplayBuffer buffer;
 };
@@ -22,6 +22,8 @@
 #include "mir/dispatch/dispatchable.h"
 #include "mir/posix_rw_mutex.h"
 
+#include <atomic>
+#include <cstdint>
 #include <functional>
 #include <initializer_list>
 #include <list>
@@ -55,6 +57,12 @@ class MultiplexingDispatchable final : public Dispatchable
 public:
     MultiplexingDispatchable();
     MultiplexingDispatchable(std::initializer_list<std::shared_ptr<Dispatchable>> dispatchees);
+    /**
+     * \brief Create an adaptor whose dispatch() handles several ready dispatchees
+     * \param [in] max_events_per_dispatch  How many ready dispatchees one call to
+     *                                      dispatch() handles at most (1 to max_batch_size)
+     */
+    explicit MultiplexingDispatchable(int max_events_per_dispatch);
     virtual ~MultiplexingDispatchable() noexcept;
 
     MultiplexingDispatchable& operator=(MultiplexingDispatchable const&) = delete;
@@ -94,11 +102,19 @@ public:
      * \param [in] fd   File descriptor of watch to remove.
      */
     void remove_watch(Fd const& fd);
+
+    static int const max_batch_size = 64;
+
 private:
+    bool is_watched(std::shared_ptr<Dispatchable> const& dispatchee);
+
     PosixRWMutex lifetime_mutex;
     std::list<std::pair<std::shared_ptr<Dispatchable>, bool>> dispatchee_holder;
 
     Fd epoll_fd;
+    int const max_events_per_dispatch;
+    /// Bumped by every removal, so a batch can tell whether its dispatchees might be stale
+    std::atomic<std::uint64_t> removals{0};
 };
 }
 }
@@ -0,0 +1,88 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_GEOMETRY_REGION_H_
+#define MIR_GEOMETRY_REGION_H_
+
+#include "mir/geometry/rectangle.h"
+#include "mir/geometry/rectangles.h"
+
+#include <iosfwd>
+#include <vector>
+
+namespace mir
+{
+namespace geometry
+{
+
+/**
+ * A set of points made up of rectangles.
+ *
+ * Unlike Rectangles, a Region never holds overlapping rectangles so it can
+ * be added to, subtracted from and intersected with exactly. Internally it is
+ * kept as horizontal bands of disjoint spans (as pixman does) with vertically
+ * adjacent identical bands merged, so equal regions compare equal.
+ */
+class Region
+{
+public:
+    Region() = default;
+    Region(Rectangle const& rect);
+    explicit Region(Rectangles const& rects);
+
+    bool empty() const;
+    Rectangle bounding_rectangle() const;
+
+    /// True if every point of rect is in the region (so always for an empty rect)
+    bool contains(Rectangle const& rect) const;
+    bool contains(Point const& point) const;
+
+    void add(Region const& other);
+    void subtract(Region const& other);
+    void intersect(Region const& other);
+
+    /// The region as non-overlapping rectangles, ordered top-to-bottom then left-to-right
+    Rectangles rectangles() const;
+
+    bool operator==(Region const& other) const;
+    bool operator!=(Region const& other) const;
+
+    struct Span
+    {
+        int left;
+        int right;
+
+        bool operator==(Span const& other) const
+        { return left == other.left && right == other.right; }
+    };
+
+    struct Band
+    {
+        int top;
+        int bottom;
+        std::vector<Span> spans;
+    };
+
+private:
+    std::vector<Band> bands;
+};
+
+std::ostream& operator<<(std::ostream& out, Region const& value);
+
+}
+}
+
+#endif /* MIR_GEOMETRY_REGION_H_ */
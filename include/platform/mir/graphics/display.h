@@ -78,6 +78,31 @@ public:
      */
     virtual std::chrono::milliseconds recommended_sleep() const = 0;
 
+    /**
+     * When the compositor should start sampling the scene for the next
+     * frame, so that the frame is posted in time for the next refresh.
+     *
+     * Platforms that know when their outputs refresh (from page flip events,
+     * say) should override this; by default it is recommended_sleep() from
+     * now. A time in the past means "as soon as there is something to draw".
+     */
+    virtual auto next_frame_start() const -> std::chrono::steady_clock::time_point
+    {
+        return std::chrono::steady_clock::now() + recommended_sleep();
+    }
+
+    /**
+     * The latest post() can return for a frame started now to be shown at
+     * the refresh it is aimed at.
+     *
+     * Platforms that can't tell when their outputs refresh don't override
+     * this, and as the default is the end of time no frame counts as late.
+     */
+    virtual auto next_frame_deadline() const -> std::chrono::steady_clock::time_point
+    {
+        return std::chrono::steady_clock::time_point::max();
+    }
+
     virtual ~DisplaySyncGroup() = default;
 protected:
     DisplaySyncGroup() = default;
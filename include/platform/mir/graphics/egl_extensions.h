@@ -87,6 +87,23 @@ EGLAPI EGLBoolean EGLAPIENTRY eglStreamConsumerAcquireAttribEXT (EGLDisplay dpy,
 #endif
 #endif /* EGL_EXT_stream_acquire_mode */
 
+#ifndef EGL_EXT_image_dma_buf_import_modifiers
+#define EGL_EXT_image_dma_buf_import_modifiers 1
+#define EGL_DMA_BUF_PLANE3_FD_EXT             0x3440
+#define EGL_DMA_BUF_PLANE3_OFFSET_EXT         0x3441
+#define EGL_DMA_BUF_PLANE3_PITCH_EXT          0x3442
+#define EGL_DMA_BUF_PLANE0_MODIFIER_LO_EXT    0x3443
+#define EGL_DMA_BUF_PLANE0_MODIFIER_HI_EXT    0x3444
+#define EGL_DMA_BUF_PLANE1_MODIFIER_LO_EXT    0x3445
+#define EGL_DMA_BUF_PLANE1_MODIFIER_HI_EXT    0x3446
+#define EGL_DMA_BUF_PLANE2_MODIFIER_LO_EXT    0x3447
+#define EGL_DMA_BUF_PLANE2_MODIFIER_HI_EXT    0x3448
+#define EGL_DMA_BUF_PLANE3_MODIFIER_LO_EXT    0x3449
+#define EGL_DMA_BUF_PLANE3_MODIFIER_HI_EXT    0x344A
+typedef EGLBoolean (EGLAPIENTRYP PFNEGLQUERYDMABUFFORMATSEXTPROC) (EGLDisplay dpy, EGLint max_formats, EGLint *formats, EGLint *num_formats);
+typedef EGLBoolean (EGLAPIENTRYP PFNEGLQUERYDMABUFMODIFIERSEXTPROC) (EGLDisplay dpy, EGLint format, EGLint max_modifiers, khronos_uint64_t *modifiers, EGLBoolean *external_only, EGLint *num_modifiers);
+#endif /* EGL_EXT_image_dma_buf_import_modifiers */
+
 namespace mir
 {
 namespace graphics
@@ -122,6 +139,28 @@ struct EGLExtensions
         PFNEGLCREATEPLATFORMWINDOWSURFACEEXTPROC const eglCreatePlatformWindowSurface;
     };
     std::experimental::optional<PlatformBaseEXT> const platform_base;
+
+    /// Whether the display supports it still needs checking with eglQueryString()
+    struct ImageDmaBufImportModifiersEXT
+    {
+        ImageDmaBufImportModifiersEXT();
+
+        PFNEGLQUERYDMABUFFORMATSEXTPROC const eglQueryDmaBufFormatsExt;
+        PFNEGLQUERYDMABUFMODIFIERSEXTPROC const eglQueryDmaBufModifiersExt;
+    };
+    std::experimental::optional<ImageDmaBufImportModifiersEXT> const image_dma_buf_import_modifiers;
+
+    /// Whether the display supports it still needs checking with eglQueryString()
+    struct FenceSyncKHR
+    {
+        FenceSyncKHR();
+
+        PFNEGLCREATESYNCKHRPROC const eglCreateSyncKHR;
+        PFNEGLDESTROYSYNCKHRPROC const eglDestroySyncKHR;
+        PFNEGLCLIENTWAITSYNCKHRPROC const eglClientWaitSyncKHR;
+        /// From EGL_KHR_wait_sync; null if the EGL implementation doesn't have it
+        PFNEGLWAITSYNCKHRPROC const eglWaitSyncKHR;
+    };
 };
 
 }
@@ -20,6 +20,7 @@
 #define MIR_GRAPHICS_GRAPHIC_BUFFER_ALLOCATOR_H_
 
 #include "mir/graphics/buffer.h"
+#include "mir/geometry/rectangles.h"
 
 #include <vector>
 #include <memory>
@@ -75,9 +76,21 @@ public:
         std::function<void()>&& on_consumed,
         std::function<void()>&& on_release) = 0;
 
+    /**
+     * Import a wl_shm buffer
+     *
+     * \param buffer [in]           The wl_buffer resource
+     * \param wayland_executor [in] An Executor that spawns tasks on the Wayland event loop
+     * \param previous [in]         The buffer last imported for the same surface, if still alive.
+     *                              Implementations may reuse its GPU resources.
+     * \param damage [in]           The parts of buffer changed since previous, in buffer coordinates
+     * \param on_consumed [in]      Called when the compositor has consumed the buffer
+     */
     virtual auto buffer_from_shm(
         wl_resource* buffer,
         std::shared_ptr<mir::Executor> wayland_executor,
+        std::shared_ptr<Buffer> const& previous,
+        geometry::Rectangles const& damage,
         std::function<void()>&& on_consumed) -> std::shared_ptr<Buffer> = 0;
 
 protected:
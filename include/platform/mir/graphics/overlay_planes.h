@@ -0,0 +1,59 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_GRAPHICS_OVERLAY_PLANES_H_
+#define MIR_GRAPHICS_OVERLAY_PLANES_H_
+
+#include "mir/graphics/renderable.h"
+
+namespace mir
+{
+namespace graphics
+{
+
+/**
+ * Optional interface of a NativeDisplayBuffer that can scan some renderables
+ * out on hardware planes while the others are composited as usual.
+ *
+ * This is for when DisplayBuffer::overlay() can't take the whole list.
+ */
+class OverlayPlanes
+{
+public:
+    virtual ~OverlayPlanes() = default;
+
+    /**
+     * Put what renderables the hardware can on overlay planes, replacing
+     * whatever was on them before.
+     *
+     * \param [in] renderlist   Everything that should appear on the screen,
+     *                          bottom to top
+     * \returns                 The renderables still to be composited, in the
+     *                          same order. Everything else is on a plane and
+     *                          stays there until the next call.
+     */
+    virtual RenderableList assign_overlays(RenderableList const& renderlist) = 0;
+
+protected:
+    OverlayPlanes() = default;
+    OverlayPlanes(OverlayPlanes const&) = delete;
+    OverlayPlanes& operator=(OverlayPlanes const&) = delete;
+};
+
+}
+}
+
+#endif /* MIR_GRAPHICS_OVERLAY_PLANES_H_ */
@@ -21,6 +21,8 @@
 
 #include <experimental/optional>
 #include <mir/geometry/rectangle.h>
+#include <mir/geometry/rectangles.h>
+#include <mir/graphics/buffer_id.h>
 #include <glm/glm.hpp>
 #include <memory>
 #include <vector>
@@ -49,6 +51,14 @@ public:
      */
     virtual std::shared_ptr<Buffer> buffer() const = 0;
 
+    /**
+     * Return the parts of buffer() that may differ from an earlier buffer of
+     * this renderable, in buffer coordinates. If nothing is returned the
+     * whole buffer must be treated as changed.
+     */
+    virtual std::experimental::optional<geometry::Rectangles>
+        buffer_damage_since(BufferID previous) const = 0;
+
     virtual geometry::Rectangle screen_position() const = 0;
     virtual std::experimental::optional<geometry::Rectangle> clip_area() const = 0;
 
@@ -72,6 +82,13 @@ public:
 
     virtual bool shaped() const = 0;  // meaning the pixel format has alpha
 
+    /**
+     * Parts of screen_position(), in screen coordinates, that the buffer is
+     * known to draw fully opaque even though shaped(). Empty if none are.
+     * Like the buffer contents this is before alpha() is applied.
+     */
+    virtual geometry::Rectangles opaque_region() const = 0;
+
     virtual unsigned int swap_interval() const = 0;
 protected:
     Renderable() = default;
@@ -48,10 +48,14 @@ extern char const* const cursor_opt;
 extern char const* const fatal_except_opt;
 extern char const* const debug_opt;
 extern char const* const composite_delay_opt;
+extern char const* const frame_timings_file_opt;
 extern char const* const enable_key_repeat_opt;
 extern char const* const x11_display_opt;
 extern char const* const wayland_extensions_opt;
 extern char const* const enable_mirclient_opt;
+extern char const* const hidden_surface_frame_rate_opt;
+extern char const* const coalesce_pointer_motion_opt;
+extern char const* const input_resampling_opt;
 
 extern char const* const offscreen_opt;
 
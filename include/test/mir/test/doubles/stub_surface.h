@@ -44,12 +44,14 @@ struct StubSurface : scene::Surface
     geometry::Point top_left() const override { return {}; }
     geometry::Rectangle input_bounds() const override { return {}; }
     bool input_area_contains(geometry::Point const&) const override { return false; }
+    auto input_extents() const -> geometry::Rectangle override { return {}; }
     void consume(MirEvent const*) override {}
     void set_alpha(float) override {}
     void set_orientation(MirOrientation) override {}
     void set_transformation(glm::mat4 const&) override {}
     bool visible() const override { return false; }
     graphics::RenderableList generate_renderables(compositor::CompositorID) const override { return {}; }
+    void append_renderables(compositor::CompositorID, compositor::FrameArena&, graphics::RenderableList&) const override {}
     int buffers_ready_for_compositor(void const*) const override { return 0; }
     MirWindowType type() const override { return mir_window_type_normal; }
     MirWindowState state() const override { return mir_window_state_fullscreen; }
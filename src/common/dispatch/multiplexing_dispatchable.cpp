@@ -22,7 +22,9 @@
 #include "mir/posix_rw_mutex.h"
 
 #include <boost/throw_exception.hpp>
+#include <array>
 #include <shared_mutex>
+#include <stdexcept>
 
 #include <sys/epoll.h>
 #include <poll.h>
@@ -72,9 +74,20 @@ private:
 }
 
 md::MultiplexingDispatchable::MultiplexingDispatchable()
+    : MultiplexingDispatchable(1)
+{
+}
+
+md::MultiplexingDispatchable::MultiplexingDispatchable(int max_events_per_dispatch)
     : lifetime_mutex{PosixRWMutex::Type::PreferWriterNonRecursive},
-      epoll_fd{mir::Fd{::epoll_create1(EPOLL_CLOEXEC)}}
+      epoll_fd{mir::Fd{::epoll_create1(EPOLL_CLOEXEC)}},
+      max_events_per_dispatch{max_events_per_dispatch}
 {
+    if (max_events_per_dispatch < 1 || max_events_per_dispatch > max_batch_size)
+    {
+        BOOST_THROW_EXCEPTION((std::invalid_argument{"Invalid number of events per dispatch"}));
+    }
+
     if (epoll_fd == mir::Fd::invalid)
     {
         BOOST_THROW_EXCEPTION((std::system_error{errno,
@@ -108,48 +121,113 @@ bool md::MultiplexingDispatchable::dispatch(md::FdEvents events)
         return false;
     }
 
-    std::shared_ptr<md::Dispatchable> source;
-    bool rearm_source{false};
-    epoll_event event;
+    struct Ready
+    {
+        std::shared_ptr<md::Dispatchable> source;
+        bool rearm_source;
+    };
+
+    std::array<epoll_event, max_batch_size> ready_events;
+    std::array<Ready, max_batch_size> ready;
+    int ready_count;
+    std::uint64_t removals_seen;
 
     {
         std::shared_lock<decltype(lifetime_mutex)> lock{lifetime_mutex};
 
-        auto result = epoll_wait(epoll_fd, &event, 1, 0);
+        ready_count = epoll_wait(epoll_fd, ready_events.data(), max_events_per_dispatch, 0);
 
-        if (result < 0)
+        if (ready_count < 0)
         {
             BOOST_THROW_EXCEPTION((std::system_error{errno,
                                                      std::system_category(),
                                                      "Failed to wait on fds"}));
         }
 
-        if (result == 0)
+        if (ready_count == 0)
         {
             // Some other thread must have stolen the event we were woken for;
             // that's ok, just return.
             return true;
         }
 
-        auto event_source = reinterpret_cast<decltype(dispatchee_holder)::pointer>(event.data.ptr);
+        // Holding the sources keeps them alive for the whole batch, even if they're removed
+        for (auto i = 0; i != ready_count; ++i)
+        {
+            auto event_source = reinterpret_cast<decltype(dispatchee_holder)::pointer>(ready_events[i].data.ptr);
 
-        source = event_source->first;
-        rearm_source = event_source->second;
-    }
+            ready[i].source = event_source->first;
+            ready[i].rearm_source = event_source->second;
+        }
 
-    if (!source->dispatch(epoll_to_fd_event(event)))
-    {
-        remove_watch(source);
+        removals_seen = removals.load(std::memory_order_acquire);
     }
-    else if (rearm_source)
+
+    // An earlier dispatch in this batch (or another thread) may have removed a source,
+    // in which case it must be neither dispatched nor re-armed
+    auto const removed = [&](int i)
+        {
+            return removals.load(std::memory_order_acquire) != removals_seen && !is_watched(ready[i].source);
+        };
+
+    auto const rearm = [&](int i)
+        {
+            if (ready[i].rearm_source)
+            {
+                auto& event = ready_events[i];
+                event.events = fd_event_to_epoll(ready[i].source->relevant_events()) | EPOLLONESHOT;
+                epoll_ctl(epoll_fd, EPOLL_CTL_MOD, ready[i].source->watch_fd(), &event);
+            }
+        };
+
+    for (auto i = 0; i != ready_count; ++i)
     {
-        event.events = fd_event_to_epoll(source->relevant_events()) | EPOLLONESHOT;
-        epoll_ctl(epoll_fd, EPOLL_CTL_MOD, source->watch_fd(), &event);
+        auto const& source = ready[i].source;
+
+        if (i != 0 && removed(i))
+        {
+            continue;
+        }
+
+        bool keep_source;
+        try
+        {
+            keep_source = source->dispatch(epoll_to_fd_event(ready_events[i]));
+        }
+        catch (...)
+        {
+            // Sources we haven't got to yet would otherwise never be woken again
+            for (auto j = i + 1; j != ready_count; ++j)
+            {
+                if (!removed(j))
+                    rearm(j);
+            }
+            throw;
+        }
+
+        if (!keep_source)
+        {
+            remove_watch(source);
+        }
+        else
+        {
+            rearm(i);
+        }
     }
 
     return true;
 }
 
+bool md::MultiplexingDispatchable::is_watched(std::shared_ptr<Dispatchable> const& dispatchee)
+{
+    std::shared_lock<decltype(lifetime_mutex)> lock{lifetime_mutex};
+
+    return std::any_of(
+        begin(dispatchee_holder),
+        end(dispatchee_holder),
+        [&dispatchee](auto const& candidate) { return candidate.first == dispatchee; });
+}
+
 md::FdEvents md::MultiplexingDispatchable::relevant_events() const
 {
     return md::FdEvent::readable;
@@ -227,4 +305,5 @@ void md::MultiplexingDispatchable::remove_watch(Fd const& fd)
     {
         return candidate.first->watch_fd() == fd;
     });
+    removals.fetch_add(1, std::memory_order_release);
 }
@@ -0,0 +1,110 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mir/events/block_pool.h"
+
+#include <boost/throw_exception.hpp>
+
+#include <stdexcept>
+
+namespace mev = mir::events;
+
+namespace
+{
+auto aligned(std::size_t size) -> std::size_t
+{
+    auto const alignment = alignof(std::max_align_t);
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+auto pack(std::uint64_t generation, std::uint32_t index) -> std::uint64_t
+{
+    return (generation << 32) | index;
+}
+
+auto generation_of(std::uint64_t head) -> std::uint64_t
+{
+    return head >> 32;
+}
+
+auto index_of(std::uint64_t head) -> std::uint32_t
+{
+    return static_cast<std::uint32_t>(head);
+}
+}
+
+mev::BlockPool::BlockPool(std::size_t block_size, std::uint32_t capacity)
+    : block_size_{aligned(block_size)},
+      capacity{capacity},
+      // Not value-initialized: pages of blocks never used are never touched
+      storage{new unsigned char[block_size_ * capacity]},
+      next{new std::atomic<std::uint32_t>[capacity]},
+      head{pack(0, 0)}
+{
+    if (capacity == 0 || block_size == 0)
+        BOOST_THROW_EXCEPTION(std::invalid_argument{"BlockPool needs blocks to hand out"});
+
+    // The index "capacity" marks the end of the free list
+    for (std::uint32_t i = 0; i != capacity; ++i)
+        next[i].store(i + 1, std::memory_order_relaxed);
+}
+
+mev::BlockPool::~BlockPool() = default;
+
+auto mev::BlockPool::allocate() -> void*
+{
+    auto current = head.load(std::memory_order_acquire);
+
+    for (;;)
+    {
+        auto const index = index_of(current);
+        if (index == capacity)
+            return nullptr;
+
+        // If another thread takes this block first next[index] may change
+        // under us, but then so has the generation and the exchange fails
+        auto const replacement = pack(generation_of(current) + 1, next[index].load(std::memory_order_relaxed));
+        if (head.compare_exchange_weak(current, replacement, std::memory_order_acquire, std::memory_order_acquire))
+            return block(index);
+    }
+}
+
+void mev::BlockPool::release(void* released)
+{
+    auto const index = static_cast<std::uint32_t>((static_cast<unsigned char*>(released) - storage.get()) / block_size_);
+    auto current = head.load(std::memory_order_relaxed);
+
+    do
+    {
+        next[index].store(index_of(current), std::memory_order_relaxed);
+    }
+    while (!head.compare_exchange_weak(
+        current,
+        pack(generation_of(current) + 1, index),
+        std::memory_order_release,
+        std::memory_order_relaxed));
+}
+
+auto mev::BlockPool::owns(void const* block) const -> bool
+{
+    auto const address = static_cast<unsigned char const*>(block);
+    return storage.get() <= address && address < storage.get() + block_size_ * capacity;
+}
+
+auto mev::BlockPool::block(std::uint32_t index) const -> unsigned char*
+{
+    return storage.get() + block_size_ * index;
+}
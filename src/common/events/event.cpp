@@ -32,11 +32,47 @@
 #include "mir/events/surface_output_event.h"
 #include "mir/events/input_device_state_event.h"
 #include "mir/events/surface_placement_event.h"
+#include "mir/events/block_pool.h"
 
 #include <capnp/serialize.h>
+#include <kj/io.h>
 
 
 namespace ml = mir::logging;
+namespace mev = mir::events;
+
+namespace
+{
+auto event_pool() -> mev::BlockPool&
+{
+    // Never destroyed, as events may be deleted by other static destructors
+    static auto const pool = new mev::BlockPool{sizeof(MirEvent), 256};
+    return *pool;
+}
+}
+
+void* MirEvent::operator new(std::size_t size)
+{
+    auto& pool = event_pool();
+
+    if (size <= pool.block_size())
+    {
+        if (auto const block = pool.allocate())
+            return block;
+    }
+
+    return ::operator new(size);
+}
+
+void MirEvent::operator delete(void* event)
+{
+    auto& pool = event_pool();
+
+    if (pool.owns(event))
+        pool.release(event);
+    else
+        ::operator delete(event);
+}
 
 MirEvent::MirEvent(MirEvent const& e)
 {
@@ -68,10 +104,14 @@ mir::EventUPtr MirEvent::deserialize(std::string const& bytes)
 
 std::string MirEvent::serialize(MirEvent const* event)
 {
-    std::string output;
-    auto flat_event = ::capnp::messageToFlatArray(const_cast<MirEvent*>(event)->message);
+    auto& message = const_cast<MirEvent*>(event)->message;
+
+    // Write straight into the result, rather than into a flat array to copy from
+    std::string output(::capnp::computeSerializedSizeInWords(message) * sizeof(::capnp::word), '\0');
+    kj::ArrayOutputStream stream{kj::arrayPtr(reinterpret_cast<kj::byte*>(&output[0]), output.size())};
+    ::capnp::writeMessage(stream, message);
 
-    return {reinterpret_cast<char*>(flat_event.asBytes().begin()), flat_event.asBytes().size()};
+    return output;
 }
 
 MirEventType MirEvent::type() const
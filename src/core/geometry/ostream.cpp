@@ -20,6 +20,7 @@
 #include "mir/geometry/size.h"
 #include "mir/geometry/rectangle.h"
 #include "mir/geometry/rectangles.h"
+#include "mir/geometry/region.h"
 
 #include <ostream>
 
@@ -57,3 +58,8 @@ std::ostream& geom::operator<<(std::ostream& out, Rectangles const& value)
     out << ']';
     return out;
 }
+
+std::ostream& geom::operator<<(std::ostream& out, Region const& value)
+{
+    return out << value.rectangles();
+}
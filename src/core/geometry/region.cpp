@@ -0,0 +1,219 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mir/geometry/region.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace geom = mir::geometry;
+
+using Span = geom::Region::Span;
+using Band = geom::Region::Band;
+
+namespace
+{
+/*
+ * Both combine() overloads sweep along one axis over the boundaries of two
+ * sorted lists of disjoint intervals. Each piece between boundaries is kept
+ * if op(in_a, in_b) says so, and neighbouring kept pieces are merged.
+ */
+template<typename Op>
+auto combine(std::vector<Span> const& a, std::vector<Span> const& b, Op op) -> std::vector<Span>
+{
+    std::vector<Span> result;
+
+    auto i = a.begin();
+    auto j = b.begin();
+    auto x = std::min(
+        i != a.end() ? i->left : std::numeric_limits<int>::max(),
+        j != b.end() ? j->left : std::numeric_limits<int>::max());
+
+    while (i != a.end() || j != b.end())
+    {
+        bool const in_a = i != a.end() && i->left <= x;
+        bool const in_b = j != b.end() && j->left <= x;
+        auto const next_a = i == a.end() ? std::numeric_limits<int>::max() : in_a ? i->right : i->left;
+        auto const next_b = j == b.end() ? std::numeric_limits<int>::max() : in_b ? j->right : j->left;
+        auto const next = std::min(next_a, next_b);
+
+        if (op(in_a, in_b))
+        {
+            if (!result.empty() && result.back().right == x)
+                result.back().right = next;
+            else
+                result.push_back({x, next});
+        }
+
+        x = next;
+        if (i != a.end() && i->right <= x) ++i;
+        if (j != b.end() && j->right <= x) ++j;
+    }
+
+    return result;
+}
+
+template<typename Op>
+auto combine(std::vector<Band> const& a, std::vector<Band> const& b, Op op) -> std::vector<Band>
+{
+    static std::vector<Span> const nothing;
+    std::vector<Band> result;
+
+    auto i = a.begin();
+    auto j = b.begin();
+    auto y = std::min(
+        i != a.end() ? i->top : std::numeric_limits<int>::max(),
+        j != b.end() ? j->top : std::numeric_limits<int>::max());
+
+    while (i != a.end() || j != b.end())
+    {
+        bool const in_a = i != a.end() && i->top <= y;
+        bool const in_b = j != b.end() && j->top <= y;
+        auto const next_a = i == a.end() ? std::numeric_limits<int>::max() : in_a ? i->bottom : i->top;
+        auto const next_b = j == b.end() ? std::numeric_limits<int>::max() : in_b ? j->bottom : j->top;
+        auto const next = std::min(next_a, next_b);
+
+        auto spans = combine(in_a ? i->spans : nothing, in_b ? j->spans : nothing, op);
+        if (!spans.empty())
+        {
+            if (!result.empty() && result.back().bottom == y && result.back().spans == spans)
+                result.back().bottom = next;
+            else
+                result.push_back({y, next, std::move(spans)});
+        }
+
+        y = next;
+        if (i != a.end() && i->bottom <= y) ++i;
+        if (j != b.end() && j->bottom <= y) ++j;
+    }
+
+    return result;
+}
+}
+
+geom::Region::Region(Rectangle const& rect)
+{
+    if (rect.size.width > Width{0} && rect.size.height > Height{0})
+    {
+        bands.push_back({
+            rect.top().as_int(), rect.bottom().as_int(),
+            {{rect.left().as_int(), rect.right().as_int()}}});
+    }
+}
+
+geom::Region::Region(Rectangles const& rects)
+{
+    for (auto const& rect : rects)
+        add(rect);
+}
+
+bool geom::Region::empty() const
+{
+    return bands.empty();
+}
+
+geom::Rectangle geom::Region::bounding_rectangle() const
+{
+    if (bands.empty())
+        return {};
+
+    auto left = std::numeric_limits<int>::max();
+    auto right = std::numeric_limits<int>::min();
+    for (auto const& band : bands)
+    {
+        left = std::min(left, band.spans.front().left);
+        right = std::max(right, band.spans.back().right);
+    }
+
+    auto const top = bands.front().top;
+    auto const bottom = bands.back().bottom;
+    return {{left, top}, {right - left, bottom - top}};
+}
+
+bool geom::Region::contains(Rectangle const& rect) const
+{
+    if (rect.size.width <= Width{0} || rect.size.height <= Height{0})
+        return true;
+
+    auto const left = rect.left().as_int();
+    auto const right = rect.right().as_int();
+    auto y = rect.top().as_int();
+    auto const bottom = rect.bottom().as_int();
+
+    auto band = std::upper_bound(bands.begin(), bands.end(), y,
+        [](int y, Band const& band) { return y < band.bottom; });
+
+    for (; y < bottom; ++band)
+    {
+        if (band == bands.end() || band->top > y)
+            return false;
+
+        auto const span = std::upper_bound(band->spans.begin(), band->spans.end(), left,
+            [](int x, Span const& span) { return x < span.right; });
+
+        if (span == band->spans.end() || span->left > left || span->right < right)
+            return false;
+
+        y = band->bottom;
+    }
+
+    return true;
+}
+
+bool geom::Region::contains(Point const& point) const
+{
+    return contains(Rectangle{point, {1, 1}});
+}
+
+void geom::Region::add(Region const& other)
+{
+    bands = combine(bands, other.bands, [](bool in_a, bool in_b) { return in_a || in_b; });
+}
+
+void geom::Region::subtract(Region const& other)
+{
+    bands = combine(bands, other.bands, [](bool in_a, bool in_b) { return in_a && !in_b; });
+}
+
+void geom::Region::intersect(Region const& other)
+{
+    bands = combine(bands, other.bands, [](bool in_a, bool in_b) { return in_a && in_b; });
+}
+
+geom::Rectangles geom::Region::rectangles() const
+{
+    Rectangles result;
+    for (auto const& band : bands)
+    {
+        for (auto const& span : band.spans)
+            result.add({{span.left, band.top}, {span.right - span.left, band.bottom - band.top}});
+    }
+    return result;
+}
+
+bool geom::Region::operator==(Region const& other) const
+{
+    return std::equal(bands.begin(), bands.end(), other.bands.begin(), other.bands.end(),
+        [](Band const& lhs, Band const& rhs)
+        {
+            return lhs.top == rhs.top && lhs.bottom == rhs.bottom && lhs.spans == rhs.spans;
+        });
+}
+
+bool geom::Region::operator!=(Region const& other) const
+{
+    return !(*this == other);
+}
@@ -46,3 +46,38 @@ mgl::Primitive mgl::tessellate_renderable_into_rectangle(
     vertices[3] = {{right, bottom, 0.0f}, {tex_right, tex_bottom}};
     return rectangle;
 }
+
+mgl::Primitive mgl::tessellate_renderable_into_rectangle(
+    mg::Renderable const& renderable,
+    geom::Displacement const& offset,
+    geom::Rectangle const& area)
+{
+    auto const whole = renderable.screen_position();
+    if (whole.size.width.as_int() <= 0 || whole.size.height.as_int() <= 0)
+        return tessellate_renderable_into_rectangle(renderable, offset);
+
+    GLfloat const whole_width = whole.size.width.as_int();
+    GLfloat const whole_height = whole.size.height.as_int();
+
+    auto rect = area;
+    rect.top_left = rect.top_left - offset;
+    GLfloat left = rect.top_left.x.as_int();
+    GLfloat right = left + rect.size.width.as_int();
+    GLfloat top = rect.top_left.y.as_int();
+    GLfloat bottom = top + rect.size.height.as_int();
+
+    mgl::Primitive rectangle;
+    rectangle.type = GL_TRIANGLE_STRIP;
+
+    GLfloat const tex_left = (area.top_left.x - whole.top_left.x).as_int() / whole_width;
+    GLfloat const tex_top = (area.top_left.y - whole.top_left.y).as_int() / whole_height;
+    GLfloat const tex_right = tex_left + area.size.width.as_int() / whole_width;
+    GLfloat const tex_bottom = tex_top + area.size.height.as_int() / whole_height;
+
+    auto& vertices = rectangle.vertices;
+    vertices[0] = {{left,  top,    0.0f}, {tex_left,  tex_top}};
+    vertices[1] = {{left,  bottom, 0.0f}, {tex_left,  tex_bottom}};
+    vertices[2] = {{right, top,    0.0f}, {tex_right, tex_top}};
+    vertices[3] = {{right, bottom, 0.0f}, {tex_right, tex_bottom}};
+    return rectangle;
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_EVENTS_BLOCK_POOL_H_
+#define MIR_EVENTS_BLOCK_POOL_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace mir
+{
+namespace events
+{
+/**
+ * A fixed number of equally sized blocks, handed out and taken back without locking.
+ *
+ * Any thread may allocate a block and any thread may release it. Free blocks
+ * form a stack whose head is tagged with a generation count, so a thread that
+ * is preempted while popping can't be fooled by the same block being released
+ * again in the meantime.
+ */
+class BlockPool
+{
+public:
+    BlockPool(std::size_t block_size, std::uint32_t capacity);
+    ~BlockPool();
+
+    /// A block of at least block_size() bytes, or nullptr if they are all in use
+    auto allocate() -> void*;
+
+    /// Return a block from allocate() to the pool
+    void release(void* block);
+
+    /// Whether block belongs to this pool
+    auto owns(void const* block) const -> bool;
+
+    auto block_size() const -> std::size_t { return block_size_; }
+
+private:
+    BlockPool(BlockPool const&) = delete;
+    BlockPool& operator=(BlockPool const&) = delete;
+
+    auto block(std::uint32_t index) const -> unsigned char*;
+
+    std::size_t const block_size_;
+    std::uint32_t const capacity;
+    std::unique_ptr<unsigned char[]> const storage;
+    std::unique_ptr<std::atomic<std::uint32_t>[]> const next;
+
+    /// The generation in the high 32 bits, the index of the first free block in the low
+    std::atomic<std::uint64_t> head;
+};
+}
+}
+
+#endif // MIR_EVENTS_BLOCK_POOL_H_
@@ -25,6 +25,8 @@
 
 #include <capnp/message.h>
 
+#include <array>
+#include <cstddef>
 #include <cstring>
 
 struct MirEvent
@@ -67,10 +69,19 @@ struct MirEvent
     static mir::EventUPtr deserialize(std::string const& bytes);
     static std::string serialize(MirEvent const* event);
 
+    /// Events (of every type) come from a lock-free pool while it has room
+    static void* operator new(std::size_t size);
+    static void operator delete(void* event);
+
 protected:
     MirEvent() = default;
 
-    ::capnp::MallocMessageBuilder message;
+    /// Room for the message of any common event, so building or copying one
+    /// doesn't allocate; larger messages spill over into the heap.
+    static std::size_t const inline_words = 128;
+    std::array<::capnp::word, inline_words> inline_segment{};
+
+    ::capnp::MallocMessageBuilder message{kj::arrayPtr(inline_segment.data(), inline_segment.size())};
     mir::capnp::Event::Builder event{message.initRoot<mir::capnp::Event>()};
 };
 
@@ -25,6 +25,7 @@
 #include "mir_toolkit/common.h"
 #include "mir/graphics/buffer_id.h"
 
+#include <experimental/optional>
 #include <memory>
 
 namespace mir
@@ -49,6 +50,15 @@ public:
     virtual void drop_old_buffers() = 0;
     virtual auto has_submitted_buffer() const -> bool = 0;
     virtual auto framedropping() const -> bool = 0;
+    /// As set by set_opaque_region(), in logical stream coordinates
+    virtual auto opaque_region() const -> geometry::Rectangles = 0;
+    /**
+     * The parts of buffer \a current that may differ from the earlier buffer
+     * \a previous, in buffer coordinates, accumulated from the damage passed to
+     * submit_buffer(). Nothing if that is no longer known.
+     */
+    virtual auto damage_between(graphics::BufferID previous, graphics::BufferID current) const
+        -> std::experimental::optional<geometry::Rectangles> = 0;
 };
 
 }
@@ -0,0 +1,114 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_COMPOSITOR_FRAME_ARENA_H_
+#define MIR_COMPOSITOR_FRAME_ARENA_H_
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace mir
+{
+namespace compositor
+{
+/**
+ * Recycles the memory of the objects a compositor creates for each frame.
+ *
+ * Objects made by an arena are owned through std::shared_ptr as usual, so
+ * whatever holds on to one (and through it, a buffer) keeps it alive exactly
+ * as long as it would if it came from std::make_shared(). The difference is
+ * that their memory is carved out of blocks the arena keeps, and is reused
+ * all at once when the last object made since it was last reused goes. Once
+ * the scene stops growing, make_shared() does not allocate.
+ *
+ * An arena belongs to one thread (a compositor's), which is the only one that
+ * may make objects from it or release them. They must all be released before
+ * the arena is destroyed.
+ */
+class FrameArena
+{
+public:
+    FrameArena();
+    ~FrameArena();
+
+    template<typename T, typename... Args>
+    auto make_shared(Args&&... args) -> std::shared_ptr<T>
+    {
+        return std::allocate_shared<T>(Allocator<T>{pool.get()}, std::forward<Args>(args)...);
+    }
+
+    /// The number of bytes the arena holds, in use or waiting to be reused
+    auto capacity() const -> std::size_t;
+
+private:
+    class Pool;
+
+    /// Hands out memory from pool
+    template<typename T>
+    struct Allocator
+    {
+        using value_type = T;
+
+        explicit Allocator(Pool* pool) noexcept
+            : pool{pool}
+        {
+        }
+
+        template<typename U>
+        Allocator(Allocator<U> const& other) noexcept
+            : pool{other.pool}
+        {
+        }
+
+        auto allocate(std::size_t n) -> T*
+        {
+            static_assert(alignof(T) <= alignof(std::max_align_t), "FrameArena does not support over-aligned types");
+            return static_cast<T*>(allocate_block(*pool, n * sizeof(T)));
+        }
+
+        void deallocate(T*, std::size_t) noexcept
+        {
+            free_block(*pool);
+        }
+
+        template<typename U>
+        auto operator==(Allocator<U> const& other) const noexcept -> bool
+        {
+            return pool == other.pool;
+        }
+
+        template<typename U>
+        auto operator!=(Allocator<U> const& other) const noexcept -> bool
+        {
+            return pool != other.pool;
+        }
+
+        Pool* pool;
+    };
+
+    static auto allocate_block(Pool& pool, std::size_t size) -> void*;
+    static void free_block(Pool& pool) noexcept;
+
+    std::unique_ptr<Pool> const pool;
+
+    FrameArena(FrameArena const&) = delete;
+    FrameArena& operator=(FrameArena const&) = delete;
+};
+}
+}
+
+#endif // MIR_COMPOSITOR_FRAME_ARENA_H_
@@ -0,0 +1,42 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_COMPOSITOR_FRAME_DEADLINE_LISTENER_H_
+#define MIR_COMPOSITOR_FRAME_DEADLINE_LISTENER_H_
+
+#include <chrono>
+
+namespace mir
+{
+namespace compositor
+{
+/// Told when the compositor will next sample the scene
+class FrameDeadlineListener
+{
+public:
+    /// Called on a compositing thread once it has posted a frame, so mustn't block
+    virtual void next_frame_at(std::chrono::steady_clock::time_point frame_start) = 0;
+
+protected:
+    FrameDeadlineListener() = default;
+    virtual ~FrameDeadlineListener() = default;
+    FrameDeadlineListener(FrameDeadlineListener const&) = delete;
+    FrameDeadlineListener& operator=(FrameDeadlineListener const&) = delete;
+};
+}
+}
+
+#endif /* MIR_COMPOSITOR_FRAME_DEADLINE_LISTENER_H_ */
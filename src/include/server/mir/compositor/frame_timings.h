@@ -0,0 +1,84 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_COMPOSITOR_FRAME_TIMINGS_H_
+#define MIR_COMPOSITOR_FRAME_TIMINGS_H_
+
+#include "mir/geometry/rectangle.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+namespace mir
+{
+namespace compositor
+{
+/// How long one stage of compositing took, over all the frames of an output
+struct FrameStageTimings
+{
+    /// Bucket n counts durations under 2^n ms (and, for n > 0, of at least 2^(n-1) ms);
+    /// the last bucket also counts everything longer.
+    static int const histogram_buckets = 8;
+
+    std::chrono::nanoseconds total{0};
+    std::chrono::nanoseconds longest{0};
+    std::array<std::uint64_t, histogram_buckets> histogram{};
+};
+
+/// The compositor's frame timings for one output (identified by its area)
+struct OutputFrameTimings
+{
+    geometry::Rectangle area;
+    std::uint64_t frames{0};
+    /// Frames after which the platform's deadline for starting the next one had already passed
+    std::uint64_t missed_deadlines{0};
+    /// From the start of the first frame recorded to the end of the last
+    std::chrono::nanoseconds elapsed{0};
+
+    FrameStageTimings scene_snapshot;   ///< Collecting the scene elements to draw
+    FrameStageTimings render;           ///< Drawing them (or putting them on overlays)
+    FrameStageTimings post;             ///< Swapping buffers and waiting for the flip
+    FrameStageTimings latency;          ///< From the scene snapshot until post() returns
+};
+
+/**
+ * Statistics about every frame the compositor has produced, for alerting on
+ * dropped frames and for benchmarks.
+ *
+ * The statistics are recorded without blocking the compositor, so reading them
+ * while frames are being composited may see one frame partly counted.
+ */
+class FrameTimings
+{
+public:
+    virtual auto outputs() const -> std::vector<OutputFrameTimings> = 0;
+
+    /// Write outputs() as a JSON object
+    virtual void write_json(std::ostream& out) const = 0;
+
+protected:
+    FrameTimings() = default;
+    virtual ~FrameTimings() = default;
+    FrameTimings(FrameTimings const&) = delete;
+    FrameTimings& operator=(FrameTimings const&) = delete;
+};
+}
+}
+
+#endif // MIR_COMPOSITOR_FRAME_TIMINGS_H_
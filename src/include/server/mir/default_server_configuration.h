@@ -55,6 +55,9 @@ class Drawer;
 class DisplayBufferCompositorFactory;
 class Compositor;
 class CompositorReport;
+class FrameTimings;
+class FrameTimingRecorder;
+class FrameDeadlineListener;
 }
 namespace frontend
 {
@@ -138,6 +141,7 @@ class InputDeviceHub;
 class DefaultInputDeviceHub;
 class CompositeEventFilter;
 class EventFilterChainDispatcher;
+class ResamplingDispatcher;
 class CursorListener;
 class TouchVisualizer;
 class CursorImages;
@@ -247,6 +251,7 @@ public:
      * configurable interfaces for modifying compositor
      *  @{ */
     virtual std::shared_ptr<compositor::CompositorReport> the_compositor_report();
+    virtual std::shared_ptr<compositor::FrameTimings> the_frame_timings();
     virtual std::shared_ptr<compositor::DisplayBufferCompositorFactory> the_display_buffer_compositor_factory();
     virtual std::shared_ptr<compositor::DisplayBufferCompositorFactory> wrap_display_buffer_compositor_factory(
         std::shared_ptr<compositor::DisplayBufferCompositorFactory> const& wrapped);
@@ -484,6 +489,16 @@ private:
 
     std::shared_ptr<scene::BroadcastingSessionEventSink> the_broadcasting_session_event_sink();
 
+    CachedPtr<compositor::FrameTimingRecorder> frame_timing_recorder;
+
+    std::shared_ptr<compositor::FrameTimingRecorder> the_frame_timing_recorder();
+
+    CachedPtr<input::ResamplingDispatcher> resampling_dispatcher;
+
+    /// Null unless input resampling is enabled
+    std::shared_ptr<input::ResamplingDispatcher> the_resampling_dispatcher();
+    std::shared_ptr<compositor::FrameDeadlineListener> the_frame_deadline_listener();
+
     auto report_factory(char const* report_opt) -> std::unique_ptr<report::ReportFactory>;
 
     CachedPtr<shell::detail::FrontendShell> frontend_shell;
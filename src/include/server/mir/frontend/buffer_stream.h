@@ -22,6 +22,7 @@
 #include <mir_toolkit/common.h>
 #include "mir/graphics/buffer_id.h"
 #include "mir/geometry/size.h"
+#include "mir/geometry/rectangles.h"
 #include <functional>
 #include <memory>
 
@@ -41,7 +42,16 @@ class BufferStream
 public:
     virtual ~BufferStream() = default;
 
-    virtual void submit_buffer(std::shared_ptr<graphics::Buffer> const& buffer) = 0;
+    /**
+     * Submit a new buffer for composition.
+     *
+     * \param [in] buffer  The new buffer
+     * \param [in] damage  The parts of buffer that differ from the previously
+     *                     submitted buffer, in buffer coordinates
+     */
+    virtual void submit_buffer(
+        std::shared_ptr<graphics::Buffer> const& buffer,
+        geometry::Rectangles const& damage) = 0;
 
     virtual void set_frame_posted_callback(
         std::function<void(geometry::Size const&)> const& callback) = 0;
@@ -55,6 +65,12 @@ public:
     //      side once we only support the NBS system.
     virtual void allow_framedropping(bool) = 0;
     virtual void set_scale(float scale) = 0;
+
+    /**
+     * Set the parts of the stream the client promises are opaque, in logical
+     * stream coordinates (those of stream_size()).
+     */
+    virtual void set_opaque_region(geometry::Rectangles const& region) = 0;
 protected:
     BufferStream() = default;
     BufferStream(BufferStream const&) = delete;
@@ -20,6 +20,8 @@
 #ifndef MIR_INPUT_INPUT_SCENE_H_
 #define MIR_INPUT_INPUT_SCENE_H_
 
+#include "mir/geometry/point.h"
+
 #include <memory>
 #include <functional>
 
@@ -44,6 +46,8 @@ public:
     virtual ~Scene() = default;
 
     virtual void for_each(std::function<void(std::shared_ptr<input::Surface> const&)> const& callback) = 0;
+    /// The topmost surface whose input area contains point, if any
+    virtual auto input_surface_at(geometry::Point point) -> std::shared_ptr<input::Surface> = 0;
 
     virtual void add_observer(std::shared_ptr<scene::Observer> const& observer) = 0;
     virtual void remove_observer(std::weak_ptr<scene::Observer> const& observer) = 0;
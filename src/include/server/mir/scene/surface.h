@@ -33,7 +33,7 @@ namespace mir
 namespace shell { class InputTargeter; }
 namespace geometry { struct Rectangle; }
 namespace graphics { class CursorImage; }
-namespace compositor { class BufferStream; }
+namespace compositor { class BufferStream; class FrameArena; }
 namespace scene
 {
 struct StreamInfo
@@ -65,6 +65,14 @@ public:
     virtual geometry::Size window_size() const = 0;
 
     virtual graphics::RenderableList generate_renderables(compositor::CompositorID id) const = 0; 
+    /**
+     * Append what generate_renderables(id) would return to renderables,
+     * allocating the renderables from arena.
+     */
+    virtual void append_renderables(
+        compositor::CompositorID id,
+        compositor::FrameArena& arena,
+        graphics::RenderableList& renderables) const = 0;
     virtual int buffers_ready_for_compositor(void const* compositor_id) const = 0;
 
     virtual MirWindowType type() const = 0;
@@ -87,6 +95,8 @@ public:
      * set_input_region({Rectangle{}}).
      */
     virtual void set_input_region(std::vector<geometry::Rectangle> const& region) = 0;
+    /// A rectangle containing every point input_area_contains() might accept (ignoring visibility)
+    virtual auto input_extents() const -> geometry::Rectangle = 0;
     /// Given value is the frame size of the window
     virtual void resize(geometry::Size const& window_size) = 0;
     virtual void set_transformation(glm::mat4 const& t) = 0;
@@ -52,6 +52,18 @@ std::experimental::optional<mg::EGLExtensions::PlatformBaseEXT> maybe_platform_b
         return {};
     }
 }
+
+std::experimental::optional<mg::EGLExtensions::ImageDmaBufImportModifiersEXT> maybe_dma_buf_modifiers_ext()
+{
+    try
+    {
+        return mg::EGLExtensions::ImageDmaBufImportModifiersEXT{};
+    }
+    catch (std::runtime_error const&)
+    {
+        return {};
+    }
+}
 }
 
 mg::EGLExtensions::EGLExtensions() :
@@ -69,7 +81,8 @@ mg::EGLExtensions::EGLExtensions() :
     glEGLImageTargetTexture2DOES{
         reinterpret_cast<PFNGLEGLIMAGETARGETTEXTURE2DOESPROC>(eglGetProcAddress("glEGLImageTargetTexture2DOES"))},
     wayland{maybe_wayland_ext()},
-    platform_base{maybe_platform_base_ext()}
+    platform_base{maybe_platform_base_ext()},
+    image_dma_buf_import_modifiers{maybe_dma_buf_modifiers_ext()}
 {
     if (!eglCreateImageKHR || !eglDestroyImageKHR)
         BOOST_THROW_EXCEPTION(std::runtime_error("EGL implementation doesn't support EGLImage"));
@@ -125,3 +138,37 @@ mg::EGLExtensions::PlatformBaseEXT::PlatformBaseEXT()
         BOOST_THROW_EXCEPTION((std::runtime_error{"EGL implementation doesn't support EGL_EXT_platform_base"}));
     }
 }
+
+mg::EGLExtensions::ImageDmaBufImportModifiersEXT::ImageDmaBufImportModifiersEXT()
+    : eglQueryDmaBufFormatsExt{
+        reinterpret_cast<PFNEGLQUERYDMABUFFORMATSEXTPROC>(eglGetProcAddress("eglQueryDmaBufFormatsEXT"))
+    },
+    eglQueryDmaBufModifiersExt{
+        reinterpret_cast<PFNEGLQUERYDMABUFMODIFIERSEXTPROC>(eglGetProcAddress("eglQueryDmaBufModifiersEXT"))
+    }
+{
+    if (!eglQueryDmaBufFormatsExt || !eglQueryDmaBufModifiersExt)
+    {
+        BOOST_THROW_EXCEPTION((std::runtime_error{"EGL implementation doesn't support EGL_EXT_image_dma_buf_import_modifiers"}));
+    }
+}
+
+mg::EGLExtensions::FenceSyncKHR::FenceSyncKHR()
+    : eglCreateSyncKHR{
+        reinterpret_cast<PFNEGLCREATESYNCKHRPROC>(eglGetProcAddress("eglCreateSyncKHR"))
+    },
+    eglDestroySyncKHR{
+        reinterpret_cast<PFNEGLDESTROYSYNCKHRPROC>(eglGetProcAddress("eglDestroySyncKHR"))
+    },
+    eglClientWaitSyncKHR{
+        reinterpret_cast<PFNEGLCLIENTWAITSYNCKHRPROC>(eglGetProcAddress("eglClientWaitSyncKHR"))
+    },
+    eglWaitSyncKHR{
+        reinterpret_cast<PFNEGLWAITSYNCKHRPROC>(eglGetProcAddress("eglWaitSyncKHR"))
+    }
+{
+    if (!eglCreateSyncKHR || !eglDestroySyncKHR || !eglClientWaitSyncKHR)
+    {
+        BOOST_THROW_EXCEPTION((std::runtime_error{"EGL implementation doesn't support EGL_KHR_fence_sync"}));
+    }
+}
@@ -48,10 +48,14 @@ char const* const mo::cursor_opt                  = "cursor";
 char const* const mo::fatal_except_opt            = "on-fatal-error-except";
 char const* const mo::debug_opt                   = "debug";
 char const* const mo::composite_delay_opt         = "composite-delay";
+char const* const mo::frame_timings_file_opt      = "frame-timings-file";
 char const* const mo::enable_key_repeat_opt       = "enable-key-repeat";
 char const* const mo::x11_display_opt             = "enable-x11";
 char const* const mo::wayland_extensions_opt      = "wayland-extensions";
 char const* const mo::enable_mirclient_opt        = "enable-mirclient";
+char const* const mo::hidden_surface_frame_rate_opt = "hidden-surface-frame-rate";
+char const* const mo::coalesce_pointer_motion_opt = "coalesce-pointer-motion";
+char const* const mo::input_resampling_opt      = "input-resampling";
 
 char const* const mo::off_opt_value = "off";
 char const* const mo::log_opt_value = "log";
@@ -182,6 +186,9 @@ mo::DefaultConfiguration::DefaultConfiguration(
             "frames from clients before compositing). Higher values result in "
             "lower latency but risk causing frame skipping. "
             "Default: A negative value means decide automatically.")
+        (frame_timings_file_opt, po::value<std::string>(),
+            "File to write the compositor's frame timing statistics to (as JSON) "
+            "whenever the server receives SIGUSR2")
         (offscreen_opt,
             "Render to offscreen buffers instead of the real outputs.")
         (touchspots_opt,
@@ -191,6 +198,16 @@ mo::DefaultConfiguration::DefaultConfiguration(
             "Cursor (mouse pointer) to use [{auto,null,software}]")
         (enable_key_repeat_opt, po::value<bool>()->default_value(true),
              "Enable server generated key repeat")
+        (hidden_surface_frame_rate_opt, po::value<double>()->default_value(1.0),
+            "How often (in Hz) to let Wayland clients the user can't see (because they are "
+            "occluded, minimised or not on any active output) draw a frame. "
+            "Zero stops them drawing until they can be seen again.")
+        (coalesce_pointer_motion_opt, po::value<bool>()->default_value(false),
+            "Merge the pointer motion sent to a Wayland client while it draws a frame, "
+            "and send it just before the client is told to draw the next one")
+        (input_resampling_opt, po::value<std::string>()->default_value(off_opt_value),
+            "Pass on the motion of touchscreens (or all pointing devices) once per "
+            "compositor frame, resampled to when the frame starts [{off,touchscreens,all}]")
         (fatal_except_opt, "On \"fatal error\" conditions [e.g. drivers behaving "
             "in unexpected ways] throw an exception (instead of a core dump)")
         (debug_opt, "Enable extra development debugging. "
@@ -19,17 +19,25 @@
 
 #include "buffer_from_wl_shm.h"
 #include "shm_buffer.h"
+#include "egl_context_executor.h"
 
 #include "mir/renderer/sw/pixel_source.h"
 #include "mir/executor.h"
 #include "mir/renderer/gl/context.h"
+#include "mir/graphics/egl_extensions.h"
 
 #define MIR_LOG_COMPONENT "wayland-gfx-helpers"
 #include "mir/log.h"
 
 #include <boost/throw_exception.hpp>
+#include <experimental/optional>
+#include <algorithm>
+#include <deque>
 #include <mutex>
+#include <condition_variable>
+#include <vector>
 #include <atomic>
+#include <cstring>
 
 #include <GLES2/gl2.h>
 #include <GLES2/gl2ext.h>
@@ -40,6 +48,7 @@
 
 namespace mg = mir::graphics;
 namespace mgc = mir::graphics::common;
+namespace geom = mir::geometry;
 
 namespace mir
 {
@@ -302,6 +311,392 @@ private:
     }
 };
 
+namespace
+{
+/// How uploads are fenced, which depends on what the EGL display supports
+struct UploadFencing
+{
+    std::experimental::optional<mg::EGLExtensions::FenceSyncKHR> fence_sync;
+    /// Whether a context can wait for a fence without blocking its thread
+    bool server_wait;
+};
+
+auto has_extension(EGLDisplay display, char const* extension) -> bool
+{
+    auto const extensions = eglQueryString(display, EGL_EXTENSIONS);
+    return extensions && strstr(extensions, extension);
+}
+
+auto fencing_for(EGLDisplay display) -> UploadFencing
+{
+    if (!has_extension(display, "EGL_KHR_fence_sync"))
+        return {{}, false};
+
+    try
+    {
+        mg::EGLExtensions::FenceSyncKHR fence_sync;
+        bool const server_wait = fence_sync.eglWaitSyncKHR && has_extension(display, "EGL_KHR_wait_sync");
+        return {fence_sync, server_wait};
+    }
+    catch (std::runtime_error const&)
+    {
+        return {{}, false};
+    }
+}
+}
+
+/**
+ * A texture reused by the SHM buffers successively committed to a surface
+ *
+ * Each buffer records the damage it was committed with. When a buffer is bound
+ * and the texture still holds an earlier buffer from that history only the
+ * damage since then is uploaded; otherwise the whole buffer is.
+ *
+ * Buffers are normally uploaded ahead of being bound, on the EGL delegate
+ * thread, so the compositor only has to wait on the upload's fence. That can
+ * leave the texture holding a later buffer than the one being bound; as the
+ * later buffer has been committed, that just shows it a frame early.
+ *
+ * Nothing writes to the texture while a compositor may still be sampling it:
+ * a bind() counts as drawing until the matching add_syncpoint(), which fences
+ * the draw, and every upload waits for both the drawing and the fences.
+ */
+class SharedShmTexture
+{
+public:
+    explicit SharedShmTexture(std::shared_ptr<mgc::EGLContextExecutor> egl_delegate)
+        : egl_delegate{std::move(egl_delegate)}
+    {
+    }
+
+    ~SharedShmTexture()
+    {
+        if (tex_id != 0 || upload_fence != EGL_NO_SYNC_KHR || !read_fences.empty())
+        {
+            // Any fences were made with fencing, so it has been set
+            egl_delegate->spawn(
+                [id = tex_id,
+                 fencing = fencing,
+                 display = fence_display,
+                 fence = upload_fence,
+                 read_fences = std::move(read_fences)]()
+                {
+                    if (fence != EGL_NO_SYNC_KHR)
+                        fencing->fence_sync->eglDestroySyncKHR(display, fence);
+                    for (auto const read_fence : read_fences)
+                        fencing->fence_sync->eglDestroySyncKHR(display, read_fence);
+                    if (id != 0)
+                        glDeleteTextures(1, &id);
+                });
+        }
+    }
+
+    /**
+     * Record that a buffer has been committed with damage
+     *
+     * \note This must be called in the order the buffers are committed
+     * \return The serial identifying the buffer to upload() and bind()
+     */
+    auto submitted(geom::Rectangles const& damage) -> std::uint64_t
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        auto const serial = ++last_serial;
+        history.push_back({serial, damage});
+        if (history.size() > max_history)
+            history.pop_front();
+        return serial;
+    }
+
+    /**
+     * Bring the texture up to date with the contents of buffer before it is bound
+     *
+     * The upload is fenced; a bind() from another context waits for the fence.
+     * upload_all and upload_damage are as for bind().
+     *
+     * \note This must be called with a current GL context
+     */
+    void upload(
+        std::uint64_t buffer,
+        geom::Size const& size,
+        MirPixelFormat format,
+        std::function<bool()> const& upload_all,
+        std::function<bool(geom::Rectangles const&)> const& upload_damage)
+    {
+        std::unique_lock<std::mutex> lock{mutex};
+
+        if (update(lock, buffer, size, format, upload_all, upload_damage))
+            fence_upload();
+    }
+
+    /**
+     * Bind the texture, bringing it up to date with the contents of buffer
+     *
+     * Either upload_all or upload_damage is called to do the upload (unless the
+     * texture is already up to date). They return false if the pixels were
+     * not available.
+     *
+     * \note This must be called with a current GL context, and followed by
+     *       add_syncpoint() once the draws using the texture have been issued
+     */
+    void bind(
+        std::uint64_t buffer,
+        geom::Size const& size,
+        MirPixelFormat format,
+        std::function<bool()> const& upload_all,
+        std::function<bool(geom::Rectangles const&)> const& upload_damage)
+    {
+        std::unique_lock<std::mutex> lock{mutex};
+
+        wait_for_upload();
+        if (update(lock, buffer, size, format, upload_all, upload_damage))
+        {
+            // Other compositors may bind the texture before this upload completes
+            fence_upload();
+        }
+        ++drawing;
+    }
+
+    /**
+     * Fence the draws issued since bind(), so the texture isn't written to
+     * before they've completed
+     *
+     * \note This must be called with the GL context bind() was called with
+     */
+    void add_syncpoint()
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        auto const& fencing = upload_fencing();
+        if (fencing.fence_sync)
+        {
+            discard_completed_reads();
+
+            fence_display = eglGetCurrentDisplay();
+            auto const fence = fencing.fence_sync->eglCreateSyncKHR(fence_display, EGL_SYNC_FENCE_KHR, nullptr);
+            if (fence != EGL_NO_SYNC_KHR)
+            {
+                // The fence won't signal unless it reaches the GPU
+                read_fences.push_back(fence);
+                glFlush();
+            }
+            else
+            {
+                glFinish();
+            }
+        }
+        else
+        {
+            glFinish();
+        }
+
+        if (drawing > 0)
+            --drawing;
+        drawn.notify_all();
+    }
+
+private:
+    // Buffers bound more than this many commits late are uploaded in full
+    static std::size_t const max_history = 8;
+
+    /// \note This must be called with a current EGL context
+    auto upload_fencing() -> UploadFencing const&
+    {
+        // There's only the one EGL display for all our contexts
+        if (!fencing)
+            fencing.emplace(fencing_for(eglGetCurrentDisplay()));
+        return fencing.value();
+    }
+
+    /// Binds the texture and uploads buffer if needed, returning whether it was
+    auto update(
+        std::unique_lock<std::mutex>& lock,
+        std::uint64_t buffer,
+        geom::Size const& size,
+        MirPixelFormat format,
+        std::function<bool()> const& upload_all,
+        std::function<bool(geom::Rectangles const&)> const& upload_damage) -> bool
+    {
+        bool const needs_initialisation = tex_id == 0;
+        if (needs_initialisation)
+        {
+            glGenTextures(1, &tex_id);
+        }
+        glBindTexture(GL_TEXTURE_2D, tex_id);
+        if (needs_initialisation)
+        {
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        }
+
+        bool const same_layout = size == contents_size && format == contents_format;
+        if (contents && contents.value() >= buffer && same_layout)
+            return false;
+
+        wait_for_reads(lock);
+
+        bool uploaded;
+        if (contents && contents.value() < buffer && same_layout)
+        {
+            if (auto const damage = damage_between(contents.value(), buffer))
+                uploaded = upload_damage(damage.value());
+            else
+                uploaded = upload_all();
+        }
+        else
+        {
+            uploaded = upload_all();
+        }
+
+        if (uploaded)
+        {
+            contents = buffer;
+            contents_size = size;
+            contents_format = format;
+        }
+        else
+        {
+            contents = std::experimental::nullopt;
+        }
+        return true;
+    }
+
+    auto damage_between(std::uint64_t previous, std::uint64_t current) const
+        -> std::experimental::optional<geom::Rectangles>
+    {
+        // Without every commit since previous we can't know everything that changed
+        if (history.empty() || history.front().first > previous + 1)
+            return {};
+
+        geom::Rectangles damage;
+        for (auto const& entry : history)
+        {
+            if (entry.first > previous && entry.first <= current)
+            {
+                for (auto const& rect : entry.second)
+                    damage.add(rect);
+            }
+        }
+        return damage;
+    }
+
+    void fence_upload()
+    {
+        auto const& fencing = upload_fencing();
+
+        discard_fence();
+        if (fencing.fence_sync)
+        {
+            fence_display = eglGetCurrentDisplay();
+            upload_fence = fencing.fence_sync->eglCreateSyncKHR(fence_display, EGL_SYNC_FENCE_KHR, nullptr);
+        }
+
+        if (upload_fence != EGL_NO_SYNC_KHR)
+        {
+            // The fence won't signal unless it reaches the GPU
+            glFlush();
+        }
+        else
+        {
+            glFinish();
+        }
+    }
+
+    void wait_for_upload()
+    {
+        if (upload_fence == EGL_NO_SYNC_KHR)
+            return;
+
+        auto const& fence_sync = upload_fencing().fence_sync.value();
+        if (fence_sync.eglClientWaitSyncKHR(fence_display, upload_fence, 0, 0) == EGL_CONDITION_SATISFIED_KHR)
+        {
+            // The upload is complete, so nobody else needs to wait for it either
+            discard_fence();
+        }
+        else if (upload_fencing().server_wait)
+        {
+            // Other compositors might still need to wait, so keep the fence
+            fence_sync.eglWaitSyncKHR(fence_display, upload_fence, 0);
+        }
+        else
+        {
+            fence_sync.eglClientWaitSyncKHR(fence_display, upload_fence, 0, EGL_FOREVER_KHR);
+            discard_fence();
+        }
+    }
+
+    /// Waits until the draws using the texture have been issued, and for them to complete
+    void wait_for_reads(std::unique_lock<std::mutex>& lock)
+    {
+        drawn.wait(lock, [this] { return drawing == 0; });
+
+        if (read_fences.empty())
+            return;
+
+        auto const& fencing = upload_fencing();
+        for (auto const fence : read_fences)
+        {
+            if (fencing.server_wait)
+            {
+                fencing.fence_sync->eglWaitSyncKHR(fence_display, fence, 0);
+            }
+            else
+            {
+                fencing.fence_sync->eglClientWaitSyncKHR(fence_display, fence, 0, EGL_FOREVER_KHR);
+            }
+            // A fence still being waited for is only deleted once it signals
+            fencing.fence_sync->eglDestroySyncKHR(fence_display, fence);
+        }
+        read_fences.clear();
+    }
+
+    /// Forgets the fences of draws that have completed, so they don't pile up between uploads
+    void discard_completed_reads()
+    {
+        auto const& fence_sync = upload_fencing().fence_sync.value();
+        read_fences.erase(
+            std::remove_if(
+                read_fences.begin(),
+                read_fences.end(),
+                [&](EGLSyncKHR fence)
+                {
+                    if (fence_sync.eglClientWaitSyncKHR(fence_display, fence, 0, 0) != EGL_CONDITION_SATISFIED_KHR)
+                        return false;
+                    fence_sync.eglDestroySyncKHR(fence_display, fence);
+                    return true;
+                }),
+            read_fences.end());
+    }
+
+    void discard_fence()
+    {
+        if (upload_fence != EGL_NO_SYNC_KHR)
+        {
+            upload_fencing().fence_sync->eglDestroySyncKHR(fence_display, upload_fence);
+            upload_fence = EGL_NO_SYNC_KHR;
+        }
+    }
+
+    std::shared_ptr<mgc::EGLContextExecutor> const egl_delegate;
+
+    std::mutex mutex;
+    GLuint tex_id{0};
+    std::uint64_t last_serial{0};
+    std::experimental::optional<std::uint64_t> contents;
+    geom::Size contents_size;
+    MirPixelFormat contents_format{mir_pixel_format_invalid};
+    std::deque<std::pair<std::uint64_t, geom::Rectangles>> history;
+    EGLDisplay fence_display{EGL_NO_DISPLAY};
+    EGLSyncKHR upload_fence{EGL_NO_SYNC_KHR};
+    /// Binds whose draws haven't been fenced yet
+    int drawing{0};
+    std::condition_variable drawn;
+    /// Fences for draws that might still be sampling the texture
+    std::vector<EGLSyncKHR> read_fences;
+    std::experimental::optional<UploadFencing> fencing;
+};
+
 class WlShmBuffer :
     public mg::common::ShmBuffer,
     public mir::renderer::software::PixelSource
@@ -310,37 +705,64 @@ public:
     WlShmBuffer(
         SharedWlBuffer buffer,
         std::shared_ptr<mgc::EGLContextExecutor> egl_delegate,
+        std::shared_ptr<SharedShmTexture> texture,
         mir::geometry::Size const& size,
         mir::geometry::Stride stride,
         MirPixelFormat format,
+        geom::Rectangles const& damage,
         std::function<void()>&& on_consumed)
         : ShmBuffer(size, format, std::move(egl_delegate)),
           on_consumed{std::move(on_consumed)},
           buffer{std::move(buffer)},
+          texture{std::move(texture)},
+          serial{this->texture->submitted(damage)},
           stride_{stride}
     {
     }
 
+    auto shared_texture() const -> std::shared_ptr<SharedShmTexture> const&
+    {
+        return texture;
+    }
+
     std::shared_ptr<mg::NativeBuffer> native_buffer_handle() const override
     {
         BOOST_THROW_EXCEPTION((std::logic_error{"Attempt to get mirclient handle for Wayland Shm buffer"}));
     }
 
+    /**
+     * Upload our contents to the shared texture ahead of bind()
+     *
+     * \note This must be called with a current GL context
+     */
+    void upload()
+    {
+        texture->upload(
+            serial,
+            size(),
+            pixel_format(),
+            [this]() { return upload_all(); },
+            [this](geom::Rectangles const& damage) { return upload_damage(damage); });
+    }
+
     void bind() override
     {
-        ShmBuffer::bind();
+        // We don't use ShmBuffer's texture, but one shared with the other buffers of our surface
+        texture->bind(
+            serial,
+            size(),
+            pixel_format(),
+            [this]() { return upload_all(); },
+            [this](geom::Rectangles const& damage) { return upload_damage(damage); });
+
         std::lock_guard<std::mutex> lock{consumption_mutex};
-        if (!uploaded)
-        {
-            read_internal(
-                [this](unsigned char const* pixels)
-                {
-                    upload_to_texture(pixels, stride());
-                });
-            on_consumed();
-            on_consumed = [](){};
-            uploaded = true;
-        }
+        on_consumed();
+        on_consumed = [](){};
+    }
+
+    void add_syncpoint() override
+    {
+        texture->add_syncpoint();
     }
 
     void write(unsigned char const* /*pixels*/, size_t /*size*/) override
@@ -365,7 +787,25 @@ public:
     }
 
 private:
-    void read_internal(std::function<void(unsigned char const*)> const& do_with_pixels)
+    auto upload_all() -> bool
+    {
+        return read_internal(
+            [this](unsigned char const* pixels)
+            {
+                upload_to_texture(pixels, stride());
+            });
+    }
+
+    auto upload_damage(geom::Rectangles const& damage) -> bool
+    {
+        return read_internal(
+            [this, &damage](unsigned char const* pixels)
+            {
+                upload_damage_to_texture(pixels, stride(), damage);
+            });
+    }
+
+    auto read_internal(std::function<void(unsigned char const*)> const& do_with_pixels) -> bool
     {
         if (auto const locked_buffer = buffer.lock())
         {
@@ -374,17 +814,20 @@ private:
             do_with_pixels(
                 static_cast<unsigned char*>(wl_shm_buffer_get_data(shm_buffer)));
             wl_shm_buffer_end_access(shm_buffer);
+            return true;
         }
         else
         {
             mir::log_debug("Wayland buffer destroyed before use; rendering will be incomplete");
+            return false;
         }
     }
 
     std::mutex consumption_mutex;
-    bool uploaded{false};
     std::function<void()> on_consumed;
     SharedWlBuffer const buffer;
+    std::shared_ptr<SharedShmTexture> const texture;
+    std::uint64_t const serial;
     mir::geometry::Stride const stride_;
 };
 
@@ -392,6 +835,8 @@ auto mg::wayland::buffer_from_wl_shm(
     wl_resource* buffer,
     std::shared_ptr<Executor> executor,
     std::shared_ptr<common::EGLContextExecutor> egl_delegate,
+    std::shared_ptr<Buffer> const& previous,
+    geometry::Rectangles const& damage,
     std::function<void()>&& on_consumed) -> std::shared_ptr<Buffer>
 {
     auto const shm_buffer = wl_shm_buffer_get(buffer);
@@ -399,14 +844,33 @@ auto mg::wayland::buffer_from_wl_shm(
     {
         BOOST_THROW_EXCEPTION((std::logic_error{"Attempt to import a non-SHM buffer as a SHM buffer"}));
     }
-    return std::make_shared<WlShmBuffer>(
+
+    std::shared_ptr<SharedShmTexture> texture;
+    if (auto const previous_shm = std::dynamic_pointer_cast<WlShmBuffer>(previous))
+        texture = previous_shm->shared_texture();
+    else
+        texture = std::make_shared<SharedShmTexture>(egl_delegate);
+
+    auto const mir_buffer = std::make_shared<WlShmBuffer>(
         SharedWlBuffer{buffer, std::move(executor)},
-        std::move(egl_delegate),
+        egl_delegate,
+        texture,
         mir::geometry::Size{
             wl_shm_buffer_get_width(shm_buffer),
             wl_shm_buffer_get_height(shm_buffer)
         },
         mir::geometry::Stride{wl_shm_buffer_get_stride(shm_buffer)},
         wl_format_to_mir_format(wl_shm_buffer_get_format(shm_buffer)),
+        damage,
         std::move(on_consumed));
+
+    // Start the upload now, so that the compositor (usually) only has to bind the texture
+    egl_delegate->spawn(
+        [weak_buffer = std::weak_ptr<WlShmBuffer>{mir_buffer}]()
+        {
+            if (auto const buffer = weak_buffer.lock())
+                buffer->upload();
+        });
+
+    return mir_buffer;
 }
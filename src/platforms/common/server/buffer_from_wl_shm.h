@@ -20,6 +20,8 @@
 #ifndef MIR_GRAPHICS_GL_WAYLAND_SHM_PROVIDER_H_
 #define MIR_GRAPHICS_GL_WAYLAND_SHM_PROVIDER_H_
 
+#include "mir/geometry/rectangles.h"
+
 #include <memory>
 #include <functional>
 
@@ -50,7 +52,12 @@ namespace wayland
  *
  * \param buffer        [in]    The Wayland SHM buffer to import
  * \param executor      [in]    An Executor that will defer work to the Wayland event loop
- * \param egl_delegate  [in]    An EGL-context-thread delegator
+ * \param egl_delegate  [in]    An EGL-context-thread delegator, which also uploads the
+ *                              buffer ahead of the compositor binding it
+ * \param previous      [in]    The buffer previously imported for the same surface, if any.
+ *                              SHM buffers of a surface share a texture, so binding one
+ *                              only uploads what changed since the texture was last updated.
+ * \param damage        [in]    The parts of buffer that changed since previous, in buffer coordinates
  * \param on_consumed   [in]    Closure to call when the compositor has consumed this buffer
  * \return                      An mg::Buffer supporting being rendered from in GL and read by the CPU.
  */
@@ -58,6 +65,8 @@ auto buffer_from_wl_shm(
     wl_resource* buffer,
     std::shared_ptr<Executor> executor,
     std::shared_ptr<common::EGLContextExecutor> egl_delegate,
+    std::shared_ptr<Buffer> const& previous,
+    geometry::Rectangles const& damage,
     std::function<void()>&& on_consumed) -> std::shared_ptr<Buffer>;
 }
 }
@@ -52,25 +52,30 @@ void mgc::EGLContextExecutor::process_loop(mgc::EGLContextExecutor* const me)
 {
     me->ctx->make_current();
 
+    // Swapped with the queue, so that we can run work without holding the lock
+    std::vector<std::function<void()>> running;
+
     std::unique_lock<std::mutex> lock{me->mutex};
-    while (!me->shutdown_requested)
+    for (;;)
     {
-        for (auto& work : me->work_queue)
+        me->new_work.wait(lock, [me]() { return me->shutdown_requested || !me->work_queue.empty(); });
+
+        // Drain the work-queue before shutting down
+        if (me->work_queue.empty())
+            break;
+
+        std::swap(running, me->work_queue);
+        lock.unlock();
+
+        for (auto& work : running)
         {
             work();
         }
-        me->work_queue.clear();
+        // …and ensure any functor cleanup happens with the EGL context current, too.
+        running.clear();
 
-        me->new_work.wait(lock);
-    }
-
-    // Drain the work-queue
-    for (auto& work : me->work_queue)
-    {
-        work();
+        lock.lock();
     }
-    // …and ensure any functor cleanup happens with the EGL context current, too.
-    me->work_queue.clear();
 
     me->ctx->release_current();
 }
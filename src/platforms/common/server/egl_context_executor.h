@@ -50,6 +50,9 @@ public:
 
     /**
      * Run a run a function on a thread with a current EGL context
+     *
+     * Work is run in the order it is spawned, and without holding any lock, so
+     * it may itself spawn more work (which is run after it).
      */
     void spawn(std::function<void()>&& functor) override;
 private:
@@ -0,0 +1,736 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "linux_dmabuf.h"
+#include "wayland_wrapper.h"
+#include "scanout_source.h"
+
+#include "mir/graphics/egl_extensions.h"
+#include "mir/graphics/egl_error.h"
+#include "mir/graphics/buffer_basic.h"
+#include "mir/graphics/texture.h"
+#include "mir/graphics/program_factory.h"
+#include "mir/graphics/program.h"
+#include "mir/renderer/gl/context.h"
+#include "mir/executor.h"
+
+#include <boost/throw_exception.hpp>
+
+#include <GLES2/gl2.h>
+#include <drm_fourcc.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <experimental/optional>
+#include <mutex>
+#include <stdexcept>
+
+#define MIR_LOG_COMPONENT "linux-dmabuf"
+#include "mir/log.h"
+
+namespace mg = mir::graphics;
+namespace mgc = mir::graphics::common;
+namespace mw = mir::wayland;
+namespace geom = mir::geometry;
+
+namespace mir
+{
+namespace wayland
+{
+extern struct wl_interface const wl_buffer_interface_data;
+}
+}
+
+namespace
+{
+// EGL_EXT_image_dma_buf_import has no more plane attributes than this
+std::size_t const max_planes = 4;
+
+auto display_supports(EGLDisplay dpy, char const* extension) -> bool
+{
+    auto const extensions = eglQueryString(dpy, EGL_EXTENSIONS);
+    return extensions && strstr(extensions, extension);
+}
+
+/// Whether the format is one GL_TEXTURE_2D can sample without knowing its layout
+auto is_rgb(uint32_t format) -> bool
+{
+    switch (format)
+    {
+    case DRM_FORMAT_XRGB8888:
+    case DRM_FORMAT_ARGB8888:
+    case DRM_FORMAT_XBGR8888:
+    case DRM_FORMAT_ABGR8888:
+    case DRM_FORMAT_RGBX8888:
+    case DRM_FORMAT_RGBA8888:
+    case DRM_FORMAT_BGRX8888:
+    case DRM_FORMAT_BGRA8888:
+    case DRM_FORMAT_XRGB2101010:
+    case DRM_FORMAT_ARGB2101010:
+    case DRM_FORMAT_XBGR2101010:
+    case DRM_FORMAT_ABGR2101010:
+    case DRM_FORMAT_RGB888:
+    case DRM_FORMAT_BGR888:
+    case DRM_FORMAT_RGB565:
+    case DRM_FORMAT_BGR565:
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+/// The formats, and the modifiers of each, that the EGL display can import for sampling
+class DmaBufFormats
+{
+public:
+    struct Format
+    {
+        uint32_t format;
+        std::vector<uint64_t> modifiers;    ///< Empty if only the implicit layout is known
+    };
+
+    DmaBufFormats(EGLDisplay dpy, mg::EGLExtensions const& extensions)
+        : formats{query_formats(dpy, extensions)}
+    {
+    }
+
+    auto begin() const { return formats.begin(); }
+    auto end() const { return formats.end(); }
+
+    auto supports(uint32_t format) const -> bool
+    {
+        return std::any_of(begin(), end(), [format](Format const& f) { return f.format == format; });
+    }
+
+private:
+    static auto query_formats(EGLDisplay dpy, mg::EGLExtensions const& extensions) -> std::vector<Format>
+    {
+        if (!display_supports(dpy, "EGL_EXT_image_dma_buf_import"))
+        {
+            BOOST_THROW_EXCEPTION((std::runtime_error{"EGL display doesn't support EGL_EXT_image_dma_buf_import"}));
+        }
+
+        if (!extensions.image_dma_buf_import_modifiers || !display_supports(dpy, "EGL_EXT_image_dma_buf_import_modifiers"))
+        {
+            // Every driver that can import dmabufs can import these
+            return {{DRM_FORMAT_ARGB8888, {}}, {DRM_FORMAT_XRGB8888, {}}};
+        }
+
+        auto const& ext = *extensions.image_dma_buf_import_modifiers;
+
+        EGLint format_count;
+        if (ext.eglQueryDmaBufFormatsExt(dpy, 0, nullptr, &format_count) != EGL_TRUE)
+        {
+            BOOST_THROW_EXCEPTION(mg::egl_error("Failed to query dmabuf formats"));
+        }
+        std::vector<EGLint> egl_formats(format_count);
+        if (ext.eglQueryDmaBufFormatsExt(dpy, format_count, egl_formats.data(), &format_count) != EGL_TRUE)
+        {
+            BOOST_THROW_EXCEPTION(mg::egl_error("Failed to query dmabuf formats"));
+        }
+        egl_formats.resize(format_count);
+
+        std::vector<Format> result;
+        for (auto const format : egl_formats)
+        {
+            EGLint modifier_count;
+            if (ext.eglQueryDmaBufModifiersExt(dpy, format, 0, nullptr, nullptr, &modifier_count) != EGL_TRUE)
+            {
+                BOOST_THROW_EXCEPTION(mg::egl_error("Failed to query dmabuf modifiers"));
+            }
+            std::vector<khronos_uint64_t> modifiers(modifier_count);
+            std::vector<EGLBoolean> external_only(modifier_count);
+            if (ext.eglQueryDmaBufModifiersExt(
+                dpy, format, modifier_count, modifiers.data(), external_only.data(), &modifier_count) != EGL_TRUE)
+            {
+                BOOST_THROW_EXCEPTION(mg::egl_error("Failed to query dmabuf modifiers"));
+            }
+
+            if (modifier_count == 0)
+            {
+                // With no modifiers there's no external_only to go by, and YUV
+                // formats generally need GL_TEXTURE_EXTERNAL_OES
+                if (is_rgb(format))
+                    result.push_back({static_cast<uint32_t>(format), {}});
+                continue;
+            }
+
+            // We sample with GL_TEXTURE_2D, so layouts that need GL_TEXTURE_EXTERNAL_OES are no use
+            Format supported{static_cast<uint32_t>(format), {}};
+            for (EGLint i = 0; i != modifier_count; ++i)
+            {
+                if (!external_only[i])
+                    supported.modifiers.push_back(modifiers[i]);
+            }
+            if (!supported.modifiers.empty())
+                result.push_back(std::move(supported));
+        }
+
+        return result;
+    }
+
+    std::vector<Format> const formats;
+};
+
+/// A client buffer, imported for sampling and, if possible, for scanout
+class DmaBufImage
+{
+public:
+    DmaBufImage(
+        EGLDisplay dpy,
+        std::shared_ptr<mg::EGLExtensions> const& extensions,
+        mgc::DmaBufBuffer&& descriptor,
+        mgc::LinuxDmaBufUnstable::ScanoutImporter const& import_for_scanout)
+        : dpy{dpy},
+          extensions{extensions},
+          descriptor{std::move(descriptor)},
+          image{import(dpy, *extensions, this->descriptor)},
+          native{import_for_scanout ? import_for_scanout(this->descriptor) : nullptr}
+    {
+    }
+
+    ~DmaBufImage()
+    {
+        extensions->eglDestroyImageKHR(dpy, image);
+    }
+
+    EGLDisplay const dpy;
+    std::shared_ptr<mg::EGLExtensions> const extensions;
+    mgc::DmaBufBuffer const descriptor;
+    EGLImageKHR const image;
+    std::shared_ptr<mg::NativeBuffer> const native;
+
+private:
+    static auto import(EGLDisplay dpy, mg::EGLExtensions const& extensions, mgc::DmaBufBuffer const& descriptor)
+        -> EGLImageKHR
+    {
+        static std::array<std::array<EGLint, 5>, max_planes> const plane_attribs{{
+            {{EGL_DMA_BUF_PLANE0_FD_EXT, EGL_DMA_BUF_PLANE0_OFFSET_EXT, EGL_DMA_BUF_PLANE0_PITCH_EXT,
+              EGL_DMA_BUF_PLANE0_MODIFIER_LO_EXT, EGL_DMA_BUF_PLANE0_MODIFIER_HI_EXT}},
+            {{EGL_DMA_BUF_PLANE1_FD_EXT, EGL_DMA_BUF_PLANE1_OFFSET_EXT, EGL_DMA_BUF_PLANE1_PITCH_EXT,
+              EGL_DMA_BUF_PLANE1_MODIFIER_LO_EXT, EGL_DMA_BUF_PLANE1_MODIFIER_HI_EXT}},
+            {{EGL_DMA_BUF_PLANE2_FD_EXT, EGL_DMA_BUF_PLANE2_OFFSET_EXT, EGL_DMA_BUF_PLANE2_PITCH_EXT,
+              EGL_DMA_BUF_PLANE2_MODIFIER_LO_EXT, EGL_DMA_BUF_PLANE2_MODIFIER_HI_EXT}},
+            {{EGL_DMA_BUF_PLANE3_FD_EXT, EGL_DMA_BUF_PLANE3_OFFSET_EXT, EGL_DMA_BUF_PLANE3_PITCH_EXT,
+              EGL_DMA_BUF_PLANE3_MODIFIER_LO_EXT, EGL_DMA_BUF_PLANE3_MODIFIER_HI_EXT}}}};
+
+        std::vector<EGLint> attribs{
+            EGL_WIDTH, descriptor.size.width.as_int(),
+            EGL_HEIGHT, descriptor.size.height.as_int(),
+            EGL_LINUX_DRM_FOURCC_EXT, static_cast<EGLint>(descriptor.format)};
+
+        for (std::size_t i = 0; i != descriptor.planes.size(); ++i)
+        {
+            auto const& plane = descriptor.planes[i];
+            auto const& names = plane_attribs[i];
+            attribs.insert(attribs.end(), {
+                names[0], plane.dma_buf,
+                names[1], static_cast<EGLint>(plane.offset),
+                names[2], static_cast<EGLint>(plane.stride)});
+
+            if (descriptor.modifier != DRM_FORMAT_MOD_INVALID)
+            {
+                attribs.insert(attribs.end(), {
+                    names[3], static_cast<EGLint>(descriptor.modifier & 0xffffffff),
+                    names[4], static_cast<EGLint>(descriptor.modifier >> 32)});
+            }
+        }
+        attribs.push_back(EGL_NONE);
+
+        auto const image = extensions.eglCreateImageKHR(
+            dpy,
+            EGL_NO_CONTEXT,
+            EGL_LINUX_DMA_BUF_EXT,
+            static_cast<EGLClientBuffer>(nullptr),
+            attribs.data());
+
+        if (image == EGL_NO_IMAGE_KHR)
+            BOOST_THROW_EXCEPTION(mg::egl_error("Failed to import dmabuf"));
+
+        return image;
+    }
+};
+
+/// The wl_buffer of a client buffer
+class DmaBufWlBuffer : public mw::Buffer
+{
+public:
+    DmaBufWlBuffer(wl_resource* resource, std::shared_ptr<DmaBufImage const> const& image)
+        : Buffer{resource, Version<1>()},
+          image{image}
+    {
+    }
+
+    static auto from(wl_resource* buffer) -> DmaBufWlBuffer*
+    {
+        if (!mw::Buffer::is_instance(buffer))
+            return nullptr;
+
+        return dynamic_cast<DmaBufWlBuffer*>(mw::Buffer::from(buffer));
+    }
+
+    std::shared_ptr<DmaBufImage const> const image;
+
+private:
+    void destroy() override
+    {
+        destroy_wayland_object();
+    }
+};
+
+GLuint get_tex_id()
+{
+    GLuint tex;
+    glGenTextures(1, &tex);
+    return tex;
+}
+
+auto has_alpha(uint32_t format) -> bool
+{
+    switch (format)
+    {
+    case DRM_FORMAT_ARGB8888:
+    case DRM_FORMAT_ABGR8888:
+    case DRM_FORMAT_RGBA8888:
+    case DRM_FORMAT_BGRA8888:
+    case DRM_FORMAT_ARGB2101010:
+    case DRM_FORMAT_ABGR2101010:
+    case DRM_FORMAT_RGBA1010102:
+    case DRM_FORMAT_BGRA1010102:
+    case DRM_FORMAT_ARGB4444:
+    case DRM_FORMAT_ABGR4444:
+    case DRM_FORMAT_RGBA4444:
+    case DRM_FORMAT_BGRA4444:
+    case DRM_FORMAT_ARGB1555:
+    case DRM_FORMAT_ABGR1555:
+    case DRM_FORMAT_RGBA5551:
+    case DRM_FORMAT_BGRA5551:
+    case DRM_FORMAT_AYUV:
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+class DmaBufTexBuffer :
+    public mg::BufferBasic,
+    public mg::NativeBufferBase,
+    public mgc::ScanoutSource,
+    public mg::gl::Texture
+{
+public:
+    // Note: Must be called with a current EGL context
+    DmaBufTexBuffer(
+        std::shared_ptr<DmaBufImage const> const& image,
+        std::shared_ptr<mir::renderer::gl::Context> const& ctx,
+        std::function<void()>&& on_consumed,
+        std::function<void()>&& on_release,
+        std::shared_ptr<mir::Executor> const& wayland_executor)
+        : image{image},
+          ctx{ctx},
+          tex{get_tex_id()},
+          on_consumed{std::move(on_consumed)},
+          on_release{std::move(on_release)},
+          wayland_executor{wayland_executor}
+    {
+        glBindTexture(GL_TEXTURE_2D, tex);
+        image->extensions->glEGLImageTargetTexture2DOES(GL_TEXTURE_2D, image->image);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+
+    ~DmaBufTexBuffer()
+    {
+        wayland_executor->spawn(
+            [context = ctx, tex = tex]()
+            {
+              context->make_current();
+
+              glDeleteTextures(1, &tex);
+
+              context->release_current();
+            });
+
+        on_release();
+    }
+
+    std::shared_ptr<mir::graphics::NativeBuffer> native_buffer_handle() const override
+    {
+        return image->native;
+    }
+
+    std::shared_ptr<mir::graphics::NativeBuffer> scanout_buffer() const override
+    {
+        return image->native;
+    }
+
+    mir::geometry::Size size() const override
+    {
+        return image->descriptor.size;
+    }
+
+    MirPixelFormat pixel_format() const override
+    {
+        // As with wl_drm buffers, the only thing anyone uses this for is whether there's an alpha channel
+        return has_alpha(image->descriptor.format) ? mir_pixel_format_argb_8888 : mir_pixel_format_xrgb_8888;
+    }
+
+    NativeBufferBase* native_buffer_base() override
+    {
+        return this;
+    }
+
+    mir::graphics::gl::Program const& shader(mir::graphics::gl::ProgramFactory& cache) const override
+    {
+        static int argb_shader{0};
+        return cache.compile_fragment_shader(
+            &argb_shader,
+            "",
+            "uniform sampler2D tex;\n"
+            "vec4 sample_to_rgba(in vec2 texcoord)\n"
+            "{\n"
+            "    return texture2D(tex, texcoord);\n"
+            "}\n");
+    }
+
+    Layout layout() const override
+    {
+        return image->descriptor.flags & mw::LinuxBufferParamsV1::Flags::y_invert ?
+            Layout::GL :
+            Layout::TopRowFirst;
+    }
+
+    void bind() override
+    {
+        glBindTexture(GL_TEXTURE_2D, tex);
+
+        std::lock_guard<decltype(consumed_mutex)> lock(consumed_mutex);
+        on_consumed();
+        on_consumed = [](){};
+    }
+
+    void add_syncpoint() override
+    {
+    }
+
+private:
+    std::shared_ptr<DmaBufImage const> const image;
+    std::shared_ptr<mir::renderer::gl::Context> const ctx;
+    GLuint const tex;
+
+    std::mutex consumed_mutex;
+    std::function<void()> on_consumed;
+    std::function<void()> const on_release;
+
+    std::shared_ptr<mir::Executor> const wayland_executor;
+};
+}
+
+namespace mir
+{
+namespace graphics
+{
+namespace common
+{
+class DmaBufImporter
+{
+public:
+    DmaBufImporter(
+        EGLDisplay dpy,
+        std::shared_ptr<EGLExtensions> const& extensions,
+        LinuxDmaBufUnstable::ScanoutImporter const& import_for_scanout)
+        : dpy{dpy},
+          extensions{extensions},
+          import_for_scanout{import_for_scanout},
+          formats{dpy, *extensions}
+    {
+    }
+
+    auto import(DmaBufBuffer&& descriptor) const -> std::shared_ptr<DmaBufImage const>
+    {
+        return std::make_shared<DmaBufImage>(dpy, extensions, std::move(descriptor), import_for_scanout);
+    }
+
+    EGLDisplay const dpy;
+    std::shared_ptr<EGLExtensions> const extensions;
+    LinuxDmaBufUnstable::ScanoutImporter const import_for_scanout;
+    DmaBufFormats const formats;
+};
+}
+}
+}
+
+namespace
+{
+class LinuxDmaBufParams : public mw::LinuxBufferParamsV1
+{
+public:
+    LinuxDmaBufParams(wl_resource* new_resource, std::shared_ptr<mgc::DmaBufImporter const> const& importer)
+        : LinuxBufferParamsV1{new_resource, Version<3>()},
+          importer{importer},
+          used{false},
+          modifier{DRM_FORMAT_MOD_INVALID}
+    {
+    }
+
+private:
+    void destroy() override
+    {
+        destroy_wayland_object();
+    }
+
+    void add(
+        mir::Fd fd,
+        uint32_t plane_idx,
+        uint32_t offset,
+        uint32_t stride,
+        uint32_t modifier_hi,
+        uint32_t modifier_lo) override
+    {
+        if (used)
+        {
+            wl_resource_post_error(resource, Error::already_used, "Params already used to create a buffer");
+            return;
+        }
+        if (plane_idx >= max_planes)
+        {
+            wl_resource_post_error(resource, Error::plane_idx, "Plane index %u out of bounds", plane_idx);
+            return;
+        }
+        if (planes[plane_idx])
+        {
+            wl_resource_post_error(resource, Error::plane_set, "Plane %u already set", plane_idx);
+            return;
+        }
+
+        auto const plane_modifier = (static_cast<uint64_t>(modifier_hi) << 32) | modifier_lo;
+        if (std::any_of(planes.begin(), planes.end(), [](auto const& plane) { return !!plane; }) &&
+            plane_modifier != modifier)
+        {
+            wl_resource_post_error(resource, Error::invalid_format, "All planes must have the same modifier");
+            return;
+        }
+
+        modifier = plane_modifier;
+        planes[plane_idx] = mgc::DmaBufPlane{fd, offset, stride};
+    }
+
+    void create(int32_t width, int32_t height, uint32_t format, uint32_t flags) override
+    {
+        if (!validate(width, height, format))
+            return;
+
+        if (auto const image = import(width, height, format, flags))
+        {
+            auto const buffer = wl_resource_create(client, &mw::wl_buffer_interface_data, 1, 0);
+            if (!buffer)
+            {
+                wl_client_post_no_memory(client);
+                return;
+            }
+            new DmaBufWlBuffer{buffer, image};
+            send_created_event(buffer);
+        }
+        else
+        {
+            send_failed_event();
+        }
+    }
+
+    void create_immed(wl_resource* buffer_id, int32_t width, int32_t height, uint32_t format, uint32_t flags) override
+    {
+        if (!validate(width, height, format))
+            return;
+
+        if (auto const image = import(width, height, format, flags))
+        {
+            new DmaBufWlBuffer{buffer_id, image};
+        }
+        else
+        {
+            wl_resource_post_error(resource, Error::invalid_wl_buffer, "Failed to import dmabuf");
+        }
+    }
+
+    /// Checks for client errors, and sends the protocol error if there is one
+    auto validate(int32_t width, int32_t height, uint32_t format) -> bool
+    {
+        if (used)
+        {
+            wl_resource_post_error(resource, Error::already_used, "Params already used to create a buffer");
+            return false;
+        }
+        used = true;
+
+        if (width < 1 || height < 1)
+        {
+            wl_resource_post_error(resource, Error::invalid_dimensions, "Invalid size %ix%i", width, height);
+            return false;
+        }
+
+        if (!importer->formats.supports(format))
+        {
+            wl_resource_post_error(resource, Error::invalid_format, "Format 0x%x not supported", format);
+            return false;
+        }
+
+        auto const unset = std::find_if(planes.begin(), planes.end(), [](auto const& plane) { return !plane; });
+        if (unset == planes.begin() ||
+            std::any_of(unset, planes.end(), [](auto const& plane) { return !!plane; }))
+        {
+            wl_resource_post_error(resource, Error::incomplete, "Planes must be set from 0 without gaps");
+            return false;
+        }
+
+        for (auto plane = planes.begin(); plane != unset; ++plane)
+        {
+            // Not every dmabuf can tell us its size; the ones that can we check
+            auto const dma_buf_size = lseek(plane->value().dma_buf, 0, SEEK_END);
+            if (dma_buf_size == -1)
+                continue;
+
+            // Only the first plane is known to have a row per pixel row
+            uint64_t const rows = plane == planes.begin() ? height : 1;
+            uint64_t const end = plane->value().offset + rows * plane->value().stride;
+            if (end > static_cast<uint64_t>(dma_buf_size))
+            {
+                wl_resource_post_error(
+                    resource,
+                    Error::out_of_bounds,
+                    "Plane %i is out of its dmabuf's bounds",
+                    static_cast<int>(plane - planes.begin()));
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /// Returns nullptr for valid buffers that we can't use
+    auto import(int32_t width, int32_t height, uint32_t format, uint32_t flags) -> std::shared_ptr<DmaBufImage const>
+    {
+        if (flags & (Flags::interlaced | Flags::bottom_first))
+        {
+            // We have no way of showing interlaced content properly
+            return nullptr;
+        }
+
+        mgc::DmaBufBuffer descriptor{{width, height}, format, modifier, flags, {}};
+        for (auto const& plane : planes)
+        {
+            if (plane)
+                descriptor.planes.push_back(plane.value());
+        }
+
+        try
+        {
+            return importer->import(std::move(descriptor));
+        }
+        catch (std::exception const& error)
+        {
+            mir::log_info("Failed to import client dmabuf: %s", error.what());
+            return nullptr;
+        }
+    }
+
+    std::shared_ptr<mgc::DmaBufImporter const> const importer;
+    bool used;
+    uint64_t modifier;
+    std::array<std::experimental::optional<mgc::DmaBufPlane>, max_planes> planes;
+};
+
+class LinuxDmaBufInstance : public mw::LinuxDmabufV1
+{
+public:
+    LinuxDmaBufInstance(wl_resource* new_resource, std::shared_ptr<mgc::DmaBufImporter const> const& importer)
+        : LinuxDmabufV1{new_resource, Version<3>()},
+          importer{importer}
+    {
+        for (auto const& format : importer->formats)
+        {
+            if (!version_supports_modifier())
+            {
+                send_format_event(format.format);
+            }
+            else if (format.modifiers.empty())
+            {
+                send_modifier_event(format.format, DRM_FORMAT_MOD_INVALID >> 32, DRM_FORMAT_MOD_INVALID & 0xffffffff);
+            }
+            else
+            {
+                for (auto const modifier : format.modifiers)
+                {
+                    send_modifier_event(format.format, modifier >> 32, modifier & 0xffffffff);
+                }
+            }
+        }
+    }
+
+private:
+    void destroy() override
+    {
+        destroy_wayland_object();
+    }
+
+    void create_params(wl_resource* params_id) override
+    {
+        new LinuxDmaBufParams{params_id, importer};
+    }
+
+    std::shared_ptr<mgc::DmaBufImporter const> const importer;
+};
+}
+
+mgc::LinuxDmaBufUnstable::LinuxDmaBufUnstable(
+    wl_display* display,
+    EGLDisplay dpy,
+    std::shared_ptr<EGLExtensions> const& egl_extensions,
+    ScanoutImporter const& import_for_scanout)
+    : Global{display, Version<3>()},
+      importer{std::make_shared<DmaBufImporter>(dpy, egl_extensions, import_for_scanout)}
+{
+}
+
+auto mgc::LinuxDmaBufUnstable::buffer_from_resource(
+    wl_resource* buffer,
+    std::function<void()>&& on_consumed,
+    std::function<void()>&& on_release,
+    std::shared_ptr<renderer::gl::Context> const& ctx,
+    std::shared_ptr<Executor> const& wayland_executor) -> std::shared_ptr<Buffer>
+{
+    if (auto const dma_buf = DmaBufWlBuffer::from(buffer))
+    {
+        return std::make_shared<DmaBufTexBuffer>(
+            dma_buf->image,
+            ctx,
+            std::move(on_consumed),
+            std::move(on_release),
+            wayland_executor);
+    }
+
+    return nullptr;
+}
+
+void mgc::LinuxDmaBufUnstable::bind(wl_resource* new_resource)
+{
+    new LinuxDmaBufInstance{new_resource, importer};
+}
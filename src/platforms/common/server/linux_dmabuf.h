@@ -0,0 +1,123 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_GRAPHICS_COMMON_LINUX_DMABUF_H_
+#define MIR_GRAPHICS_COMMON_LINUX_DMABUF_H_
+
+#include "linux-dmabuf-unstable-v1_wrapper.h"
+
+#include "mir/fd.h"
+#include "mir/geometry/size.h"
+
+#include <EGL/egl.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace mir
+{
+class Executor;
+
+namespace renderer
+{
+namespace gl
+{
+class Context;
+}
+}
+
+namespace graphics
+{
+class Buffer;
+class NativeBuffer;
+struct EGLExtensions;
+
+namespace common
+{
+struct DmaBufPlane
+{
+    mir::Fd dma_buf;
+    uint32_t offset;
+    uint32_t stride;
+};
+
+/// A buffer a client has put together from dmabufs with zwp_linux_buffer_params_v1
+struct DmaBufBuffer
+{
+    geometry::Size size;
+    uint32_t format;        ///< DRM fourcc code
+    uint64_t modifier;      ///< DRM_FORMAT_MOD_INVALID if the layout is implicit
+    uint32_t flags;         ///< zwp_linux_buffer_params_v1 flags
+    std::vector<DmaBufPlane> planes;
+};
+
+class DmaBufImporter;
+
+/**
+ * The zwp_linux_dmabuf_v1 global.
+ *
+ * Clients are offered the formats and modifiers the EGL display can import
+ * for sampling, and their buffers are imported as EGLImages once, when the
+ * wl_buffer is created.
+ */
+class LinuxDmaBufUnstable : public mir::wayland::LinuxDmabufV1::Global
+{
+public:
+    /**
+     * Imports a client buffer so that the display can scan it out, or returns
+     * nullptr if it can't.
+     *
+     * The result is what the mg::Buffers of the client buffer return from
+     * ScanoutSource::scanout_buffer(), which is how the display finds buffers
+     * it can put on a plane without compositing.
+     */
+    using ScanoutImporter = std::function<std::shared_ptr<NativeBuffer>(DmaBufBuffer const&)>;
+
+    /// \note dpy must support EGL_EXT_image_dma_buf_import
+    LinuxDmaBufUnstable(
+        wl_display* display,
+        EGLDisplay dpy,
+        std::shared_ptr<EGLExtensions> const& egl_extensions,
+        ScanoutImporter const& import_for_scanout);
+
+    /**
+     * Get a mir::graphics::Buffer for a wl_buffer created through this global.
+     *
+     * The returned buffer supports the mg::gl::Texture interface.
+     *
+     * \note This must be called on the Wayland thread, with a current GL context
+     *
+     * \return  The buffer, or nullptr if buffer was not created through zwp_linux_dmabuf_v1
+     */
+    auto buffer_from_resource(
+        wl_resource* buffer,
+        std::function<void()>&& on_consumed,
+        std::function<void()>&& on_release,
+        std::shared_ptr<renderer::gl::Context> const& ctx,
+        std::shared_ptr<Executor> const& wayland_executor) -> std::shared_ptr<Buffer>;
+
+private:
+    void bind(wl_resource* new_resource) override;
+
+    std::shared_ptr<DmaBufImporter const> const importer;
+};
+}
+}
+}
+
+#endif // MIR_GRAPHICS_COMMON_LINUX_DMABUF_H_
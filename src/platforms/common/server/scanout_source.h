@@ -0,0 +1,53 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_GRAPHICS_COMMON_SCANOUT_SOURCE_H_
+#define MIR_GRAPHICS_COMMON_SCANOUT_SOURCE_H_
+
+#include <memory>
+
+namespace mir
+{
+namespace graphics
+{
+class NativeBuffer;
+
+namespace common
+{
+/**
+ * Offered (through Buffer::native_buffer_base()) by client buffers that the
+ * platform may have imported for scanout.
+ *
+ * The display only looks for something to put on a plane in buffers offering
+ * this: others, such as wl_shm buffers, throw from native_buffer_handle().
+ */
+class ScanoutSource
+{
+public:
+    /// The buffer as imported for scanout, or nullptr if the platform couldn't import it
+    virtual auto scanout_buffer() const -> std::shared_ptr<NativeBuffer> = 0;
+
+protected:
+    ScanoutSource() = default;
+    virtual ~ScanoutSource() = default;
+    ScanoutSource(ScanoutSource const&) = delete;
+    ScanoutSource& operator=(ScanoutSource const&) = delete;
+};
+}
+}
+}
+
+#endif // MIR_GRAPHICS_COMMON_SCANOUT_SOURCE_H_
@@ -141,14 +141,14 @@ MirPixelFormat mgc::ShmBuffer::pixel_format() const
     return pixel_format_;
 }
 
-void mgc::ShmBuffer::upload_to_texture(void const* pixels, geom::Stride const& stride)
+namespace
 {
-    GLenum format, type;
-
-    if (mg::get_gl_pixel_format(pixel_format_, format, type))
+/// Sets up GL to read rows of stride bytes, restoring the defaults on destruction
+class UnpackRowLength
+{
+public:
+    UnpackRowLength(geom::Stride const& stride, MirPixelFormat format)
     {
-        auto const stride_in_px =
-            stride.as_int() / MIR_BYTES_PER_PIXEL(pixel_format());
         /*
          * We assume (as does Weston, AFAICT) that stride is
          * a multiple of whole pixels, but it need not be.
@@ -157,9 +157,29 @@ void mgc::ShmBuffer::upload_to_texture(void const* pixels, geom::Stride const& s
          * This should be possible by calculating GL_UNPACK_ALIGNMENT
          * to match the size of the partial-pixel-stride().
          */
-
-        glPixelStorei(GL_UNPACK_ROW_LENGTH_EXT, stride_in_px);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH_EXT, stride.as_int() / MIR_BYTES_PER_PIXEL(format));
         glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    }
+
+    ~UnpackRowLength()
+    {
+        // Be nice to other users of the GL context by reverting our changes to shared state
+        glPixelStorei(GL_UNPACK_ROW_LENGTH_EXT, 0);     // 0 is default, meaning “use width”
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);          // 4 is default; word alignment.
+    }
+
+    UnpackRowLength(UnpackRowLength const&) = delete;
+    UnpackRowLength& operator=(UnpackRowLength const&) = delete;
+};
+}
+
+void mgc::ShmBuffer::upload_to_texture(void const* pixels, geom::Stride const& stride)
+{
+    GLenum format, type;
+
+    if (mg::get_gl_pixel_format(pixel_format_, format, type))
+    {
+        UnpackRowLength const unpack{stride, pixel_format()};
 
         glTexImage2D(
             GL_TEXTURE_2D,
@@ -170,10 +190,49 @@ void mgc::ShmBuffer::upload_to_texture(void const* pixels, geom::Stride const& s
             format,
             type,
             pixels);
+    }
+    else
+    {
+        mir::log_error(
+            "Buffer %i has non-GL-compatible pixel format %i; rendering will be incomplete",
+            id().as_value(),
+            pixel_format());
+    }
+}
 
-        // Be nice to other users of the GL context by reverting our changes to shared state
-        glPixelStorei(GL_UNPACK_ROW_LENGTH_EXT, 0);     // 0 is default, meaning “use width”
-        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);          // 4 is default; word alignment.
+void mgc::ShmBuffer::upload_damage_to_texture(
+    void const* pixels,
+    geom::Stride const& stride,
+    geom::Rectangles const& damage)
+{
+    GLenum format, type;
+
+    if (mg::get_gl_pixel_format(pixel_format_, format, type))
+    {
+        UnpackRowLength const unpack{stride, pixel_format()};
+
+        geom::Rectangle const buffer_area{{}, size()};
+        auto const bytes_per_pixel = MIR_BYTES_PER_PIXEL(pixel_format());
+
+        for (auto const& rect : damage)
+        {
+            auto const area = rect.intersection_with(buffer_area);
+            if (area.size.width <= geom::Width{0} || area.size.height <= geom::Height{0})
+                continue;
+
+            auto const x = area.top_left.x.as_int();
+            auto const y = area.top_left.y.as_int();
+
+            // GL_UNPACK_ROW_LENGTH takes care of the stride; we just need to find the first pixel
+            glTexSubImage2D(
+                GL_TEXTURE_2D,
+                0,
+                x, y,
+                area.size.width.as_int(), area.size.height.as_int(),
+                format,
+                type,
+                static_cast<unsigned char const*>(pixels) + y * stride.as_int() + x * bytes_per_pixel);
+        }
     }
     else
     {
@@ -23,6 +23,7 @@
 #include "mir/graphics/buffer_basic.h"
 #include "mir/geometry/dimensions.h"
 #include "mir/geometry/size.h"
+#include "mir/geometry/rectangles.h"
 #include "mir_toolkit/common.h"
 #include "mir/renderer/gl/texture_target.h"
 #include "mir_toolkit/mir_native_buffer.h"
@@ -69,6 +70,17 @@ protected:
 
     /// \note This must be called with a current GL context
     void upload_to_texture(void const* pixels, geometry::Stride const& stride);
+
+    /**
+     * Update just the damaged parts of the bound texture
+     *
+     * The texture must already hold an image of this buffer's size and format.
+     * \note This must be called with a current GL context
+     */
+    void upload_damage_to_texture(
+        void const* pixels,
+        geometry::Stride const& stride,
+        geometry::Rectangles const& damage);
 private:
     geometry::Size const size_;
     MirPixelFormat const pixel_format_;
@@ -552,11 +552,15 @@ mir::graphics::eglstream::BufferAllocator::buffer_from_resource(
 auto mge::BufferAllocator::buffer_from_shm(
     wl_resource* buffer,
     std::shared_ptr<Executor> wayland_executor,
+    std::shared_ptr<Buffer> const& previous,
+    geometry::Rectangles const& damage,
     std::function<void()>&& on_consumed) -> std::shared_ptr<Buffer>
 {
     return mg::wayland::buffer_from_wl_shm(
         buffer,
         std::move(wayland_executor),
         egl_delegate,
+        previous,
+        damage,
         std::move(on_consumed));
 }
@@ -34,6 +34,8 @@
 #include "mir/renderer/gl/context_source.h"
 #include "mir/graphics/egl_wayland_allocator.h"
 #include "buffer_from_wl_shm.h"
+#include "linux_dmabuf.h"
+#include "native_buffer.h"
 #include "mir/executor.h"
 
 #include <boost/throw_exception.hpp>
@@ -52,6 +54,7 @@
 #include <fcntl.h>
 
 #include <wayland-server.h>
+#include <drm_fourcc.h>
 
 #define MIR_LOG_COMPONENT "gbm-kms-buffer-allocator"
 #include <mir/log.h>
@@ -200,6 +203,63 @@ struct GBMBODeleter
     }
 };
 
+/// Imports a client's dmabuf into our GBM device, so the display can use it as a framebuffer
+auto import_for_scanout(gbm_device* device, mgc::DmaBufBuffer const& buffer) -> std::shared_ptr<mg::NativeBuffer>
+{
+    // Planes can't flip buffers vertically
+    if (buffer.flags & mir::wayland::LinuxBufferParamsV1::Flags::y_invert)
+        return nullptr;
+
+#ifndef MIR_NO_GBM_MODIFIERS
+    gbm_import_fd_modifier_data data{};
+    data.width = buffer.size.width.as_uint32_t();
+    data.height = buffer.size.height.as_uint32_t();
+    data.format = buffer.format;
+    data.num_fds = buffer.planes.size();
+    for (std::size_t i = 0; i != buffer.planes.size(); ++i)
+    {
+        data.fds[i] = buffer.planes[i].dma_buf;
+        data.strides[i] = buffer.planes[i].stride;
+        data.offsets[i] = buffer.planes[i].offset;
+    }
+    data.modifier = buffer.modifier;
+
+    auto const bo = gbm_bo_import(device, GBM_BO_IMPORT_FD_MODIFIER, &data, GBM_BO_USE_SCANOUT);
+#else
+    if (buffer.planes.size() != 1 || buffer.planes[0].offset != 0 || buffer.modifier != DRM_FORMAT_MOD_INVALID)
+        return nullptr;
+
+    gbm_import_fd_data data{
+        buffer.planes[0].dma_buf,
+        buffer.size.width.as_uint32_t(),
+        buffer.size.height.as_uint32_t(),
+        buffer.planes[0].stride,
+        buffer.format};
+
+    auto const bo = gbm_bo_import(device, GBM_BO_IMPORT_FD, &data, GBM_BO_USE_SCANOUT);
+#endif
+    if (!bo)
+        return nullptr;
+
+    std::shared_ptr<mgg::NativeBuffer> native{
+        new mgg::NativeBuffer(),
+        [](mgg::NativeBuffer* native)
+        {
+            gbm_bo_destroy(native->bo);
+            delete native;
+        }};
+    native->bo = bo;
+    native->is_gbm_buffer = true;
+    native->native_format = buffer.format;
+    native->native_flags = GBM_BO_USE_SCANOUT;
+    native->width = buffer.size.width.as_int();
+    native->height = buffer.size.height.as_int();
+    native->stride = buffer.planes[0].stride;
+    native->flags = mir_buffer_flag_can_scanout;
+
+    return native;
+}
+
 std::unique_ptr<mir::renderer::gl::Context> context_for_output(mg::Display const& output)
 {
     try
@@ -295,6 +355,24 @@ void mgg::BufferAllocator::bind_display(wl_display* display, std::shared_ptr<Exe
 
     mg::wayland::bind_display(dpy, display, *egl_extensions);
 
+    try
+    {
+        mgc::LinuxDmaBufUnstable::ScanoutImporter import;
+        if (bypass_option == mgg::BypassOption::allowed)
+        {
+            import = [device = device](mgc::DmaBufBuffer const& buffer)
+                {
+                    return import_for_scanout(device, buffer);
+                };
+        }
+
+        dmabuf_extension = std::make_shared<mgc::LinuxDmaBufUnstable>(display, dpy, egl_extensions, import);
+    }
+    catch (std::exception const& error)
+    {
+        mir::log_info("Not offering linux-dmabuf to clients: %s", error.what());
+    }
+
     this->wayland_executor = std::move(wayland_executor);
 }
 
@@ -307,6 +385,19 @@ std::shared_ptr<mg::Buffer> mgg::BufferAllocator::buffer_from_resource(
         [this]() { ctx->make_current(); },
         [this]() { ctx->release_current(); });
 
+    if (dmabuf_extension)
+    {
+        if (auto const dmabuf = dmabuf_extension->buffer_from_resource(
+            buffer,
+            std::move(on_consumed),
+            std::move(on_release),
+            ctx,
+            wayland_executor))
+        {
+            return dmabuf;
+        }
+    }
+
     return mg::wayland::buffer_from_resource(
         buffer,
         std::move(on_consumed),
@@ -319,11 +410,15 @@ std::shared_ptr<mg::Buffer> mgg::BufferAllocator::buffer_from_resource(
 auto mgg::BufferAllocator::buffer_from_shm(
     wl_resource* buffer,
     std::shared_ptr<Executor> wayland_executor,
+    std::shared_ptr<Buffer> const& previous,
+    geometry::Rectangles const& damage,
     std::function<void()>&& on_consumed) -> std::shared_ptr<Buffer>
 {
     return mg::wayland::buffer_from_wl_shm(
         buffer,
         std::move(wayland_executor),
         egl_delegate,
+        previous,
+        damage,
         std::move(on_consumed));
 }
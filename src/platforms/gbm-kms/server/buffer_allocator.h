@@ -51,6 +51,7 @@ struct EGLExtensions;
 namespace common
 {
 class EGLContextExecutor;
+class LinuxDmaBufUnstable;
 }
 
 namespace gbm
@@ -83,6 +84,8 @@ public:
     auto buffer_from_shm(
         wl_resource* buffer,
         std::shared_ptr<Executor> wayland_executor,
+        std::shared_ptr<Buffer> const& previous,
+        geometry::Rectangles const& damage,
         std::function<void()>&& on_consumed) -> std::shared_ptr<Buffer> override;
 private:
     std::shared_ptr<Buffer> alloc_hardware_buffer(
@@ -91,6 +94,7 @@ private:
     std::shared_ptr<renderer::gl::Context> const ctx;
     std::shared_ptr<common::EGLContextExecutor> const egl_delegate;
     std::shared_ptr<Executor> wayland_executor;
+    std::shared_ptr<common::LinuxDmaBufUnstable> dmabuf_extension;
     gbm_device* const device;
     std::shared_ptr<EGLExtensions> const egl_extensions;
 
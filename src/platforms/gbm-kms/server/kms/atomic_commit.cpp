@@ -0,0 +1,67 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "atomic_commit.h"
+#include "page_flipper.h"
+
+#include <boost/throw_exception.hpp>
+#include <stdexcept>
+
+namespace mgg = mir::graphics::gbm;
+
+mgg::AtomicCommit::AtomicCommit()
+    : request_{drmModeAtomicAlloc(), &drmModeAtomicFree}
+{
+    if (!request_)
+        BOOST_THROW_EXCEPTION(std::runtime_error("Failed to allocate atomic KMS request"));
+}
+
+void mgg::AtomicCommit::add_property(uint32_t object_id, uint32_t property_id, uint64_t value)
+{
+    if (drmModeAtomicAddProperty(request_.get(), object_id, property_id, value) < 0)
+        BOOST_THROW_EXCEPTION(std::runtime_error("Failed to add property to atomic KMS request"));
+}
+
+void mgg::AtomicCommit::add_flip(
+    std::shared_ptr<PageFlipper> const& flipper,
+    uint32_t crtc_id,
+    uint32_t connector_id)
+{
+    if (this->flipper && this->flipper != flipper)
+        BOOST_THROW_EXCEPTION(std::logic_error("An atomic commit can't span DRM devices"));
+
+    this->flipper = flipper;
+    flips_.push_back({crtc_id, connector_id});
+}
+
+bool mgg::AtomicCommit::schedule()
+{
+    // Every output being flipped is switched off
+    if (flips_.empty())
+        return true;
+
+    return flipper->schedule_atomic_flip(*this);
+}
+
+drmModeAtomicReq* mgg::AtomicCommit::request() const
+{
+    return request_.get();
+}
+
+auto mgg::AtomicCommit::flips() const -> std::vector<FlipTarget> const&
+{
+    return flips_;
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_GRAPHICS_GBM_ATOMIC_COMMIT_H_
+#define MIR_GRAPHICS_GBM_ATOMIC_COMMIT_H_
+
+#include "kms-utils/drm_mode_resources.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace mir
+{
+namespace graphics
+{
+namespace gbm
+{
+
+class PageFlipper;
+
+/**
+ * A CRTC flipped by an atomic commit, and the connector it drives.
+ */
+struct FlipTarget
+{
+    uint32_t crtc_id;
+    uint32_t connector_id;
+};
+
+/**
+ * An atomic KMS request. The page flips of several outputs on one DRM device
+ * can be put together in one so they all flip on the same vblank.
+ */
+class AtomicCommit
+{
+public:
+    AtomicCommit();
+
+    void add_property(uint32_t object_id, uint32_t property_id, uint64_t value);
+
+    /// The commit flips crtc_id; flipper will deliver its page flip event
+    void add_flip(std::shared_ptr<PageFlipper> const& flipper, uint32_t crtc_id, uint32_t connector_id);
+
+    /**
+     * Commit without waiting for the flips, which are waited for with
+     * PageFlipper::wait_for_flip() as usual.
+     *
+     * \returns False if the commit failed, in which case nothing changed
+     */
+    bool schedule();
+
+    drmModeAtomicReq* request() const;
+    std::vector<FlipTarget> const& flips() const;
+
+private:
+    kms::DRMModeAtomicReqUPtr const request_;
+    std::shared_ptr<PageFlipper> flipper;
+    std::vector<FlipTarget> flips_;
+};
+
+}
+}
+}
+
+#endif /* MIR_GRAPHICS_GBM_ATOMIC_COMMIT_H_ */
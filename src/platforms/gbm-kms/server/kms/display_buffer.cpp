@@ -17,6 +17,7 @@
  */
 
 #include "display_buffer.h"
+#include "atomic_commit.h"
 #include "kms_output.h"
 #include "mir/graphics/display_report.h"
 #include "mir/graphics/transformation.h"
@@ -25,6 +26,7 @@
 #include "mir/fatal.h"
 #include "mir/log.h"
 #include "native_buffer.h"
+#include "scanout_source.h"
 #include "display_helpers.h"
 #include "egl_helper.h"
 #include "mir/graphics/egl_error.h"
@@ -45,6 +47,7 @@
 
 namespace mg = mir::graphics;
 namespace mgg = mir::graphics::gbm;
+namespace mgc = mir::graphics::common;
 namespace geom = mir::geometry;
 namespace mgmh = mir::graphics::gbm::helpers;
 
@@ -168,6 +171,55 @@ bool needs_bounce_buffer(mgg::KMSOutput const& destination, gbm_bo* source)
     return destination.buffer_requires_migration(source);
 }
 
+uint32_t fourcc_format_of(gbm_bo* bo)
+{
+    // Mir might use the old GBM_BO_ enum formats, but KMS needs fourcc formats
+    auto const format = gbm_bo_get_format(bo);
+    if (format == GBM_BO_FORMAT_XRGB8888)
+        return GBM_FORMAT_XRGB8888;
+    if (format == GBM_BO_FORMAT_ARGB8888)
+        return GBM_FORMAT_ARGB8888;
+    return format;
+}
+
+/// The GBM buffer a client buffer was imported for scanout as, if any
+auto scanout_buffer_of(mg::Buffer& buffer) -> std::shared_ptr<mgg::NativeBuffer>
+{
+    // Anything else (wl_shm buffers, for a start) can't be scanned out, and
+    // may well throw if asked for a native buffer
+    auto const source = dynamic_cast<mgc::ScanoutSource const*>(buffer.native_buffer_base());
+    if (!source)
+        return nullptr;
+
+    auto const native = std::dynamic_pointer_cast<mgg::NativeBuffer>(source->scanout_buffer());
+    if (!native || !(native->flags & mir_buffer_flag_can_scanout))
+        return nullptr;
+
+    return native;
+}
+
+/// The scanout-capable GBM buffer behind renderable, if it can go on a plane as it is
+gbm_bo* overlay_candidate(mg::Renderable const& renderable, geom::Rectangle const& area)
+{
+    static glm::mat4 const identity(1);
+
+    auto const position = renderable.screen_position();
+    auto const clip = renderable.clip_area();
+
+    // Overlay planes don't blend, crop or transform here
+    if (renderable.alpha() != 1.0f ||
+        renderable.shaped() ||
+        renderable.transformation() != identity ||
+        (clip && !clip.value().contains(position)) ||
+        !area.contains(position))
+    {
+        return nullptr;
+    }
+
+    auto const native = scanout_buffer_of(*renderable.buffer());
+    return native ? native->bo : nullptr;
+}
+
 const GLchar* const vshader =
     {
         "attribute vec4 position;\n"
@@ -439,7 +491,9 @@ mgg::DisplayBuffer::DisplayBuffer(
       area(area),
       transform{transformation},
       needs_set_crtc{false},
-      page_flips_pending{false}
+      page_flips_pending{false},
+      composite_render_time{std::chrono::milliseconds{50}},
+      bypass_render_time{std::chrono::milliseconds{5}}
 {
     listener->report_successful_setup_of_native_resources();
 
@@ -505,6 +559,7 @@ mgg::DisplayBuffer::DisplayBuffer(
 
 mgg::DisplayBuffer::~DisplayBuffer()
 {
+    clear_overlays();
 }
 
 geom::Rectangle mgg::DisplayBuffer::view_area() const
@@ -526,6 +581,13 @@ void mgg::DisplayBuffer::set_transformation(glm::mat2 const& t, geometry::Rectan
 bool mgg::DisplayBuffer::overlay(RenderableList const& renderable_list)
 {
     glm::mat2 static const no_transformation(1);
+
+    // The compositor tries this first thing each frame
+    if (!frame_started)
+    {
+        frame_start = std::chrono::steady_clock::now();
+        frame_started = true;
+    }
     if (transform == no_transformation &&
        (bypass_option == mgg::BypassOption::allowed))
     {
@@ -534,13 +596,15 @@ bool mgg::DisplayBuffer::overlay(RenderableList const& renderable_list)
         if (bypass_it != renderable_list.rend())
         {
             auto bypass_buffer = (*bypass_it)->buffer();
-            auto native = std::dynamic_pointer_cast<mgg::NativeBuffer>(bypass_buffer->native_buffer_handle());
-            if (native && native->flags & mir_buffer_flag_can_scanout &&
+            auto native = scanout_buffer_of(*bypass_buffer);
+            if (native &&
                 bypass_buffer->size() == surface.size() &&
                 !needs_bounce_buffer(*outputs.front(), native->bo))
             {
                 if (auto bufobj = outputs.front()->fb_for(native->bo))
                 {
+                    // Nothing should show over the bypassed buffer
+                    clear_overlays();
                     bypass_buf = bypass_buffer;
                     bypass_bufobj = bufobj;
                     return true;
@@ -554,6 +618,112 @@ bool mgg::DisplayBuffer::overlay(RenderableList const& renderable_list)
     return false;
 }
 
+mg::RenderableList mgg::DisplayBuffer::assign_overlays(RenderableList const& renderable_list)
+{
+    glm::mat2 static const no_transformation(1);
+
+    if (!overlay_planes_probed)
+    {
+        // Planes belong to a CRTC, so there's no sharing them in clone mode
+        if (outputs.size() == 1)
+            overlay_planes = outputs.front()->overlay_planes();
+        overlay_frames.resize(overlay_planes.size());
+        overlay_planes_probed = true;
+    }
+
+    std::vector<OverlayFrame> frames(overlay_planes.size());
+    std::vector<bool> on_plane(renderable_list.size(), false);
+
+    if (!overlay_planes.empty() &&
+        transform == no_transformation &&
+        bypass_option == mgg::BypassOption::allowed)
+    {
+        auto const& output = outputs.front();
+
+        // Planes are above everything composited, so nothing may be drawn
+        // over a renderable put on one.
+        std::vector<geom::Rectangle> above;
+
+        for (auto i = renderable_list.size(); i-- != 0;)
+        {
+            auto const& renderable = *renderable_list[i];
+            auto const position = renderable.screen_position();
+            auto const overlapped = std::any_of(above.begin(), above.end(),
+                [&position](geom::Rectangle const& r) { return r.overlaps(position); });
+            above.push_back(position);
+
+            if (overlapped)
+                continue;
+
+            auto const bo = overlay_candidate(renderable, area);
+            if (!bo || needs_bounce_buffer(*output, bo))
+                continue;
+
+            auto const fb = output->fb_for(bo);
+            if (!fb)
+                continue;
+
+            auto const buffer = renderable.buffer();
+            auto const format = fourcc_format_of(bo);
+            OverlayFrame const frame{buffer, {as_point(position.top_left - area.top_left), position.size}};
+
+            for (auto p = 0u; p != overlay_planes.size(); ++p)
+            {
+                auto const& formats = overlay_planes[p].formats;
+                if (frames[p].buffer ||
+                    std::find(formats.begin(), formats.end(), format) == formats.end())
+                {
+                    continue;
+                }
+
+                // If the hardware rejects this the renderable is composited instead
+                auto const unchanged =
+                    overlay_frames[p].buffer == buffer && overlay_frames[p].destination == frame.destination;
+                if (unchanged ||
+                    output->set_overlay(
+                        overlay_planes[p].id, fb, {{0, 0}, buffer->size()}, frame.destination))
+                {
+                    frames[p] = frame;
+                    on_plane[i] = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    for (auto p = 0u; p != overlay_frames.size(); ++p)
+    {
+        if (!overlay_frames[p].buffer || overlay_frames[p].buffer == frames[p].buffer)
+            continue;
+
+        if (!frames[p].buffer)
+            outputs.front()->set_overlay(overlay_planes[p].id, nullptr, {}, {});
+
+        replaced_overlay_buffers.push_back(std::move(overlay_frames[p].buffer));
+    }
+    overlay_frames = std::move(frames);
+
+    RenderableList composited;
+    for (auto i = 0u; i != renderable_list.size(); ++i)
+    {
+        if (!on_plane[i])
+            composited.push_back(renderable_list[i]);
+    }
+    return composited;
+}
+
+void mgg::DisplayBuffer::clear_overlays()
+{
+    for (auto p = 0u; p != overlay_frames.size(); ++p)
+    {
+        if (overlay_frames[p].buffer)
+        {
+            outputs.front()->set_overlay(overlay_planes[p].id, nullptr, {}, {});
+            replaced_overlay_buffers.push_back(std::move(overlay_frames[p].buffer));
+        }
+    }
+}
+
 void mgg::DisplayBuffer::for_each_display_buffer(
     std::function<void(graphics::DisplayBuffer&)> const& f)
 {
@@ -615,6 +785,13 @@ void mgg::DisplayBuffer::post()
     if (!needs_set_crtc && !schedule_page_flip(*bufobj))
         needs_set_crtc = true;
 
+    // Once this flip completes, buffers taken off overlay planes are off screen
+    retiring_overlay_buffers.insert(
+        retiring_overlay_buffers.end(),
+        std::make_move_iterator(replaced_overlay_buffers.begin()),
+        std::make_move_iterator(replaced_overlay_buffers.end()));
+    replaced_overlay_buffers.clear();
+
     /*
      * Fallback blitting: Not pretty, since it may tear. VirtualBox seems
      * to need to do this on every frame. [will complete in this thread]
@@ -625,10 +802,16 @@ void mgg::DisplayBuffer::post()
         needs_set_crtc = false;
     }
 
-    using namespace std;  // For operator""ms()
+    using namespace std::chrono;
 
-    // Predicted worst case render time for the next frame...
-    auto predicted_render_time = 50ms;
+    // It's very likely the next frame will be composited like this one...
+    auto& render_time = bypass_buf ? bypass_render_time : composite_render_time;
+    bool const measured = frame_started;
+    if (measured)
+    {
+        render_time.record(duration_cast<microseconds>(steady_clock::now() - frame_start));
+        frame_started = false;
+    }
 
     if (bypass_buf)
     {
@@ -643,10 +826,6 @@ void mgg::DisplayBuffer::post()
          */
         scheduled_bypass_frame = bypass_buf;
         wait_for_page_flip();
-
-        // It's very likely the next frame will be bypassed like this one so
-        // we only need time for kernel page flip scheduling...
-        predicted_render_time = 5ms;
     }
     else
     {
@@ -657,28 +836,96 @@ void mgg::DisplayBuffer::post()
          */
         if (outputs.size() == 1)
             wait_for_page_flip();
-
-        /*
-         * TODO: If you're optimistic about your GPU performance and/or
-         *       measure it carefully you may wish to set predicted_render_time
-         *       to a lower value here for lower latency.
-         *
-         *predicted_render_time = 9ms; // e.g. about the same as Weston
-         */
     }
 
     // Buffer lifetimes are managed exclusively by scheduled*/visible* now
     bypass_buf = nullptr;
     bypass_bufobj = nullptr;
 
-    recommend_sleep = 0ms;
+    if (outputs.size() == 1)
+    {
+        /*
+         * If we slept before this frame, started it on time and still missed
+         * a vblank then we slept too long.
+         */
+        auto const msc = outputs.front()->last_frame().msc;
+        if (measured && recommend_sleep > milliseconds::zero() &&
+            frame_start <= next_frame_due + milliseconds{1} &&
+            last_msc && msc > last_msc + 1)
+        {
+            render_time.missed_deadline();
+        }
+        last_msc = msc;
+    }
+
+    auto const now = steady_clock::now();
+    next_frame_due = now;
     if (outputs.size() == 1)
     {
         auto const& output = outputs.front();
-        auto const min_frame_interval = 1000ms / output->max_refresh_rate();
+        auto const min_frame_interval = duration_cast<microseconds>(seconds{1}) / output->max_refresh_rate();
+        auto const predicted_render_time = render_time.predicted_render_time();
         if (predicted_render_time < min_frame_interval)
-            recommend_sleep = min_frame_interval - predicted_render_time;
+        {
+            next_frame_due = now + (min_frame_interval - predicted_render_time);
+
+            /*
+             * Better, count from when the last page flip actually completed:
+             * we may have got here some time after it, and the next vblank
+             * won't wait for us.
+             */
+            auto const next_vblank = next_vblank_after(now);
+            if (next_vblank != steady_clock::time_point{})
+                next_frame_due = std::max(now, next_vblank - predicted_render_time);
+        }
+    }
+    recommend_sleep = duration_cast<milliseconds>(next_frame_due - now);
+}
+
+auto mgg::DisplayBuffer::next_frame_start() const -> std::chrono::steady_clock::time_point
+{
+    return next_frame_due;
+}
+
+auto mgg::DisplayBuffer::next_frame_deadline() const -> std::chrono::steady_clock::time_point
+{
+    using namespace std::chrono;
+
+    auto const next_vblank = next_vblank_after(steady_clock::now());
+    if (next_vblank == steady_clock::time_point{})
+        return steady_clock::time_point::max();
+
+    /*
+     * post() returns soon after the flip it waits for completes; half a
+     * refresh later and it must have waited for a later vblank.
+     */
+    auto const refresh_interval = duration_cast<microseconds>(seconds{1}) / outputs.front()->max_refresh_rate();
+    return next_vblank + refresh_interval / 2;
+}
+
+auto mgg::DisplayBuffer::next_vblank_after(std::chrono::steady_clock::time_point now) const
+    -> std::chrono::steady_clock::time_point
+{
+    using namespace std::chrono;
+
+    // In clone mode we neither wait for page flips nor have a single vblank to aim for
+    if (outputs.size() != 1)
+        return {};
+
+    auto const& output = outputs.front();
+    auto const last_flip = output->last_frame().ust;
+    if (last_flip.clock_id != CLOCK_MONOTONIC || last_flip.nanoseconds <= nanoseconds::zero())
+        return {};
+
+    auto const refresh_interval = duration_cast<microseconds>(seconds{1}) / output->max_refresh_rate();
+    steady_clock::time_point next_vblank{
+        duration_cast<steady_clock::duration>(last_flip.nanoseconds + refresh_interval)};
+    if (next_vblank <= now)
+    {
+        // Skip however many vblanks went by while we were idle in one step
+        next_vblank += ((now - next_vblank) / refresh_interval + 1) * refresh_interval;
     }
+    return next_vblank;
 }
 
 std::chrono::milliseconds mgg::DisplayBuffer::recommended_sleep() const
@@ -691,7 +938,25 @@ bool mgg::DisplayBuffer::schedule_page_flip(FBHandle const& bufobj)
     /*
      * Schedule the current front buffer object for display. Note that
      * the page flip is asynchronous and synchronized with vertical refresh.
+     *
+     * Where we can, all outputs are flipped by one atomic commit so clones
+     * change frame together, along with any overlay planes.
      */
+    AtomicCommit commit;
+    auto const atomic = std::all_of(outputs.begin(), outputs.end(),
+        [&](std::shared_ptr<KMSOutput> const& output) { return output->add_page_flip(commit, bufobj); });
+
+    if (atomic)
+    {
+        page_flips_pending = commit.schedule();
+
+        // The overlay planes didn't change either, so start them afresh
+        if (!page_flips_pending)
+            clear_overlays();
+
+        return page_flips_pending;
+    }
+
     for (auto& output : outputs)
     {
         if (output->schedule_page_flip(bufobj))
@@ -709,6 +974,7 @@ void mgg::DisplayBuffer::wait_for_page_flip()
             output->wait_for_page_flip();
 
         page_flips_pending = false;
+        retiring_overlay_buffers.clear();
     }
 
     if (scheduled_bypass_frame || scheduled_composite_frame)
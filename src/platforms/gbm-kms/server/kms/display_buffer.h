@@ -21,8 +21,11 @@
 
 #include "mir/graphics/display_buffer.h"
 #include "mir/graphics/display.h"
+#include "mir/graphics/overlay_planes.h"
 #include "mir/renderer/gl/render_target.h"
 #include "display_helpers.h"
+#include "kms_output.h"
+#include "render_time_predictor.h"
 #include "egl_helper.h"
 #include "platform_common.h"
 
@@ -96,6 +99,7 @@ private:
 class DisplayBuffer : public graphics::DisplayBuffer,
                       public graphics::DisplaySyncGroup,
                       public graphics::NativeDisplayBuffer,
+                      public graphics::OverlayPlanes,
                       public renderer::gl::RenderTarget
 {
 public:
@@ -112,12 +116,15 @@ public:
     void release_current() override;
     void swap_buffers() override;
     bool overlay(RenderableList const& renderlist) override;
+    RenderableList assign_overlays(RenderableList const& renderlist) override;
     void bind() override;
 
     void for_each_display_buffer(
         std::function<void(graphics::DisplayBuffer&)> const& f) override;
     void post() override;
     std::chrono::milliseconds recommended_sleep() const override;
+    auto next_frame_start() const -> std::chrono::steady_clock::time_point override;
+    auto next_frame_deadline() const -> std::chrono::steady_clock::time_point override;
 
     glm::mat2 transformation() const override;
     NativeDisplayBuffer* native_display_buffer() override;
@@ -129,6 +136,16 @@ public:
 private:
     bool schedule_page_flip(FBHandle const& bufobj);
     void set_crtc(FBHandle const&);
+    void clear_overlays();
+    /// The first vblank after now, or a default time_point if we can't tell
+    auto next_vblank_after(std::chrono::steady_clock::time_point now) const
+        -> std::chrono::steady_clock::time_point;
+
+    struct OverlayFrame
+    {
+        std::shared_ptr<graphics::Buffer> buffer;
+        geometry::Rectangle destination;
+    };
 
     std::shared_ptr<graphics::Buffer> visible_bypass_frame, scheduled_bypass_frame;
     std::shared_ptr<Buffer> bypass_buf{nullptr};
@@ -138,6 +155,15 @@ private:
 
     std::vector<std::shared_ptr<KMSOutput>> outputs;
 
+    /*
+     * Overlay planes are probed on first use. Buffers are held while on a
+     * plane, and once replaced until a page flip shows they are off screen.
+     */
+    bool overlay_planes_probed{false};
+    std::vector<OverlayPlane> overlay_planes;
+    std::vector<OverlayFrame> overlay_frames;
+    std::vector<std::shared_ptr<graphics::Buffer>> replaced_overlay_buffers, retiring_overlay_buffers;
+
     /*
      * Destruction order is important here:
      *  - The GBMFrontBuffers depend on *either*:
@@ -155,6 +181,19 @@ private:
     std::atomic<bool> needs_set_crtc;
     std::chrono::milliseconds recommend_sleep{0};
     bool page_flips_pending;
+
+    /*
+     * How long frames take from the start of compositing (the overlay()
+     * call) to post(), to recommend sleeping as long as is safe before
+     * starting the next one.
+     */
+    RenderTimePredictor composite_render_time;
+    RenderTimePredictor bypass_render_time;
+    std::chrono::steady_clock::time_point frame_start;
+    /// When to start the next frame to make the vblank after the last page flip
+    std::chrono::steady_clock::time_point next_frame_due;
+    bool frame_started{false};
+    int64_t last_msc{0};
 };
 
 }
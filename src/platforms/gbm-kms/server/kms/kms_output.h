@@ -22,6 +22,7 @@
 #include "mir/geometry/size.h"
 #include "mir/geometry/point.h"
 #include "mir/geometry/displacement.h"
+#include "mir/geometry/rectangle.h"
 #include "mir/graphics/display_configuration.h"
 #include "mir/graphics/frame.h"
 #include "mir_toolkit/common.h"
@@ -29,6 +30,7 @@
 #include "kms-utils/drm_mode_resources.h"
 
 #include <gbm.h>
+#include <vector>
 
 namespace mir
 {
@@ -40,6 +42,16 @@ namespace gbm
 {
 
 class FBHandle;
+class AtomicCommit;
+
+/**
+ * A hardware plane that can show a framebuffer over the primary plane.
+ */
+struct OverlayPlane
+{
+    uint32_t id;
+    std::vector<uint32_t> formats;  ///< DRM fourcc formats the plane can scan out
+};
 
 class KMSOutput
 {
@@ -67,6 +79,15 @@ public:
     virtual bool set_crtc(FBHandle const& fb) = 0;
     virtual void clear_crtc() = 0;
     virtual bool schedule_page_flip(FBHandle const& fb) = 0;
+    /**
+     * Add a page flip of this output to fb, and any overlay changes since
+     * the last one, to an atomic commit. The flip is waited for with
+     * wait_for_page_flip() once the commit is scheduled.
+     *
+     * \return  False if this output can't be flipped atomically; use
+     *          schedule_page_flip() instead
+     */
+    virtual bool add_page_flip(AtomicCommit& commit, FBHandle const& fb) = 0;
     virtual void wait_for_page_flip() = 0;
 
     virtual bool set_cursor(gbm_bo* buffer) = 0;
@@ -74,6 +95,28 @@ public:
     virtual bool clear_cursor() = 0;
     virtual bool has_cursor() const = 0;
 
+    /**
+     * The overlay planes free to use on the CRTC driving this output. This
+     * does not include the primary or cursor planes, and is empty without
+     * atomic KMS.
+     */
+    virtual std::vector<OverlayPlane> overlay_planes() = 0;
+
+    /**
+     * Show the source part of fb on an overlay plane, scaled to fill
+     * destination (relative to the output's top left), or disable the plane
+     * if fb is null. This is checked now but only shown with the next page
+     * flip (see add_page_flip()).
+     *
+     * \return  False if the hardware can't show fb like that (or there is
+     *          no atomic KMS to show it with)
+     */
+    virtual bool set_overlay(
+        uint32_t plane_id,
+        FBHandle const* fb,
+        geometry::Rectangle const& source,
+        geometry::Rectangle const& destination) = 0;
+
     virtual void set_power_mode(MirPowerMode mode) = 0;
     virtual void set_gamma(GammaCurves const& gamma) = 0;
     virtual Frame last_frame() const = 0;
@@ -17,7 +17,9 @@
  */
 
 #include "kms_page_flipper.h"
+#include "atomic_commit.h"
 #include "mir/graphics/display_report.h"
+#include "mir/log.h"
 
 #include <stdexcept>
 #include <boost/throw_exception.hpp>
@@ -44,6 +46,30 @@ void page_flip_handler(int /*fd*/, unsigned int seq,
                                               seq, ns);
 }
 
+void page_flip_handler2(int /*fd*/, unsigned int seq,
+                        unsigned int sec, unsigned int usec,
+                        unsigned int crtc_id, void* data)
+{
+    /*
+     * One atomic commit can flip several CRTCs, each getting an event with
+     * the same data, so only the kernel knows which CRTC flipped. We only
+     * make such commits if it tells us.
+     */
+    auto page_flip_data = static_cast<mgg::PageFlipEventData*>(data);
+    std::chrono::nanoseconds ns{sec*1000000000LL + usec*1000LL};
+    page_flip_data->flipper->notify_page_flip(crtc_id ? crtc_id : page_flip_data->crtc_id,
+                                              seq, ns);
+}
+
+bool enable_atomic(int drm_fd)
+{
+    uint64_t crtc_in_event = 0;
+    if (drmGetCap(drm_fd, DRM_CAP_CRTC_IN_VBLANK_EVENT, &crtc_in_event) || !crtc_in_event)
+        return false;
+
+    return drmSetClientCap(drm_fd, DRM_CLIENT_CAP_ATOMIC, 1) == 0;
+}
+
 }
 
 mgg::KMSPageFlipper::KMSPageFlipper(
@@ -52,13 +78,17 @@ mgg::KMSPageFlipper::KMSPageFlipper(
     drm_fd{drm_fd},
     report{report},
     pending_page_flips(),
-    worker_tid()
+    worker_tid(),
+    atomic{enable_atomic(drm_fd)},
+    atomic_flip_data{0, 0, this}
 {
     uint64_t mono = 0;
     if (drmGetCap(drm_fd, DRM_CAP_TIMESTAMP_MONOTONIC, &mono) || !mono)
         clock_id = CLOCK_REALTIME;
     else
         clock_id = CLOCK_MONOTONIC;
+
+    mir::log_info("Using %s KMS page flips", atomic ? "atomic" : "legacy");
 }
 
 bool mgg::KMSPageFlipper::schedule_flip(uint32_t crtc_id,
@@ -88,12 +118,48 @@ bool mgg::KMSPageFlipper::schedule_flip(uint32_t crtc_id,
     return (ret == 0);
 }
 
+bool mgg::KMSPageFlipper::supports_atomic() const
+{
+    return atomic;
+}
+
+bool mgg::KMSPageFlipper::schedule_atomic_flip(AtomicCommit const& commit)
+{
+    if (!atomic)
+        return false;
+
+    std::unique_lock<std::mutex> lock{pf_mutex};
+
+    for (auto const& flip : commit.flips())
+    {
+        if (pending_page_flips.find(flip.crtc_id) != pending_page_flips.end())
+            BOOST_THROW_EXCEPTION(std::logic_error("Page flip for crtc_id is already scheduled"));
+    }
+
+    for (auto const& flip : commit.flips())
+        pending_page_flips[flip.crtc_id] = PageFlipEventData{flip.crtc_id, flip.connector_id, this};
+
+    auto ret = drmModeAtomicCommit(drm_fd, commit.request(),
+                                   DRM_MODE_ATOMIC_NONBLOCK | DRM_MODE_PAGE_FLIP_EVENT,
+                                   &atomic_flip_data);
+
+    if (ret)
+    {
+        mir::log_debug("Atomic page flip failed (%s)", strerror(-ret));
+        for (auto const& flip : commit.flips())
+            pending_page_flips.erase(flip.crtc_id);
+    }
+
+    return (ret == 0);
+}
+
 mg::Frame mgg::KMSPageFlipper::wait_for_flip(uint32_t crtc_id)
 {
     drmEventContext evctx;
     memset(&evctx, 0, sizeof evctx);
-    evctx.version = 2;  // We only support the old v2 page_flip_handler
+    evctx.version = 3;
     evctx.page_flip_handler = &page_flip_handler;
+    evctx.page_flip_handler2 = &page_flip_handler2;
 
     static std::thread::id const invalid_tid;
 
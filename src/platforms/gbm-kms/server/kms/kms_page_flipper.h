@@ -53,6 +53,8 @@ public:
     KMSPageFlipper(int drm_fd, std::shared_ptr<DisplayReport> const& report);
 
     bool schedule_flip(uint32_t crtc_id, uint32_t fb_id, uint32_t connector_id) override;
+    bool supports_atomic() const override;
+    bool schedule_atomic_flip(AtomicCommit const& commit) override;
     Frame wait_for_flip(uint32_t crtc_id) override;
 
     std::thread::id debug_get_worker_tid();
@@ -69,6 +71,9 @@ private:
     std::condition_variable pf_cv;
     std::thread::id worker_tid;
     clockid_t clock_id;
+    bool atomic;
+    /// The event data of atomic commits, which name the CRTC in the event
+    PageFlipEventData atomic_flip_data;
 };
 
 }
@@ -29,12 +29,22 @@ namespace graphics
 namespace gbm
 {
 
+class AtomicCommit;
+
 class PageFlipper
 {
 public:
     virtual ~PageFlipper() {}
 
     virtual bool schedule_flip(uint32_t crtc_id, uint32_t fb_id, uint32_t connector_id) = 0;
+
+    /// Whether the device takes atomic commits, so schedule_atomic_flip() can work
+    virtual bool supports_atomic() const = 0;
+    /**
+     * Commit without blocking. Each CRTC the commit flips is then waited for
+     * with wait_for_flip() as if it had been flipped by schedule_flip().
+     */
+    virtual bool schedule_atomic_flip(AtomicCommit const& commit) = 0;
     virtual Frame wait_for_flip(uint32_t crtc_id) = 0;
 
 protected:
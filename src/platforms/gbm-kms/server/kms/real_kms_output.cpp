@@ -18,6 +18,7 @@
 
 #include "real_kms_output.h"
 #include "mir/graphics/display_configuration.h"
+#include "atomic_commit.h"
 #include "page_flipper.h"
 #include "kms-utils/kms_connector.h"
 #include "mir/fatal.h"
@@ -28,6 +29,7 @@
 #include <boost/throw_exception.hpp>
 #include <system_error>
 #include <xf86drm.h>
+#include <drm_fourcc.h>
 
 namespace mg = mir::graphics;
 namespace mgg = mg::gbm;
@@ -69,6 +71,20 @@ void bo_user_data_destroy(gbm_bo* /*bo*/, void *data)
     delete bufobj;
 }
 
+int crtc_index_of(int drm_fd, uint32_t crtc_id)
+{
+    mgk::DRMModeResources resources{drm_fd};
+
+    int crtc_index = 0;
+    for (auto& crtc : resources.crtcs())
+    {
+        if (crtc->crtc_id == crtc_id)
+            break;
+        ++crtc_index;
+    }
+    return crtc_index;
+}
+
 }
 
 mgg::RealKMSOutput::RealKMSOutput(
@@ -83,7 +99,10 @@ mgg::RealKMSOutput::RealKMSOutput(
       saved_crtc(),
       using_saved_crtc{true},
       has_cursor_{false},
-      power_mode(mir_power_mode_on)
+      power_mode(mir_power_mode_on),
+      primary_plane_id{0},
+      primary_plane_crtc_id{0},
+      mode_blob_id{0}
 {
     reset();
 
@@ -102,6 +121,9 @@ mgg::RealKMSOutput::RealKMSOutput(
 mgg::RealKMSOutput::~RealKMSOutput()
 {
     restore_saved_crtc();
+
+    if (mode_blob_id)
+        drmModeDestroyPropertyBlob(drm_fd_, mode_blob_id);
 }
 
 uint32_t mgg::RealKMSOutput::id() const
@@ -140,6 +162,7 @@ void mgg::RealKMSOutput::reset()
 
     /* Discard previously current crtc */
     current_crtc = nullptr;
+    overlay_states.clear();
 }
 
 geom::Size mgg::RealKMSOutput::size() const
@@ -172,6 +195,12 @@ bool mgg::RealKMSOutput::set_crtc(FBHandle const& fb)
         return false;
     }
 
+    if (set_crtc_atomic(fb))
+    {
+        using_saved_crtc = false;
+        return true;
+    }
+
     auto ret = drmModeSetCrtc(drm_fd_, current_crtc->crtc_id,
                               fb.get_drm_fb_id(), fb_offset.dx.as_int(), fb_offset.dy.as_int(),
                               &connector->connector_id, 1,
@@ -248,6 +277,33 @@ bool mgg::RealKMSOutput::schedule_page_flip(FBHandle const& fb)
         connector->connector_id);
 }
 
+bool mgg::RealKMSOutput::add_page_flip(AtomicCommit& commit, FBHandle const& fb)
+{
+    std::unique_lock<std::mutex> lg(power_mutex);
+    if (power_mode != mir_power_mode_on)
+        return true;
+    if (!ensure_primary_plane())
+        return false;
+
+    try
+    {
+        add_plane_state(
+            commit,
+            primary_plane_id,
+            {fb.get_drm_fb_id(), {{fb_offset.dx.as_int(), fb_offset.dy.as_int()}, size()}, {{0, 0}, size()}});
+        add_overlay_states(commit);
+    }
+    catch (std::exception const& e)
+    {
+        mir::log_warning("Output %s can't be flipped atomically: %s",
+                         mgk::connector_name(connector).c_str(), e.what());
+        return false;
+    }
+
+    commit.add_flip(page_flipper, current_crtc->crtc_id, connector->connector_id);
+    return true;
+}
+
 void mgg::RealKMSOutput::wait_for_page_flip()
 {
     std::unique_lock<std::mutex> lg(power_mutex);
@@ -324,6 +380,96 @@ bool mgg::RealKMSOutput::has_cursor() const
     return has_cursor_;
 }
 
+std::vector<mgg::OverlayPlane> mgg::RealKMSOutput::overlay_planes()
+{
+    std::vector<OverlayPlane> planes;
+
+    /*
+     * Legacy KMS changes planes as soon as it's asked to rather than on the
+     * next page flip, so it can't change an overlay without tearing.
+     */
+    if (!ensure_crtc() || !ensure_primary_plane())
+        return planes;
+
+    try
+    {
+        auto const crtc_index = crtc_index_of(drm_fd_, current_crtc->crtc_id);
+
+        kms::PlaneResources plane_resources{drm_fd_};
+        for (auto& plane : plane_resources.planes())
+        {
+            if (!(plane->possible_crtcs & (1 << crtc_index)))
+                continue;
+
+            if (plane->crtc_id && plane->crtc_id != current_crtc->crtc_id)
+                continue;   // In use by another output
+
+            kms::ObjectProperties const props{drm_fd_, plane};
+            if (!props.has_property("type") || props["type"] != DRM_PLANE_TYPE_OVERLAY)
+                continue;
+
+            planes.push_back(
+                OverlayPlane{
+                    plane->plane_id,
+                    {plane->formats, plane->formats + plane->count_formats}});
+        }
+    }
+    catch (std::exception const& e)
+    {
+        // Not all drivers have planes to offer; that's fine
+        mir::log_debug("Output %s has no usable overlay planes: %s",
+                       mgk::connector_name(connector).c_str(), e.what());
+        planes.clear();
+    }
+
+    return planes;
+}
+
+bool mgg::RealKMSOutput::set_overlay(
+    uint32_t plane_id,
+    FBHandle const* fb,
+    geom::Rectangle const& source,
+    geom::Rectangle const& destination)
+{
+    // Without atomic KMS there are no overlay planes to set
+    if (!ensure_primary_plane())
+        return false;
+
+    if (!fb)
+    {
+        overlay_states[plane_id] = PlaneState{0, {}, {}};
+        return true;
+    }
+
+    PlaneState const state{fb->get_drm_fb_id(), source, destination};
+
+    // Check the hardware can show this alongside the other overlays
+    try
+    {
+        AtomicCommit test;
+        for (auto const& overlay : overlay_states)
+        {
+            if (overlay.first != plane_id)
+                add_plane_state(test, overlay.first, overlay.second);
+        }
+        add_plane_state(test, plane_id, state);
+
+        if (auto result = drmModeAtomicCommit(drm_fd_, test.request(), DRM_MODE_ATOMIC_TEST_ONLY, nullptr))
+        {
+            mir::log_debug("set_overlay: atomic test commit failed (%s)", strerror(-result));
+            return false;
+        }
+    }
+    catch (std::exception const& e)
+    {
+        mir::log_debug("set_overlay: %s", e.what());
+        return false;
+    }
+
+    overlay_states[plane_id] = state;
+    return true;
+}
+
 bool mgg::RealKMSOutput::ensure_crtc()
 {
     /* Nothing to do if we already have a crtc */
@@ -340,6 +486,145 @@ bool mgg::RealKMSOutput::ensure_crtc()
     return (current_crtc != nullptr);
 }
 
+bool mgg::RealKMSOutput::ensure_primary_plane()
+{
+    if (!current_crtc || !page_flipper->supports_atomic())
+        return false;
+
+    if (primary_plane_crtc_id == current_crtc->crtc_id)
+        return primary_plane_id != 0;
+
+    primary_plane_crtc_id = current_crtc->crtc_id;
+    primary_plane_id = 0;
+
+    try
+    {
+        auto const crtc_index = crtc_index_of(drm_fd_, current_crtc->crtc_id);
+
+        kms::PlaneResources plane_resources{drm_fd_};
+        for (auto& plane : plane_resources.planes())
+        {
+            if (!(plane->possible_crtcs & (1 << crtc_index)))
+                continue;
+
+            if (plane->crtc_id && plane->crtc_id != current_crtc->crtc_id)
+                continue;
+
+            kms::ObjectProperties props{drm_fd_, plane};
+            if (props.has_property("type") && props["type"] == DRM_PLANE_TYPE_PRIMARY)
+            {
+                primary_plane_id = plane->plane_id;
+                plane_properties.erase(primary_plane_id);
+                plane_properties.emplace(primary_plane_id, std::move(props));
+                break;
+            }
+        }
+    }
+    catch (std::exception const& e)
+    {
+        mir::log_debug("Failed to find primary plane: %s", e.what());
+    }
+
+    if (!primary_plane_id)
+    {
+        mir::log_info("Output %s has no primary plane; using legacy KMS",
+                      mgk::connector_name(connector).c_str());
+    }
+
+    return primary_plane_id != 0;
+}
+
+bool mgg::RealKMSOutput::set_crtc_atomic(FBHandle const& fb)
+{
+    if (!ensure_primary_plane())
+        return false;
+
+    auto& mode = connector->modes[mode_index];
+    uint32_t blob_id{0};
+    if (drmModeCreatePropertyBlob(drm_fd_, &mode, sizeof(mode), &blob_id))
+        return false;
+
+    int result{-EINVAL};
+    try
+    {
+        auto const crtc_id = current_crtc->crtc_id;
+        auto const connector_id = connector->connector_id;
+        kms::ObjectProperties const crtc_props{drm_fd_, crtc_id, DRM_MODE_OBJECT_CRTC};
+        kms::ObjectProperties const connector_props{drm_fd_, connector_id, DRM_MODE_OBJECT_CONNECTOR};
+
+        AtomicCommit commit;
+        commit.add_property(crtc_id, crtc_props.id_for("MODE_ID"), blob_id);
+        commit.add_property(crtc_id, crtc_props.id_for("ACTIVE"), 1);
+        commit.add_property(connector_id, connector_props.id_for("CRTC_ID"), crtc_id);
+        add_plane_state(
+            commit,
+            primary_plane_id,
+            {fb.get_drm_fb_id(), {{fb_offset.dx.as_int(), fb_offset.dy.as_int()}, size()}, {{0, 0}, size()}});
+        add_overlay_states(commit);
+
+        result = drmModeAtomicCommit(drm_fd_, commit.request(), DRM_MODE_ATOMIC_ALLOW_MODESET, nullptr);
+    }
+    catch (std::exception const& e)
+    {
+        mir::log_debug("Atomic modeset of output %s failed: %s",
+                       mgk::connector_name(connector).c_str(), e.what());
+    }
+
+    if (result)
+    {
+        drmModeDestroyPropertyBlob(drm_fd_, blob_id);
+        return false;
+    }
+
+    if (mode_blob_id)
+        drmModeDestroyPropertyBlob(drm_fd_, mode_blob_id);
+    mode_blob_id = blob_id;
+    return true;
+}
+
+void mgg::RealKMSOutput::add_plane_state(AtomicCommit& commit, uint32_t plane_id, PlaneState const& state)
+{
+    auto props = plane_properties.find(plane_id);
+    if (props == plane_properties.end())
+    {
+        props = plane_properties.emplace(
+            plane_id,
+            kms::ObjectProperties{drm_fd_, plane_id, DRM_MODE_OBJECT_PLANE}).first;
+    }
+    auto const& plane = props->second;
+
+    commit.add_property(plane_id, plane.id_for("FB_ID"), state.fb_id);
+    commit.add_property(plane_id, plane.id_for("CRTC_ID"), state.fb_id ? current_crtc->crtc_id : 0);
+
+    if (state.fb_id)
+    {
+        // Source coordinates are 16.16 fixed point; CRTC_X and CRTC_Y are signed
+        commit.add_property(plane_id, plane.id_for("SRC_X"), uint64_t{state.source.left().as_uint32_t()} << 16);
+        commit.add_property(plane_id, plane.id_for("SRC_Y"), uint64_t{state.source.top().as_uint32_t()} << 16);
+        commit.add_property(plane_id, plane.id_for("SRC_W"), uint64_t{state.source.size.width.as_uint32_t()} << 16);
+        commit.add_property(plane_id, plane.id_for("SRC_H"), uint64_t{state.source.size.height.as_uint32_t()} << 16);
+        commit.add_property(plane_id, plane.id_for("CRTC_X"), static_cast<int64_t>(state.destination.left().as_int()));
+        commit.add_property(plane_id, plane.id_for("CRTC_Y"), static_cast<int64_t>(state.destination.top().as_int()));
+        commit.add_property(plane_id, plane.id_for("CRTC_W"), state.destination.size.width.as_uint32_t());
+        commit.add_property(plane_id, plane.id_for("CRTC_H"), state.destination.size.height.as_uint32_t());
+    }
+}
+
+void mgg::RealKMSOutput::add_overlay_states(AtomicCommit& commit)
+{
+    for (auto const& overlay : overlay_states)
+        add_plane_state(commit, overlay.first, overlay.second);
+
+    // Once switched off a plane is free for other CRTCs, so stop touching it
+    for (auto i = overlay_states.begin(); i != overlay_states.end();)
+    {
+        if (i->second.fb_id)
+            ++i;
+        else
+            i = overlay_states.erase(i);
+    }
+}
+
 void mgg::RealKMSOutput::restore_saved_crtc()
 {
     if (!using_saved_crtc)
@@ -639,9 +924,6 @@ mgg::FBHandle* mgg::RealKMSOutput::fb_for(gbm_bo* bo) const
         return bufobj;
 
     uint32_t fb_id{0};
-    uint32_t handles[4] = {gbm_bo_get_handle(bo).u32, 0, 0, 0};
-    uint32_t strides[4] = {gbm_bo_get_stride(bo), 0, 0, 0};
-    uint32_t offsets[4] = {0, 0, 0, 0};
 
     auto format = gbm_bo_get_format(bo);
     /*
@@ -656,9 +938,53 @@ mgg::FBHandle* mgg::RealKMSOutput::fb_for(gbm_bo* bo) const
     auto const width = gbm_bo_get_width(bo);
     auto const height = gbm_bo_get_height(bo);
 
-    /* Create a KMS FB object with the gbm_bo attached to it. */
-    auto ret = drmModeAddFB2(drm_fd_, width, height, format,
-                             handles, strides, offsets, &fb_id, 0);
+    int ret{-1};
+#ifndef MIR_NO_GBM_MODIFIERS
+    /*
+     * Buffers with an explicit layout (such as client buffers imported through
+     * linux-dmabuf) can be tiled, compressed, or have more than one plane, and
+     * the kernel needs telling all of that.
+     */
+    auto const modifier = gbm_bo_get_modifier(bo);
+    if (modifier != DRM_FORMAT_MOD_INVALID)
+    {
+        uint32_t handles[4] = {0, 0, 0, 0};
+        uint32_t strides[4] = {0, 0, 0, 0};
+        uint32_t offsets[4] = {0, 0, 0, 0};
+        uint64_t modifiers[4] = {0, 0, 0, 0};
+
+        auto const plane_count = gbm_bo_get_plane_count(bo);
+        for (int i = 0; i != plane_count && i != 4; ++i)
+        {
+            handles[i] = gbm_bo_get_handle_for_plane(bo, i).u32;
+            strides[i] = gbm_bo_get_stride_for_plane(bo, i);
+            offsets[i] = gbm_bo_get_offset(bo, i);
+            modifiers[i] = modifier;
+        }
+
+        ret = drmModeAddFB2WithModifiers(drm_fd_, width, height, format,
+                                         handles, strides, offsets, modifiers,
+                                         &fb_id, DRM_MODE_FB_MODIFIERS);
+
+        /*
+         * Without kernel support for modifiers a linear, single plane buffer
+         * may still work. Anything else would be scanned out as garbage.
+         */
+        if (ret && (plane_count != 1 || modifier != DRM_FORMAT_MOD_LINEAR))
+            return nullptr;
+    }
+#endif
+
+    if (ret)
+    {
+        uint32_t handles[4] = {gbm_bo_get_handle(bo).u32, 0, 0, 0};
+        uint32_t strides[4] = {gbm_bo_get_stride(bo), 0, 0, 0};
+        uint32_t offsets[4] = {0, 0, 0, 0};
+
+        /* Create a KMS FB object with the gbm_bo attached to it. */
+        ret = drmModeAddFB2(drm_fd_, width, height, format,
+                            handles, strides, offsets, &fb_id, 0);
+    }
     if (ret)
         return nullptr;
 
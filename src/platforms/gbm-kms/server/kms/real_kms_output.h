@@ -25,6 +25,7 @@
 
 #include <memory>
 #include <mutex>
+#include <unordered_map>
 
 namespace mir
 {
@@ -54,6 +55,7 @@ public:
     bool set_crtc(FBHandle const& fb) override;
     void clear_crtc() override;
     bool schedule_page_flip(FBHandle const& fb) override;
+    bool add_page_flip(AtomicCommit& commit, FBHandle const& fb) override;
     void wait_for_page_flip() override;
 
     bool set_cursor(gbm_bo* buffer) override;
@@ -61,6 +63,13 @@ public:
     bool clear_cursor() override;
     bool has_cursor() const override;
 
+    std::vector<OverlayPlane> overlay_planes() override;
+    bool set_overlay(
+        uint32_t plane_id,
+        FBHandle const* fb,
+        geometry::Rectangle const& source,
+        geometry::Rectangle const& destination) override;
+
     void set_power_mode(MirPowerMode mode) override;
     void set_gamma(GammaCurves const& gamma) override;
 
@@ -74,9 +83,22 @@ public:
     bool buffer_requires_migration(gbm_bo* bo) const override;
     int drm_fd() const override;
 private:
+    /// What an atomic commit puts on a plane; no fb means the plane is off
+    struct PlaneState
+    {
+        uint32_t fb_id;
+        geometry::Rectangle source;
+        geometry::Rectangle destination;
+    };
+
     bool ensure_crtc();
     void restore_saved_crtc();
 
+    bool ensure_primary_plane();
+    bool set_crtc_atomic(FBHandle const& fb);
+    void add_plane_state(AtomicCommit& commit, uint32_t plane_id, PlaneState const& state);
+    void add_overlay_states(AtomicCommit& commit);
+
     int const drm_fd_;
     std::shared_ptr<PageFlipper> const page_flipper;
 
@@ -93,6 +115,12 @@ private:
 
     std::mutex power_mutex;
 
+    uint32_t primary_plane_id;
+    uint32_t primary_plane_crtc_id;
+    std::unordered_map<uint32_t, kms::ObjectProperties> plane_properties;
+    std::unordered_map<uint32_t, PlaneState> overlay_states;
+    uint32_t mode_blob_id;
+
     AtomicFrame last_frame_;
 };
 
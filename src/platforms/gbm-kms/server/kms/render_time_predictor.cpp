@@ -0,0 +1,78 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "render_time_predictor.h"
+
+#include <algorithm>
+
+namespace mgg = mir::graphics::gbm;
+
+using namespace std::chrono;
+
+namespace
+{
+// Covers the jitter of waking up and getting the flip to the kernel
+auto const base_margin = microseconds{1000};
+auto const margin_step = microseconds{1000};
+auto const max_margin = microseconds{8000};
+// About a second at 60Hz
+std::size_t const frames_per_margin_step = 60;
+}
+
+std::size_t const mgg::RenderTimePredictor::window_size;
+std::size_t const mgg::RenderTimePredictor::min_samples;
+
+mgg::RenderTimePredictor::RenderTimePredictor(microseconds fallback)
+    : fallback{fallback},
+      sample_count{0},
+      next_sample{0},
+      margin{base_margin},
+      frames_since_miss{0}
+{
+}
+
+void mgg::RenderTimePredictor::record(microseconds render_time)
+{
+    samples[next_sample] = render_time;
+    next_sample = (next_sample + 1) % window_size;
+    sample_count = std::min(sample_count + 1, window_size);
+
+    if (++frames_since_miss >= frames_per_margin_step && margin > base_margin)
+    {
+        margin = std::max(margin - margin_step, base_margin);
+        frames_since_miss = 0;
+    }
+}
+
+void mgg::RenderTimePredictor::missed_deadline()
+{
+    margin = std::min(margin + margin_step, max_margin);
+    frames_since_miss = 0;
+}
+
+auto mgg::RenderTimePredictor::predicted_render_time() const -> microseconds
+{
+    if (sample_count < min_samples)
+        return fallback;
+
+    // The 95th percentile, so the odd slow frame doesn't make every frame late
+    std::array<microseconds, window_size> sorted;
+    auto const end = std::copy_n(samples.begin(), sample_count, sorted.begin());
+    auto const percentile = sorted.begin() + (sample_count * 95) / 100;
+    std::nth_element(sorted.begin(), percentile, end);
+
+    return *percentile + margin;
+}
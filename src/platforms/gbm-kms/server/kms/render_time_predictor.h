@@ -0,0 +1,67 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_GRAPHICS_GBM_RENDER_TIME_PREDICTOR_H_
+#define MIR_GRAPHICS_GBM_RENDER_TIME_PREDICTOR_H_
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+
+namespace mir
+{
+namespace graphics
+{
+namespace gbm
+{
+
+/**
+ * Predicts how long the next frame will take to get from the start of
+ * compositing to a scheduled page flip, from how long recent frames took.
+ *
+ * The prediction is a high percentile of a rolling window of measurements
+ * plus a safety margin. The margin grows each time a frame started on time
+ * still missed its vblank, and shrinks again while frames keep making it.
+ */
+class RenderTimePredictor
+{
+public:
+    /// Until enough frames have been measured fallback is the prediction
+    explicit RenderTimePredictor(std::chrono::microseconds fallback);
+
+    void record(std::chrono::microseconds render_time);
+    void missed_deadline();
+
+    std::chrono::microseconds predicted_render_time() const;
+
+private:
+    static std::size_t const window_size = 64;
+    static std::size_t const min_samples = 8;
+
+    std::chrono::microseconds const fallback;
+    std::array<std::chrono::microseconds, window_size> samples;
+    std::size_t sample_count;
+    std::size_t next_sample;
+
+    std::chrono::microseconds margin;
+    std::size_t frames_since_miss;
+};
+
+}
+}
+}
+
+#endif /* MIR_GRAPHICS_GBM_RENDER_TIME_PREDICTOR_H_ */
@@ -483,6 +483,8 @@ private:
 auto mg::rpi::BufferAllocator::buffer_from_shm(
     wl_resource* buffer,
     std::shared_ptr<mir::Executor> /*wayland_executor*/,
+    std::shared_ptr<Buffer> const& /*previous*/,
+    geometry::Rectangles const& /*damage*/,
     std::function<void()>&& on_consumed) -> std::shared_ptr<Buffer>
 {
     auto shm_buffer = wl_shm_buffer_get(buffer);
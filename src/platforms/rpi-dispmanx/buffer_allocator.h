@@ -73,6 +73,8 @@ public:
 	std::function<void()>&&) override;
 
     std::shared_ptr<Buffer> buffer_from_shm(wl_resource* buffer, std::shared_ptr<mir::Executor> wayland_executor,
+                                            std::shared_ptr<Buffer> const& previous,
+                                            geometry::Rectangles const& damage,
                                             std::function<void()>&& on_consumed) override;
 
 private:
@@ -55,6 +55,8 @@ public:
     auto buffer_from_shm(
         wl_resource* buffer,
         std::shared_ptr<Executor> wayland_executor,
+        std::shared_ptr<Buffer> const& previous,
+        geometry::Rectangles const& damage,
         std::function<void()>&& on_consumed) -> std::shared_ptr<Buffer> override;
 
     std::vector<MirPixelFormat> supported_pixel_formats() override;
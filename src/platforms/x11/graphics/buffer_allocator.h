@@ -68,6 +68,8 @@ public:
     auto buffer_from_shm(
         wl_resource* buffer,
         std::shared_ptr<Executor> wayland_executor,
+        std::shared_ptr<Buffer> const& previous,
+        geometry::Rectangles const& damage,
         std::function<void()>&& on_consumed) -> std::shared_ptr<Buffer> override;
 private:
     std::shared_ptr<renderer::gl::Context> const ctx;
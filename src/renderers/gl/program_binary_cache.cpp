@@ -0,0 +1,284 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define MIR_LOG_COMPONENT "GLRenderer"
+
+#include "program_binary_cache.h"
+#include "mir/log.h"
+
+#include <GLES2/gl2ext.h>
+#include <EGL/egl.h>
+
+#include <boost/filesystem.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include <unistd.h>
+
+namespace mrg = mir::renderer::gl;
+
+namespace
+{
+char const magic[] = "MIRGLPB1";
+
+// Nothing a driver produces comes close; anything larger is a corrupt file
+std::uint32_t const max_binary_size = 64 * 1024 * 1024;
+
+/// FNV-1a: the key is verified on load, so the name only needs to spread entries out
+auto hash_of(std::string const& text) -> std::uint64_t
+{
+    std::uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : text)
+    {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+void write_u32(std::ostream& out, std::uint32_t value)
+{
+    out.write(reinterpret_cast<char const*>(&value), sizeof value);
+}
+
+auto read_u32(std::istream& in) -> std::uint32_t
+{
+    std::uint32_t value{0};
+    in.read(reinterpret_cast<char*>(&value), sizeof value);
+    return value;
+}
+
+auto gl_string(GLenum name) -> std::string
+{
+    auto const value = reinterpret_cast<char const*>(glGetString(name));
+    return value ? value : "";
+}
+
+bool has_gl_extension(char const* name)
+{
+    std::istringstream tokens{gl_string(GL_EXTENSIONS)};
+    std::string token;
+    while (tokens >> token)
+    {
+        if (token == name)
+            return true;
+    }
+    return false;
+}
+
+struct ProgramBinaryOES
+{
+    PFNGLGETPROGRAMBINARYOESPROC glGetProgramBinaryOES;
+    PFNGLPROGRAMBINARYOESPROC glProgramBinaryOES;
+};
+
+/// The GL_OES_get_program_binary entry points, if the current context has a binary format to use
+auto program_binary_oes() -> std::experimental::optional<ProgramBinaryOES>
+{
+    if (!has_gl_extension("GL_OES_get_program_binary"))
+        return {};
+
+    // Some drivers advertise the extension without any formats
+    GLint formats{0};
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_OES, &formats);
+    if (formats <= 0)
+        return {};
+
+    ProgramBinaryOES const entry_points{
+        reinterpret_cast<PFNGLGETPROGRAMBINARYOESPROC>(eglGetProcAddress("glGetProgramBinaryOES")),
+        reinterpret_cast<PFNGLPROGRAMBINARYOESPROC>(eglGetProcAddress("glProgramBinaryOES"))};
+
+    if (!entry_points.glGetProgramBinaryOES || !entry_points.glProgramBinaryOES)
+        return {};
+
+    return entry_points;
+}
+}
+
+mrg::ProgramBinaryCache::ProgramBinaryCache(std::string directory)
+    : directory{std::move(directory)}
+{
+}
+
+auto mrg::ProgramBinaryCache::default_directory() -> std::string
+{
+    if (auto const cache_home = getenv("XDG_CACHE_HOME"))
+    {
+        if (*cache_home)
+            return std::string{cache_home} + "/mir/gl-programs";
+    }
+
+    if (auto const home = getenv("HOME"))
+    {
+        if (*home)
+            return std::string{home} + "/.cache/mir/gl-programs";
+    }
+
+    return {};
+}
+
+auto mrg::ProgramBinaryCache::path_for(std::string const& key) const -> std::string
+{
+    char name[32];
+    snprintf(name, sizeof name, "%016llx.bin", static_cast<unsigned long long>(hash_of(key)));
+    return directory + "/" + name;
+}
+
+auto mrg::ProgramBinaryCache::load(std::string const& key) const -> std::experimental::optional<Binary>
+{
+    if (directory.empty())
+        return {};
+
+    std::ifstream in{path_for(key), std::ios::binary};
+    if (!in)
+        return {};
+
+    char file_magic[sizeof magic - 1];
+    in.read(file_magic, sizeof file_magic);
+    if (!in || memcmp(file_magic, magic, sizeof file_magic) != 0)
+        return {};
+
+    auto const key_size = read_u32(in);
+    if (!in || key_size != key.size())
+        return {};
+
+    std::string file_key(key_size, '\0');
+    in.read(&file_key[0], key_size);
+    if (!in || file_key != key)
+        return {};
+
+    Binary binary;
+    binary.format = read_u32(in);
+    auto const data_size = read_u32(in);
+    if (!in || data_size == 0 || data_size > max_binary_size)
+        return {};
+
+    binary.data.resize(data_size);
+    in.read(binary.data.data(), data_size);
+    if (!in || in.peek() != std::ifstream::traits_type::eof())
+        return {};
+
+    return binary;
+}
+
+void mrg::ProgramBinaryCache::store(std::string const& key, Binary const& binary) const
+{
+    if (directory.empty() || binary.data.empty() || binary.data.size() > max_binary_size)
+        return;
+
+    boost::system::error_code ec;
+    boost::filesystem::create_directories(directory, ec);
+    if (ec)
+        return;
+
+    // Write to a private file and rename it into place, so that nobody
+    // (including another server sharing the cache) sees a partial entry
+    auto const path = path_for(key);
+    std::string temp_path = path + ".XXXXXX";
+    auto const fd = mkstemp(&temp_path[0]);
+    if (fd < 0)
+        return;
+    close(fd);
+
+    {
+        std::ofstream out{temp_path, std::ios::binary | std::ios::trunc};
+        out.write(magic, sizeof magic - 1);
+        write_u32(out, key.size());
+        out.write(key.data(), key.size());
+        write_u32(out, binary.format);
+        write_u32(out, binary.data.size());
+        out.write(binary.data.data(), binary.data.size());
+        out.close();
+
+        if (!out)
+        {
+            unlink(temp_path.c_str());
+            return;
+        }
+    }
+
+    if (rename(temp_path.c_str(), path.c_str()) != 0)
+        unlink(temp_path.c_str());
+}
+
+void mrg::ProgramBinaryCache::discard(std::string const& key) const
+{
+    if (!directory.empty())
+        unlink(path_for(key).c_str());
+}
+
+auto mrg::ProgramBinaryCache::program_for(
+    GLchar const* vertex_src,
+    GLchar const* fragment_src,
+    std::function<GLuint()> const& build) const -> GLuint
+{
+    if (directory.empty())
+        return build();
+
+    auto const oes = program_binary_oes();
+    if (!oes)
+        return build();
+
+    auto const key =
+        gl_string(GL_VENDOR) + '\n' +
+        gl_string(GL_RENDERER) + '\n' +
+        gl_string(GL_VERSION) + '\n' +
+        vertex_src + '\0' + fragment_src;
+
+    if (auto const cached = load(key))
+    {
+        if (auto const program = glCreateProgram())
+        {
+            oes->glProgramBinaryOES(program, cached->format, cached->data.data(), cached->data.size());
+            GLint ok{GL_FALSE};
+            glGetProgramiv(program, GL_LINK_STATUS, &ok);
+            if (ok)
+                return program;
+
+            // The driver is free to reject binaries it made itself (e.g. after
+            // an update that didn't change its version string)
+            glDeleteProgram(program);
+        }
+        discard(key);
+    }
+
+    auto const program = build();
+
+    GLint size{0};
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH_OES, &size);
+    if (size > 0)
+    {
+        Binary binary{0, std::vector<char>(size)};
+        GLsizei written{0};
+        oes->glGetProgramBinaryOES(program, size, &written, &binary.format, binary.data.data());
+        if (written > 0)
+        {
+            binary.data.resize(written);
+            store(key, binary);
+        }
+        else
+        {
+            mir::log_debug("Failed to retrieve GL program binary for caching");
+        }
+    }
+
+    return program;
+}
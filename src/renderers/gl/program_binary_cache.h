@@ -0,0 +1,85 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_RENDERER_GL_PROGRAM_BINARY_CACHE_H_
+#define MIR_RENDERER_GL_PROGRAM_BINARY_CACHE_H_
+
+#include <GLES2/gl2.h>
+
+#include <experimental/optional>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace mir
+{
+namespace renderer
+{
+namespace gl
+{
+/**
+ * Keeps linked GL programs on disk (via GL_OES_get_program_binary) so that
+ * later runs of the server can skip compiling and linking their shaders.
+ *
+ * Entries are keyed by the GL vendor, renderer and version strings along with
+ * the shader sources, so a driver update or a change to a shader simply misses.
+ * Anything going wrong - no extension, no cache directory, an unreadable or
+ * stale file, a binary the driver rejects - falls back to building the program
+ * from source; the cache is never a reason to fail.
+ *
+ * The cache holds no state beyond its directory and is safe to share between
+ * renderers on different threads.
+ */
+class ProgramBinaryCache
+{
+public:
+    struct Binary
+    {
+        GLenum format;
+        std::vector<char> data;
+    };
+
+    /// Caches in directory, creating it when needed; an empty directory disables the cache
+    explicit ProgramBinaryCache(std::string directory);
+
+    /// "mir/gl-programs" under $XDG_CACHE_HOME (or ~/.cache), or empty if neither is known
+    static auto default_directory() -> std::string;
+
+    auto load(std::string const& key) const -> std::experimental::optional<Binary>;
+    void store(std::string const& key, Binary const& binary) const;
+    void discard(std::string const& key) const;
+
+    /**
+     * The program linked from vertex_src and fragment_src, loaded from the
+     * cache if possible, or else made by build() and added to the cache.
+     *
+     * \note This must be called with a current GL context
+     */
+    auto program_for(
+        GLchar const* vertex_src,
+        GLchar const* fragment_src,
+        std::function<GLuint()> const& build) const -> GLuint;
+
+private:
+    auto path_for(std::string const& key) const -> std::string;
+
+    std::string const directory;
+};
+}
+}
+}
+
+#endif // MIR_RENDERER_GL_PROGRAM_BINARY_CACHE_H_
@@ -17,6 +17,7 @@
  */
 
 #include "program_family.h"
+#include "program_binary_cache.h"
 #include <GLES2/gl2.h>
 #include <GLES2/gl2ext.h>
 #include <mutex>
@@ -53,6 +54,11 @@ void ProgramFamily::Shader::init(GLenum type, const GLchar* src)
     }
 }
 
+ProgramFamily::ProgramFamily(std::shared_ptr<ProgramBinaryCache> const& cache)
+    : cache{cache}
+{
+}
+
 ProgramFamily::~ProgramFamily() noexcept
 {
     // shader and program lifetimes are managed manually, so that we don't
@@ -89,30 +95,35 @@ GLuint ProgramFamily::add_program(const GLchar* const vshader_src,
     static std::mutex lp1416482_mutex;
     std::lock_guard<decltype(lp1416482_mutex)> lock{lp1416482_mutex};
 
-    auto& v = vshader[vshader_src];
-    if (!v.id) v.init(GL_VERTEX_SHADER, vshader_src);
-
-    auto& f = fshader[fshader_src];
-    if (!f.id) f.init(GL_FRAGMENT_SHADER, fshader_src);
-
-    auto& p = program[{v.id, f.id}];
+    auto& p = program[{vshader_src, fshader_src}];
     if (!p.id)
     {
-        p.id = glCreateProgram();
-        glAttachShader(p.id, v.id);
-        glAttachShader(p.id, f.id);
-        glLinkProgram(p.id);
-        GLint ok;
-        glGetProgramiv(p.id, GL_LINK_STATUS, &ok);
-        if (!ok)
-        {
-            GLchar log[1024];
-            glGetProgramInfoLog(p.id, sizeof log - 1, NULL, log);
-            log[sizeof log - 1] = '\0';
-            glDeleteShader(p.id);
-            p.id = 0;
-            throw std::runtime_error(std::string("Link failed: ")+log);
-        }
+        auto const build = [&]
+            {
+                auto& v = vshader[vshader_src];
+                if (!v.id) v.init(GL_VERTEX_SHADER, vshader_src);
+
+                auto& f = fshader[fshader_src];
+                if (!f.id) f.init(GL_FRAGMENT_SHADER, fshader_src);
+
+                GLuint const id = glCreateProgram();
+                glAttachShader(id, v.id);
+                glAttachShader(id, f.id);
+                glLinkProgram(id);
+                GLint ok;
+                glGetProgramiv(id, GL_LINK_STATUS, &ok);
+                if (!ok)
+                {
+                    GLchar log[1024];
+                    glGetProgramInfoLog(id, sizeof log - 1, NULL, log);
+                    log[sizeof log - 1] = '\0';
+                    glDeleteProgram(id);
+                    throw std::runtime_error(std::string("Link failed: ")+log);
+                }
+                return id;
+            };
+
+        p.id = cache ? cache->program_for(vshader_src, fshader_src, build) : build();
     }
 
     return p.id;
@@ -19,9 +19,11 @@
 #define MIR_LOG_COMPONENT "GLRenderer"
 
 #include "renderer.h"
+#include "program_binary_cache.h"
 #include "mir/compositor/buffer_stream.h"
 #include "mir/gl/default_program_factory.h"
 #include "mir/graphics/renderable.h"
+#include "mir/geometry/region.h"
 #include "mir/graphics/buffer.h"
 #include "mir/graphics/display_buffer.h"
 #include "mir/gl/tessellation_helpers.h"
@@ -42,6 +44,7 @@
 #include <boost/throw_exception.hpp>
 #include <stdexcept>
 #include <cmath>
+#include <cstddef>
 #include <sstream>
 
 namespace mg = mir::graphics;
@@ -155,10 +158,100 @@ public:
         return id;
     }
 
+    /// Stop managing (and return) the GL object
+    GLuint release()
+    {
+        auto const released = id;
+        id = 0;
+        return released;
+    }
+
 private:
     GLuint id;
 };
 
+// Back buffers older than this are fully repainted
+std::size_t const max_tracked_buffer_age = 4;
+
+bool has_egl_extension(EGLDisplay dpy, char const* name)
+{
+    auto const extensions = eglQueryString(dpy, EGL_EXTENSIONS);
+    if (!extensions)
+        return false;
+
+    std::istringstream tokens{extensions};
+    std::string token;
+    while (tokens >> token)
+    {
+        if (token == name)
+            return true;
+    }
+    return false;
+}
+
+/// rects with cut removed, as rectangles that don't overlap cut
+void scissor_to(geom::Rectangle const& area, geom::Rectangle const& viewport)
+{
+    glScissor(
+        area.top_left.x.as_int() - viewport.top_left.x.as_int(),
+        viewport.top_left.y.as_int() + viewport.size.height.as_int() -
+            area.top_left.y.as_int() - area.size.height.as_int(),
+        area.size.width.as_int(),
+        area.size.height.as_int());
+}
+
+/// The parameters of glBlendFuncSeparate() (and glBlendColor(), for GL_ONE_MINUS_CONSTANT_ALPHA)
+struct Blend
+{
+    GLenum src_rgb, dst_rgb, src_alpha, dst_alpha;
+    GLfloat constant_alpha;
+};
+
+bool operator==(Blend const& lhs, Blend const& rhs)
+{
+    return lhs.src_rgb == rhs.src_rgb &&
+           lhs.dst_rgb == rhs.dst_rgb &&
+           lhs.src_alpha == rhs.src_alpha &&
+           lhs.dst_alpha == rhs.dst_alpha &&
+           lhs.constant_alpha == rhs.constant_alpha;
+}
+
+Blend const opaque_blend{GL_ONE, GL_ZERO, GL_ZERO, GL_ONE, 1.0f};
+
+/// Appends primitive as GL_TRIANGLES, so that consecutive primitives can share a draw call
+void append_triangles(mgl::Primitive const& primitive, std::vector<mgl::Vertex>& vertices)
+{
+    auto const& v = primitive.vertices;
+    switch (primitive.type)
+    {
+    case GL_TRIANGLES:
+        vertices.insert(vertices.end(), v, v + primitive.nvertices);
+        break;
+
+    case GL_TRIANGLE_STRIP:
+        for (int i = 2; i < primitive.nvertices; ++i)
+        {
+            // Every other triangle of a strip is wound the other way
+            if (i % 2 == 0)
+                vertices.insert(vertices.end(), {v[i - 2], v[i - 1], v[i]});
+            else
+                vertices.insert(vertices.end(), {v[i - 1], v[i - 2], v[i]});
+        }
+        break;
+
+    case GL_TRIANGLE_FAN:
+        for (int i = 2; i < primitive.nvertices; ++i)
+        {
+            vertices.insert(vertices.end(), {v[0], v[i - 1], v[i]});
+        }
+        break;
+
+    default:
+        mir::log_warning("Ignoring GL primitive of unsupported type %d", primitive.type);
+        break;
+    }
+}
+
 using ProgramHandle = GLHandle<&glDeleteProgram>;
 using ShaderHandle = GLHandle<&glDeleteShader>;
 
@@ -193,14 +286,21 @@ const GLchar* const vertex_shader_src =
     "   v_texcoord = texcoord;\n"
     "}\n"
 };
+
+/// Shared by every renderer: the cache itself is stateless apart from its directory
+auto shared_program_cache() -> std::shared_ptr<mrg::ProgramBinaryCache>
+{
+    static auto const cache =
+        std::make_shared<mrg::ProgramBinaryCache>(mrg::ProgramBinaryCache::default_directory());
+    return cache;
+}
 }
 
 class mrg::Renderer::ProgramFactory : public mir::graphics::gl::ProgramFactory
 {
 public:
-    // NOTE: This must be called with a current GL context
-    ProgramFactory()
-        : vertex_shader{compile_shader(GL_VERTEX_SHADER, vertex_shader_src)}
+    explicit ProgramFactory(std::shared_ptr<ProgramBinaryCache> const& cache)
+        : cache{cache}
     {
     }
 
@@ -260,22 +360,38 @@ public:
         // GL shader compilation is *not* threadsafe, and requires external synchronisation
         std::lock_guard<std::mutex> lock{compilation_mutex};
 
-        ShaderHandle const opaque_shader{
-            compile_shader(GL_FRAGMENT_SHADER, opaque_fragment.str().c_str())};
-        ShaderHandle const alpha_shader{
-            compile_shader(GL_FRAGMENT_SHADER, alpha_fragment.str().c_str())};
+        auto const opaque_src = opaque_fragment.str();
+        auto const alpha_src = alpha_fragment.str();
 
         programs.emplace_back(id, std::make_unique<::Program>(
-            link_shader(vertex_shader, opaque_shader),
-            link_shader(vertex_shader, alpha_shader)));
+            program_for(opaque_src.c_str()),
+            program_for(alpha_src.c_str())));
 
         return *programs.back().second;
-
-        // We delete opaque_shader and alpha_shader here. This is fine; it only marks them
-        // for deletion. GL will only delete them once the GL Program they're linked in is destroyed.
     }
 
 private:
+    // NOTE: This must be called with a current GL context and compilation_mutex held
+    ProgramHandle program_for(GLchar const* fragment_src)
+    {
+        return ProgramHandle{cache->program_for(vertex_shader_src, fragment_src, [&]
+            {
+                ShaderHandle const fragment_shader{compile_shader(GL_FRAGMENT_SHADER, fragment_src)};
+                return link_shader(vertex(), fragment_shader).release();
+
+                // We delete fragment_shader here. This is fine; it only marks it for deletion.
+                // GL will only delete it once the GL Program it's linked in is destroyed.
+            })};
+    }
+
+    /// The vertex shader is only compiled once a program misses the cache
+    ShaderHandle const& vertex()
+    {
+        if (!vertex_shader)
+            vertex_shader.emplace(compile_shader(GL_VERTEX_SHADER, vertex_shader_src));
+        return *vertex_shader;
+    }
+
     static GLuint compile_shader(GLenum type, GLchar const* src)
     {
         GLuint id = glCreateShader(type);
@@ -324,12 +440,50 @@ private:
         return program;
     }
 
-    ShaderHandle const vertex_shader;
+    std::shared_ptr<ProgramBinaryCache> const cache;
+    std::experimental::optional<ShaderHandle> vertex_shader;
     std::vector<std::pair<void*, std::unique_ptr<::Program>>> programs;
     // GL requires us to synchronise multi-threaded access to the shader APIs.
     std::mutex compilation_mutex;
 };
 
+class mrg::Renderer::FrameBatch
+{
+public:
+    /// Everything needed to draw one renderable from the frame's vertex buffer
+    struct Draw
+    {
+        Program const* program;
+        std::shared_ptr<mg::gl::Texture> texture;
+        std::shared_ptr<mgl::Texture> fallback_texture;
+        std::experimental::optional<geom::Rectangle> clip_area;
+        glm::vec2 centre;
+        glm::mat4 transform;
+        float alpha;
+        Blend blend;                ///< How the parts not known to be opaque are drawn
+        GLint first_vertex;
+        GLsizei opaque_vertices;    ///< Drawn first, without blending
+        GLsizei blended_vertices;
+    };
+
+    // NOTE: This must be called with a current GL context
+    FrameBatch()
+    {
+        glGenBuffers(1, &vertex_buffer);
+    }
+
+    ~FrameBatch()
+    {
+        if (vertex_buffer)
+            glDeleteBuffers(1, &vertex_buffer);
+    }
+
+    GLuint vertex_buffer{0};
+    // These keep their capacity from frame to frame
+    std::vector<mgl::Vertex> vertices;
+    std::vector<Draw> draws;
+};
+
 mrg::Renderer::Program::Program(GLuint program_id)
 {
     id = program_id;
@@ -353,9 +507,11 @@ mrg::Renderer::Program::Program(GLuint program_id)
 mrg::Renderer::Renderer(graphics::DisplayBuffer& display_buffer)
     : render_target(&display_buffer),
       clear_color{0.0f, 0.0f, 0.0f, 0.0f},
+      family{shared_program_cache()},
       default_program(family.add_program(vshader, default_fshader)),
       alpha_program(family.add_program(vshader, alpha_fshader)),
-      program_factory{std::make_unique<ProgramFactory>()},
+      program_factory{std::make_unique<ProgramFactory>(shared_program_cache())},
+      batch{std::make_unique<FrameBatch>()},
       texture_cache(mgl::DefaultProgramFactory().create_texture_cache()),
       display_transform(1)
 {
@@ -375,6 +531,14 @@ mrg::Renderer::Renderer(graphics::DisplayBuffer& display_buffer)
             auto val = eglQueryString(disp, s.id);
             mir::log_info(std::string(s.label) + ": " + (val ? val : ""));
         }
+
+        // EGL_KHR_partial_update implies buffer age queries too
+        if (has_egl_extension(disp, "EGL_KHR_partial_update"))
+        {
+            eglSetDamageRegionKHR = reinterpret_cast<PFNEGLSETDAMAGEREGIONKHRPROC>(
+                eglGetProcAddress("eglSetDamageRegionKHR"));
+        }
+        has_buffer_age = eglSetDamageRegionKHR || has_egl_extension(disp, "EGL_EXT_buffer_age");
     }
 
     struct {GLenum id; char const* label;} const glstrings[] =
@@ -427,18 +591,49 @@ void mrg::Renderer::render(mg::RenderableList const& renderables) const
 {
     render_target.bind();
 
+    repaint_area = area_to_repaint();
+    if (repaint_area)
+    {
+        auto const& area = repaint_area.value();
+        if (eglSetDamageRegionKHR)
+        {
+            // Damage regions are in surface coordinates, origin at bottom-left
+            EGLint rect[4] = {
+                area.top_left.x.as_int() - viewport.top_left.x.as_int(),
+                viewport.top_left.y.as_int() + viewport.size.height.as_int() -
+                    area.top_left.y.as_int() - area.size.height.as_int(),
+                area.size.width.as_int(),
+                area.size.height.as_int()};
+            eglSetDamageRegionKHR(eglGetCurrentDisplay(), eglGetCurrentSurface(EGL_DRAW), rect, 1);
+        }
+        glEnable(GL_SCISSOR_TEST);
+        scissor_to(area, viewport);
+    }
+
     glClearColor(clear_color[0], clear_color[1], clear_color[2], clear_color[3]);
     glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
     glClear(GL_COLOR_BUFFER_BIT);
 
     ++frameno;
+    batch->vertices.clear();
     for (auto const& r : renderables)
     {
-        draw(*r);
+        add_to_batch(*r);
     }
+    draw_batch();
+
+    if (repaint_area)
+        glDisable(GL_SCISSOR_TEST);
 
     render_target.swap_buffers();
 
+    if (!repaint_area)
+    {
+        // Back buffers older than this frame can no longer be patched up
+        needs_full_repaint = false;
+        damage_history.clear();
+    }
+
     // Deleting unused textures only requires the GL context. This clean-up
     // does not affect screen contents so can happen after swap_buffers...
     texture_cache->drop_unused();
@@ -447,22 +642,52 @@ void mrg::Renderer::render(mg::RenderableList const& renderables) const
         mir::log_debug("GL error: %d", gl_error);
 }
 
-void mrg::Renderer::draw(mg::Renderable const& renderable) const
+std::experimental::optional<geom::Rectangle> mrg::Renderer::area_to_repaint() const
 {
-    auto const clip_area = renderable.clip_area();
-    if (clip_area)
+    if (needs_full_repaint || !has_buffer_age || !viewport_is_unscaled || damage_history.empty())
+        return {};
+
+    EGLint age{0};
+    if (!eglQuerySurface(eglGetCurrentDisplay(), eglGetCurrentSurface(EGL_DRAW), EGL_BUFFER_AGE_EXT, &age))
+        return {};
+
+    // Age zero means the contents are undefined. Otherwise the buffer is
+    // missing the changes from the last "age" frames.
+    if (age <= 0 || static_cast<std::size_t>(age) > damage_history.size())
+        return {};
+
+    geom::Rectangles damage;
+    for (auto frame = damage_history.begin(); frame != damage_history.begin() + age; ++frame)
     {
-        glEnable(GL_SCISSOR_TEST);
-        glScissor(
-            clip_area.value().top_left.x.as_int() -
-                viewport.top_left.x.as_int(),
-            viewport.top_left.y.as_int() +
-                viewport.size.height.as_int() -
-                clip_area.value().top_left.y.as_int() -
-                clip_area.value().size.height.as_int(),
-            clip_area.value().size.width.as_int(), 
-            clip_area.value().size.height.as_int()
-        );
+        for (auto const& rect : *frame)
+            damage.add(rect);
+    }
+
+    return damage.bounding_rectangle().intersection_with(viewport);
+}
+
+void mrg::Renderer::add_to_batch(mg::Renderable const& renderable) const
+{
+    static glm::mat4 const identity(1);
+
+    if (repaint_area &&
+        renderable.transformation() == identity &&
+        !renderable.screen_position().overlaps(repaint_area.value()))
+    {
+        // Nothing of this renderable needs repainting, but keep its texture
+        // cached for when it does.
+        if (!std::dynamic_pointer_cast<mg::gl::Texture>(renderable.buffer()))
+        {
+            try
+            {
+                texture_cache->load(renderable);
+            }
+            catch (std::exception const&)
+            {
+                report_exception();
+            }
+        }
+        return;
     }
 
     auto const texture = std::dynamic_pointer_cast<mg::gl::Texture>(renderable.buffer());
@@ -512,41 +737,24 @@ void mrg::Renderer::draw(mg::Renderable const& renderable) const
         return;
     }
 
-    auto const& prog = *maybe_prog;
-
-    glUseProgram(prog.id);
-    if (prog.last_used_frameno != frameno)
-    {   // Avoid reloading the screen-global uniforms on every renderable
-        // TODO: We actually only need to bind these *once*, right? Not once per frame?
-        prog.last_used_frameno = frameno;
-        for (auto i = 0u; i < prog.tex_uniforms.size(); ++i)
-        {
-            if (prog.tex_uniforms[i] != -1)
-            {
-                glUniform1i(prog.tex_uniforms[i], i);
-            }
-        }
-        glUniformMatrix4fv(prog.display_transform_uniform, 1, GL_FALSE,
-                           glm::value_ptr(display_transform));
-        glUniformMatrix4fv(prog.screen_to_gl_coords_uniform, 1, GL_FALSE,
-                           glm::value_ptr(screen_to_gl_coords));
-    }
-
-    glActiveTexture(GL_TEXTURE0);
+    FrameBatch::Draw draw;
+    draw.program = maybe_prog;
+    draw.texture = texture;
+    draw.fallback_texture = surface_tex;
+    draw.clip_area = renderable.clip_area();
+    draw.alpha = renderable.alpha();
 
     auto const& rect = renderable.screen_position();
-    GLfloat centrex = rect.top_left.x.as_int() +
-                      rect.size.width.as_int() / 2.0f;
-    GLfloat centrey = rect.top_left.y.as_int() +
-                      rect.size.height.as_int() / 2.0f;
-    glUniform2f(prog.centre_uniform, centrex, centrey);
+    draw.centre = glm::vec2{
+        rect.top_left.x.as_int() + rect.size.width.as_int() / 2.0f,
+        rect.top_left.y.as_int() + rect.size.height.as_int() / 2.0f};
 
-    glm::mat4 transform = renderable.transformation();
+    draw.transform = renderable.transformation();
     if (texture && (texture->layout() == mg::gl::Texture::Layout::TopRowFirst))
     {
         // GL textures have (0,0) at bottom-left rather than top-left
         // We have to invert this texture to get it the way up GL expects.
-        transform *= glm::mat4{
+        draw.transform *= glm::mat4{
             1.0, 0.0, 0.0, 0.0,
             0.0, -1.0, 0.0, 0.0,
             0.0, 0.0, 1.0, 0.0,
@@ -554,100 +762,221 @@ void mrg::Renderer::draw(mg::Renderable const& renderable) const
         };
     }
 
-    glUniformMatrix4fv(prog.transform_uniform, 1, GL_FALSE,
-                       glm::value_ptr(transform));
+    primitives.clear();
 
-    if (prog.alpha_uniform >= 0)
-        glUniform1f(prog.alpha_uniform, renderable.alpha());
+    // The opaque parts of a translucent buffer can be drawn without blending.
+    // (We don't know what a transformation or flipped texture does to them.)
+    bool const shaped = renderable.shaped();
+    std::size_t opaque_primitives = 0;
+    auto const opaque_region = renderable.opaque_region();
+    if (shaped &&
+        renderable.alpha() == 1.0f &&
+        opaque_region.size() > 0 &&
+        renderable.transformation() == identity &&
+        !(texture && texture->layout() == mg::gl::Texture::Layout::TopRowFirst))
+    {
+        auto const whole = renderable.screen_position();
+        geom::Region opaque{opaque_region};
+        opaque.intersect(whole);
+        geom::Region translucent{whole};
+        translucent.subtract(opaque);
+
+        for (auto const& rect : opaque.rectangles())
+            primitives.push_back(mgl::tessellate_renderable_into_rectangle(renderable, {}, rect));
+        opaque_primitives = primitives.size();
+
+        for (auto const& rect : translucent.rectangles())
+            primitives.push_back(mgl::tessellate_renderable_into_rectangle(renderable, {}, rect));
+    }
+    else
+    {
+        tessellate(primitives, renderable);
+    }
 
-    glEnableVertexAttribArray(prog.position_attr);
-    glEnableVertexAttribArray(prog.texcoord_attr);
+    // These renderable method names could be better (see LP: #1236224)
+    if (shaped)  // Client is RGBA:
+    {
+        draw.blend = {GL_ONE, GL_ONE_MINUS_SRC_ALPHA,
+                      GL_ONE, GL_ONE_MINUS_SRC_ALPHA, 1.0f};
+    }
+    else if (renderable.alpha() == 1.0f)  // RGBX and no window translucency:
+    {
+        draw.blend = opaque_blend;  // Avoid using src_alpha!
+    }
+    else
+    {   // Client is RGBX but we also have window translucency.
+        // The texture alpha channel is possibly uninitialized so we must be
+        // careful and avoid using SRC_ALPHA (LP: #1423462).
+        draw.blend = {GL_ONE,  GL_ONE_MINUS_CONSTANT_ALPHA,
+                      GL_ZERO, GL_ONE, renderable.alpha()};
+    }
 
-    primitives.clear();
-    tessellate(primitives, renderable);
+    auto& vertices = batch->vertices;
+    draw.first_vertex = vertices.size();
+    for (std::size_t i = 0; i != opaque_primitives; ++i)
+        append_triangles(primitives[i], vertices);
+    draw.opaque_vertices = vertices.size() - draw.first_vertex;
+    for (std::size_t i = opaque_primitives; i != primitives.size(); ++i)
+        append_triangles(primitives[i], vertices);
+    draw.blended_vertices = vertices.size() - draw.first_vertex - draw.opaque_vertices;
 
-    // if we fail to load the texture, we need to carry on (part of lp:1629275)
-    try
-    {
-        typedef struct  // Represents parameters of glBlendFuncSeparate()
-        {
-            GLenum src_rgb, dst_rgb, src_alpha, dst_alpha;
-        } BlendSeparate;
+    batch->draws.push_back(std::move(draw));
+}
 
-        BlendSeparate client_blend;
+void mrg::Renderer::draw_batch() const
+{
+    auto& draws = batch->draws;
+    auto& vertices = batch->vertices;
 
-        // These renderable method names could be better (see LP: #1236224)
-        if (renderable.shaped())  // Client is RGBA:
-        {
-            client_blend = {GL_ONE, GL_ONE_MINUS_SRC_ALPHA,
-                            GL_ONE, GL_ONE_MINUS_SRC_ALPHA};
-        }
-        else if (renderable.alpha() == 1.0f)  // RGBX and no window translucency:
-        {
-            client_blend = {GL_ONE,  GL_ZERO,
-                            GL_ZERO, GL_ONE};  // Avoid using src_alpha!
-        }
-        else
-        {   // Client is RGBX but we also have window translucency.
-            // The texture alpha channel is possibly uninitialized so we must be
-            // careful and avoid using SRC_ALPHA (LP: #1423462).
-            client_blend = {GL_ONE,  GL_ONE_MINUS_CONSTANT_ALPHA,
-                            GL_ZERO, GL_ONE};
-            glBlendColor(0.0f, 0.0f, 0.0f, renderable.alpha());
-        }
+    if (draws.empty())
+        return;
 
-        for (auto const& p : primitives)
+    // One upload for the whole frame; GL_STREAM_DRAW lets the driver orphan
+    // last frame's storage rather than wait for the GPU to finish with it.
+    glBindBuffer(GL_ARRAY_BUFFER, batch->vertex_buffer);
+    glBufferData(
+        GL_ARRAY_BUFFER,
+        vertices.size() * sizeof(mgl::Vertex),
+        vertices.data(),
+        GL_STREAM_DRAW);
+
+    // GL state is only set when it changes from the previous draw
+    Program const* current_program{nullptr};
+    std::experimental::optional<Blend> current_blend;
+
+    auto const set_blend =
+        [&current_blend](Blend const& blend)
         {
-            BlendSeparate blend;
+            if (current_blend && current_blend.value() == blend)
+                return;
 
-            blend = client_blend;
-            if (surface_tex)
+            if (blend.dst_rgb == GL_ZERO)
             {
-                surface_tex->bind();
+                glDisable(GL_BLEND);
             }
             else
             {
-                texture->bind();
+                if (!current_blend || current_blend.value().dst_rgb == GL_ZERO)
+                    glEnable(GL_BLEND);
+                if (blend.dst_rgb == GL_ONE_MINUS_CONSTANT_ALPHA)
+                    glBlendColor(0.0f, 0.0f, 0.0f, blend.constant_alpha);
+                glBlendFuncSeparate(blend.src_rgb,   blend.dst_rgb,
+                                    blend.src_alpha, blend.dst_alpha);
+            }
+            current_blend = blend;
+        };
+
+    for (auto const& draw : draws)
+    {
+        auto const& prog = *draw.program;
+
+        if (&prog != current_program)
+        {
+            if (current_program)
+            {
+                glDisableVertexAttribArray(current_program->texcoord_attr);
+                glDisableVertexAttribArray(current_program->position_attr);
             }
 
+            glUseProgram(prog.id);
+            if (prog.last_used_frameno != frameno)
+            {   // Avoid reloading the screen-global uniforms on every renderable
+                // TODO: We actually only need to bind these *once*, right? Not once per frame?
+                prog.last_used_frameno = frameno;
+                for (auto i = 0u; i < prog.tex_uniforms.size(); ++i)
+                {
+                    if (prog.tex_uniforms[i] != -1)
+                    {
+                        glUniform1i(prog.tex_uniforms[i], i);
+                    }
+                }
+                glUniformMatrix4fv(prog.display_transform_uniform, 1, GL_FALSE,
+                                   glm::value_ptr(display_transform));
+                glUniformMatrix4fv(prog.screen_to_gl_coords_uniform, 1, GL_FALSE,
+                                   glm::value_ptr(screen_to_gl_coords));
+            }
+
+            glEnableVertexAttribArray(prog.position_attr);
+            glEnableVertexAttribArray(prog.texcoord_attr);
             glVertexAttribPointer(prog.position_attr, 3, GL_FLOAT,
                                   GL_FALSE, sizeof(mgl::Vertex),
-                                  &p.vertices[0].position);
+                                  reinterpret_cast<void const*>(offsetof(mgl::Vertex, position)));
             glVertexAttribPointer(prog.texcoord_attr, 2, GL_FLOAT,
                                   GL_FALSE, sizeof(mgl::Vertex),
-                                  &p.vertices[0].texcoord);
+                                  reinterpret_cast<void const*>(offsetof(mgl::Vertex, texcoord)));
 
-            if (blend.dst_rgb == GL_ZERO)
+            current_program = &prog;
+        }
+
+        if (draw.clip_area)
+        {
+            glEnable(GL_SCISSOR_TEST);
+            scissor_to(
+                repaint_area ?
+                    draw.clip_area.value().intersection_with(repaint_area.value()) :
+                    draw.clip_area.value(),
+                viewport);
+        }
+
+        glUniform2f(prog.centre_uniform, draw.centre.x, draw.centre.y);
+        glUniformMatrix4fv(prog.transform_uniform, 1, GL_FALSE,
+                           glm::value_ptr(draw.transform));
+        if (prog.alpha_uniform >= 0)
+            glUniform1f(prog.alpha_uniform, draw.alpha);
+
+        // if we fail to load the texture, we need to carry on (part of lp:1629275)
+        try
+        {
+            glActiveTexture(GL_TEXTURE0);
+            if (draw.fallback_texture)
             {
-                glDisable(GL_BLEND);
+                draw.fallback_texture->bind();
             }
             else
             {
-                glEnable(GL_BLEND);
-                glBlendFuncSeparate(blend.src_rgb,   blend.dst_rgb,
-                                    blend.src_alpha, blend.dst_alpha);
+                draw.texture->bind();
             }
 
-            glDrawArrays(p.type, 0, p.nvertices);
+            if (draw.opaque_vertices > 0)
+            {
+                set_blend(opaque_blend);
+                glDrawArrays(GL_TRIANGLES, draw.first_vertex, draw.opaque_vertices);
+            }
+            if (draw.blended_vertices > 0)
+            {
+                set_blend(draw.blend);
+                glDrawArrays(GL_TRIANGLES, draw.first_vertex + draw.opaque_vertices, draw.blended_vertices);
+            }
 
-            if (texture)
+            if (draw.texture)
             {
                 // We're done with the texture for now
-                texture->add_syncpoint();
+                draw.texture->add_syncpoint();
             }
         }
-    }
-    catch (std::exception const& ex)
-    {
-        report_exception();
+        catch (std::exception const& ex)
+        {
+            report_exception();
+        }
+
+        if (draw.clip_area)
+        {
+            if (repaint_area)
+                scissor_to(repaint_area.value(), viewport);
+            else
+                glDisable(GL_SCISSOR_TEST);
+        }
     }
 
-    glDisableVertexAttribArray(prog.texcoord_attr);
-    glDisableVertexAttribArray(prog.position_attr);
-    if (renderable.clip_area())
+    if (current_program)
     {
-        glDisable(GL_SCISSOR_TEST);
+        glDisableVertexAttribArray(current_program->texcoord_attr);
+        glDisableVertexAttribArray(current_program->position_attr);
     }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // Don't hold on to the buffers until the next frame
+    draws.clear();
 }
 
 void mrg::Renderer::set_viewport(geometry::Rectangle const& rect)
@@ -690,6 +1019,7 @@ void mrg::Renderer::set_viewport(geometry::Rectangle const& rect)
                       0.0f});
 
     viewport = rect;
+    needs_full_repaint = true;
     update_gl_viewport();
 }
 
@@ -711,6 +1041,8 @@ void mrg::Renderer::update_gl_viewport()
     auto surf = eglGetCurrentSurface(EGL_DRAW);
     EGLint buf_width = 0, buf_height = 0;
 
+    viewport_is_unscaled = false;
+
     if (viewport_width > 0.0f && viewport_height > 0.0f &&
         eglQuerySurface(dpy, surf, EGL_WIDTH, &buf_width) && buf_width > 0 &&
         eglQuerySurface(dpy, surf, EGL_HEIGHT, &buf_height) && buf_height > 0)
@@ -726,6 +1058,13 @@ void mrg::Renderer::update_gl_viewport()
         GLint offset_y = (buf_height - reduced_height) / 2;
 
         glViewport(offset_x, offset_y, reduced_width, reduced_height);
+
+        // Partial repaints are scissored in viewport coordinates, which
+        // only match the framebuffer if nothing is rotated or scaled.
+        viewport_is_unscaled =
+            display_transform == glm::mat4(1) &&
+            buf_width == viewport.size.width.as_int() &&
+            buf_height == viewport.size.height.as_int();
     }
 }
 
@@ -735,12 +1074,23 @@ void mrg::Renderer::set_output_transform(glm::mat2 const& t)
     if (new_display_transform != display_transform)
     {
         display_transform = new_display_transform;
+        needs_full_repaint = true;
         update_gl_viewport();
     }
 }
 
+void mrg::Renderer::set_damage(geom::Rectangles const& damage)
+{
+    damage_history.push_front(damage);
+    if (damage_history.size() > max_tracked_buffer_age)
+        damage_history.pop_back();
+}
+
 void mrg::Renderer::suspend()
 {
     texture_cache->invalidate();
+    // Whatever was shown instead did not go through our back buffers, and
+    // their age doesn't count the frames that were skipped
+    needs_full_repaint = true;
 }
 
@@ -29,6 +29,10 @@
 #include "mir/renderer/gl/render_target.h"
 
 #include <GLES2/gl2.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <deque>
+#include <experimental/optional>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -65,6 +69,7 @@ public:
     // These are called with a valid GL context:
     void set_viewport(geometry::Rectangle const& rect) override;
     void set_output_transform(glm::mat2 const&) override;
+    void set_damage(geometry::Rectangles const& damage) override;
     void render(graphics::RenderableList const&) const override;
 
     // This is called _without_ a GL context:
@@ -103,6 +108,14 @@ protected:
      *                            grown and/or modified.
      * \param [in]     renderable The renderable surface being tessellated.
      *
+     * \note Renderables with an opaque_region() are not passed through
+     *       tessellate(), but split into rectangles so their opaque parts
+     *       can be drawn without blending.
+     *
+     * \note Primitives must be GL_TRIANGLES, GL_TRIANGLE_STRIP or
+     *       GL_TRIANGLE_FAN. They are converted to GL_TRIANGLES so that
+     *       all of a renderable's primitives can be drawn in one call.
+     *
      * \note The cohesion of this function to gl::Renderer is quite loose and it
      *       does not strictly need to reside here.
      *       However it seems a good choice under gl::Renderer while this remains
@@ -123,18 +136,45 @@ protected:
     static const GLchar* const default_fshader;
     static const GLchar* const alpha_fshader;
 
-    virtual void draw(graphics::Renderable const& renderable) const;
-
 private:
     void update_gl_viewport();
 
+    /**
+     * Tessellate renderable into the frame's vertex buffer, to be drawn by
+     * draw_batch().
+     *
+     * Drawing the whole frame from one buffer means a single upload, and one
+     * draw call per renderable (two if it has an opaque region) rather than
+     * one per primitive, with GL state only set where it changes.
+     */
+    void add_to_batch(graphics::Renderable const& renderable) const;
+    void draw_batch() const;
+
+    /**
+     * The part of the viewport that needs repainting, or nothing if the
+     * whole viewport does. This depends on the age of the back buffer
+     * (EGL_EXT_buffer_age) so must be called after binding the render target.
+     */
+    std::experimental::optional<geometry::Rectangle> area_to_repaint() const;
+
     class ProgramFactory;
     std::unique_ptr<ProgramFactory> const program_factory;
+    class FrameBatch;
+    std::unique_ptr<FrameBatch> const batch;
     std::unique_ptr<mir::gl::TextureCache> const texture_cache;
     geometry::Rectangle viewport;
     glm::mat4 screen_to_gl_coords;
     glm::mat4 display_transform;
     std::vector<mir::gl::Primitive> mutable primitives;
+
+    // Damage of the frames since the last full repaint, newest first
+    std::deque<geometry::Rectangles> mutable damage_history;
+    // Set when the back buffers can't be trusted, until the next full frame
+    bool mutable needs_full_repaint{true};
+    std::experimental::optional<geometry::Rectangle> mutable repaint_area;
+    bool viewport_is_unscaled{false};
+    bool has_buffer_age{false};
+    PFNEGLSETDAMAGEREGIONKHRPROC eglSetDamageRegionKHR{nullptr};
 };
 
 }
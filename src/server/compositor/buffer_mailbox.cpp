@@ -0,0 +1,289 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "buffer_mailbox.h"
+#include "mir/graphics/buffer.h"
+
+#include <boost/throw_exception.hpp>
+#include <stdexcept>
+
+namespace mc = mir::compositor;
+namespace mg = mir::graphics;
+
+/*
+ * All the atomics here use the default (sequentially consistent) ordering;
+ * the correctness arguments below rely on there being a single total order
+ * of the loads and stores involved.
+ *
+ * The published word packs:
+ *  - bits 0-4: the slot holding the latest buffer
+ *  - bit 5: set if there is no buffer on offer
+ *  - bits 6-21: the acquirers currently copying the latest buffer
+ *  - the rest: the generation, incremented on every post() and take()
+ *
+ * An acquirer counts itself in the published word with the same
+ * compare-and-swap that reads it, so the slot it read cannot be emptied
+ * before it is done. When it is done it takes itself off the count again if
+ * the post is still current. Otherwise the poster has replaced the post,
+ * moving the count into the slot's retired_readers, and whichever of them
+ * brings that to zero empties the slot for reuse.
+ *
+ * A buffer is only written to a slot that is not in use, and so has no readers.
+ */
+namespace
+{
+std::uint64_t const slot_mask{(1 << 5) - 1};
+std::uint64_t const empty_bit{1 << 5};
+int const readers_shift{6};
+std::uint64_t const one_reader{std::uint64_t{1} << readers_shift};
+std::uint64_t const readers_mask{((std::uint64_t{1} << 16) - 1) << readers_shift};
+int const generation_shift{22};
+
+auto generation_of(std::uint64_t published) -> std::uint64_t
+{
+    return published >> generation_shift;
+}
+
+auto slot_of(std::uint64_t published) -> std::size_t
+{
+    return published & slot_mask;
+}
+
+auto readers_of(std::uint64_t published) -> std::int64_t
+{
+    return (published & readers_mask) >> readers_shift;
+}
+
+auto next_published(std::uint64_t current, std::size_t slot, bool empty) -> std::uint64_t
+{
+    return ((generation_of(current) + 1) << generation_shift) | (empty ? empty_bit : 0) | slot;
+}
+
+/*
+ * A consumer's seen word holds the generation it last acquired in the low
+ * bits and the number of times its entry has been reclaimed in the high
+ * bits, so that a consumer cannot record into an entry taken from under it.
+ */
+int const tag_shift{48};
+std::uint64_t const generation_mask{(std::uint64_t{1} << tag_shift) - 1};
+
+auto seen_generation(std::uint64_t seen) -> std::uint64_t
+{
+    return seen & generation_mask;
+}
+
+auto with_generation(std::uint64_t seen, std::uint64_t generation) -> std::uint64_t
+{
+    return (seen & ~generation_mask) | (generation & generation_mask);
+}
+
+auto retagged(std::uint64_t seen, std::uint64_t generation) -> std::uint64_t
+{
+    return with_generation(seen + (std::uint64_t{1} << tag_shift), generation);
+}
+
+/// Never matches a (masked) generation, so its owner is treated as not having seen anything
+std::uint64_t const never_seen{generation_mask};
+}
+
+mc::BufferMailbox::BufferMailbox()
+    : published{empty_bit}
+{
+    static_assert(std::tuple_size<decltype(slots)>::value <= slot_mask + 1, "slot index must fit in the published word");
+}
+
+mc::BufferMailbox::~BufferMailbox() = default;
+
+void mc::BufferMailbox::post(std::shared_ptr<mg::Buffer> const& buffer)
+{
+    auto const slot = claim_free_slot();
+    slots[slot].buffer = buffer;
+
+    // Only acquirers change the published word besides us, and they leave the generation alone
+    auto const current = published.load();
+    retire(published.exchange(next_published(current, slot, false)));
+}
+
+auto mc::BufferMailbox::take() -> std::shared_ptr<mg::Buffer>
+{
+    auto const current = published.load();
+    if (current & empty_bit)
+        return {};
+
+    // Nobody else writes to a published slot, so this is safe alongside the acquirers' copies
+    auto buffer = slots[slot_of(current)].buffer;
+    retire(published.exchange(next_published(current, slot_of(current), true)));
+
+    return buffer;
+}
+
+std::shared_ptr<mg::Buffer> mc::BufferMailbox::compositor_acquire(CompositorID id)
+{
+    auto buffer = try_compositor_acquire(id);
+
+    if (!buffer)
+        BOOST_THROW_EXCEPTION(std::logic_error("no buffer to give to compositor"));
+
+    return buffer;
+}
+
+auto mc::BufferMailbox::try_compositor_acquire(CompositorID id) -> std::shared_ptr<mg::Buffer>
+{
+    std::uint64_t generation;
+    auto buffer = acquire_latest(generation);
+
+    if (buffer)
+        record_seen(id, generation);
+
+    return buffer;
+}
+
+std::shared_ptr<mg::Buffer> mc::BufferMailbox::snapshot_acquire()
+{
+    std::uint64_t generation;
+    auto buffer = acquire_latest(generation);
+
+    if (!buffer)
+        BOOST_THROW_EXCEPTION(std::logic_error("no buffer to give to snapshotter"));
+
+    return buffer;
+}
+
+bool mc::BufferMailbox::buffer_ready_for(CompositorID id) const
+{
+    auto const current = published.load();
+
+    if (current & empty_bit)
+        return false;
+
+    return last_seen_by(id) != (generation_of(current) & generation_mask);
+}
+
+auto mc::BufferMailbox::acquire_latest(std::uint64_t& generation) -> std::shared_ptr<mg::Buffer>
+{
+    auto current = published.load();
+    do
+    {
+        if (current & empty_bit)
+            return {};
+    }
+    while (!published.compare_exchange_weak(current, current + one_reader));
+
+    auto buffer = slots[slot_of(current)].buffer;
+    generation = generation_of(current);
+    finish_reading(current);
+
+    return buffer;
+}
+
+void mc::BufferMailbox::finish_reading(std::uint64_t acquired)
+{
+    auto current = published.load();
+    while (generation_of(current) == generation_of(acquired))
+    {
+        if (published.compare_exchange_weak(current, current - one_reader))
+            return;
+    }
+
+    // The post was replaced while we were reading it, and we were counted in its retirement
+    auto& slot = slots[slot_of(acquired)];
+    if (slot.retired_readers.fetch_sub(1) == 1)
+        recycle(slot);
+}
+
+auto mc::BufferMailbox::claim_free_slot() -> std::size_t
+{
+    for (auto i = 0u; i != slots.size(); ++i)
+    {
+        if (!slots[i].in_use.load())
+        {
+            slots[i].in_use = true;
+            return i;
+        }
+    }
+
+    // Only possible with more acquirers than max_compositors part way through copying a buffer
+    BOOST_THROW_EXCEPTION(std::logic_error("too many concurrent acquirers for buffer mailbox"));
+}
+
+void mc::BufferMailbox::retire(std::uint64_t replaced)
+{
+    if (replaced & empty_bit)
+        return;
+
+    auto& slot = slots[slot_of(replaced)];
+    auto const readers = readers_of(replaced);
+    if (slot.retired_readers.fetch_add(readers) + readers == 0)
+        recycle(slot);
+}
+
+void mc::BufferMailbox::recycle(Slot& slot)
+{
+    slot.buffer.reset();
+    slot.in_use = false;
+}
+
+/*
+ * An entry's seen word must be read before its id. Reclaiming an entry
+ * writes the id first and the retagged seen word second, so if we see our id
+ * after reading the seen word that seen word was ours.
+ */
+auto mc::BufferMailbox::last_seen_by(CompositorID id) const -> std::uint64_t
+{
+    for (auto const& consumer : consumers)
+    {
+        auto const seen = consumer.seen.load();
+        if (consumer.id.load() == id)
+            return seen_generation(seen);
+    }
+    return never_seen;
+}
+
+void mc::BufferMailbox::record_seen(CompositorID id, std::uint64_t generation)
+{
+    for (auto& consumer : consumers)
+    {
+        auto seen = consumer.seen.load();
+        if (consumer.id.load() == id)
+        {
+            // This only fails if the entry was reclaimed since we looked at it
+            if (consumer.seen.compare_exchange_strong(seen, with_generation(seen, generation)))
+                return;
+            break;
+        }
+    }
+
+    // First acquire by this compositor (or first since losing its entry)
+    std::lock_guard<decltype(claim_mutex)> lock{claim_mutex};
+
+    auto const latest_generation = generation_of(published.load()) & generation_mask;
+    for (auto& consumer : consumers)
+    {
+        auto const seen = consumer.seen.load();
+        auto const owner = consumer.id.load();
+
+        // An entry that hasn't seen the latest post tells us no more than a missing entry
+        if (owner == id || !owner || seen_generation(seen) != latest_generation)
+        {
+            consumer.id = id;
+            consumer.seen = retagged(seen, generation);
+            return;
+        }
+    }
+
+    // Every entry has seen the latest post. Leaving this compositor untracked means
+    // it will be told there is a new buffer until one of them is reclaimable.
+}
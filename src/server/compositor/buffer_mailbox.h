@@ -0,0 +1,105 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_COMPOSITOR_BUFFER_MAILBOX_H_
+#define MIR_COMPOSITOR_BUFFER_MAILBOX_H_
+
+#include "mir/compositor/compositor_id.h"
+#include "buffer_acquisition.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+namespace mir
+{
+namespace graphics { class Buffer; }
+namespace compositor
+{
+/**
+ * Hands the most recently posted buffer to any number of compositors.
+ *
+ * Each post() replaces (and releases) the buffer before it, so only the latest
+ * is ever on offer; compositors that see the same post get the same buffer.
+ * There must only be one poster at a time, but compositors may acquire
+ * concurrently with each other and with the poster without taking a lock,
+ * and the poster never waits for them: a replaced buffer is released by
+ * whichever of the poster and the acquirers copying it finishes last.
+ */
+class BufferMailbox : public BufferAcquisition
+{
+public:
+    BufferMailbox();
+    ~BufferMailbox();
+
+    /// Offer buffer in place of whatever was offered before
+    void post(std::shared_ptr<graphics::Buffer> const& buffer);
+    /// Stop offering a buffer, returning the one that was on offer (if any)
+    auto take() -> std::shared_ptr<graphics::Buffer>;
+
+    std::shared_ptr<graphics::Buffer> compositor_acquire(CompositorID id) override;
+    std::shared_ptr<graphics::Buffer> snapshot_acquire() override;
+    /// As compositor_acquire(), but returns null rather than throwing if there is no buffer
+    auto try_compositor_acquire(CompositorID id) -> std::shared_ptr<graphics::Buffer>;
+    /// Whether there is a buffer that compositor id has not yet acquired
+    bool buffer_ready_for(CompositorID id) const;
+
+private:
+    struct Slot
+    {
+        std::shared_ptr<graphics::Buffer> buffer;
+        /// Set by the poster when it fills the slot, and cleared once the slot is emptied
+        std::atomic<bool> in_use{false};
+        /// Once the slot is replaced: the acquirers counted then, less those that have since finished
+        std::atomic<std::int64_t> retired_readers{0};
+    };
+
+    /// A compositor and the last post it acquired
+    struct Consumer
+    {
+        std::atomic<CompositorID> id{nullptr};
+        /// The generation acquired, tagged with a count of the times this entry was reused
+        std::atomic<std::uint64_t> seen{0};
+    };
+
+    auto acquire_latest(std::uint64_t& generation) -> std::shared_ptr<graphics::Buffer>;
+    /// Stop counting an acquirer against the post it read from
+    void finish_reading(std::uint64_t acquired);
+    auto claim_free_slot() -> std::size_t;
+    /// Hand a replaced post's slot over to the acquirers still reading it
+    void retire(std::uint64_t replaced);
+    static void recycle(Slot& slot);
+    auto last_seen_by(CompositorID id) const -> std::uint64_t;
+    void record_seen(CompositorID id, std::uint64_t generation);
+
+    // We're highly unlikely to have more compositors than this looking at one stream
+    static std::size_t const max_compositors{16};
+
+    /// An acquirer holds on to at most one slot, so the poster can always find a free one
+    std::array<Slot, max_compositors + 2> slots;
+    /// The generation of the latest post, whether it's empty, which slot it's in and its readers
+    std::atomic<std::uint64_t> published;
+
+    std::array<Consumer, max_compositors> consumers;
+    /// Serialises consumers claiming entries; only needed on a compositor's first acquire
+    std::mutex claim_mutex;
+};
+}
+}
+
+#endif /* MIR_COMPOSITOR_BUFFER_MAILBOX_H_ */
@@ -0,0 +1,185 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "damage_tracker.h"
+#include "mir/graphics/buffer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace mc = mir::compositor;
+namespace mg = mir::graphics;
+namespace geom = mir::geometry;
+
+namespace
+{
+void add_damage(geom::Rectangles& damage, geom::Rectangle const& area, geom::Rectangle const& view_area)
+{
+    auto const visible = area.intersection_with(view_area);
+    if (visible.size.width > geom::Width{0} && visible.size.height > geom::Height{0})
+        damage.add(visible);
+}
+
+/// Maps damage in buffer coordinates onto the screen, rounding outwards
+void add_buffer_damage(
+    geom::Rectangles& damage,
+    geom::Rectangles const& buffer_damage,
+    mg::Renderable const& renderable,
+    geom::Rectangle const& area,
+    geom::Rectangle const& view_area)
+{
+    auto const position = renderable.screen_position();
+    auto const buffer_size = renderable.buffer()->size();
+    if (buffer_size.width.as_int() <= 0 || buffer_size.height.as_int() <= 0)
+    {
+        add_damage(damage, area, view_area);
+        return;
+    }
+
+    auto const x_scale = double(position.size.width.as_int()) / buffer_size.width.as_int();
+    auto const y_scale = double(position.size.height.as_int()) / buffer_size.height.as_int();
+
+    for (auto const& rect : buffer_damage)
+    {
+        auto const left = std::floor(rect.top_left.x.as_int() * x_scale);
+        auto const top = std::floor(rect.top_left.y.as_int() * y_scale);
+        auto const right = std::ceil(rect.bottom_right().x.as_int() * x_scale);
+        auto const bottom = std::ceil(rect.bottom_right().y.as_int() * y_scale);
+
+        geom::Rectangle const on_screen{
+            {position.top_left.x.as_int() + int(left), position.top_left.y.as_int() + int(top)},
+            {int(right - left), int(bottom - top)}};
+
+        add_damage(damage, on_screen.intersection_with(area), view_area);
+    }
+}
+}
+
+geom::Rectangles mc::DamageTracker::damage_for(
+    mg::RenderableList const& renderables,
+    geom::Rectangle const& view_area)
+{
+    static glm::mat4 const identity(1);
+
+    std::vector<RenderableState> current_frame;
+    current_frame.reserve(renderables.size());
+
+    for (auto const& renderable : renderables)
+    {
+        auto area = renderable->screen_position();
+        if (auto const clip = renderable->clip_area())
+            area = area.intersection_with(clip.value());
+
+        current_frame.push_back(
+            RenderableState{
+                renderable->id(),
+                area,
+                renderable->buffer()->id(),
+                renderable->alpha(),
+                renderable->shaped(),
+                renderable->transformation() != identity});
+    }
+
+    auto const previous = std::move(previous_frame);
+    auto const full_damage = !previous_view_area || previous_view_area.value() != view_area;
+
+    previous_frame = current_frame;
+    previous_view_area = view_area;
+
+    if (full_damage)
+        return geom::Rectangles{view_area};
+
+    auto const find = [](std::vector<RenderableState> const& frame, mg::Renderable::ID id)
+        {
+            return std::find_if(frame.begin(), frame.end(),
+                [id](RenderableState const& state) { return state.id == id; });
+        };
+
+    // Renderables whose screen position is not their drawn position (due to
+    // a transformation) can draw anywhere. Be pessimistic.
+    auto const transformed = [](RenderableState const& state) { return state.transformed; };
+    if (std::any_of(previous.begin(), previous.end(), transformed) ||
+        std::any_of(current_frame.begin(), current_frame.end(), transformed))
+    {
+        return geom::Rectangles{view_area};
+    }
+
+    geom::Rectangles damage;
+
+    for (auto const& state : previous)
+    {
+        auto const now = find(current_frame, state.id);
+        if (now == current_frame.end())
+        {
+            add_damage(damage, state.area, view_area);
+        }
+        else if (now->area != state.area)
+        {
+            add_damage(damage, state.area, view_area);
+            add_damage(damage, now->area, view_area);
+        }
+        else if (now->alpha != state.alpha || now->shaped != state.shaped)
+        {
+            add_damage(damage, now->area, view_area);
+        }
+        else if (now->buffer != state.buffer)
+        {
+            // Only the parts of the buffer the client said it changed
+            auto const& renderable = *renderables[now - current_frame.begin()];
+            if (auto const buffer_damage = renderable.buffer_damage_since(state.buffer))
+                add_buffer_damage(damage, buffer_damage.value(), renderable, now->area, view_area);
+            else
+                add_damage(damage, now->area, view_area);
+        }
+    }
+
+    for (auto const& state : current_frame)
+    {
+        if (find(previous, state.id) == previous.end())
+            add_damage(damage, state.area, view_area);
+    }
+
+    // Restacking: compare the order of renderables present in both frames.
+    // Everything from the first difference on may have changed what is on top.
+    auto p = previous.begin();
+    auto c = current_frame.begin();
+    bool restacked = false;
+    while (p != previous.end() && c != current_frame.end())
+    {
+        if (find(current_frame, p->id) == current_frame.end())
+        {
+            ++p;
+        }
+        else if (find(previous, c->id) == previous.end())
+        {
+            ++c;
+        }
+        else if (restacked || p->id != c->id)
+        {
+            restacked = true;
+            add_damage(damage, c->area, view_area);
+            ++p;
+            ++c;
+        }
+        else
+        {
+            ++p;
+            ++c;
+        }
+    }
+
+    return damage;
+}
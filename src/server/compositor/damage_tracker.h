@@ -0,0 +1,80 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_COMPOSITOR_DAMAGE_TRACKER_H_
+#define MIR_COMPOSITOR_DAMAGE_TRACKER_H_
+
+#include "mir/graphics/renderable.h"
+#include "mir/graphics/buffer_id.h"
+#include "mir/geometry/rectangle.h"
+#include "mir/geometry/rectangles.h"
+
+#include <experimental/optional>
+#include <vector>
+
+namespace mir
+{
+namespace compositor
+{
+
+/**
+ * Works out which parts of an output changed between consecutive frames.
+ *
+ * The damage is found by comparing what is about to be rendered with what
+ * was rendered last time: renderables that appeared, disappeared, moved,
+ * were restacked, changed opacity or had a new buffer submitted all damage
+ * the area they covered before and the area they cover now. When a stream can
+ * say which part of a new buffer changed only that part is damaged. As the
+ * software cursor is just another renderable cursor motion is covered too.
+ */
+class DamageTracker
+{
+public:
+    DamageTracker() = default;
+
+    /**
+     * The area of view_area that needs repainting to show renderables,
+     * given the renderables passed to the previous call.
+     *
+     * The first frame, and any frame where view_area changes, is fully
+     * damaged.
+     */
+    geometry::Rectangles damage_for(
+        graphics::RenderableList const& renderables,
+        geometry::Rectangle const& view_area);
+
+private:
+    struct RenderableState
+    {
+        graphics::Renderable::ID id;
+        geometry::Rectangle area;
+        graphics::BufferID buffer;
+        float alpha;
+        bool shaped;
+        bool transformed;
+    };
+
+    std::vector<RenderableState> previous_frame;
+    std::experimental::optional<geometry::Rectangle> previous_view_area;
+
+    DamageTracker(DamageTracker const&) = delete;
+    DamageTracker& operator=(DamageTracker const&) = delete;
+};
+
+}
+}
+
+#endif /* MIR_COMPOSITOR_DAMAGE_TRACKER_H_ */
@@ -22,13 +22,18 @@
 #include "buffer_stream_factory.h"
 #include "default_display_buffer_compositor_factory.h"
 #include "multi_threaded_compositor.h"
+#include "frame_timing_recorder.h"
 #include "gl/renderer_factory.h"
 #include "mir/main_loop.h"
+#include "mir/log.h"
 
 #include "mir/options/configuration.h"
 
 #include <boost/throw_exception.hpp>
 
+#include <csignal>
+#include <fstream>
+
 namespace mc = mir::compositor;
 namespace ms = mir::scene;
 namespace mf = mir::frontend;
@@ -76,11 +81,48 @@ mir::DefaultServerConfiguration::the_compositor()
                 the_display_buffer_compositor_factory(),
                 the_shell(),
                 the_compositor_report(),
+                the_frame_timing_recorder(),
+                the_frame_deadline_listener(),
                 composite_delay,
                 true);
         });
 }
 
+std::shared_ptr<mc::FrameTimings> mir::DefaultServerConfiguration::the_frame_timings()
+{
+    return the_frame_timing_recorder();
+}
+
+std::shared_ptr<mc::FrameTimingRecorder> mir::DefaultServerConfiguration::the_frame_timing_recorder()
+{
+    return frame_timing_recorder(
+        [this]()
+        {
+            auto const recorder = std::make_shared<mc::FrameTimingRecorder>();
+
+            if (the_options()->is_set(options::frame_timings_file_opt))
+            {
+                auto const path = the_options()->get<std::string>(options::frame_timings_file_opt);
+                std::weak_ptr<mc::FrameTimings> const timings = recorder;
+
+                the_main_loop()->register_signal_handler(
+                    {SIGUSR2},
+                    [path, timings](int)
+                    {
+                        if (auto const recorded = timings.lock())
+                        {
+                            std::ofstream out{path, std::ios::trunc};
+                            recorded->write_json(out);
+                            if (!out)
+                                mir::log_warning("Failed to write frame timings to %s", path.c_str());
+                        }
+                    });
+            }
+
+            return recorder;
+        });
+}
+
 std::shared_ptr<mir::renderer::RendererFactory> mir::DefaultServerConfiguration::the_renderer_factory()
 {
     return renderer_factory(
@@ -23,6 +23,7 @@
 #include "mir/compositor/scene_element.h"
 #include "mir/graphics/renderable.h"
 #include "mir/graphics/display_buffer.h"
+#include "mir/graphics/overlay_planes.h"
 #include "mir/graphics/buffer.h"
 #include "mir/compositor/buffer_stream.h"
 #include "mir/renderer/renderer.h"
@@ -49,7 +50,7 @@ void mc::DefaultDisplayBufferCompositor::composite(mc::SceneElementSequence&& sc
     report->began_frame(this);
 
     auto const& view_area = display_buffer.view_area();
-    auto const& occlusions = mc::filter_occlusions_from(scene_elements, view_area);
+    auto const& occlusions = mc::filter_occlusions_from(scene_elements, view_area, arena);
 
     for (auto const& element : occlusions)
         element->occluded();
@@ -74,14 +75,21 @@ void mc::DefaultDisplayBufferCompositor::composite(mc::SceneElementSequence&& sc
 
     if (display_buffer.overlay(renderable_list))
     {
+        damage_tracker.damage_for(renderable_list, view_area);
         report->renderables_in_frame(this, renderable_list);
         renderer->suspend();
     }
     else
     {
+        // Whatever the hardware puts on overlay planes needn't be composited
+        auto const overlays =
+            dynamic_cast<mg::OverlayPlanes*>(display_buffer.native_display_buffer());
+        auto composited = overlays ? overlays->assign_overlays(renderable_list) : renderable_list;
+
         renderer->set_output_transform(display_buffer.transformation());
         renderer->set_viewport(view_area);
-        renderer->render(renderable_list);
+        renderer->set_damage(damage_tracker.damage_for(composited, view_area));
+        renderer->render(composited);
 
         report->renderables_in_frame(this, renderable_list);
         report->rendered_frame(this);
@@ -97,6 +105,7 @@ void mc::DefaultDisplayBufferCompositor::composite(mc::SceneElementSequence&& sc
          *        problematic IPC (LP: #1395421) will instead occur in buffer
          *        acquisition calls when we composite the next frame.
          */
+        composited.clear();
         renderable_list.clear();
     }
 
@@ -21,6 +21,8 @@
 
 #include "mir/compositor/display_buffer_compositor.h"
 #include "mir/compositor/compositor_report.h"
+#include "mir/compositor/frame_arena.h"
+#include "damage_tracker.h"
 #include <memory>
 
 namespace mir
@@ -52,6 +54,9 @@ private:
     graphics::DisplayBuffer& display_buffer;
     std::shared_ptr<renderer::Renderer> const renderer;
     std::shared_ptr<CompositorReport> const report;
+    DamageTracker damage_tracker;
+    /// For the elements occlusion filtering clips (composite() is only called on one thread)
+    FrameArena arena;
 };
 
 }
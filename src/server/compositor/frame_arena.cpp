@@ -0,0 +1,139 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mir/compositor/frame_arena.h"
+
+#include <algorithm>
+#include <new>
+#include <vector>
+
+namespace mc = mir::compositor;
+
+namespace
+{
+// Room for the elements and snapshots of a typical scene
+std::size_t const min_chunk_size{16 * 1024};
+
+auto aligned(std::size_t size) -> std::size_t
+{
+    auto const alignment = alignof(std::max_align_t);
+    return (size + alignment - 1) / alignment * alignment;
+}
+}
+
+/// Chunks of memory handed out in order, all reused once everything handed out is freed
+class mc::FrameArena::Pool
+{
+public:
+    auto allocate(std::size_t size) -> void*
+    {
+        size = aligned(size);
+
+        while (current != chunks.size() && chunks[current].size - used < size)
+        {
+            ++current;
+            used = 0;
+        }
+
+        if (current == chunks.size())
+        {
+            chunks.emplace_back(std::max(min_chunk_size, size));
+        }
+
+        auto const block = chunks[current].memory.get() + used;
+        used += size;
+        ++live;
+        return block;
+    }
+
+    void free() noexcept
+    {
+        if (--live != 0)
+        {
+            return;
+        }
+
+        // A frame that outgrew one chunk gets a single one big enough for it next time
+        if (chunks.size() > 1)
+        {
+            try
+            {
+                Chunk merged{capacity()};
+                chunks.clear();
+                chunks.push_back(std::move(merged));
+            }
+            catch (std::bad_alloc const&)
+            {
+                // Keep the chunks we have
+            }
+        }
+
+        current = 0;
+        used = 0;
+    }
+
+    auto capacity() const -> std::size_t
+    {
+        std::size_t total{0};
+        for (auto const& chunk : chunks)
+        {
+            total += chunk.size;
+        }
+        return total;
+    }
+
+private:
+    struct Chunk
+    {
+        explicit Chunk(std::size_t size)
+            : size{size},
+              memory{new char[size]}
+        {
+        }
+
+        std::size_t size;
+        std::unique_ptr<char[]> memory;
+    };
+
+    std::vector<Chunk> chunks;
+    /// Where the next block comes from
+    std::size_t current{0};
+    std::size_t used{0};
+    /// Blocks handed out and not yet freed
+    std::size_t live{0};
+};
+
+mc::FrameArena::FrameArena()
+    : pool{std::make_unique<Pool>()}
+{
+}
+
+mc::FrameArena::~FrameArena() = default;
+
+auto mc::FrameArena::capacity() const -> std::size_t
+{
+    return pool->capacity();
+}
+
+auto mc::FrameArena::allocate_block(Pool& pool, std::size_t size) -> void*
+{
+    return pool.allocate(size);
+}
+
+void mc::FrameArena::free_block(Pool& pool) noexcept
+{
+    pool.free();
+}
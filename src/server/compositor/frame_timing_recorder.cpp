@@ -0,0 +1,189 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "frame_timing_recorder.h"
+
+#include <algorithm>
+#include <ostream>
+
+namespace mc = mir::compositor;
+namespace geom = mir::geometry;
+
+using namespace std::chrono;
+
+namespace
+{
+auto bucket_for(nanoseconds length) -> int
+{
+    auto const ms = duration_cast<milliseconds>(length).count();
+    int bucket = 0;
+    while (bucket < mc::FrameStageTimings::histogram_buckets - 1 && ms >= (1 << bucket))
+        ++bucket;
+    return bucket;
+}
+
+auto since_epoch(steady_clock::time_point time) -> std::int64_t
+{
+    return duration_cast<nanoseconds>(time.time_since_epoch()).count();
+}
+
+auto as_ms(nanoseconds length) -> double
+{
+    return duration_cast<duration<double, std::milli>>(length).count();
+}
+
+void write_json(std::ostream& out, mc::FrameStageTimings const& stage, std::uint64_t frames)
+{
+    out << "{\"total_ms\": " << as_ms(stage.total)
+        << ", \"mean_ms\": " << (frames ? as_ms(stage.total) / frames : 0.0)
+        << ", \"max_ms\": " << as_ms(stage.longest)
+        << ", \"histogram\": [";
+
+    for (auto i = 0u; i != stage.histogram.size(); ++i)
+        out << (i ? ", " : "") << stage.histogram[i];
+
+    out << "]}";
+}
+}
+
+void mc::FrameTimingRecorder::Output::Stage::record(nanoseconds length)
+{
+    auto const ns = length.count();
+    total_ns.fetch_add(ns, std::memory_order_relaxed);
+
+    auto longest = longest_ns.load(std::memory_order_relaxed);
+    while (ns > longest && !longest_ns.compare_exchange_weak(longest, ns, std::memory_order_relaxed))
+        ;
+
+    histogram[bucket_for(length)].fetch_add(1, std::memory_order_relaxed);
+}
+
+auto mc::FrameTimingRecorder::Output::Stage::timings() const -> FrameStageTimings
+{
+    FrameStageTimings result;
+    result.total = nanoseconds{total_ns.load(std::memory_order_relaxed)};
+    result.longest = nanoseconds{longest_ns.load(std::memory_order_relaxed)};
+    for (auto i = 0u; i != histogram.size(); ++i)
+        result.histogram[i] = histogram[i].load(std::memory_order_relaxed);
+    return result;
+}
+
+mc::FrameTimingRecorder::Output::Output(geom::Rectangle const& area)
+    : area{area}
+{
+}
+
+void mc::FrameTimingRecorder::Output::record(Frame const& frame)
+{
+    scene_snapshot.record(frame.scene_snapshot);
+    render.record(frame.render);
+    post.record(frame.post);
+    latency.record(frame.end - frame.start);
+
+    if (frame.missed_deadline)
+        missed_deadlines.fetch_add(1, std::memory_order_relaxed);
+
+    std::int64_t no_start{0};
+    first_start_ns.compare_exchange_strong(no_start, since_epoch(frame.start), std::memory_order_relaxed);
+
+    auto const end = since_epoch(frame.end);
+    auto last_end = last_end_ns.load(std::memory_order_relaxed);
+    while (end > last_end && !last_end_ns.compare_exchange_weak(last_end, end, std::memory_order_relaxed))
+        ;
+
+    // Counted last, so a reader seeing the frame sees (most of) its timings too
+    frames.fetch_add(1, std::memory_order_release);
+}
+
+auto mc::FrameTimingRecorder::Output::timings() const -> OutputFrameTimings
+{
+    OutputFrameTimings result;
+    result.area = area;
+    result.frames = frames.load(std::memory_order_acquire);
+    result.missed_deadlines = missed_deadlines.load(std::memory_order_relaxed);
+    if (result.frames)
+    {
+        result.elapsed = nanoseconds{
+            last_end_ns.load(std::memory_order_relaxed) - first_start_ns.load(std::memory_order_relaxed)};
+    }
+    result.scene_snapshot = scene_snapshot.timings();
+    result.render = render.timings();
+    result.post = post.timings();
+    result.latency = latency.timings();
+    return result;
+}
+
+mc::FrameTimingRecorder::FrameTimingRecorder() = default;
+mc::FrameTimingRecorder::~FrameTimingRecorder() = default;
+
+auto mc::FrameTimingRecorder::output_at(geom::Rectangle const& area) -> std::shared_ptr<Output>
+{
+    std::lock_guard<std::mutex> lock{mutex};
+
+    for (auto const& output : recorded_outputs)
+    {
+        if (output->area == area)
+            return output;
+    }
+
+    recorded_outputs.push_back(std::make_shared<Output>(area));
+    return recorded_outputs.back();
+}
+
+auto mc::FrameTimingRecorder::outputs() const -> std::vector<OutputFrameTimings>
+{
+    std::lock_guard<std::mutex> lock{mutex};
+
+    std::vector<OutputFrameTimings> result;
+    result.reserve(recorded_outputs.size());
+    for (auto const& output : recorded_outputs)
+        result.push_back(output->timings());
+    return result;
+}
+
+void mc::FrameTimingRecorder::write_json(std::ostream& out) const
+{
+    out << "{\"histogram_bounds_ms\": [";
+    for (auto i = 0; i != FrameStageTimings::histogram_buckets - 1; ++i)
+        out << (i ? ", " : "") << (1 << i);
+    out << "],\n \"outputs\": [";
+
+    auto first = true;
+    for (auto const& output : outputs())
+    {
+        out << (first ? "\n  " : ",\n  ")
+            << "{\"x\": " << output.area.top_left.x.as_int()
+            << ", \"y\": " << output.area.top_left.y.as_int()
+            << ", \"width\": " << output.area.size.width.as_int()
+            << ", \"height\": " << output.area.size.height.as_int()
+            << ", \"frames\": " << output.frames
+            << ", \"missed_deadlines\": " << output.missed_deadlines
+            << ", \"elapsed_ms\": " << as_ms(output.elapsed);
+
+        out << ",\n   \"scene_snapshot\": ";
+        ::write_json(out, output.scene_snapshot, output.frames);
+        out << ",\n   \"render\": ";
+        ::write_json(out, output.render, output.frames);
+        out << ",\n   \"post\": ";
+        ::write_json(out, output.post, output.frames);
+        out << ",\n   \"latency\": ";
+        ::write_json(out, output.latency, output.frames);
+        out << "}";
+        first = false;
+    }
+
+    out << "]}\n";
+}
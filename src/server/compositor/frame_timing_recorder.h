@@ -0,0 +1,99 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_COMPOSITOR_FRAME_TIMING_RECORDER_H_
+#define MIR_COMPOSITOR_FRAME_TIMING_RECORDER_H_
+
+#include "mir/compositor/frame_timings.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+namespace mir
+{
+namespace compositor
+{
+/**
+ * Collects FrameTimings from the compositing threads.
+ *
+ * Recording a frame only updates atomic counters, so it never waits on a
+ * reader (or on another compositing thread recording the same output).
+ * Outputs are matched by area, so their statistics carry on across display
+ * configuration changes that leave them where they are.
+ */
+class FrameTimingRecorder : public FrameTimings
+{
+public:
+    /// The durations of one frame of an output
+    struct Frame
+    {
+        std::chrono::steady_clock::time_point start;    ///< When the scene snapshot was started
+        std::chrono::steady_clock::time_point end;      ///< When post() returned
+        std::chrono::nanoseconds scene_snapshot;
+        std::chrono::nanoseconds render;
+        std::chrono::nanoseconds post;
+        bool missed_deadline;
+    };
+
+    class Output
+    {
+    public:
+        explicit Output(geometry::Rectangle const& area);
+
+        void record(Frame const& frame);
+        auto timings() const -> OutputFrameTimings;
+
+        geometry::Rectangle const area;
+
+    private:
+        struct Stage
+        {
+            void record(std::chrono::nanoseconds length);
+            auto timings() const -> FrameStageTimings;
+
+            std::atomic<std::int64_t> total_ns{0};
+            std::atomic<std::int64_t> longest_ns{0};
+            std::array<std::atomic<std::uint64_t>, FrameStageTimings::histogram_buckets> histogram{};
+        };
+
+        std::atomic<std::uint64_t> frames{0};
+        std::atomic<std::uint64_t> missed_deadlines{0};
+        std::atomic<std::int64_t> first_start_ns{0};
+        std::atomic<std::int64_t> last_end_ns{0};
+        Stage scene_snapshot;
+        Stage render;
+        Stage post;
+        Stage latency;
+    };
+
+    FrameTimingRecorder();
+    ~FrameTimingRecorder();
+
+    /// Where to record the frames of the output at area
+    auto output_at(geometry::Rectangle const& area) -> std::shared_ptr<Output>;
+
+    auto outputs() const -> std::vector<OutputFrameTimings> override;
+    void write_json(std::ostream& out) const override;
+
+private:
+    std::mutex mutable mutex;
+    std::vector<std::shared_ptr<Output>> recorded_outputs;
+};
+}
+}
+
+#endif // MIR_COMPOSITOR_FRAME_TIMING_RECORDER_H_
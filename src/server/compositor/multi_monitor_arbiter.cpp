@@ -41,6 +41,17 @@ mc::MultiMonitorArbiter::~MultiMonitorArbiter()
 }
 
 std::shared_ptr<mg::Buffer> mc::MultiMonitorArbiter::compositor_acquire(compositor::CompositorID id)
+{
+    auto const buffer = try_compositor_acquire(id);
+
+    // If there was no current buffer and we weren't able to set one, throw and exception
+    if (!buffer)
+        BOOST_THROW_EXCEPTION(std::logic_error("no buffer to give to compositor"));
+
+    return buffer;
+}
+
+std::shared_ptr<mg::Buffer> mc::MultiMonitorArbiter::try_compositor_acquire(compositor::CompositorID id)
 {
     std::lock_guard<decltype(mutex)> lk(mutex);
 
@@ -57,9 +68,8 @@ std::shared_ptr<mg::Buffer> mc::MultiMonitorArbiter::compositor_acquire(composit
         // Otherwise leave the current buffer alone
     }
 
-    // If there was no current buffer and we weren't able to set one, throw and exception
     if (!current_buffer)
-        BOOST_THROW_EXCEPTION(std::logic_error("no buffer to give to compositor"));
+        return nullptr;
 
     // The compositor is now a user of the current buffer
     // This means we will try to give it a new buffer next time it asks
@@ -117,6 +127,13 @@ void mc::MultiMonitorArbiter::advance_schedule()
     } 
 }
 
+std::shared_ptr<mg::Buffer> mc::MultiMonitorArbiter::release_current_buffer()
+{
+    std::lock_guard<decltype(mutex)> lk(mutex);
+    clear_current_users();
+    return std::move(current_buffer);
+}
+
 void mc::MultiMonitorArbiter::add_current_buffer_user(mc::CompositorID id)
 {
     // First try and find an empty slot in our vector…
@@ -43,9 +43,13 @@ public:
 
     std::shared_ptr<graphics::Buffer> compositor_acquire(compositor::CompositorID id) override;
     std::shared_ptr<graphics::Buffer> snapshot_acquire() override;
+    /// As compositor_acquire(), but returns null rather than throwing if there is no buffer
+    std::shared_ptr<graphics::Buffer> try_compositor_acquire(compositor::CompositorID id);
     void set_schedule(std::shared_ptr<Schedule> const& schedule);
     bool buffer_ready_for(compositor::CompositorID id);
     void advance_schedule();
+    /// Stop holding on to the current buffer (if any), returning it
+    std::shared_ptr<graphics::Buffer> release_current_buffer();
 
 private:
     void add_current_buffer_user(compositor::CompositorID id);
@@ -17,11 +17,13 @@
  */
 
 #include "multi_threaded_compositor.h"
+#include "frame_timing_recorder.h"
 #include "mir/graphics/display.h"
 #include "mir/graphics/display_buffer.h"
 #include "mir/compositor/display_buffer_compositor.h"
 #include "mir/compositor/display_buffer_compositor_factory.h"
 #include "mir/compositor/display_listener.h"
+#include "mir/compositor/frame_deadline_listener.h"
 #include "mir/compositor/scene.h"
 #include "mir/compositor/compositor_report.h"
 #include "mir/scene/legacy_scene_change_notification.h"
@@ -57,7 +59,9 @@ public:
         std::shared_ptr<mc::Scene> const& scene,
         std::shared_ptr<DisplayListener> const& display_listener,
         std::chrono::milliseconds fixed_composite_delay,
-        std::shared_ptr<CompositorReport> const& report) :
+        std::shared_ptr<CompositorReport> const& report,
+        std::shared_ptr<FrameTimingRecorder> const& frame_timings,
+        std::shared_ptr<FrameDeadlineListener> const& frame_deadlines) :
         compositor_factory{db_compositor_factory},
         group(group),
         scene(scene),
@@ -66,6 +70,8 @@ public:
         force_sleep{fixed_composite_delay},
         display_listener{display_listener},
         report{report},
+        frame_timings{frame_timings},
+        frame_deadlines{frame_deadlines},
         started_future{started.get_future()}
     {
     }
@@ -76,11 +82,13 @@ public:
         mir::set_thread_name("Mir/Comp");
 
         std::vector<std::tuple<mg::DisplayBuffer*, std::unique_ptr<mc::DisplayBufferCompositor>>> compositors;
+        std::vector<std::shared_ptr<FrameTimingRecorder::Output>> output_timings;
         group.for_each_display_buffer(
-        [this, &compositors](mg::DisplayBuffer& buffer)
+        [this, &compositors, &output_timings](mg::DisplayBuffer& buffer)
         {
             compositors.emplace_back(
                 std::make_tuple(&buffer, compositor_factory->create_compositor_for(buffer)));
+            output_timings.push_back(frame_timings->output_at(buffer.view_area()));
 
             auto const& r = buffer.view_area();
             auto const comp_id = std::get<1>(compositors.back()).get();
@@ -135,12 +143,36 @@ public:
                     not_posted_yet = false;
                     lock.unlock();
 
-                    for (auto& tuple : compositors)
+                    // The deadline for the refresh this frame is aimed at, before we make it any later
+                    auto const deadline = group.next_frame_deadline();
+
+                    std::vector<FrameTimingRecorder::Frame> frames(compositors.size());
+                    for (auto i = 0u; i != compositors.size(); ++i)
                     {
-                        auto& compositor = std::get<1>(tuple);
-                        compositor->composite(scene->scene_elements_for(compositor.get()));
+                        auto& compositor = std::get<1>(compositors[i]);
+                        auto& frame = frames[i];
+
+                        frame.start = std::chrono::steady_clock::now();
+                        auto elements = scene->scene_elements_for(compositor.get());
+                        auto const rendering = std::chrono::steady_clock::now();
+                        compositor->composite(std::move(elements));
+
+                        frame.scene_snapshot = rendering - frame.start;
+                        frame.render = std::chrono::steady_clock::now() - rendering;
                     }
+
+                    auto const posting = std::chrono::steady_clock::now();
                     group.post();
+                    auto const posted = std::chrono::steady_clock::now();
+
+                    for (auto i = 0u; i != frames.size(); ++i)
+                    {
+                        auto& frame = frames[i];
+                        frame.end = posted;
+                        frame.post = posted - posting;
+                        frame.missed_deadline = deadline < posted;
+                        output_timings[i]->record(frame);
+                    }
 
                     /*
                      * "Predictive bypass" optimization: If the last frame was
@@ -148,12 +180,19 @@ public:
                      * beneficial to sleep for most of the next frame. This reduces
                      * the latency between snapshotting the scene and post()
                      * completing by almost a whole frame.
+                     *
+                     * The platform knows when the next refresh is, so it says when
+                     * to start. Client commits arriving meanwhile only raise
+                     * frames_scheduled, so they are all picked up by that one frame.
                      */
-                    auto delay = force_sleep >= std::chrono::milliseconds::zero() ?
-                                 force_sleep : group.recommended_sleep();
-                    std::this_thread::sleep_for(delay);
+                    auto const next_frame_start = force_sleep >= std::chrono::milliseconds::zero() ?
+                        std::chrono::steady_clock::now() + force_sleep : group.next_frame_start();
+
+                    if (frame_deadlines)
+                        frame_deadlines->next_frame_at(next_frame_start);
 
                     lock.lock();
+                    run_cv.wait_until(lock, next_frame_start, [&]{ return !running; });
 
                     /*
                      * Note the compositor may have chosen to ignore any number
@@ -241,6 +280,8 @@ private:
     std::condition_variable run_cv;
     std::shared_ptr<DisplayListener> const display_listener;
     std::shared_ptr<CompositorReport> const report;
+    std::shared_ptr<FrameTimingRecorder> const frame_timings;
+    std::shared_ptr<FrameDeadlineListener> const frame_deadlines;
     std::promise<void> started;
     std::future<void> started_future;
     bool not_posted_yet = true;
@@ -257,11 +298,36 @@ mc::MultiThreadedCompositor::MultiThreadedCompositor(
     std::shared_ptr<CompositorReport> const& compositor_report,
     std::chrono::milliseconds fixed_composite_delay,
     bool compose_on_start)
+    : MultiThreadedCompositor{
+        display,
+        scene,
+        db_compositor_factory,
+        display_listener,
+        compositor_report,
+        std::make_shared<FrameTimingRecorder>(),
+        nullptr,
+        fixed_composite_delay,
+        compose_on_start}
+{
+}
+
+mc::MultiThreadedCompositor::MultiThreadedCompositor(
+    std::shared_ptr<mg::Display> const& display,
+    std::shared_ptr<mc::Scene> const& scene,
+    std::shared_ptr<DisplayBufferCompositorFactory> const& db_compositor_factory,
+    std::shared_ptr<DisplayListener> const& display_listener,
+    std::shared_ptr<CompositorReport> const& compositor_report,
+    std::shared_ptr<FrameTimingRecorder> const& frame_timings,
+    std::shared_ptr<FrameDeadlineListener> const& frame_deadlines,
+    std::chrono::milliseconds fixed_composite_delay,
+    bool compose_on_start)
     : display{display},
       scene{scene},
       display_buffer_compositor_factory{db_compositor_factory},
       display_listener{display_listener},
       report{compositor_report},
+      frame_timings{frame_timings},
+      frame_deadlines{frame_deadlines},
       state{CompositorState::stopped},
       fixed_composite_delay{fixed_composite_delay},
       compose_on_start{compose_on_start},
@@ -368,7 +434,7 @@ void mc::MultiThreadedCompositor::create_compositing_threads()
     {
         auto thread_functor = std::make_unique<mc::CompositingFunctor>(
             display_buffer_compositor_factory, group, scene, display_listener,
-            fixed_composite_delay, report);
+            fixed_composite_delay, report, frame_timings, frame_deadlines);
 
         futures.push_back(thread_pool.run(std::ref(*thread_functor), &group));
         thread_functors.push_back(std::move(thread_functor));
@@ -49,6 +49,8 @@ class DisplayListener;
 class CompositingFunctor;
 class Scene;
 class CompositorReport;
+class FrameTimingRecorder;
+class FrameDeadlineListener;
 
 enum class CompositorState
 {
@@ -69,6 +71,16 @@ public:
         std::shared_ptr<CompositorReport> const& compositor_report,
         std::chrono::milliseconds fixed_composite_delay,  // -1 = automatic
         bool compose_on_start);
+    MultiThreadedCompositor(
+        std::shared_ptr<graphics::Display> const& display,
+        std::shared_ptr<Scene> const& scene,
+        std::shared_ptr<DisplayBufferCompositorFactory> const& db_compositor_factory,
+        std::shared_ptr<DisplayListener> const& display_listener,
+        std::shared_ptr<CompositorReport> const& compositor_report,
+        std::shared_ptr<FrameTimingRecorder> const& frame_timings,
+        std::shared_ptr<FrameDeadlineListener> const& frame_deadlines,  // may be null
+        std::chrono::milliseconds fixed_composite_delay,  // -1 = automatic
+        bool compose_on_start);
     ~MultiThreadedCompositor();
 
     void start();
@@ -83,6 +95,8 @@ private:
     std::shared_ptr<DisplayBufferCompositorFactory> const display_buffer_compositor_factory;
     std::shared_ptr<DisplayListener> const display_listener;
     std::shared_ptr<CompositorReport> const report;
+    std::shared_ptr<FrameTimingRecorder> const frame_timings;
+    std::shared_ptr<FrameDeadlineListener> const frame_deadlines;
 
     std::vector<std::unique_ptr<CompositingFunctor>> thread_functors;
     std::vector<std::future<void>> futures;
@@ -17,72 +17,135 @@
  */
 
 #include "mir/geometry/rectangle.h"
+#include "mir/geometry/region.h"
 #include "mir/compositor/scene_element.h"
+#include "mir/compositor/frame_arena.h"
 #include "mir/graphics/renderable.h"
 #include "occlusion.h"
 
-#include <vector>
-
 using namespace mir::geometry;
 using namespace mir::graphics;
 using namespace mir::compositor;
 
 namespace
 {
-bool renderable_is_occluded(
-    Renderable const& renderable, 
-    Rectangle const& area,
-    std::vector<Rectangle>& coverage)
+/// A renderable with its clip area narrowed to the part left visible
+class ClippedRenderable : public Renderable
 {
-    static glm::mat4 const identity(1);
-    static Rectangle const empty{};
+public:
+    ClippedRenderable(std::shared_ptr<Renderable> const& renderable, Rectangle const& clip) :
+        renderable{renderable},
+        clip{clip}
+    {
+    }
+
+    ID id() const override { return renderable->id(); }
+    std::shared_ptr<Buffer> buffer() const override { return renderable->buffer(); }
 
-    if (renderable.transformation() != identity)
-        return false;  // Weirdly transformed. Assume never occluded.
+    std::experimental::optional<Rectangles> buffer_damage_since(BufferID previous) const override
+    { return renderable->buffer_damage_since(previous); }
 
-    auto const& window = renderable.screen_position();
-    auto const& clipped_window = window.intersection_with(area);
+    Rectangle screen_position() const override { return renderable->screen_position(); }
+    std::experimental::optional<Rectangle> clip_area() const override { return clip; }
+    float alpha() const override { return renderable->alpha(); }
+    glm::mat4 transformation() const override { return renderable->transformation(); }
+    bool shaped() const override { return renderable->shaped(); }
+    Rectangles opaque_region() const override { return renderable->opaque_region(); }
+    unsigned int swap_interval() const override { return renderable->swap_interval(); }
 
-    if (clipped_window == empty)
-        return true;  // Not in the area; definitely occluded.
+private:
+    std::shared_ptr<Renderable> const renderable;
+    Rectangle const clip;
+};
 
-    bool occluded = false;
-    for (auto const& r : coverage)
+class ClippedSceneElement : public SceneElement
+{
+public:
+    ClippedSceneElement(std::shared_ptr<SceneElement> const& element, std::shared_ptr<Renderable> const& clipped) :
+        element{element},
+        renderable_{clipped}
     {
-        if (r.contains(clipped_window))
-        {
-            occluded = true;
-            break;
-        }
     }
 
-    if (!occluded && renderable.alpha() == 1.0f && !renderable.shaped())
-        coverage.push_back(clipped_window);
+    std::shared_ptr<Renderable> renderable() const override { return renderable_; }
+    void rendered() override { element->rendered(); }
+    void occluded() override { element->occluded(); }
 
-    return occluded;
+private:
+    std::shared_ptr<SceneElement> const element;
+    std::shared_ptr<Renderable> const renderable_;
+};
+
+/// The part of area the renderable draws to, assuming it is untransformed
+Rectangle drawn_area_of(Renderable const& renderable, Rectangle const& area)
+{
+    auto drawn = renderable.screen_position().intersection_with(area);
+    if (auto const clip = renderable.clip_area())
+        drawn = drawn.intersection_with(clip.value());
+    return drawn;
+}
+
+void add_coverage(Renderable const& renderable, Rectangle const& drawn, Region& coverage)
+{
+    if (renderable.alpha() != 1.0f)
+        return;
+
+    if (!renderable.shaped())
+    {
+        coverage.add(drawn);
+    }
+    else
+    {
+        Region opaque{renderable.opaque_region()};
+        opaque.intersect(drawn);
+        coverage.add(opaque);
+    }
 }
 }
 
 SceneElementSequence mir::compositor::filter_occlusions_from(
     SceneElementSequence& elements,
-    Rectangle const& area)
+    Rectangle const& area,
+    FrameArena& arena)
 {
+    static glm::mat4 const identity(1);
+
     SceneElementSequence occluded;
-    std::vector<Rectangle> coverage;
+    Region coverage;
 
     auto it = elements.rbegin();
     while (it != elements.rend())
     {
         auto const renderable = (*it)->renderable();
-        if (renderable_is_occluded(*renderable, area, coverage))
+
+        if (renderable->transformation() != identity)
         {
+            // Weirdly transformed. Assume never occluded (and covering nothing).
+            ++it;
+            continue;
+        }
+
+        auto const drawn = drawn_area_of(*renderable, area);
+        if (coverage.contains(drawn))
+        {
+            // This includes renderables not in the area at all
             occluded.insert(occluded.begin(), *it);
             it = SceneElementSequence::reverse_iterator(elements.erase(std::prev(it.base())));
+            continue;
         }
-        else
+
+        // If coverage hides an edge of the renderable, clip to what is left
+        Region visible{drawn};
+        visible.subtract(coverage);
+        auto const visible_bounds = visible.bounding_rectangle();
+        if (visible_bounds != drawn)
         {
-            it++;
+            auto const clipped = arena.make_shared<ClippedRenderable>(renderable, visible_bounds);
+            *it = arena.make_shared<ClippedSceneElement>(*it, clipped);
         }
+
+        add_coverage(*renderable, drawn, coverage);
+        ++it;
     }
 
     return occluded;
@@ -25,8 +25,13 @@ namespace mir
 {
 namespace compositor
 {
+class FrameArena;
 
-SceneElementSequence filter_occlusions_from(SceneElementSequence& list, geometry::Rectangle const& area);
+/// Elements left partly visible are replaced by ones clipped to what is visible, made in arena
+SceneElementSequence filter_occlusions_from(
+    SceneElementSequence& list,
+    geometry::Rectangle const& area,
+    FrameArena& arena);
 
 } // namespace compositor
 } // namespace mir
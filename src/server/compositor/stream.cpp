@@ -19,9 +19,9 @@
 
 #include "stream.h"
 #include "queueing_schedule.h"
-#include "dropping_schedule.h"
 #include "mir/graphics/buffer.h"
 #include <boost/throw_exception.hpp>
+#include <algorithm>
 
 namespace mc = mir::compositor;
 namespace geom = mir::geometry;
@@ -29,6 +29,12 @@ namespace mg = mir::graphics;
 namespace ms = mir::scene;
 namespace geom = mir::geometry;
 
+namespace
+{
+// Consumers more than this many buffers behind see the whole buffer damaged
+std::size_t const max_damage_history = 8;
+}
+
 enum class mc::Stream::ScheduleMode {
     Queueing,
     Dropping
@@ -37,6 +43,7 @@ enum class mc::Stream::ScheduleMode {
 mc::Stream::Stream(
     geom::Size size, MirPixelFormat pf) :
     schedule_mode(ScheduleMode::Queueing),
+    mode_switches{0},
     schedule(std::make_shared<mc::QueueingSchedule>()),
     arbiter(std::make_shared<mc::MultiMonitorArbiter>(schedule)),
     latest_buffer_size(size),
@@ -48,17 +55,42 @@ mc::Stream::Stream(
 
 mc::Stream::~Stream() = default;
 
-void mc::Stream::submit_buffer(std::shared_ptr<mg::Buffer> const& buffer)
+void mc::Stream::submit_buffer(std::shared_ptr<mg::Buffer> const& buffer, geom::Rectangles const& damage)
 {
     if (!buffer)
         BOOST_THROW_EXCEPTION(std::invalid_argument("cannot submit null buffer"));
 
     {
         std::lock_guard<decltype(mutex)> lk(mutex);
+
+        geom::Rectangle const buffer_area{{}, buffer->size()};
+        geom::Rectangles buffer_damage;
+        if (first_frame_posted && buffer->size() == latest_buffer_size)
+        {
+            for (auto const& rect : damage)
+            {
+                auto const clipped = rect.intersection_with(buffer_area);
+                if (clipped.size.width > geom::Width{0} && clipped.size.height > geom::Height{0})
+                    buffer_damage.add(clipped);
+            }
+        }
+        else
+        {
+            buffer_damage.add(buffer_area);
+        }
+
+        submissions.push_back({buffer->id(), buffer_damage});
+        if (submissions.size() > max_damage_history)
+            submissions.pop_front();
+
         first_frame_posted = true;
         pf = buffer->pixel_format();
         latest_buffer_size = buffer->size();
-        schedule->schedule(buffer);
+        latest_submission = buffer;
+        if (schedule_mode == ScheduleMode::Dropping)
+            mailbox.post(buffer);
+        else
+            schedule->schedule(buffer);
     }
     {
         std::lock_guard<decltype(callback_mutex)> lock{callback_mutex};
@@ -69,7 +101,10 @@ void mc::Stream::submit_buffer(std::shared_ptr<mg::Buffer> const& buffer)
 void mc::Stream::with_most_recent_buffer_do(std::function<void(mg::Buffer&)> const& fn)
 {
     std::lock_guard<decltype(mutex)> lk(mutex);
-    fn(*arbiter->snapshot_acquire());
+    if (schedule_mode == ScheduleMode::Dropping)
+        fn(*mailbox.snapshot_acquire());
+    else
+        fn(*arbiter->snapshot_acquire());
 }
 
 MirPixelFormat mc::Stream::pixel_format() const
@@ -87,7 +122,29 @@ void mc::Stream::set_frame_posted_callback(
 
 std::shared_ptr<mg::Buffer> mc::Stream::lock_compositor_buffer(void const* id)
 {
-    return arbiter->compositor_acquire(id);
+    for (;;)
+    {
+        auto const switches = mode_switches.load();
+        auto const mode = schedule_mode.load();
+        auto const other_mode = mode == ScheduleMode::Dropping ? ScheduleMode::Queueing : ScheduleMode::Dropping;
+
+        // If the mode switched since we looked, the buffers may have moved to the other structure
+        if (auto const buffer = try_compositor_acquire(mode, id))
+            return buffer;
+        if (auto const buffer = try_compositor_acquire(other_mode, id))
+            return buffer;
+
+        // Each retry means another switch has completed, so this doesn't wait on anything
+        if (mode_switches.load() == switches)
+            BOOST_THROW_EXCEPTION(std::logic_error("no buffer to give to compositor"));
+    }
+}
+
+auto mc::Stream::try_compositor_acquire(ScheduleMode mode, void const* id) -> std::shared_ptr<mg::Buffer>
+{
+    if (mode == ScheduleMode::Dropping)
+        return mailbox.try_compositor_acquire(id);
+    return arbiter->try_compositor_acquire(id);
 }
 
 geom::Size mc::Stream::stream_size()
@@ -101,15 +158,30 @@ geom::Size mc::Stream::stream_size()
 void mc::Stream::allow_framedropping(bool dropping)
 {
     std::lock_guard<decltype(mutex)> lk(mutex);
+    auto const latest = latest_submission.lock();
+
     if (dropping && schedule_mode == ScheduleMode::Queueing)
     {
-        transition_schedule(std::make_shared<mc::DroppingSchedule>(), lk);
+        // Only the most recent buffer makes it into the mailbox
+        if (latest)
+            mailbox.post(latest);
         schedule_mode = ScheduleMode::Dropping;
+        ++mode_switches;
+
+        // Compositors that still think we're queueing fall back to the mailbox once these are
+        // empty. Draining the schedule first means they can't refill the arbiter after.
+        while (schedule->num_scheduled())
+            schedule->next_buffer();
+        arbiter->release_current_buffer();
     }
     else if (!dropping && schedule_mode == ScheduleMode::Dropping)
     {
-        transition_schedule(std::make_shared<mc::QueueingSchedule>(), lk);
+        if (latest)
+            schedule->schedule(latest);
         schedule_mode = ScheduleMode::Queueing;
+        ++mode_switches;
+
+        mailbox.take();
     }
 }
 
@@ -118,20 +190,11 @@ bool mc::Stream::framedropping() const
     return schedule_mode == ScheduleMode::Dropping;
 }
 
-void mc::Stream::transition_schedule(
-    std::shared_ptr<mc::Schedule>&& new_schedule, std::lock_guard<std::mutex> const&)
-{
-    std::vector<std::shared_ptr<mg::Buffer>> transferred_buffers;
-    while(schedule->num_scheduled())
-        transferred_buffers.emplace_back(schedule->next_buffer());
-    for(auto& buffer : transferred_buffers)
-        new_schedule->schedule(buffer);
-    schedule = new_schedule;
-    arbiter->set_schedule(schedule);
-}
-
 int mc::Stream::buffers_ready_for_compositor(void const* id) const
 {
+    if (schedule_mode == ScheduleMode::Dropping)
+        return mailbox.buffer_ready_for(id) ? 1 : 0;
+
     std::lock_guard<decltype(mutex)> lk(mutex);
     if (arbiter->buffer_ready_for(id))
         return 1;
@@ -141,6 +204,10 @@ int mc::Stream::buffers_ready_for_compositor(void const* id) const
 void mc::Stream::drop_old_buffers()
 {
     std::lock_guard<decltype(mutex)> lk(mutex);
+    // The mailbox never holds anything but the latest buffer
+    if (schedule_mode == ScheduleMode::Dropping)
+        return;
+
     std::vector<std::shared_ptr<mg::Buffer>> transferred_buffers;
     while(schedule->num_scheduled())
         transferred_buffers.emplace_back(schedule->next_buffer());
@@ -165,3 +232,42 @@ void mc::Stream::set_scale(float scale)
     std::lock_guard<decltype(mutex)> lk(mutex);
     scale_ = scale;
 }
+
+void mc::Stream::set_opaque_region(geom::Rectangles const& region)
+{
+    std::lock_guard<decltype(mutex)> lk(mutex);
+    opaque_region_ = region;
+}
+
+auto mc::Stream::opaque_region() const -> geom::Rectangles
+{
+    std::lock_guard<decltype(mutex)> lk(mutex);
+    return opaque_region_;
+}
+
+auto mc::Stream::damage_between(mg::BufferID previous, mg::BufferID current) const
+    -> std::experimental::optional<geom::Rectangles>
+{
+    std::lock_guard<decltype(mutex)> lk(mutex);
+
+    auto const submitted = [](mg::BufferID id)
+        {
+            return [id](Submission const& submission) { return submission.buffer == id; };
+        };
+
+    auto const from = std::find_if(submissions.begin(), submissions.end(), submitted(previous));
+    if (from == submissions.end())
+        return {};
+
+    auto const to = std::find_if(from, submissions.end(), submitted(current));
+    if (to == submissions.end())
+        return {};
+
+    geom::Rectangles damage;
+    for (auto i = std::next(from); i != std::next(to); ++i)
+    {
+        for (auto const& rect : i->damage)
+            damage.add(rect);
+    }
+    return damage;
+}
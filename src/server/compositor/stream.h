@@ -26,6 +26,9 @@
 #include "mir/lockable_callback.h"
 #include "mir/geometry/size.h"
 #include "multi_monitor_arbiter.h"
+#include "buffer_mailbox.h"
+#include <atomic>
+#include <deque>
 #include <mutex>
 #include <memory>
 #include <set>
@@ -42,7 +45,9 @@ public:
     Stream(geometry::Size sz, MirPixelFormat format);
     ~Stream();
 
-    void submit_buffer(std::shared_ptr<graphics::Buffer> const& buffer) override;
+    void submit_buffer(
+        std::shared_ptr<graphics::Buffer> const& buffer,
+        geometry::Rectangles const& damage) override;
     void with_most_recent_buffer_do(std::function<void(graphics::Buffer&)> const& exec) override;
     MirPixelFormat pixel_format() const override;
     void set_frame_posted_callback(
@@ -56,19 +61,44 @@ public:
     void drop_old_buffers() override;
     bool has_submitted_buffer() const override;
     void set_scale(float scale) override;
+    void set_opaque_region(geometry::Rectangles const& region) override;
+    auto opaque_region() const -> geometry::Rectangles override;
+    auto damage_between(graphics::BufferID previous, graphics::BufferID current) const
+        -> std::experimental::optional<geometry::Rectangles> override;
 
 private:
     enum class ScheduleMode;
-    void transition_schedule(std::shared_ptr<Schedule>&& new_schedule, std::lock_guard<std::mutex> const&);
+
+    /// Acquire from the arbiter or the mailbox, returning null if it has no buffer
+    auto try_compositor_acquire(ScheduleMode mode, void const* user_id) -> std::shared_ptr<graphics::Buffer>;
 
     std::mutex mutable mutex;
-    ScheduleMode schedule_mode;
-    std::shared_ptr<Schedule> schedule;
+    /// Only written under mutex. Compositors read it without locking, so a mode switch
+    /// fills the new mode's structure before flipping this and empties the old one after.
+    std::atomic<ScheduleMode> schedule_mode;
+    /// Incremented after each flip of schedule_mode, so that a compositor that finds
+    /// both structures empty can tell whether it raced with a switch
+    std::atomic<unsigned> mode_switches;
+    // When queueing, every submitted buffer is handed to the compositors in turn...
+    std::shared_ptr<Schedule> const schedule;
     std::shared_ptr<MultiMonitorArbiter> const arbiter;
+    // ...but when dropping, they only ever get the latest, without contending with submissions
+    BufferMailbox mailbox;
     geometry::Size latest_buffer_size;
+    /// Always still held by the arbiter (or schedule) or the mailbox
+    std::weak_ptr<graphics::Buffer> latest_submission;
     float scale_{1.0f};
     MirPixelFormat pf;
     bool first_frame_posted;
+    geometry::Rectangles opaque_region_;
+
+    struct Submission
+    {
+        graphics::BufferID buffer;
+        geometry::Rectangles damage;
+    };
+    // Damage of the most recently submitted buffers, oldest first
+    std::deque<Submission> submissions;
 
     std::mutex callback_mutex;
     std::function<void(geometry::Size const&)> frame_callback;
@@ -435,7 +435,10 @@ void mf::SessionMediator::submit_buffer(
     mfd::ProtobufBufferPacker request_msg{const_cast<mir::protobuf::Buffer*>(&request->buffer())};
     auto b = buffer_cache.at(buffer_id);
 
-    stream->submit_buffer(std::make_shared<AutoSendBuffer>(b, executor, event_sink));
+    // The mirclient protocol has no notion of damage
+    stream->submit_buffer(
+        std::make_shared<AutoSendBuffer>(b, executor, event_sink),
+        geom::Rectangles{geom::Rectangle{{}, b->size()}});
 
     done->Run();
 }
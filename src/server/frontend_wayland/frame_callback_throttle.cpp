@@ -0,0 +1,174 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "frame_callback_throttle.h"
+
+#include "mir/scene/null_surface_observer.h"
+#include "mir/scene/surface.h"
+#include "mir/executor.h"
+
+#include <wayland-server-core.h>
+
+#include <algorithm>
+
+namespace mf = mir::frontend;
+namespace ms = mir::scene;
+
+using namespace std::chrono;
+
+namespace
+{
+auto can_be_seen(ms::Surface const& surface) -> bool
+{
+    switch (surface.state())
+    {
+    case mir_window_state_minimized:
+    case mir_window_state_hidden:
+        return false;
+
+    default:
+        return surface.visible() &&
+               surface.query(mir_window_attrib_visibility) == mir_window_visibility_exposed;
+    }
+}
+}
+
+/// Relays changes that might bring the surface into sight (from any thread) to the Wayland thread
+class mf::FrameCallbackThrottle::SightObserver : public ms::NullSurfaceObserver
+{
+public:
+    SightObserver(std::function<void()> on_change)
+        : on_change{std::move(on_change)}
+    {
+    }
+
+    void attrib_changed(ms::Surface const*, MirWindowAttrib attrib, int /*value*/) override
+    {
+        if (attrib == mir_window_attrib_visibility || attrib == mir_window_attrib_state)
+            on_change();
+    }
+
+    void hidden_set_to(ms::Surface const*, bool hide) override
+    {
+        if (!hide)
+            on_change();
+    }
+
+private:
+    std::function<void()> const on_change;
+};
+
+mf::FrameCallbackThrottle::FrameCallbackThrottle(
+    wl_event_loop* loop,
+    std::shared_ptr<Executor> const& wayland_executor,
+    nanoseconds interval,
+    std::function<void()> send_callbacks)
+    : wayland_executor{wayland_executor},
+      interval{interval},
+      send_callbacks{std::move(send_callbacks)},
+      timer{wl_event_loop_add_timer(loop, &on_timer, this)},
+      alive{std::make_shared<bool>(true)}
+{
+}
+
+mf::FrameCallbackThrottle::~FrameCallbackThrottle()
+{
+    stop_waiting();
+    wl_event_source_remove(timer);
+}
+
+void mf::FrameCallbackThrottle::request(std::shared_ptr<ms::Surface> const& surface)
+{
+    if (!surface || can_be_seen(*surface))
+    {
+        stop_waiting();
+        send();
+        return;
+    }
+
+    if (waiting)
+        return;
+
+    auto const since_last = steady_clock::now() - last_sent;
+    if (interval > nanoseconds::zero() && since_last >= interval)
+    {
+        send();
+        return;
+    }
+
+    waiting = true;
+    watched_surface = surface;
+    observer = std::make_shared<SightObserver>(
+        [executor = wayland_executor, this, alive = std::weak_ptr<bool>{alive}]()
+        {
+            executor->spawn([this, alive]()
+                {
+                    if (alive.lock())
+                        recheck();
+                });
+        });
+    surface->add_observer(observer);
+
+    if (interval > nanoseconds::zero())
+    {
+        auto const delay = duration_cast<milliseconds>(interval - since_last);
+        // A zero delay would disarm the timer
+        wl_event_source_timer_update(timer, std::max(1, static_cast<int>(delay.count())));
+    }
+}
+
+int mf::FrameCallbackThrottle::on_timer(void* data)
+{
+    auto const self = static_cast<FrameCallbackThrottle*>(data);
+    if (self->waiting)
+    {
+        self->stop_waiting();
+        self->send();
+    }
+    return 0;
+}
+
+void mf::FrameCallbackThrottle::send()
+{
+    last_sent = steady_clock::now();
+    send_callbacks();
+}
+
+void mf::FrameCallbackThrottle::stop_waiting()
+{
+    if (!waiting)
+        return;
+
+    waiting = false;
+    wl_event_source_timer_update(timer, 0);
+    if (auto const surface = watched_surface.lock())
+        surface->remove_observer(observer);
+    watched_surface.reset();
+    observer.reset();
+}
+
+void mf::FrameCallbackThrottle::recheck()
+{
+    if (!waiting)
+        return;
+
+    auto const surface = watched_surface.lock();
+    if (!surface || can_be_seen(*surface))
+    {
+        stop_waiting();
+        send();
+    }
+}
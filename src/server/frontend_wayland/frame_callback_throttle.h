@@ -0,0 +1,95 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_FRONTEND_FRAME_CALLBACK_THROTTLE_H_
+#define MIR_FRONTEND_FRAME_CALLBACK_THROTTLE_H_
+
+#include <chrono>
+#include <functional>
+#include <memory>
+
+struct wl_event_loop;
+struct wl_event_source;
+
+namespace mir
+{
+class Executor;
+namespace scene
+{
+class Surface;
+class SurfaceObserver;
+}
+namespace frontend
+{
+/**
+ * Holds back the frame callbacks of a surface the user can't see
+ *
+ * A surface is out of sight when it is hidden, minimised or (according to the
+ * compositors' occlusion tracking) occluded on every active output. Rather than
+ * being sent as soon as it asks, such a surface gets its frame callbacks at most
+ * once per interval, or not at all if the interval is zero. Any held back are
+ * sent as soon as the surface comes back into sight.
+ *
+ * \note This must only be used on the Wayland thread (the surface observer it adds
+ *       passes anything it hears on to that thread)
+ */
+class FrameCallbackThrottle
+{
+public:
+    /**
+     * \param loop              The Wayland event loop
+     * \param wayland_executor  An executor that runs work on the Wayland event loop
+     * \param interval          How often to send callbacks while out of sight (zero for never)
+     * \param send_callbacks    Sends the surface's frame callbacks
+     */
+    FrameCallbackThrottle(
+        wl_event_loop* loop,
+        std::shared_ptr<Executor> const& wayland_executor,
+        std::chrono::nanoseconds interval,
+        std::function<void()> send_callbacks);
+    ~FrameCallbackThrottle();
+
+    /// Send the frame callbacks now if surface (which may be null) can be seen, or else when allowed
+    void request(std::shared_ptr<scene::Surface> const& surface);
+
+    FrameCallbackThrottle(FrameCallbackThrottle const&) = delete;
+    FrameCallbackThrottle& operator=(FrameCallbackThrottle const&) = delete;
+
+private:
+    class SightObserver;
+
+    static int on_timer(void* data);
+    void send();
+    void stop_waiting();
+    /// Called when something changed that might have brought the surface into sight
+    void recheck();
+
+    std::shared_ptr<Executor> const wayland_executor;
+    std::chrono::nanoseconds const interval;
+    std::function<void()> const send_callbacks;
+    wl_event_source* const timer;
+
+    std::chrono::steady_clock::time_point last_sent;
+    bool waiting{false};
+    std::weak_ptr<scene::Surface> watched_surface;
+    std::shared_ptr<scene::SurfaceObserver> observer;
+    /// Lets work queued on the Wayland loop know if we've gone
+    std::shared_ptr<bool> const alive;
+};
+}
+}
+
+#endif // MIR_FRONTEND_FRAME_CALLBACK_THROTTLE_H_
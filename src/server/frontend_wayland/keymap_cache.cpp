@@ -0,0 +1,150 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "keymap_cache.h"
+
+#include "mir/anonymous_shm_file.h"
+#include "mir/log.h"
+
+#include <xkbcommon/xkbcommon.h>
+#include <boost/throw_exception.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <linux/memfd.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace mf = mir::frontend;
+namespace mi = mir::input;
+
+namespace
+{
+auto text_of(xkb_keymap* keymap) -> std::string
+{
+    std::unique_ptr<char, void(*)(void*)> const buffer{
+        xkb_keymap_get_as_string(keymap, XKB_KEYMAP_FORMAT_TEXT_V1),
+        free};
+
+    if (!buffer)
+        BOOST_THROW_EXCEPTION(std::runtime_error{"Failed to serialize keymap"});
+
+    return buffer.get();
+}
+
+/// A memfd holding text that nobody (including any client) can change, or
+/// an invalid Fd if the kernel doesn't support sealing
+auto sealed_file_holding(std::string const& text) -> mir::Fd
+{
+    mir::Fd const fd{static_cast<int>(syscall(SYS_memfd_create, "mir-keymap", MFD_CLOEXEC | MFD_ALLOW_SEALING))};
+    if (fd < 0)
+        return mir::Fd{};
+
+    for (size_t written = 0; written < text.size();)
+    {
+        auto const result = write(fd, text.data() + written, text.size() - written);
+        if (result < 0 && errno != EINTR)
+        {
+            BOOST_THROW_EXCEPTION(
+                std::system_error(errno, std::system_category(), "Failed to write keymap"));
+        }
+        if (result > 0)
+            written += result;
+    }
+
+    if (fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) < 0)
+        return mir::Fd{};
+
+    return fd;
+}
+}
+
+mf::KeymapCache::CompiledKeymap::CompiledKeymap(mi::Keymap const& names, KeymapPtr keymap)
+    : names{names},
+      keymap_{std::move(keymap)},
+      text{text_of(keymap_.get())},
+      shared_fd{sealed_file_holding(text)}
+{
+    if (shared_fd < 0)
+        log_warning("Unable to seal keymap file, each client will be sent a copy");
+}
+
+mf::KeymapCache::CompiledKeymap::~CompiledKeymap() = default;
+
+auto mf::KeymapCache::CompiledKeymap::fd() const -> Fd
+{
+    if (is_shared())
+        return shared_fd;
+
+    // A writable file can't be shared, as any client could change it for the others
+    AnonymousShmFile copy{text.size()};
+    memcpy(copy.base_ptr(), text.data(), text.size());
+    return Fd{fcntl(copy.fd(), F_DUPFD_CLOEXEC, 0)};
+}
+
+mf::KeymapCache::KeymapCache()
+    : context{xkb_context_new(XKB_CONTEXT_NO_FLAGS), &xkb_context_unref}
+{
+}
+
+mf::KeymapCache::~KeymapCache() = default;
+
+auto mf::KeymapCache::keymap_for(mi::Keymap const& names) -> std::shared_ptr<CompiledKeymap const>
+{
+    std::lock_guard<std::mutex> lock{mutex};
+
+    if (most_recent && most_recent->names == names)
+        return most_recent;
+
+    compiled.erase(
+        std::remove_if(begin(compiled), end(compiled), [](auto const& entry) { return entry.expired(); }),
+        end(compiled));
+
+    for (auto const& entry : compiled)
+    {
+        if (auto const keymap = entry.lock())
+        {
+            if (keymap->names == names)
+                return most_recent = keymap;
+        }
+    }
+
+    xkb_rule_names const rule_names = {
+        "evdev",
+        names.model.c_str(),
+        names.layout.c_str(),
+        names.variant.c_str(),
+        names.options.c_str()
+    };
+
+    CompiledKeymap::KeymapPtr keymap{
+        xkb_keymap_new_from_names(context.get(), &rule_names, XKB_KEYMAP_COMPILE_NO_FLAGS),
+        &xkb_keymap_unref};
+
+    if (!keymap)
+    {
+        BOOST_THROW_EXCEPTION(std::runtime_error{
+            "Failed to compile keymap " + names.model + "-" + names.layout + "-" + names.variant + "-" + names.options});
+    }
+
+    most_recent = std::make_shared<CompiledKeymap>(names, std::move(keymap));
+    compiled.push_back(most_recent);
+    return most_recent;
+}
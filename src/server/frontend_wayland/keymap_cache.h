@@ -0,0 +1,95 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_FRONTEND_KEYMAP_CACHE_H_
+#define MIR_FRONTEND_KEYMAP_CACHE_H_
+
+#include "mir/fd.h"
+#include "mir/input/keymap.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// from <xkbcommon/xkbcommon.h>
+struct xkb_keymap;
+struct xkb_context;
+
+namespace mir
+{
+namespace frontend
+{
+/**
+ * Compiles each keymap once for all the wl_keyboards of the server
+ *
+ * The text of a compiled keymap is written once to a sealed (and so read-only)
+ * memfd, which is sent to every client using it. Keymaps stay cached for as
+ * long as a keyboard holds them, and the most recently requested one for
+ * longer.
+ */
+class KeymapCache
+{
+public:
+    class CompiledKeymap
+    {
+    public:
+        using KeymapPtr = std::unique_ptr<xkb_keymap, void (*)(xkb_keymap*)>;
+
+        CompiledKeymap(mir::input::Keymap const& names, KeymapPtr keymap);
+        ~CompiledKeymap();
+
+        mir::input::Keymap const names;
+
+        /// Never null; for creating the xkb_state of a keyboard
+        auto keymap() const -> xkb_keymap* { return keymap_.get(); }
+
+        /// The fd to send in a wl_keyboard.keymap event (not owned by the caller)
+        /// \note Without memfd sealing each call makes a private copy
+        auto fd() const -> Fd;
+        auto size() const -> size_t { return text.size(); }
+
+        /// Whether every client is sent the same read-only fd
+        auto is_shared() const -> bool { return shared_fd >= 0; }
+
+    private:
+        CompiledKeymap(CompiledKeymap const&) = delete;
+        CompiledKeymap& operator=(CompiledKeymap const&) = delete;
+
+        KeymapPtr const keymap_;
+        std::string const text;
+        Fd const shared_fd;
+    };
+
+    KeymapCache();
+    ~KeymapCache();
+
+    auto keymap_for(mir::input::Keymap const& names) -> std::shared_ptr<CompiledKeymap const>;
+
+private:
+    KeymapCache(KeymapCache const&) = delete;
+    KeymapCache& operator=(KeymapCache const&) = delete;
+
+    std::unique_ptr<xkb_context, void (*)(xkb_context*)> const context;
+
+    std::mutex mutex;
+    std::vector<std::weak_ptr<CompiledKeymap const>> compiled;
+    std::shared_ptr<CompiledKeymap const> most_recent;
+};
+}
+}
+
+#endif // MIR_FRONTEND_KEYMAP_CACHE_H_
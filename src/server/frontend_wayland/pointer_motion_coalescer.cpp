@@ -0,0 +1,200 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pointer_motion_coalescer.h"
+
+#include "mir/events/event.h"
+#include "mir/events/pointer_event.h"
+
+#include <wayland-server-core.h>
+
+#include <algorithm>
+
+namespace mf = mir::frontend;
+
+using namespace std::chrono;
+
+namespace
+{
+auto pointer_motion_in(MirEvent& event) -> MirPointerEvent*
+{
+    if (event.type() != mir_event_type_input)
+        return nullptr;
+
+    auto const input = event.to_input();
+    if (input->input_type() != mir_input_event_type_pointer)
+        return nullptr;
+
+    auto const pointer = input->to_pointer();
+    return pointer->action() == mir_pointer_action_motion ? pointer : nullptr;
+}
+
+auto can_merge(MirPointerEvent const& earlier, MirPointerEvent const& later) -> bool
+{
+    return earlier.device_id() == later.device_id() &&
+           earlier.buttons() == later.buttons() &&
+           earlier.modifiers() == later.modifiers();
+}
+
+/// Makes later stand for both events
+void merge(MirPointerEvent const& earlier, MirPointerEvent& later)
+{
+    later.set_dx(earlier.dx() + later.dx());
+    later.set_dy(earlier.dy() + later.dy());
+    later.set_hscroll(earlier.hscroll() + later.hscroll());
+    later.set_vscroll(earlier.vscroll() + later.vscroll());
+}
+}
+
+mf::PointerMotionCoalescer::PointerMotionCoalescer(wl_event_loop* loop, nanoseconds max_hold)
+    : max_hold{max_hold},
+      hold_timer{wl_event_loop_add_timer(loop, &on_hold_timeout, this)}
+{
+}
+
+mf::PointerMotionCoalescer::~PointerMotionCoalescer() = default;
+
+void mf::PointerMotionCoalescer::stop()
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    awaiting_frame = false;
+    hold_timer_armed = false;
+
+    if (hold_timer)
+    {
+        wl_event_source_remove(hold_timer);
+        hold_timer = nullptr;
+    }
+}
+
+void mf::PointerMotionCoalescer::set_dispatch(Dispatch const& dispatch)
+{
+    this->dispatch = dispatch;
+}
+
+auto mf::PointerMotionCoalescer::add(std::shared_ptr<MirEvent> const& event) -> bool
+{
+    std::lock_guard<std::mutex> lock{mutex};
+
+    auto const motion = pointer_motion_in(*event);
+    auto const previous_motion = pending.empty() ? nullptr : pointer_motion_in(*pending.back());
+
+    if (motion && previous_motion && can_merge(*previous_motion, *motion))
+    {
+        merge(*previous_motion, *motion);
+        pending.back() = event;
+    }
+    else
+    {
+        if (motion)
+            motion_since = motion->event_time();
+        pending.push_back(event);
+    }
+
+    if (motion && awaiting_frame)
+    {
+        // The client will see the motion when it starts its next frame, unless that is taking too long.
+        // Motion held for the first time goes to the Wayland thread too, so it can time the hold.
+        if (motion->event_time() - motion_since > max_hold)
+            hold_expired = true;
+        else if (hold_timer_armed)
+            return false;
+    }
+
+    if (flush_scheduled)
+        return false;
+
+    flush_scheduled = true;
+    return true;
+}
+
+void mf::PointerMotionCoalescer::flush()
+{
+    std::unique_lock<std::mutex> lock{mutex};
+    flush_scheduled = false;
+
+    auto due = std::move(pending);
+    pending.clear();
+
+    if (awaiting_frame && !hold_expired && !due.empty() && pointer_motion_in(*due.back()))
+    {
+        pending.push_back(std::move(due.back()));
+        due.pop_back();
+        // The client may never start its frame, or the pointer stop moving
+        set_hold_timer(true);
+    }
+    else
+    {
+        hold_expired = false;
+        set_hold_timer(false);
+    }
+
+    // Only the Wayland thread dispatches, so events can't overtake each other once unlocked
+    lock.unlock();
+    dispatch_all(due);
+}
+
+void mf::PointerMotionCoalescer::frame_requested()
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    awaiting_frame = true;
+}
+
+void mf::PointerMotionCoalescer::frame_done()
+{
+    std::unique_lock<std::mutex> lock{mutex};
+    awaiting_frame = false;
+    hold_expired = false;
+    set_hold_timer(false);
+
+    auto const due = std::move(pending);
+    pending.clear();
+
+    lock.unlock();
+    dispatch_all(due);
+}
+
+int mf::PointerMotionCoalescer::on_hold_timeout(void* data)
+{
+    auto const self = static_cast<PointerMotionCoalescer*>(data);
+    {
+        std::lock_guard<std::mutex> lock{self->mutex};
+        self->hold_timer_armed = false;
+        self->hold_expired = true;
+    }
+    self->flush();
+    return 0;
+}
+
+void mf::PointerMotionCoalescer::set_hold_timer(bool armed)
+{
+    if (!hold_timer || armed == hold_timer_armed)
+        return;
+
+    hold_timer_armed = armed;
+    // Round up, and as a zero delay disarms the timer wait at least a millisecond
+    auto const delay_ms = duration_cast<milliseconds>(max_hold + milliseconds{1} - nanoseconds{1}).count();
+    wl_event_source_timer_update(hold_timer, armed ? std::max<int>(1, delay_ms) : 0);
+}
+
+void mf::PointerMotionCoalescer::dispatch_all(std::vector<std::shared_ptr<MirEvent>> const& events) const
+{
+    if (!dispatch)
+        return;
+
+    for (auto const& event : events)
+        dispatch(mir_event_get_input_event(event.get()));
+}
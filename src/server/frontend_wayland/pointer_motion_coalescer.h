@@ -0,0 +1,109 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_FRONTEND_POINTER_MOTION_COALESCER_H_
+#define MIR_FRONTEND_POINTER_MOTION_COALESCER_H_
+
+#include "mir_toolkit/events/event.h"
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct wl_event_loop;
+struct wl_event_source;
+
+namespace mir
+{
+namespace frontend
+{
+/**
+ * Merges the pointer motion sent to a wl_surface into one event per client frame
+ *
+ * Input events arrive on the input thread and are dispatched on the Wayland
+ * thread. Consecutive motion (including scrolling) with the same buttons and
+ * modifiers held is merged: the merged event has the latest position and
+ * the sum of the relative and scroll deltas. Anything else (buttons, touches,
+ * keys, enter and leave) is never merged or reordered, and flushes any motion
+ * before it.
+ *
+ * While the client waits on a frame callback its motion is held back until
+ * just before the callback is sent, or until it has been held for max_hold
+ * (whether or not more input arrives meanwhile). Otherwise motion is
+ * dispatched as soon as the Wayland thread gets to it, merged with any that
+ * arrived while it was queued.
+ */
+class PointerMotionCoalescer
+{
+public:
+    using Dispatch = std::function<void(MirInputEvent const* event)>;
+
+    /// \param loop  The Wayland event loop, which times how long motion is held for
+    PointerMotionCoalescer(wl_event_loop* loop, std::chrono::nanoseconds max_hold);
+    ~PointerMotionCoalescer();
+
+    /// Wayland thread: stops holding motion back and lets go of the event loop. As the
+    /// coalescer can be kept alive off the Wayland thread, its owner calls this when done with it
+    void stop();
+
+    /// Wayland thread: where flushed events go
+    void set_dispatch(Dispatch const& dispatch);
+
+    /// Input thread: takes an input event for the surface
+    /// \returns whether the caller needs to arrange for flush() on the Wayland thread
+    auto add(std::shared_ptr<MirEvent> const& event) -> bool;
+
+    /// Wayland thread: dispatches the events that are due, oldest first
+    /// (motion being held back for a frame stays pending)
+    void flush();
+
+    /// Wayland thread: the client has committed frame callbacks
+    void frame_requested();
+
+    /// Wayland thread: the client is about to be sent its frame callbacks, so
+    /// gets the motion held back for it first
+    void frame_done();
+
+private:
+    PointerMotionCoalescer(PointerMotionCoalescer const&) = delete;
+    PointerMotionCoalescer& operator=(PointerMotionCoalescer const&) = delete;
+
+    static int on_hold_timeout(void* data);
+    /// Wayland thread, with mutex held
+    void set_hold_timer(bool armed);
+    void dispatch_all(std::vector<std::shared_ptr<MirEvent>> const& events) const;
+
+    std::chrono::nanoseconds const max_hold;
+    Dispatch dispatch;
+
+    std::mutex mutex;
+    /// Only the last can be motion that more motion is merged into
+    std::vector<std::shared_ptr<MirEvent>> pending;
+    /// When the motion at the end of pending started
+    std::chrono::nanoseconds motion_since{0};
+    bool awaiting_frame{false};
+    bool hold_expired{false};
+    bool flush_scheduled{false};
+    /// Null once stopped
+    wl_event_source* hold_timer;
+    bool hold_timer_armed{false};
+};
+}
+}
+
+#endif // MIR_FRONTEND_POINTER_MOTION_COALESCER_H_
@@ -0,0 +1,210 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "presentation_time.h"
+
+#include "wl_surface.h"
+#include "output_manager.h"
+#include "mir_display.h"
+#include "deleted_for_resource.h"
+
+#include "mir/graphics/display_configuration.h"
+#include "mir/time/steady_clock.h"
+
+#include <wayland-server-core.h>
+
+namespace mf = mir::frontend;
+namespace mg = mir::graphics;
+namespace geom = mir::geometry;
+namespace mw = mir::wayland;
+
+using namespace std::chrono;
+
+namespace
+{
+// The clock page flip timestamps are taken on, at least on current kernels
+clockid_t const presentation_clock = CLOCK_MONOTONIC;
+}
+
+namespace mir
+{
+namespace frontend
+{
+class WpPresentation : public wayland::Presentation::Global
+{
+public:
+    WpPresentation(
+        wl_display* display,
+        std::shared_ptr<mg::Display> const& graphics_display,
+        OutputManager* const output_manager);
+
+private:
+    class Instance : public wayland::Presentation
+    {
+    public:
+        Instance(
+            wl_resource* new_resource,
+            std::weak_ptr<PresentationTracker> const& tracker,
+            OutputManager* const output_manager);
+
+    private:
+        void destroy() override;
+        void feedback(wl_resource* surface, wl_resource* callback) override;
+
+        std::weak_ptr<PresentationTracker> const tracker;
+        OutputManager* const output_manager;
+    };
+
+    void bind(wl_resource* new_resource) override;
+
+    OutputManager* const output_manager;
+    std::shared_ptr<PresentationTracker> const tracker;
+};
+}
+}
+
+auto mf::create_wp_presentation(
+    wl_display* display,
+    std::shared_ptr<mg::Display> const& graphics_display,
+    OutputManager* const output_manager) -> std::shared_ptr<WpPresentation>
+{
+    return std::make_shared<WpPresentation>(display, graphics_display, output_manager);
+}
+
+mf::PresentationFeedback::PresentationFeedback(
+    wl_resource* new_resource,
+    std::weak_ptr<PresentationTracker> const& tracker,
+    OutputManager* const output_manager)
+    : wayland::PresentationFeedback{new_resource, Version<1>()},
+      destroyed_flag{deleted_flag_for_resource(resource)},
+      tracker{tracker},
+      output_manager{output_manager}
+{
+}
+
+auto mf::PresentationFeedback::frame_sampler() const -> std::function<PresentationTracker::FramesShown()>
+{
+    if (auto const t = tracker.lock())
+        return t->frame_sampler();
+    else
+        return [] { return PresentationTracker::FramesShown{}; };
+}
+
+void mf::PresentationFeedback::consumed(
+    geom::Rectangle const& extents,
+    PresentationTracker::FramesShown const& shown_before)
+{
+    if (*destroyed_flag)
+        return;
+
+    if (auto const t = tracker.lock())
+        t->consumed(shared_from_this(), extents, shown_before);
+    else
+        discarded();
+}
+
+void mf::PresentationFeedback::discarded()
+{
+    if (*destroyed_flag)
+        return;
+
+    send_discarded_event();
+    destroy_wayland_object();
+}
+
+auto mf::PresentationFeedback::destroyed() const -> bool
+{
+    return *destroyed_flag;
+}
+
+void mf::PresentationFeedback::presented(
+    mg::DisplayConfigurationOutputId output_id,
+    nanoseconds timestamp,
+    nanoseconds refresh,
+    uint64_t msc)
+{
+    if (*destroyed_flag)
+        return;
+
+    if (auto const output = output_manager->output_for(output_id))
+    {
+        output.value()->for_each_output_resource_bound_by(
+            client,
+            [this](wl_resource* output_resource) { send_sync_output_event(output_resource); });
+    }
+
+    // Without a frame counter, we don't know it was synchronized to the hardware
+    uint32_t const flags = msc == 0 ? 0 :
+        mw::PresentationFeedback::Kind::vsync |
+        mw::PresentationFeedback::Kind::hw_clock |
+        mw::PresentationFeedback::Kind::hw_completion;
+
+    auto const sec = duration_cast<seconds>(timestamp);
+    uint64_t const tv_sec = sec.count();
+    uint32_t const tv_nsec = (timestamp - sec).count();
+
+    send_presented_event(
+        tv_sec >> 32, tv_sec & 0xffffffff,
+        tv_nsec,
+        refresh.count(),
+        msc >> 32, msc & 0xffffffff,
+        flags);
+    destroy_wayland_object();
+}
+
+mf::WpPresentation::WpPresentation(
+    wl_display* display,
+    std::shared_ptr<mg::Display> const& graphics_display,
+    OutputManager* const output_manager)
+    : Global{display, Version<1>()},
+      output_manager{output_manager},
+      tracker{std::make_shared<PresentationTracker>(
+          wl_display_get_event_loop(display),
+          graphics_display,
+          [output_manager](std::function<void(mg::DisplayConfigurationOutput const&)> const& f)
+          {
+              output_manager->display_config()->for_each_output(f);
+          },
+          std::make_shared<time::SteadyClock>())}
+{
+}
+
+void mf::WpPresentation::bind(wl_resource* new_resource)
+{
+    new Instance{new_resource, tracker, output_manager};
+}
+
+mf::WpPresentation::Instance::Instance(
+    wl_resource* new_resource,
+    std::weak_ptr<PresentationTracker> const& tracker,
+    OutputManager* const output_manager)
+    : Presentation{new_resource, Version<1>()},
+      tracker{tracker},
+      output_manager{output_manager}
+{
+    send_clock_id_event(presentation_clock);
+}
+
+void mf::WpPresentation::Instance::destroy()
+{
+    destroy_wayland_object();
+}
+
+void mf::WpPresentation::Instance::feedback(wl_resource* surface, wl_resource* callback)
+{
+    WlSurface::from(surface)->add_presentation_feedback(
+        std::make_shared<PresentationFeedback>(callback, tracker, output_manager));
+}
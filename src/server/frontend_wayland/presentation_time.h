@@ -0,0 +1,84 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_FRONTEND_PRESENTATION_TIME_H
+#define MIR_FRONTEND_PRESENTATION_TIME_H
+
+#include "presentation-time_wrapper.h"
+#include "presentation_tracker.h"
+
+#include <memory>
+
+struct wl_display;
+
+namespace mir
+{
+namespace graphics
+{
+class Display;
+}
+namespace geometry
+{
+struct Rectangle;
+}
+namespace frontend
+{
+class OutputManager;
+class WpPresentation;
+
+/// Feedback on when one content update (wl_surface.commit) reached the screen
+class PresentationFeedback
+    : public wayland::PresentationFeedback,
+      public PresentationTracker::Feedback,
+      public std::enable_shared_from_this<PresentationFeedback>
+{
+public:
+    PresentationFeedback(
+        wl_resource* new_resource,
+        std::weak_ptr<PresentationTracker> const& tracker,
+        OutputManager* const output_manager);
+
+    /// For the compositor to note the frames shown when it takes the content update
+    auto frame_sampler() const -> std::function<PresentationTracker::FramesShown()>;
+
+    /// The compositor took the content update after shown_before, so it's presented with the next frame of the output it's mostly on
+    void consumed(geometry::Rectangle const& extents, PresentationTracker::FramesShown const& shown_before);
+
+    /// The content update was superseded before the compositor got it, or its surface is gone
+    void discarded() override;
+
+    auto destroyed() const -> bool override;
+
+    void presented(
+        graphics::DisplayConfigurationOutputId output,
+        std::chrono::nanoseconds timestamp,
+        std::chrono::nanoseconds refresh,
+        uint64_t msc) override;
+
+private:
+    std::shared_ptr<bool> const destroyed_flag;
+    std::weak_ptr<PresentationTracker> const tracker;
+    OutputManager* const output_manager;
+};
+
+auto create_wp_presentation(
+    wl_display* display,
+    std::shared_ptr<graphics::Display> const& graphics_display,
+    OutputManager* const output_manager) -> std::shared_ptr<WpPresentation>;
+}
+}
+
+#endif // MIR_FRONTEND_PRESENTATION_TIME_H
@@ -0,0 +1,248 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "presentation_tracker.h"
+
+#include "mir/graphics/display.h"
+#include "mir/geometry/rectangle.h"
+#include "mir/time/clock.h"
+#include "mir/time/posix_timestamp.h"
+
+#include <wayland-server-core.h>
+
+#include <algorithm>
+#include <experimental/optional>
+#include <mutex>
+
+namespace mf = mir::frontend;
+namespace mg = mir::graphics;
+namespace geom = mir::geometry;
+
+using namespace std::chrono;
+
+namespace
+{
+// The clock page flip timestamps are taken on, at least on current kernels
+clockid_t const presentation_clock = CLOCK_MONOTONIC;
+
+// How often to look for new frames if we don't know the refresh rate
+auto const default_check_interval = milliseconds{16};
+
+// An output that hasn't shown a new frame for this long is most likely off
+auto const discard_after = seconds{1};
+
+auto on_presentation_clock(mir::time::PosixTimestamp const& timestamp) -> nanoseconds
+{
+    if (timestamp.clock_id == presentation_clock)
+        return timestamp.nanoseconds;
+
+    auto const offset =
+        mir::time::PosixTimestamp::now(timestamp.clock_id).nanoseconds -
+        mir::time::PosixTimestamp::now(presentation_clock).nanoseconds;
+    return timestamp.nanoseconds - offset;
+}
+}
+
+struct mf::PresentationTracker::Outputs
+{
+    explicit Outputs(std::shared_ptr<mg::Display> const& display)
+        : display{display}
+    {
+    }
+
+    auto frames_shown() const -> FramesShown
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        FramesShown shown;
+        shown.reserve(ids.size());
+        for (auto const id : ids)
+            shown.emplace_back(id, display->last_frame_on(id.as_value()).msc);
+        return shown;
+    }
+
+    std::shared_ptr<mg::Display> const display;
+    std::mutex mutable mutex;
+    std::vector<mg::DisplayConfigurationOutputId> ids;
+};
+
+mf::PresentationTracker::PresentationTracker(
+    wl_event_loop* loop,
+    std::shared_ptr<mg::Display> const& display,
+    ForEachOutput for_each_output,
+    std::shared_ptr<time::Clock> const& clock)
+    : display{display},
+      for_each_output{std::move(for_each_output)},
+      clock{clock},
+      outputs{std::make_shared<Outputs>(display)},
+      timer{wl_event_loop_add_timer(loop, &on_timer, this)}
+{
+    std::vector<mg::DisplayConfigurationOutputId> in_use;
+    this->for_each_output(
+        [&](mg::DisplayConfigurationOutput const& output)
+        {
+            if (output.used && output.connected)
+                in_use.push_back(output.id);
+        });
+    set_sampled_outputs(std::move(in_use));
+}
+
+mf::PresentationTracker::~PresentationTracker()
+{
+    wl_event_source_remove(timer);
+}
+
+auto mf::PresentationTracker::frame_sampler() const -> std::function<FramesShown()>
+{
+    return [outputs = outputs]() { return outputs->frames_shown(); };
+}
+
+void mf::PresentationTracker::consumed(
+    std::shared_ptr<Feedback> const& feedback,
+    geom::Rectangle const& extents,
+    FramesShown const& shown_before)
+{
+    // Presentation is synchronized to the output showing most of the surface
+    std::experimental::optional<Pending> best;
+    int best_area{0};
+    std::vector<mg::DisplayConfigurationOutputId> in_use;
+    for_each_output(
+        [&](mg::DisplayConfigurationOutput const& output)
+        {
+            if (output.used && output.connected)
+                in_use.push_back(output.id);
+
+            if (!output.used ||
+                !output.connected ||
+                output.power_mode != mir_power_mode_on ||
+                output.current_mode_index >= output.modes.size())
+            {
+                return;
+            }
+
+            auto const overlap = output.extents().intersection_with(extents);
+            auto const area = overlap.size.width.as_int() * overlap.size.height.as_int();
+            if (area > best_area)
+            {
+                auto const hz = output.modes[output.current_mode_index].vrefresh_hz;
+                best_area = area;
+                best = Pending{
+                    feedback,
+                    output.id,
+                    msc_before(shown_before, output.id),
+                    hz > 0 ? nanoseconds{static_cast<int64_t>(1e9 / hz)} : nanoseconds::zero(),
+                    now()};
+            }
+        });
+
+    // Keep the frame sampler up to date with the display configuration
+    set_sampled_outputs(std::move(in_use));
+
+    if (!best)
+    {
+        // Nothing the user can see
+        feedback->discarded();
+        return;
+    }
+
+    if (pending.empty())
+        schedule_check(best.value().refresh);
+
+    pending.push_back(best.value());
+}
+
+auto mf::PresentationTracker::msc_before(
+    FramesShown const& shown_before,
+    mg::DisplayConfigurationOutputId output_id) const -> int64_t
+{
+    auto const sample = std::find_if(begin(shown_before), end(shown_before),
+        [output_id](FramesShown::value_type const& shown) { return shown.first == output_id; });
+
+    if (sample != end(shown_before))
+        return sample->second;
+
+    // The output came into use after the sample was taken, so this is the best we have
+    return display->last_frame_on(output_id.as_value()).msc;
+}
+
+void mf::PresentationTracker::set_sampled_outputs(std::vector<mg::DisplayConfigurationOutputId> ids)
+{
+    std::lock_guard<std::mutex> lock{outputs->mutex};
+    outputs->ids = std::move(ids);
+}
+
+int mf::PresentationTracker::on_timer(void* data)
+{
+    static_cast<PresentationTracker*>(data)->check_pending();
+    return 0;
+}
+
+void mf::PresentationTracker::check_pending()
+{
+    auto const time = now();
+    auto next_check = nanoseconds::max();
+
+    auto const done = std::remove_if(begin(pending), end(pending), [&](Pending const& item)
+        {
+            if (item.feedback->destroyed())
+                return true;
+
+            auto const frame = display->last_frame_on(item.output_id.as_value());
+            if (frame.msc == 0)
+            {
+                // The platform doesn't count frames, so all we know is it's had time to show
+                item.feedback->presented(item.output_id, time, item.refresh, 0);
+                return true;
+            }
+
+            if (frame.msc > item.msc)
+            {
+                // The content update made the first frame after it was consumed
+                auto const msc = item.msc + 1;
+                auto const timestamp = on_presentation_clock(frame.ust) - (frame.msc - msc) * item.refresh;
+                item.feedback->presented(item.output_id, timestamp, item.refresh, msc);
+                return true;
+            }
+
+            if (time - item.consumed_at > discard_after)
+            {
+                item.feedback->discarded();
+                return true;
+            }
+
+            next_check = std::min(next_check, item.refresh);
+            return false;
+        });
+    pending.erase(done, end(pending));
+
+    if (!pending.empty())
+        schedule_check(next_check);
+}
+
+void mf::PresentationTracker::schedule_check(nanoseconds delay)
+{
+    if (delay <= nanoseconds::zero() || delay == nanoseconds::max())
+        delay = default_check_interval;
+
+    // Round up, so we don't look before the frame we're waiting for
+    auto const delay_ms = std::max<int64_t>(1, duration_cast<milliseconds>(delay + milliseconds{1}).count());
+    wl_event_source_timer_update(timer, delay_ms);
+}
+
+auto mf::PresentationTracker::now() const -> nanoseconds
+{
+    // Our clocks are steady_clock, which is CLOCK_MONOTONIC
+    return clock->now().time_since_epoch();
+}
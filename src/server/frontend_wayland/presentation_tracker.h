@@ -0,0 +1,165 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_FRONTEND_PRESENTATION_TRACKER_H_
+#define MIR_FRONTEND_PRESENTATION_TRACKER_H_
+
+#include "mir/graphics/display_configuration.h"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+struct wl_event_loop;
+struct wl_event_source;
+
+namespace mir
+{
+namespace graphics
+{
+class Display;
+}
+namespace geometry
+{
+struct Rectangle;
+}
+namespace time
+{
+class Clock;
+}
+namespace frontend
+{
+/**
+ * Watches the frames shown on outputs, and says when content updates were presented.
+ *
+ * The page flip timestamps come from the graphics platform's
+ * Display::last_frame_on(). The frame counter is sampled by the compositor as
+ * it takes each content update (see frame_sampler()), and the presentation is
+ * the frame after that. Later frames are only noticed by polling about once a
+ * refresh, so feedback can arrive up to a refresh late, but presentation times
+ * are worked back from the frame counter so a late sample doesn't make a late
+ * timestamp.
+ *
+ * \note Apart from frame_sampler()'s result, this must only be used on the Wayland thread
+ */
+class PresentationTracker
+{
+public:
+    /// Told what became of one content update
+    class Feedback
+    {
+    public:
+        /// If the client no longer wants to know
+        virtual auto destroyed() const -> bool = 0;
+
+        /**
+         * The content update was shown
+         *
+         * \param output     The output it was synchronized to
+         * \param timestamp  When, on the presentation clock (CLOCK_MONOTONIC)
+         * \param refresh    The output's refresh interval (zero if not known)
+         * \param msc        The frame it was first shown in, or zero if the platform
+         *                   doesn't count frames (timestamp is then only when we noticed)
+         */
+        virtual void presented(
+            graphics::DisplayConfigurationOutputId output,
+            std::chrono::nanoseconds timestamp,
+            std::chrono::nanoseconds refresh,
+            uint64_t msc) = 0;
+
+        /// The content update wasn't shown, or we can't tell when it was
+        virtual void discarded() = 0;
+
+    protected:
+        Feedback() = default;
+        virtual ~Feedback() = default;
+        Feedback(Feedback const&) = delete;
+        Feedback& operator=(Feedback const&) = delete;
+    };
+
+    /// The count of frames (msc) shown so far on each output in use
+    using FramesShown = std::vector<std::pair<graphics::DisplayConfigurationOutputId, int64_t>>;
+
+    /// Calls its argument for each output in the current display configuration
+    using ForEachOutput =
+        std::function<void(std::function<void(graphics::DisplayConfigurationOutput const&)> const&)>;
+
+    /**
+     * \param loop            The Wayland event loop
+     * \param display         Where to find the frames shown on outputs
+     * \param for_each_output Where to find the outputs
+     * \param clock           A clock on the presentation clock's timeline
+     */
+    PresentationTracker(
+        wl_event_loop* loop,
+        std::shared_ptr<graphics::Display> const& display,
+        ForEachOutput for_each_output,
+        std::shared_ptr<time::Clock> const& clock);
+    ~PresentationTracker();
+
+    /**
+     * Notes the frames shown so far, for the compositor to call as it takes a content update.
+     *
+     * Unlike the tracker this can be called on any thread, and may outlive it.
+     */
+    auto frame_sampler() const -> std::function<FramesShown()>;
+
+    /**
+     * The compositor took the content update after shown_before, so it's presented
+     * with the next frame of the output showing most of it
+     */
+    void consumed(
+        std::shared_ptr<Feedback> const& feedback,
+        geometry::Rectangle const& extents,
+        FramesShown const& shown_before);
+
+    PresentationTracker(PresentationTracker const&) = delete;
+    PresentationTracker& operator=(PresentationTracker const&) = delete;
+
+private:
+    struct Pending
+    {
+        std::shared_ptr<Feedback> feedback;
+        graphics::DisplayConfigurationOutputId output_id;
+        int64_t msc;                        ///< Of the last frame shown before the compositor took the content update
+        std::chrono::nanoseconds refresh;   ///< Zero if not known
+        std::chrono::nanoseconds consumed_at;
+    };
+
+    /// The outputs for frame_sampler() to look at, shared with it
+    struct Outputs;
+
+    void set_sampled_outputs(std::vector<graphics::DisplayConfigurationOutputId> ids);
+    auto msc_before(FramesShown const& shown_before, graphics::DisplayConfigurationOutputId output_id) const -> int64_t;
+    static int on_timer(void* data);
+    void check_pending();
+    void schedule_check(std::chrono::nanoseconds delay);
+    auto now() const -> std::chrono::nanoseconds;
+
+    std::shared_ptr<graphics::Display> const display;
+    ForEachOutput const for_each_output;
+    std::shared_ptr<time::Clock> const clock;
+    std::shared_ptr<Outputs> const outputs;
+    wl_event_source* const timer;
+    std::vector<Pending> pending;
+};
+}
+}
+
+#endif // MIR_FRONTEND_PRESENTATION_TRACKER_H_
@@ -237,10 +237,14 @@ public:
     WlCompositor(
         struct wl_display* display,
         std::shared_ptr<mir::Executor> const& executor,
-        std::shared_ptr<mg::GraphicBufferAllocator> const& allocator)
+        std::shared_ptr<mg::GraphicBufferAllocator> const& allocator,
+        std::chrono::nanoseconds hidden_frame_interval,
+        bool coalesce_pointer_motion)
         : Global(display, Version<4>()),
           allocator{allocator},
-          executor{executor}
+          executor{executor},
+          hidden_frame_interval{hidden_frame_interval},
+          coalesce_pointer_motion{coalesce_pointer_motion}
     {
     }
 
@@ -249,6 +253,8 @@ public:
 private:
     std::shared_ptr<mg::GraphicBufferAllocator> const allocator;
     std::shared_ptr<mir::Executor> const executor;
+    std::chrono::nanoseconds const hidden_frame_interval;
+    bool const coalesce_pointer_motion;
     std::map<std::pair<wl_client*, uint32_t>, std::vector<std::function<void(WlSurface*)>>> surface_callbacks;
 
     class Instance : wayland::Compositor
@@ -288,7 +294,12 @@ void WlCompositor::on_surface_created(wl_client* client, uint32_t id, std::funct
 
 void WlCompositor::Instance::create_surface(wl_resource* new_surface)
 {
-    auto const surface = new WlSurface{new_surface, compositor->executor, compositor->allocator};
+    auto const surface = new WlSurface{
+        new_surface,
+        compositor->executor,
+        compositor->allocator,
+        compositor->hidden_frame_interval,
+        compositor->coalesce_pointer_motion};
     auto const key = std::make_pair(wl_resource_get_client(new_surface), wl_resource_get_id(new_surface));
     auto const callbacks = compositor->surface_callbacks.find(key);
     if (callbacks != compositor->surface_callbacks.end())
@@ -609,6 +620,7 @@ void mf::WaylandExtensions::run_builders(wl_display*, std::function<void(std::fu
 mf::WaylandConnector::WaylandConnector(
     std::shared_ptr<msh::Shell> const& shell,
     std::shared_ptr<MirDisplay> const& display_config,
+    std::shared_ptr<mg::Display> const& graphics_display,
     std::shared_ptr<mi::InputDeviceHub> const& input_hub,
     std::shared_ptr<mi::Seat> const& seat,
     std::shared_ptr<mg::GraphicBufferAllocator> const& allocator,
@@ -616,7 +628,9 @@ mf::WaylandConnector::WaylandConnector(
     std::shared_ptr<SurfaceStack> const& surface_stack,
     bool arw_socket,
     std::unique_ptr<WaylandExtensions> extensions_,
-    WaylandProtocolExtensionFilter const& extension_filter)
+    WaylandProtocolExtensionFilter const& extension_filter,
+    std::chrono::nanoseconds hidden_frame_interval,
+    bool coalesce_pointer_motion)
     : display{wl_display_create(), &cleanup_display},
       pause_signal{eventfd(0, EFD_CLOEXEC | EFD_SEMAPHORE)},
       executor{std::make_shared<WaylandExecutor>(wl_display_get_event_loop(display.get()))},
@@ -663,7 +677,9 @@ mf::WaylandConnector::WaylandConnector(
     compositor_global = std::make_unique<mf::WlCompositor>(
         display.get(),
         executor,
-        this->allocator);
+        this->allocator,
+        hidden_frame_interval,
+        coalesce_pointer_motion);
     subcompositor_global = std::make_unique<mf::WlSubcompositor>(display.get());
     seat_global = std::make_unique<mf::WlSeat>(display.get(), input_hub, seat, executor);
     output_manager = std::make_unique<mf::OutputManager>(
@@ -678,7 +694,8 @@ mf::WaylandConnector::WaylandConnector(
         shell,
         seat_global.get(),
         output_manager.get(),
-        surface_stack});
+        surface_stack,
+        graphics_display});
 
     wl_display_init_shm(display.get());
 
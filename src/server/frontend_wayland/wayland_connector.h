@@ -24,6 +24,7 @@
 #include "mir/optional_value.h"
 
 #include <wayland-server-core.h>
+#include <chrono>
 #include <unordered_map>
 #include <thread>
 #include <vector>
@@ -41,6 +42,7 @@ class Seat;
 namespace graphics
 {
 class GraphicBufferAllocator;
+class Display;
 }
 namespace geometry
 {
@@ -78,6 +80,7 @@ public:
         WlSeat* seat;
         OutputManager* output_manager;
         std::shared_ptr<SurfaceStack> surface_stack;
+        std::shared_ptr<graphics::Display> graphics_display;
     };
 
     WaylandExtensions() = default;
@@ -108,6 +111,7 @@ public:
     WaylandConnector(
         std::shared_ptr<shell::Shell> const& shell,
         std::shared_ptr<MirDisplay> const& display_config,
+        std::shared_ptr<graphics::Display> const& graphics_display,
         std::shared_ptr<input::InputDeviceHub> const& input_hub,
         std::shared_ptr<input::Seat> const& seat,
         std::shared_ptr<graphics::GraphicBufferAllocator> const& allocator,
@@ -115,7 +119,9 @@ public:
         std::shared_ptr<SurfaceStack> const& surface_stack,
         bool arw_socket,
         std::unique_ptr<WaylandExtensions> extensions,
-        WaylandProtocolExtensionFilter const& extension_filter);
+        WaylandProtocolExtensionFilter const& extension_filter,
+        std::chrono::nanoseconds hidden_frame_interval,
+        bool coalesce_pointer_motion);
 
     ~WaylandConnector() override;
 
@@ -24,6 +24,7 @@
 #include "xdg_shell_stable.h"
 #include "xdg_output_v1.h"
 #include "layer_shell_v1.h"
+#include "presentation_time.h"
 #include "xwayland_wm_shell.h"
 #include "mir_display.h"
 #include "wl_seat.h"
@@ -71,6 +72,10 @@ std::vector<ExtensionBuilder> const internal_extension_builders = {
         mw::XdgOutputManagerV1::interface_name, [](auto const& ctx) -> std::shared_ptr<void>
             { return create_xdg_output_manager_v1(ctx.display, ctx.output_manager); }
     },
+    {
+        mw::Presentation::interface_name, [](auto const& ctx) -> std::shared_ptr<void>
+            { return create_wp_presentation(ctx.display, ctx.graphics_display, ctx.output_manager); }
+    },
 };
 
 ExtensionBuilder const xwayland_builder {
@@ -157,7 +162,8 @@ auto mf::get_standard_extensions() -> std::vector<std::string>
     return std::vector<std::string>{
         mw::Shell::interface_name,
         mw::XdgWmBase::interface_name,
-        mw::XdgShellV6::interface_name};
+        mw::XdgShellV6::interface_name,
+        mw::Presentation::interface_name};
 }
 
 auto mf::get_supported_extensions() -> std::vector<std::string>
@@ -178,6 +184,12 @@ std::shared_ptr<mf::Connector>
         {
             auto options = the_options();
             bool const arw_socket = options->is_set(options::arw_server_socket_opt);
+            auto const hidden_frame_rate = options->get<double>(options::hidden_surface_frame_rate_opt);
+            auto const hidden_frame_interval = hidden_frame_rate > 0 ?
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::duration<double>{1.0 / hidden_frame_rate}) :
+                std::chrono::nanoseconds::zero();
+            bool const coalesce_pointer_motion = options->get<bool>(options::coalesce_pointer_motion_opt);
 
             auto wayland_extensions = std::set<std::string>{
                 enabled_wayland_extensions.begin(),
@@ -190,6 +202,7 @@ std::shared_ptr<mf::Connector>
             return std::make_shared<mf::WaylandConnector>(
                 the_shell(),
                 display_config,
+                the_display(),
                 the_input_device_hub(),
                 the_seat(),
                 the_buffer_allocator(),
@@ -200,7 +213,9 @@ std::shared_ptr<mf::Connector>
                     wayland_extensions,
                     options->is_set(mo::x11_display_opt),
                     wayland_extension_hooks),
-                wayland_extension_filter);
+                wayland_extension_filter,
+                hidden_frame_interval,
+                coalesce_pointer_motion);
         });
 }
 
@@ -22,6 +22,8 @@
 #include "wayland_utils.h"
 #include "window_wl_surface_role.h"
 #include "wayland_input_dispatcher.h"
+#include "pointer_motion_coalescer.h"
+#include "wl_surface.h"
 
 #include <mir/events/event_builders.h>
 
@@ -41,9 +43,18 @@ mf::WaylandSurfaceObserver::WaylandSurfaceObserver(
     : seat{seat},
       window{window},
       input_dispatcher{std::make_unique<WaylandInputDispatcher>(seat, surface)},
+      pointer_motion_coalescer{surface->pointer_motion_coalescer},
       window_size{geometry::Size{0,0}},
       destroyed{std::make_shared<bool>(false)}
 {
+    if (pointer_motion_coalescer)
+    {
+        pointer_motion_coalescer->set_dispatch([this, destroyed = destroyed](MirInputEvent const* event)
+            {
+                if (!*destroyed)
+                    input_dispatcher->handle_event(event);
+            });
+    }
 }
 
 mf::WaylandSurfaceObserver::~WaylandSurfaceObserver()
@@ -132,6 +143,14 @@ void mf::WaylandSurfaceObserver::input_consumed(ms::Surface const*, MirEvent con
     {
         std::shared_ptr<MirEvent> owned_event = mev::clone_event(*event);
 
+        if (pointer_motion_coalescer)
+        {
+            // Flush even if we're destroyed meanwhile, as the coalescer belongs to the surface
+            if (pointer_motion_coalescer->add(owned_event))
+                seat->spawn([coalescer = pointer_motion_coalescer]() { coalescer->flush(); });
+            return;
+        }
+
         run_on_wayland_thread_unless_destroyed(
             [this, owned_event]()
             {
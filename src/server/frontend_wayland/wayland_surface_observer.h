@@ -37,6 +37,7 @@ class WlSurface;
 class WlSeat;
 class WindowWlSurfaceRole;
 class WaylandInputDispatcher;
+class PointerMotionCoalescer;
 
 class WaylandSurfaceObserver
     : public scene::NullSurfaceObserver
@@ -81,9 +82,10 @@ public:
     void disconnect() { *destroyed = true; }
 
 private:
-    WlSeat* const seat; // only used by run_on_wayland_thread_unless_destroyed()
+    WlSeat* const seat; // only used to run work on the Wayland thread
     WindowWlSurfaceRole* const window;
     std::unique_ptr<WaylandInputDispatcher> const input_dispatcher;
+    std::shared_ptr<PointerMotionCoalescer> const pointer_motion_coalescer;
 
     geometry::Size window_size;
     std::experimental::optional<geometry::Size> requested_size;
@@ -23,6 +23,8 @@
 #include "wl_subcompositor.h"
 #include "wl_region.h"
 #include "deleted_for_resource.h"
+#include "presentation_time.h"
+#include "pointer_motion_coalescer.h"
 
 #include "wayland_wrapper.h"
 
@@ -30,14 +32,17 @@
 
 #include "mir/graphics/buffer_properties.h"
 #include "mir/scene/session.h"
+#include "mir/scene/surface.h"
 #include "mir/frontend/wayland.h"
 #include "mir/compositor/buffer_stream.h"
 #include "mir/executor.h"
 #include "mir/graphics/graphic_buffer_allocator.h"
 #include "mir/shell/surface_specification.h"
 #include "mir/log.h"
+#include "mir/geometry/rectangles.h"
 
 #include <algorithm>
+#include <chrono>
 #include <boost/throw_exception.hpp>
 #include <wayland-server-protocol.h>
 
@@ -46,6 +51,12 @@ namespace geom = mir::geometry;
 namespace mw = mir::wayland;
 namespace msh = mir::shell;
 
+namespace
+{
+/// However long a client takes to draw, it sees pointer motion at least this often
+std::chrono::milliseconds const max_pointer_motion_hold{50};
+}
+
 mf::WlSurfaceState::Callback::Callback(wl_resource* new_resource)
     : mw::Callback{new_resource, Version<1>()},
       destroyed{deleted_flag_for_resource(resource)}
@@ -66,10 +77,20 @@ void mf::WlSurfaceState::update_from(WlSurfaceState const& source)
     if (source.input_shape)
         input_shape = source.input_shape;
 
+    if (source.opaque_region)
+        opaque_region = source.opaque_region;
+
     frame_callbacks.insert(end(frame_callbacks),
                            begin(source.frame_callbacks),
                            end(source.frame_callbacks));
 
+    presentation_feedbacks.insert(end(presentation_feedbacks),
+                                  begin(source.presentation_feedbacks),
+                                  end(source.presentation_feedbacks));
+
+    surface_damage.insert(end(surface_damage), begin(source.surface_damage), end(source.surface_damage));
+    buffer_damage.insert(end(buffer_damage), begin(source.buffer_damage), end(source.buffer_damage));
+
     if (source.surface_data_invalidated)
         surface_data_invalidated = true;
 }
@@ -84,14 +105,27 @@ bool mf::WlSurfaceState::surface_data_needs_refresh() const
 mf::WlSurface::WlSurface(
     wl_resource* new_resource,
     std::shared_ptr<Executor> const& executor,
-    std::shared_ptr<graphics::GraphicBufferAllocator> const& allocator)
+    std::shared_ptr<graphics::GraphicBufferAllocator> const& allocator,
+    std::chrono::nanoseconds hidden_frame_interval,
+    bool coalesce_pointer_motion)
     : Surface(new_resource, Version<4>()),
         session{get_session(client)},
         stream{session->create_buffer_stream({{}, mir_pixel_format_invalid, graphics::BufferUsage::undefined})},
+        pointer_motion_coalescer{
+            coalesce_pointer_motion ?
+                std::make_shared<PointerMotionCoalescer>(
+                    wl_display_get_event_loop(wl_client_get_display(client)),
+                    max_pointer_motion_hold) :
+                nullptr},
         allocator{allocator},
         executor{executor},
         null_role{this},
-        role{&null_role}
+        role{&null_role},
+        frame_throttle{
+            wl_display_get_event_loop(wl_client_get_display(client)),
+            executor,
+            hidden_frame_interval,
+            [this]() { send_frame_callbacks(); }}
 {
     // wl_surface is specified to act in mailbox mode
     stream->allow_framedropping(true);
@@ -107,8 +141,16 @@ mf::WlSurface::~WlSurface()
         listener.second();
     }
 
+    for (auto const& feedback : pending.presentation_feedbacks)
+        feedback->discarded();
+    discard_presentation_feedbacks();
+
     role->destroy();
     session->destroy_buffer_stream(stream);
+
+    // Input may yet reach the coalescer, but it mustn't use the event loop after we've gone
+    if (pointer_motion_coalescer)
+        pointer_motion_coalescer->stop();
 }
 
 bool mf::WlSurface::synchronized() const
@@ -242,18 +284,73 @@ mf::WlSurface* mf::WlSurface::from(wl_resource* resource)
 
 void mf::WlSurface::send_frame_callbacks()
 {
+    // Let the client start its frame with the latest pointer position
+    if (pointer_motion_coalescer && !frame_callbacks.empty())
+        pointer_motion_coalescer->frame_done();
+
+    // The timestamp is in milliseconds, with an undefined base
+    auto const timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+
     for (auto const& frame : frame_callbacks)
     {
         if (!*frame->destroyed)
         {
-            // TODO: argument should be a timestamp
-            frame->send_done_event(0);
+            frame->send_done_event(timestamp);
             frame->destroy_wayland_object();
         }
     }
     frame_callbacks.clear();
 }
 
+void mf::WlSurface::content_consumed(PresentationTracker::FramesShown const& shown_before)
+{
+    auto const surface = scene_surface();
+
+    // Clients the user can't see don't need to draw at full speed
+    frame_throttle.request(surface ? surface.value() : nullptr);
+
+    if (presentation_feedbacks.empty())
+        return;
+
+    if (surface)
+    {
+        geom::Rectangle const extents{surface.value()->top_left(), surface.value()->window_size()};
+        for (auto const& feedback : presentation_feedbacks)
+        {
+            feedback->consumed(extents, shown_before);
+        }
+        presentation_feedbacks.clear();
+    }
+    else
+    {
+        discard_presentation_feedbacks();
+    }
+}
+
+auto mf::WlSurface::frame_sampler() const -> std::function<PresentationTracker::FramesShown()>
+{
+    if (presentation_feedbacks.empty())
+        return [] { return PresentationTracker::FramesShown{}; };
+
+    // They all share the one tracker
+    return presentation_feedbacks.front()->frame_sampler();
+}
+
+void mf::WlSurface::discard_presentation_feedbacks()
+{
+    for (auto const& feedback : presentation_feedbacks)
+    {
+        feedback->discarded();
+    }
+    presentation_feedbacks.clear();
+}
+
+void mf::WlSurface::add_presentation_feedback(std::shared_ptr<PresentationFeedback> const& feedback)
+{
+    pending.presentation_feedbacks.push_back(feedback);
+}
+
 void mf::WlSurface::destroy()
 {
     destroy_wayland_object();
@@ -271,20 +368,12 @@ void mf::WlSurface::attach(std::experimental::optional<wl_resource*> const& buff
 
 void mf::WlSurface::damage(int32_t x, int32_t y, int32_t width, int32_t height)
 {
-    (void)x;
-    (void)y;
-    (void)width;
-    (void)height;
-    // This isn't essential, but could enable optimizations
+    pending.surface_damage.push_back({{x, y}, {width, height}});
 }
 
 void mf::WlSurface::damage_buffer(int32_t x, int32_t y, int32_t width, int32_t height)
 {
-    (void)x;
-    (void)y;
-    (void)width;
-    (void)height;
-    // This isn't essential, but could enable optimizations
+    pending.buffer_damage.push_back({{x, y}, {width, height}});
 }
 
 void mf::WlSurface::frame(wl_resource* new_callback)
@@ -294,8 +383,14 @@ void mf::WlSurface::frame(wl_resource* new_callback)
 
 void mf::WlSurface::set_opaque_region(std::experimental::optional<wl_resource*> const& region)
 {
-    (void)region;
-    // This isn't essential, but could enable optimizations
+    if (region)
+    {
+        pending.opaque_region = WlRegion::from(region.value())->rectangle_vector();
+    }
+    else
+    {
+        pending.opaque_region = std::vector<geom::Rectangle>{};
+    }
 }
 
 void mf::WlSurface::set_input_region(std::experimental::optional<wl_resource*> const& region)
@@ -341,6 +436,25 @@ MirPixelFormat wl_format_to_mir_format(uint32_t format)
             return mir_pixel_format_invalid;
     }
 }
+
+/// Clients commonly damage INT32_MAX sized areas, so scale and clip without overflowing
+void add_clipped_damage(geom::Rectangles& damage, geom::Rectangle const& rect, int scale, geom::Size const& buffer_size)
+{
+    auto const clip = [](int64_t value, int64_t max) { return static_cast<int>(std::min(std::max(value, int64_t{0}), max)); };
+
+    int64_t const x = rect.top_left.x.as_int();
+    int64_t const y = rect.top_left.y.as_int();
+    int64_t const width = buffer_size.width.as_int();
+    int64_t const height = buffer_size.height.as_int();
+
+    auto const left = clip(x * scale, width);
+    auto const top = clip(y * scale, height);
+    auto const right = clip((x + rect.size.width.as_int()) * scale, width);
+    auto const bottom = clip((y + rect.size.height.as_int()) * scale, height);
+
+    if (right > left && bottom > top)
+        damage.add({{left, top}, {right - left, bottom - top}});
+}
 }
 
 void mf::WlSurface::commit(WlSurfaceState const& state)
@@ -350,6 +464,17 @@ void mf::WlSurface::commit(WlSurfaceState const& state)
     // callbacks should be sent at once.
     frame_callbacks.insert(end(frame_callbacks), begin(state.frame_callbacks), end(state.frame_callbacks));
 
+    if (pointer_motion_coalescer && !state.frame_callbacks.empty())
+        pointer_motion_coalescer->frame_requested();
+
+    // wl_surface is in mailbox mode, so a new buffer means the compositor won't see any it doesn't have yet
+    if (state.buffer)
+        discard_presentation_feedbacks();
+    presentation_feedbacks.insert(
+        end(presentation_feedbacks),
+        begin(state.presentation_feedbacks),
+        end(state.presentation_feedbacks));
+
     if (state.offset)
         offset_ = state.offset.value();
 
@@ -357,7 +482,18 @@ void mf::WlSurface::commit(WlSurfaceState const& state)
         input_shape = state.input_shape.value();
 
     if (state.scale)
+    {
+        buffer_scale = state.scale.value();
         stream->set_scale(state.scale.value());
+    }
+
+    if (state.opaque_region)
+    {
+        geom::Rectangles region;
+        for (auto const& rect : state.opaque_region.value())
+            region.add(rect);
+        stream->set_opaque_region(region);
+    }
 
     if (state.buffer)
     {
@@ -367,22 +503,43 @@ void mf::WlSurface::commit(WlSurfaceState const& state)
         {
             // TODO: unmap surface, and unmap all subsurfaces
             buffer_size_ = std::experimental::nullopt;
+            discard_presentation_feedbacks();
             send_frame_callbacks();
         }
         else
         {
-            auto const executor_send_frame_callbacks = [executor = executor, weak_self = mw::make_weak(this)]()
+            // Called by the compositor as it takes the buffer, which is when presentation is counted from
+            auto const executor_send_frame_callbacks =
+                [executor = executor, weak_self = mw::make_weak(this), sample_frames = frame_sampler()]()
                 {
-                    executor->spawn([weak_self]()
+                    auto const shown_before = sample_frames();
+                    executor->spawn([weak_self, shown_before]()
                         {
                             if (weak_self)
                             {
-                                weak_self.value().send_frame_callbacks();
+                                weak_self.value().content_consumed(shown_before);
                             }
                         });
                 };
 
+            auto const damage_for = [&state, this](geom::Size const& size)
+                {
+                    geom::Rectangles damage;
+                    for (auto const& rect : state.surface_damage)
+                        add_clipped_damage(damage, rect, buffer_scale, size);
+                    for (auto const& rect : state.buffer_damage)
+                        add_clipped_damage(damage, rect, 1, size);
+
+                    // A client attaching a buffer without saying what changed is buggy,
+                    // but not so rare that we can assume nothing did
+                    if (state.surface_damage.empty() && state.buffer_damage.empty())
+                        damage.add({{}, size});
+
+                    return damage;
+                };
+
             std::shared_ptr<graphics::Buffer> mir_buffer;
+            geom::Rectangles damage;
 
             if (auto const shm_buffer = wl_shm_buffer_get(buffer))
             {
@@ -400,10 +557,14 @@ void mf::WlSurface::commit(WlSurfaceState const& state)
                     BOOST_THROW_EXCEPTION((
                                               std::runtime_error{"Buffer has invalid stride"}));
                 }
+                damage = damage_for({width, wl_shm_buffer_get_height(shm_buffer)});
                 mir_buffer = allocator->buffer_from_shm(
                     buffer,
                     executor,
+                    previous_shm_buffer.lock(),
+                    damage,
                     std::move(executor_send_frame_callbacks));
+                previous_shm_buffer = mir_buffer;
                 tracepoint(
                     mir_server_wayland,
                     sw_buffer_committed,
@@ -425,6 +586,8 @@ void mf::WlSurface::commit(WlSurfaceState const& state)
                     buffer,
                     std::move(executor_send_frame_callbacks),
                     std::move(release_buffer));
+                damage = damage_for(mir_buffer->size());
+                previous_shm_buffer.reset();
                 tracepoint(
                     mir_server_wayland,
                     hw_buffer_committed,
@@ -432,7 +595,7 @@ void mf::WlSurface::commit(WlSurfaceState const& state)
                     mir_buffer->id().as_value());
             }
 
-            stream->submit_buffer(mir_buffer);
+            stream->submit_buffer(mir_buffer, damage);
             auto const new_buffer_size = stream->stream_size();
 
             if (!input_shape && std::experimental::make_optional(new_buffer_size) != buffer_size_)
@@ -445,7 +608,7 @@ void mf::WlSurface::commit(WlSurfaceState const& state)
     }
     else
     {
-        send_frame_callbacks();
+        content_consumed(frame_sampler()());
     }
 
     for (WlSubsurface* child: children)
@@ -22,11 +22,14 @@
 #include "wayland_wrapper.h"
 
 #include "wl_surface_role.h"
+#include "frame_callback_throttle.h"
+#include "presentation_tracker.h"
 
 #include "mir/geometry/displacement.h"
 #include "mir/geometry/size.h"
 #include "mir/geometry/point.h"
 
+#include <chrono>
 #include <vector>
 #include <map>
 
@@ -36,6 +39,7 @@ class Executor;
 
 namespace graphics
 {
+class Buffer;
 class GraphicBufferAllocator;
 }
 namespace scene
@@ -58,6 +62,8 @@ namespace frontend
 {
 class WlSurface;
 class WlSubsurface;
+class PresentationFeedback;
+class PointerMotionCoalescer;
 
 struct WlSurfaceState
 {
@@ -83,7 +89,11 @@ struct WlSurfaceState
     std::experimental::optional<int> scale;
     std::experimental::optional<geometry::Displacement> offset;
     std::experimental::optional<std::experimental::optional<std::vector<geometry::Rectangle>>> input_shape;
+    std::experimental::optional<std::vector<geometry::Rectangle>> opaque_region; ///< empty if set to null
     std::vector<std::shared_ptr<Callback>> frame_callbacks;
+    std::vector<std::shared_ptr<PresentationFeedback>> presentation_feedbacks;
+    std::vector<geometry::Rectangle> surface_damage; ///< from wl_surface.damage, in surface coordinates
+    std::vector<geometry::Rectangle> buffer_damage;  ///< from wl_surface.damage_buffer, in buffer coordinates
 
 private:
     // only set to true if invalidate_surface_data() is called
@@ -111,7 +121,9 @@ class WlSurface : public wayland::Surface
 public:
     WlSurface(wl_resource* new_resource,
               std::shared_ptr<mir::Executor> const& executor,
-              std::shared_ptr<graphics::GraphicBufferAllocator> const& allocator);
+              std::shared_ptr<graphics::GraphicBufferAllocator> const& allocator,
+              std::chrono::nanoseconds hidden_frame_interval,
+              bool coalesce_pointer_motion);
 
     ~WlSurface();
 
@@ -134,11 +146,14 @@ public:
                                std::vector<mir::geometry::Rectangle>& input_shape_accumulator,
                                geometry::Displacement const& parent_offset) const;
     void commit(WlSurfaceState const& state);
+    void add_presentation_feedback(std::shared_ptr<PresentationFeedback> const& feedback);
     void add_destroy_listener(void const* key, std::function<void()> listener);
     void remove_destroy_listener(void const* key);
 
     std::shared_ptr<scene::Session> const session;
     std::shared_ptr<compositor::BufferStream> const stream;
+    /// Null unless pointer motion is to be sent once per frame
+    std::shared_ptr<PointerMotionCoalescer> const pointer_motion_coalescer;
 
     static WlSurface* from(wl_resource* resource);
 
@@ -152,12 +167,22 @@ private:
 
     WlSurfaceState pending;
     geometry::Displacement offset_;
+    int buffer_scale{1};
+    /// Shm buffers of a surface can share GPU resources, so keep track of the last one (without keeping it alive)
+    std::weak_ptr<graphics::Buffer> previous_shm_buffer;
     std::experimental::optional<geometry::Size> buffer_size_;
     std::vector<std::shared_ptr<WlSurfaceState::Callback>> frame_callbacks;
+    std::vector<std::shared_ptr<PresentationFeedback>> presentation_feedbacks;
     std::experimental::optional<std::vector<mir::geometry::Rectangle>> input_shape;
     std::map<void const*, std::function<void()>> destroy_listeners;
+    FrameCallbackThrottle frame_throttle;
 
     void send_frame_callbacks();
+    /// The compositor has the latest content (or there is no new content for it to have)
+    void content_consumed(PresentationTracker::FramesShown const& shown_before);
+    /// Notes the frames shown, for presentation feedback on the content the compositor takes next
+    auto frame_sampler() const -> std::function<PresentationTracker::FramesShown()>;
+    void discard_presentation_feedbacks();
 
     void destroy() override;
     void attach(std::experimental::optional<wl_resource*> const& buffer, int32_t x, int32_t y) override;
@@ -19,6 +19,7 @@
 #include "mir/default_server_configuration.h"
 
 #include "key_repeat_dispatcher.h"
+#include "resampling_dispatcher.h"
 #include "event_filter_chain_dispatcher.h"
 #include "config_changer.h"
 #include "cursor_controller.h"
@@ -140,12 +141,53 @@ mir::DefaultServerConfiguration::the_input_dispatcher()
             // lp:1675357: Disable generation of key repeat events on nested servers
             auto enable_repeat = options->get<bool>(options::enable_key_repeat_opt);
 
+            // Resampling is only in the chain when enabled
+            std::shared_ptr<mi::InputDispatcher> next_dispatcher = the_resampling_dispatcher();
+            if (!next_dispatcher)
+                next_dispatcher = the_event_filter_chain_dispatcher();
+
             return std::make_shared<mi::KeyRepeatDispatcher>(
-                the_event_filter_chain_dispatcher(), the_main_loop(), the_cookie_authority(),
+                next_dispatcher, the_main_loop(), the_cookie_authority(),
                 enable_repeat, key_repeat_timeout, key_repeat_delay, false);
         });
 }
 
+std::shared_ptr<mi::ResamplingDispatcher>
+mir::DefaultServerConfiguration::the_resampling_dispatcher()
+{
+    return resampling_dispatcher(
+        [this]() -> std::shared_ptr<mi::ResamplingDispatcher>
+        {
+            // Sampling a little before the frame usually leaves a newer sample to
+            // interpolate towards; predicting is limited to half a frame at 60Hz
+            std::chrono::milliseconds const resampling_latency{5};
+            std::chrono::milliseconds const max_prediction{8};
+
+            auto const resampling = the_options()->get<std::string>(options::input_resampling_opt);
+
+            mi::ResamplingDispatcher::ResampledDevices resampled_devices;
+            if (resampling == "touchscreens")
+                resampled_devices = mi::ResamplingDispatcher::ResampledDevices::touchscreens;
+            else if (resampling == "all")
+                resampled_devices = mi::ResamplingDispatcher::ResampledDevices::touchscreens_and_pointers;
+            else if (resampling == options::off_opt_value)
+                return nullptr;
+            else
+                throw AbnormalExit(std::string("Invalid ") + options::input_resampling_opt + " option: " + resampling +
+                                   " (valid options are: \"" + options::off_opt_value + "\", \"touchscreens\" and \"all\")");
+
+            return std::make_shared<mi::ResamplingDispatcher>(
+                the_event_filter_chain_dispatcher(), the_main_loop(), the_clock(),
+                resampled_devices, resampling_latency, max_prediction);
+        });
+}
+
+std::shared_ptr<mir::compositor::FrameDeadlineListener>
+mir::DefaultServerConfiguration::the_frame_deadline_listener()
+{
+    return the_resampling_dispatcher();
+}
+
 std::shared_ptr<mi::CursorListener>
 mir::DefaultServerConfiguration::the_cursor_listener()
 {
@@ -261,7 +303,9 @@ mir::DefaultServerConfiguration::the_input_reading_multiplexer()
     return input_reading_multiplexer(
         []() -> std::shared_ptr<mir::dispatch::MultiplexingDispatchable>
         {
-            return std::make_shared<mir::dispatch::MultiplexingDispatchable>();
+            // Several input platforms may be ready at once; handle them in a single wakeup
+            int const max_events_per_dispatch{16};
+            return std::make_shared<mir::dispatch::MultiplexingDispatchable>(max_events_per_dispatch);
         }
     );
 }
@@ -315,6 +359,8 @@ std::shared_ptr<mi::DefaultInputDeviceHub> mir::DefaultServerConfiguration::the_
            // pressed keys get repeated indefinitely
            if (key_repeater)
                key_repeater->set_input_device_hub(hub);
+           if (auto const resampler = the_resampling_dispatcher())
+               resampler->set_input_device_hub(hub);
            return hub;
        });
 }
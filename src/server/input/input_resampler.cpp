@@ -0,0 +1,297 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "input_resampler.h"
+
+#include "mir/events/event_builders.h"
+#include "mir/events/pointer_event.h"
+#include "mir/events/touch_event.h"
+
+#include <algorithm>
+
+namespace mi = mir::input;
+namespace mev = mir::events;
+
+namespace
+{
+// Samples closer together than this are too noisy to extrapolate from, and
+// further apart too stale
+std::chrono::nanoseconds const min_extrapolation_interval{std::chrono::milliseconds{2}};
+std::chrono::nanoseconds const max_extrapolation_interval{std::chrono::milliseconds{20}};
+
+// More held back samples than this are superseded anyway
+size_t const max_held = 64;
+
+auto time_of(MirEvent const& event) -> std::chrono::nanoseconds
+{
+    return event.to_input()->event_time();
+}
+
+auto is_resampled_motion(MirEvent const& event) -> bool
+{
+    auto const input = event.to_input();
+    switch (input->input_type())
+    {
+    case mir_input_event_type_touch:
+    {
+        auto const touch = input->to_touch();
+        for (size_t i = 0; i != touch->pointer_count(); ++i)
+        {
+            if (touch->action(i) != mir_touch_action_change)
+                return false;
+        }
+        return touch->pointer_count() > 0;
+    }
+
+    case mir_input_event_type_pointer:
+    {
+        auto const pointer = input->to_pointer();
+        return pointer->action() == mir_pointer_action_motion &&
+               pointer->hscroll() == 0 && pointer->vscroll() == 0;
+    }
+
+    default:
+        return false;
+    }
+}
+
+/// Whether positions can be resampled between the events: the same touches, or a pointer with the same buttons
+auto same_contacts(MirEvent const& a, MirEvent const& b) -> bool
+{
+    auto const first = a.to_input();
+    auto const second = b.to_input();
+    if (first->input_type() != second->input_type())
+        return false;
+
+    switch (first->input_type())
+    {
+    case mir_input_event_type_touch:
+    {
+        auto const first_touch = first->to_touch();
+        auto const second_touch = second->to_touch();
+        if (first_touch->pointer_count() != second_touch->pointer_count())
+            return false;
+
+        for (size_t i = 0; i != first_touch->pointer_count(); ++i)
+        {
+            if (first_touch->id(i) != second_touch->id(i))
+                return false;
+        }
+        return true;
+    }
+
+    case mir_input_event_type_pointer:
+        return first->to_pointer()->buttons() == second->to_pointer()->buttons();
+
+    default:
+        return false;
+    }
+}
+
+/// The latest of samples [first, last), standing for all of them
+auto merged(std::deque<std::shared_ptr<MirEvent const>> const& samples, size_t first, size_t last)
+    -> std::shared_ptr<MirEvent>
+{
+    std::shared_ptr<MirEvent> result = mev::clone_event(*samples[last - 1]);
+
+    if (result->to_input()->input_type() == mir_input_event_type_pointer)
+    {
+        auto const pointer = result->to_input()->to_pointer();
+        for (auto i = first; i != last - 1; ++i)
+        {
+            auto const earlier = samples[i]->to_input()->to_pointer();
+            pointer->set_dx(pointer->dx() + earlier->dx());
+            pointer->set_dy(pointer->dy() + earlier->dy());
+        }
+    }
+
+    return result;
+}
+
+/// Moves event to where it would be alpha of the way from one sample to another
+void resample(MirEvent& event, MirEvent const& from, MirEvent const& to, float alpha, std::chrono::nanoseconds time)
+{
+    auto const lerp = [alpha](float a, float b) { return a + alpha * (b - a); };
+
+    auto const input = event.to_input();
+    input->set_event_time(time);
+
+    if (input->input_type() == mir_input_event_type_touch)
+    {
+        auto const touch = input->to_touch();
+        auto const from_touch = from.to_input()->to_touch();
+        auto const to_touch = to.to_input()->to_touch();
+        for (size_t i = 0; i != touch->pointer_count(); ++i)
+        {
+            touch->set_x(i, lerp(from_touch->x(i), to_touch->x(i)));
+            touch->set_y(i, lerp(from_touch->y(i), to_touch->y(i)));
+        }
+    }
+    else
+    {
+        auto const pointer = input->to_pointer();
+        auto const from_pointer = from.to_input()->to_pointer();
+        auto const to_pointer = to.to_input()->to_pointer();
+        pointer->set_x(lerp(from_pointer->x(), to_pointer->x()));
+        pointer->set_y(lerp(from_pointer->y(), to_pointer->y()));
+    }
+}
+}
+
+mi::InputResampler::InputResampler(std::chrono::nanoseconds latency, std::chrono::nanoseconds max_prediction)
+    : latency{latency},
+      max_prediction{max_prediction}
+{
+}
+
+mi::InputResampler::~InputResampler() = default;
+
+void mi::InputResampler::set_resampling(MirInputDeviceId id, bool enabled)
+{
+    if (enabled)
+        streams[id];
+    else
+        streams.erase(id);
+}
+
+auto mi::InputResampler::is_resampling(MirInputDeviceId id) const -> bool
+{
+    return streams.find(id) != streams.end();
+}
+
+void mi::InputResampler::add(std::shared_ptr<MirEvent const> const& event, bool hold, EventSink const& pass_on)
+{
+    if (mir_event_get_type(event.get()) != mir_event_type_input)
+    {
+        pass_on(event);
+        return;
+    }
+
+    auto const found = streams.find(event->to_input()->device_id());
+    if (found == streams.end())
+    {
+        pass_on(event);
+        return;
+    }
+
+    auto& stream = found->second;
+    auto& samples = stream.samples;
+
+    if (is_resampled_motion(*event))
+    {
+        samples.push_back(event);
+
+        if (hold)
+        {
+            if (++stream.held > max_held)
+            {
+                samples.pop_front();
+                --stream.held;
+            }
+        }
+        else if (stream.held)
+        {
+            pass_on(merged(samples, samples.size() - stream.held - 1, samples.size()));
+            stream.held = 0;
+        }
+        else
+        {
+            pass_on(event);
+        }
+
+        // Keep the two latest samples passed on to extrapolate from
+        while (samples.size() > stream.held + 2)
+            samples.pop_front();
+    }
+    else
+    {
+        if (stream.held)
+            pass_on(merged(samples, samples.size() - stream.held, samples.size()));
+        pass_on(event);
+
+        // Motion from before the touches (or buttons) changed can't be resampled with what follows
+        samples.clear();
+        samples.push_back(event);
+        stream.held = 0;
+    }
+}
+
+auto mi::InputResampler::resample_at(std::chrono::nanoseconds frame_time) -> Events
+{
+    auto const sample_time = frame_time - latency;
+    Events result;
+
+    for (auto& entry : streams)
+    {
+        auto& stream = entry.second;
+        auto& samples = stream.samples;
+        auto const first_held = samples.size() - stream.held;
+
+        auto due_end = first_held;
+        while (due_end != samples.size() && time_of(*samples[due_end]) <= sample_time)
+            ++due_end;
+
+        // Everything held back is newer than the sample time, so it waits for the next frame
+        if (due_end == first_held)
+            continue;
+
+        auto const event = merged(samples, first_held, due_end);
+        auto const& current = *samples[due_end - 1];
+
+        if (due_end != samples.size())
+        {
+            auto const& next = *samples[due_end];
+            if (same_contacts(current, next))
+            {
+                auto const alpha = float(double((sample_time - time_of(current)).count()) /
+                                         (time_of(next) - time_of(current)).count());
+                resample(*event, current, next, alpha, sample_time);
+            }
+        }
+        else if (due_end >= 2)
+        {
+            auto const& previous = *samples[due_end - 2];
+            auto const interval = time_of(current) - time_of(previous);
+
+            if (same_contacts(previous, current) &&
+                min_extrapolation_interval <= interval && interval <= max_extrapolation_interval)
+            {
+                auto const predicted_time = std::min(
+                    sample_time,
+                    time_of(current) + std::min(interval / 2, max_prediction));
+
+                if (predicted_time > time_of(current))
+                {
+                    auto const alpha = float(double((predicted_time - time_of(previous)).count()) / interval.count());
+                    resample(*event, previous, current, alpha, predicted_time);
+                }
+            }
+        }
+
+        result.push_back(event);
+
+        stream.held = samples.size() - due_end;
+        while (samples.size() > stream.held + 2)
+            samples.pop_front();
+    }
+
+    return result;
+}
+
+auto mi::InputResampler::has_held_motion() const -> bool
+{
+    return std::any_of(begin(streams), end(streams), [](auto const& entry) { return entry.second.held != 0; });
+}
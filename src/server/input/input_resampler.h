@@ -0,0 +1,93 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_INPUT_INPUT_RESAMPLER_H_
+#define MIR_INPUT_INPUT_RESAMPLER_H_
+
+#include "mir_toolkit/event.h"
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace mir
+{
+namespace input
+{
+/**
+ * Resamples the motion of touchscreens and pointers to the compositor's frames
+ *
+ * Instead of passing on every sample from a device, motion is held back until
+ * the compositor starts a frame. One event then stands for it, placed where
+ * the device was a fixed latency before the frame:
+ *  - interpolated between the samples either side of that time; or
+ *  - extrapolated from the latest two samples, but never further ahead of the
+ *    latest than max_prediction or half the interval between them.
+ * Samples newer than that time stay held back for the next frame. Pointer
+ * events keep the sum of the relative motion they stand for.
+ *
+ * Anything else from the device (touches starting or ending, buttons,
+ * scrolling) is never resampled. The latest motion held back before it is
+ * passed on first, as it was sampled.
+ *
+ * \note Not threadsafe
+ */
+class InputResampler
+{
+public:
+    using Events = std::vector<std::shared_ptr<MirEvent const>>;
+    using EventSink = std::function<void(std::shared_ptr<MirEvent const> const&)>;
+
+    InputResampler(std::chrono::nanoseconds latency, std::chrono::nanoseconds max_prediction);
+    ~InputResampler();
+
+    void set_resampling(MirInputDeviceId id, bool enabled);
+    auto is_resampling(MirInputDeviceId id) const -> bool;
+
+    /// Gives pass_on the events to pass on now, oldest first. Motion from a
+    /// resampled device is held back for resample_at() if hold is set.
+    void add(std::shared_ptr<MirEvent const> const& event, bool hold, EventSink const& pass_on);
+
+    /// \returns the events standing for the motion held back, for a frame
+    ///          starting at frame_time (on the clock of the input events)
+    auto resample_at(std::chrono::nanoseconds frame_time) -> Events;
+
+    auto has_held_motion() const -> bool;
+
+private:
+    InputResampler(InputResampler const&) = delete;
+    InputResampler& operator=(InputResampler const&) = delete;
+
+    struct Stream
+    {
+        /// Recent motion, the last held of which hasn't been passed on yet
+        std::deque<std::shared_ptr<MirEvent const>> samples;
+        size_t held{0};
+    };
+
+    std::chrono::nanoseconds const latency;
+    std::chrono::nanoseconds const max_prediction;
+
+    /// Only for the devices being resampled
+    std::unordered_map<MirInputDeviceId, Stream> streams;
+};
+}
+}
+
+#endif // MIR_INPUT_INPUT_RESAMPLER_H_
@@ -0,0 +1,177 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "resampling_dispatcher.h"
+
+#include "mir/input/device.h"
+#include "mir/input/input_device_hub.h"
+#include "mir/input/input_device_observer.h"
+#include "mir/time/alarm.h"
+#include "mir/time/alarm_factory.h"
+#include "mir/time/clock.h"
+
+namespace mi = mir::input;
+namespace mt = mir::time;
+
+namespace
+{
+// A frame further off than this isn't worth holding motion back for
+std::chrono::milliseconds const max_frame_wait{50};
+
+struct DeviceTracker : mi::InputDeviceObserver
+{
+    DeviceTracker(mi::ResamplingDispatcher* dispatcher)
+        : dispatcher{dispatcher} {}
+
+    void device_added(std::shared_ptr<mi::Device> const& device) override
+    {
+        auto const capabilities = device->capabilities();
+        switch (dispatcher->resampled_devices)
+        {
+        case mi::ResamplingDispatcher::ResampledDevices::touchscreens_and_pointers:
+            if (contains(capabilities, mi::DeviceCapability::pointer))
+                dispatcher->set_resampling(device->id(), true);
+            // fallthrough
+        case mi::ResamplingDispatcher::ResampledDevices::touchscreens:
+            if (contains(capabilities, mi::DeviceCapability::touchscreen))
+                dispatcher->set_resampling(device->id(), true);
+            break;
+
+        case mi::ResamplingDispatcher::ResampledDevices::none:
+            break;
+        }
+    }
+
+    void device_changed(std::shared_ptr<mi::Device> const&) override
+    {
+    }
+
+    void device_removed(std::shared_ptr<mi::Device> const& device) override
+    {
+        dispatcher->set_resampling(device->id(), false);
+    }
+
+    void changes_complete() override
+    {
+    }
+
+    mi::ResamplingDispatcher* const dispatcher;
+};
+}
+
+mi::ResamplingDispatcher::ResamplingDispatcher(
+    std::shared_ptr<InputDispatcher> const& next_dispatcher,
+    std::shared_ptr<mt::AlarmFactory> const& alarm_factory,
+    std::shared_ptr<mt::Clock> const& clock,
+    ResampledDevices resampled_devices,
+    std::chrono::nanoseconds latency,
+    std::chrono::nanoseconds max_prediction)
+    : resampled_devices{resampled_devices},
+      next_dispatcher{next_dispatcher},
+      clock{clock},
+      latency{latency},
+      next_frame_start{mt::Timestamp{}},
+      resampler{latency, max_prediction},
+      alarm{alarm_factory->create_alarm([this]{ pass_on_resampled_motion(); })}
+{
+}
+
+mi::ResamplingDispatcher::~ResamplingDispatcher() = default;
+
+bool mi::ResamplingDispatcher::dispatch(std::shared_ptr<MirEvent const> const& event)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+
+    auto const frame_start = upcoming_frame(clock->now());
+
+    // Held motion counts as handled
+    bool handled = true;
+    resampler.add(
+        event,
+        frame_start != mt::Timestamp{},
+        [this, &handled](std::shared_ptr<MirEvent const> const& passed_on)
+        {
+            handled = next_dispatcher->dispatch(passed_on);
+        });
+
+    if (!alarm_pending && resampler.has_held_motion())
+    {
+        alarm_pending = true;
+        alarm_frame_start = frame_start;
+        alarm->reschedule_for(frame_start);
+    }
+
+    return handled;
+}
+
+void mi::ResamplingDispatcher::start()
+{
+    next_dispatcher->start();
+}
+
+void mi::ResamplingDispatcher::stop()
+{
+    alarm->cancel();
+    next_dispatcher->stop();
+}
+
+void mi::ResamplingDispatcher::next_frame_at(std::chrono::steady_clock::time_point frame_start)
+{
+    next_frame_start = frame_start;
+}
+
+void mi::ResamplingDispatcher::set_resampling(MirInputDeviceId id, bool enabled)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    resampler.set_resampling(id, enabled);
+}
+
+void mi::ResamplingDispatcher::set_input_device_hub(std::shared_ptr<InputDeviceHub> const& hub)
+{
+    hub->add_observer(std::make_shared<DeviceTracker>(this));
+}
+
+auto mi::ResamplingDispatcher::upcoming_frame(mt::Timestamp now) const -> mt::Timestamp
+{
+    auto const frame_start = next_frame_start.load();
+    if (now < frame_start && frame_start - now <= max_frame_wait)
+        return frame_start;
+
+    return mt::Timestamp{};
+}
+
+void mi::ResamplingDispatcher::pass_on_resampled_motion()
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    alarm_pending = false;
+
+    // Resample to the frame, not to however late the alarm went off
+    auto const events = resampler.resample_at(alarm_frame_start.time_since_epoch());
+
+    if (resampler.has_held_motion())
+    {
+        // Motion newer than the sample time waits for the next frame, or if
+        // the compositor has gone idle, just long enough to become due
+        auto const now = clock->now();
+        auto const frame_start = upcoming_frame(now);
+        alarm_pending = true;
+        alarm_frame_start = frame_start != mt::Timestamp{} ? frame_start : now + latency;
+        alarm->reschedule_for(alarm_frame_start);
+    }
+
+    for (auto const& event : events)
+        next_dispatcher->dispatch(event);
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_INPUT_RESAMPLING_DISPATCHER_H_
+#define MIR_INPUT_RESAMPLING_DISPATCHER_H_
+
+#include "input_resampler.h"
+
+#include "mir/input/input_dispatcher.h"
+#include "mir/compositor/frame_deadline_listener.h"
+#include "mir/time/types.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+namespace mir
+{
+namespace time
+{
+class Alarm;
+class AlarmFactory;
+class Clock;
+}
+namespace input
+{
+class InputDeviceHub;
+
+/**
+ * Passes on the motion of selected devices once per compositor frame, resampled
+ * to the frame (see InputResampler).
+ *
+ * Motion is only held back while the compositor has said when its next frame
+ * starts. When it is idle, or the platform doesn't know, events go straight
+ * through.
+ */
+class ResamplingDispatcher : public InputDispatcher, public compositor::FrameDeadlineListener
+{
+public:
+    /// The devices resampled from when they are added
+    enum class ResampledDevices
+    {
+        none,
+        touchscreens,
+        touchscreens_and_pointers
+    };
+
+    ResamplingDispatcher(
+        std::shared_ptr<InputDispatcher> const& next_dispatcher,
+        std::shared_ptr<time::AlarmFactory> const& alarm_factory,
+        std::shared_ptr<time::Clock> const& clock,
+        ResampledDevices resampled_devices,
+        std::chrono::nanoseconds latency,
+        std::chrono::nanoseconds max_prediction);
+    ~ResamplingDispatcher();
+
+    // InputDispatcher
+    bool dispatch(std::shared_ptr<MirEvent const> const& event) override;
+    void start() override;
+    void stop() override;
+
+    // FrameDeadlineListener
+    void next_frame_at(std::chrono::steady_clock::time_point frame_start) override;
+
+    /// Selects whether to resample the motion of a device
+    void set_resampling(MirInputDeviceId id, bool enabled);
+
+    void set_input_device_hub(std::shared_ptr<InputDeviceHub> const& hub);
+
+    ResampledDevices const resampled_devices;
+
+private:
+    /// The start of the frame to hold motion back for, if the compositor is expecting one
+    auto upcoming_frame(time::Timestamp now) const -> time::Timestamp;
+    void pass_on_resampled_motion();
+
+    std::shared_ptr<InputDispatcher> const next_dispatcher;
+    std::shared_ptr<time::Clock> const clock;
+    std::chrono::nanoseconds const latency;
+
+    std::atomic<time::Timestamp> next_frame_start;
+
+    /// Held while passing events on, so they can't overtake each other
+    std::mutex mutex;
+    InputResampler resampler;
+    bool alarm_pending{false};
+    time::Timestamp alarm_frame_start;
+
+    // Last, so it is destroyed (and can't go off) before what it uses
+    std::unique_ptr<time::Alarm> const alarm;
+};
+}
+}
+
+#endif // MIR_INPUT_RESAMPLING_DISPATCHER_H_
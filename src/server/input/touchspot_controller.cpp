@@ -68,6 +68,16 @@ public:
     {
         return buffer_;
     }
+
+    std::experimental::optional<geom::Rectangles> buffer_damage_since(mg::BufferID) const override
+    {
+        return {};
+    }
+
+    geom::Rectangles opaque_region() const override
+    {
+        return {};
+    }
     
     geom::Rectangle screen_position() const override
     {
@@ -20,12 +20,14 @@
 
 #include "basic_surface.h"
 #include "mir/compositor/buffer_stream.h"
+#include "mir/compositor/frame_arena.h"
 #include "mir/frontend/event_sink.h"
 #include "mir/shell/input_targeter.h"
 #include "mir/graphics/buffer.h"
 #include "mir/graphics/cursor_image.h"
 #include "mir/graphics/pixel_format_utils.h"
 #include "mir/geometry/displacement.h"
+#include "mir/geometry/rectangles.h"
 #include "mir/renderer/sw/pixel_source.h"
 
 #include "mir/scene/scene_report.h"
@@ -171,6 +173,12 @@ void ms::SurfaceObservers::application_id_set_to(Surface const* surf, std::strin
                  { observer->application_id_set_to(surf, application_id); });
 }
 
+void ms::SurfaceObservers::input_region_set_to(Surface const* surf, std::vector<geom::Rectangle> const& region)
+{
+    for_each([&](std::shared_ptr<SurfaceObserver> const& observer)
+                 { observer->input_region_set_to(surf, region); });
+}
+
 ms::BasicSurface::ProofOfMutexLock::ProofOfMutexLock(std::unique_lock<std::mutex> const& lock)
 {
     if (!lock.owns_lock())
@@ -365,9 +373,33 @@ std::shared_ptr<mf::BufferStream> ms::BasicSurface::primary_buffer_stream() cons
 }
 
 void ms::BasicSurface::set_input_region(std::vector<geom::Rectangle> const& input_rectangles)
+{
+    std::unique_lock<std::mutex> lock(guard);
+    if (input_rectangles != custom_input_rectangles)
+    {
+        custom_input_rectangles = input_rectangles;
+
+        lock.unlock();
+        observers->input_region_set_to(this, input_rectangles);
+    }
+}
+
+auto ms::BasicSurface::input_extents() const -> geom::Rectangle
 {
     std::lock_guard<std::mutex> lock(guard);
-    custom_input_rectangles = input_rectangles;
+
+    geom::Rectangle const content{content_top_left(lock), content_size(lock)};
+    if (custom_input_rectangles.empty())
+        return content;
+
+    // Custom input rectangles are relative to the content, but not confined to it
+    geom::Rectangles extents;
+    for (auto const& rectangle : custom_input_rectangles)
+    {
+        if (rectangle.size.width > geom::Width{} && rectangle.size.height > geom::Height{})
+            extents.add({content.top_left + as_displacement(rectangle.top_left), rectangle.size});
+    }
+    return extents.bounding_rectangle();
 }
 
 void ms::BasicSurface::resize(geom::Size const& desired_size)
@@ -808,6 +840,7 @@ public:
         std::experimental::optional<geom::Rectangle> const& clip_area,
         glm::mat4 const& transform,
         float alpha,
+        geom::Rectangles const& opaque_region,
         mg::Renderable::ID id)
     : underlying_buffer_stream{stream},
       compositor_id{compositor_id},
@@ -815,6 +848,7 @@ public:
       screen_position_(position),
       clip_area_(clip_area),
       transformation_(transform),
+      opaque_region_(opaque_region),
       id_(id)
     {
     }
@@ -835,6 +869,11 @@ public:
         return compositor_buffer;
     }
 
+    std::experimental::optional<geom::Rectangles> buffer_damage_since(mg::BufferID previous) const override
+    {
+        return underlying_buffer_stream->damage_between(previous, buffer()->id());
+    }
+
     geom::Rectangle screen_position() const override
     { return screen_position_; }
 
@@ -850,6 +889,9 @@ public:
     bool shaped() const override
     { return mg::contains_alpha(underlying_buffer_stream->pixel_format()); }
 
+    geom::Rectangles opaque_region() const override
+    { return opaque_region_; }
+
     mg::Renderable::ID id() const override
     { return id_; }
 private:
@@ -860,8 +902,29 @@ private:
     geom::Rectangle const screen_position_;
     std::experimental::optional<geom::Rectangle> const clip_area_;
     glm::mat4 const transformation_;
+    geom::Rectangles const opaque_region_;
     mg::Renderable::ID const id_;
 };
+
+/// The opaque region of stream placed at position, in screen coordinates
+auto opaque_region_of(mc::BufferStream& stream, geom::Rectangle const& position) -> geom::Rectangles
+{
+    geom::Rectangles region;
+
+    // A stream stretched to a different size may have its opaque edges blended
+    if (position.size != stream.stream_size())
+        return region;
+
+    for (auto rect : stream.opaque_region())
+    {
+        rect.top_left = rect.top_left + as_displacement(position.top_left);
+        auto const visible = rect.intersection_with(position);
+        if (visible.size.width > geom::Width{0} && visible.size.height > geom::Height{0})
+            region.add(visible);
+    }
+
+    return region;
+}
 }
 
 int ms::BasicSurface::buffers_ready_for_compositor(void const* id) const
@@ -922,11 +985,29 @@ mg::RenderableList ms::BasicSurface::generate_renderables(mc::CompositorID id) c
 {
     std::lock_guard<std::mutex> lock(guard);
     mg::RenderableList list;
-    
+    append_snapshots(lock, id, nullptr, list);
+    return list;
+}
+
+void ms::BasicSurface::append_renderables(
+    mc::CompositorID id,
+    mc::FrameArena& arena,
+    mg::RenderableList& renderables) const
+{
+    std::lock_guard<std::mutex> lock(guard);
+    append_snapshots(lock, id, &arena, renderables);
+}
+
+void ms::BasicSurface::append_snapshots(
+    ProofOfMutexLock const& lock,
+    mc::CompositorID id,
+    mc::FrameArena* arena,
+    mg::RenderableList& renderables) const
+{
     if (clip_area_)
     {
         if (!surface_rect.overlaps(clip_area_.value()))
-            return list;
+            return;
     }
 
     auto const content_top_left_ = content_top_left(lock);
@@ -941,14 +1022,32 @@ mg::RenderableList ms::BasicSurface::generate_renderables(mc::CompositorID id) c
             else
                 size = info.stream->stream_size();
 
-            list.emplace_back(std::make_shared<SurfaceSnapshot>(
-                info.stream, id,
-                geom::Rectangle{content_top_left_ + info.displacement, std::move(size)},
-                clip_area_,
-                transformation_matrix, surface_alpha, info.stream.get()));
+            geom::Rectangle const position{content_top_left_ + info.displacement, size};
+
+            auto const opaque_region = opaque_region_of(*info.stream, position);
+
+            if (arena)
+            {
+                renderables.emplace_back(arena->make_shared<SurfaceSnapshot>(
+                    info.stream, id,
+                    position,
+                    clip_area_,
+                    transformation_matrix, surface_alpha,
+                    opaque_region,
+                    info.stream.get()));
+            }
+            else
+            {
+                renderables.emplace_back(std::make_shared<SurfaceSnapshot>(
+                    info.stream, id,
+                    position,
+                    clip_area_,
+                    transformation_matrix, surface_alpha,
+                    opaque_region,
+                    info.stream.get()));
+            }
         }
     }
-    return list;
 }
 
 void ms::BasicSurface::set_confine_pointer_state(MirPointerConfinementState state)
@@ -101,6 +101,7 @@ public:
     geometry::Point top_left() const override;
     geometry::Rectangle input_bounds() const override;
     bool input_area_contains(geometry::Point const& point) const override;
+    auto input_extents() const -> geometry::Rectangle override;
     void consume(MirEvent const* event) override;
     void set_alpha(float alpha) override;
     void set_orientation(MirOrientation orientation) override;
@@ -109,6 +110,10 @@ public:
     bool visible() const override;
 
     graphics::RenderableList generate_renderables(compositor::CompositorID id) const override;
+    void append_renderables(
+        compositor::CompositorID id,
+        compositor::FrameArena& arena,
+        graphics::RenderableList& renderables) const override;
     int buffers_ready_for_compositor(void const* compositor_id) const override;
 
     MirWindowType type() const override;
@@ -185,6 +190,12 @@ private:
     MirOrientationMode set_preferred_orientation(MirOrientationMode mode);
     auto content_size(ProofOfMutexLock const&) const -> geometry::Size;
     auto content_top_left(ProofOfMutexLock const&) const -> geometry::Point;
+    /// Snapshots come from arena, or the heap if arena is null
+    void append_snapshots(
+        ProofOfMutexLock const&,
+        compositor::CompositorID id,
+        compositor::FrameArena* arena,
+        graphics::RenderableList& renderables) const;
 
     std::shared_ptr<SurfaceObservers> observers = std::make_shared<SurfaceObservers>();
     std::mutex mutable guard;
@@ -0,0 +1,223 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "input_grid.h"
+#include "mir/scene/surface.h"
+
+#include <algorithm>
+
+namespace ms = mir::scene;
+namespace geom = mir::geometry;
+
+namespace
+{
+// A surface covering more cells than this (a couple of 4K outputs' worth at the
+// default cell size) is cheaper to check on every lookup than to bucket
+long const max_cells_per_entry{1024};
+
+/// Rounds towards negative infinity, unlike integer division
+auto cell_index(int coordinate, int cell_size) -> int
+{
+    return coordinate >= 0 ? coordinate / cell_size : -((-coordinate + cell_size - 1) / cell_size);
+}
+
+auto cell_key(int column, int row) -> std::int64_t
+{
+    return (static_cast<std::int64_t>(column) << 32) | static_cast<std::uint32_t>(row);
+}
+
+/// The (inclusive) range of cells a rectangle overlaps
+struct CellRange
+{
+    int left;
+    int top;
+    int right;
+    int bottom;
+
+    auto count() const -> long
+    {
+        return (long{right} - left + 1) * (long{bottom} - top + 1);
+    }
+
+    template<typename Action>
+    void for_each(Action const& action) const
+    {
+        for (auto column = left; column <= right; ++column)
+        {
+            for (auto row = top; row <= bottom; ++row)
+            {
+                action(cell_key(column, row));
+            }
+        }
+    }
+};
+
+auto cells_covering(geom::Rectangle const& rect, int cell_size) -> CellRange
+{
+    auto const bottom_right = rect.bottom_right();
+    return {
+        cell_index(rect.top_left.x.as_int(), cell_size),
+        cell_index(rect.top_left.y.as_int(), cell_size),
+        cell_index(bottom_right.x.as_int() - 1, cell_size),
+        cell_index(bottom_right.y.as_int() - 1, cell_size)};
+}
+
+auto is_empty(geom::Rectangle const& rect) -> bool
+{
+    return rect.size.width <= geom::Width{} || rect.size.height <= geom::Height{};
+}
+
+template<typename Entry>
+auto below(Entry const* lhs, Entry const* rhs) -> bool
+{
+    return lhs->layer < rhs->layer || (lhs->layer == rhs->layer && lhs->order < rhs->order);
+}
+
+template<typename Cell, typename Entry>
+void insert_in_stacking_order(Cell& cell, Entry const* entry)
+{
+    cell.insert(std::upper_bound(cell.begin(), cell.end(), entry, below<Entry>), entry);
+}
+
+template<typename Cell, typename Entry>
+void erase(Cell& cell, Entry const* entry)
+{
+    cell.erase(std::remove(cell.begin(), cell.end(), entry), cell.end());
+}
+}
+
+ms::InputGrid::InputGrid(int cell_size)
+    : cell_size{cell_size}
+{
+}
+
+ms::InputGrid::~InputGrid() = default;
+
+void ms::InputGrid::place_on_top(std::shared_ptr<Surface> const& surface, unsigned int layer)
+{
+    auto const existing = entries.find(surface.get());
+    if (existing != entries.end())
+    {
+        remove_from_cells(existing->second);
+        existing->second.layer = layer;
+        existing->second.order = next_order++;
+        add_to_cells(existing->second);
+    }
+    else
+    {
+        auto const& entry = entries.emplace(
+            surface.get(),
+            Entry{surface, surface->input_extents(), layer, next_order++}).first->second;
+        add_to_cells(entry);
+    }
+}
+
+void ms::InputGrid::update_extents(Surface const* surface)
+{
+    auto const existing = entries.find(surface);
+    if (existing == entries.end())
+        return;
+
+    auto& entry = existing->second;
+    auto const extents = entry.surface->input_extents();
+    if (extents != entry.extents)
+    {
+        remove_from_cells(entry);
+        entry.extents = extents;
+        add_to_cells(entry);
+    }
+}
+
+void ms::InputGrid::remove(Surface const* surface)
+{
+    auto const existing = entries.find(surface);
+    if (existing != entries.end())
+    {
+        remove_from_cells(existing->second);
+        entries.erase(existing);
+    }
+}
+
+auto ms::InputGrid::surface_at(geom::Point point) const -> std::shared_ptr<Surface>
+{
+    static Cell const no_entries;
+    auto const found = cells.find(cell_of(point));
+    auto const& cell = found != cells.end() ? found->second : no_entries;
+
+    // Walk the cell and the oversized entries together, from the top down
+    auto i = cell.rbegin();
+    auto j = oversized.rbegin();
+    while (i != cell.rend() || j != oversized.rend())
+    {
+        Entry const* entry;
+        if (j == oversized.rend() || (i != cell.rend() && below(*j, *i)))
+            entry = *i++;
+        else
+            entry = *j++;
+
+        if (entry->extents.contains(point) && entry->surface->input_area_contains(point))
+            return entry->surface;
+    }
+
+    return {};
+}
+
+auto ms::InputGrid::cell_of(geom::Point point) const -> std::int64_t
+{
+    return cell_key(cell_index(point.x.as_int(), cell_size), cell_index(point.y.as_int(), cell_size));
+}
+
+void ms::InputGrid::add_to_cells(Entry const& entry)
+{
+    if (is_empty(entry.extents))
+        return;
+
+    auto const covered = cells_covering(entry.extents, cell_size);
+    if (covered.count() > max_cells_per_entry)
+    {
+        insert_in_stacking_order(oversized, &entry);
+        return;
+    }
+
+    covered.for_each([&](std::int64_t key)
+        {
+            insert_in_stacking_order(cells[key], &entry);
+        });
+}
+
+void ms::InputGrid::remove_from_cells(Entry const& entry)
+{
+    if (is_empty(entry.extents))
+        return;
+
+    auto const covered = cells_covering(entry.extents, cell_size);
+    if (covered.count() > max_cells_per_entry)
+    {
+        erase(oversized, &entry);
+        return;
+    }
+
+    covered.for_each([&](std::int64_t key)
+        {
+            auto const cell = cells.find(key);
+            if (cell != cells.end())
+            {
+                erase(cell->second, &entry);
+                if (cell->second.empty())
+                    cells.erase(cell);
+            }
+        });
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_SCENE_INPUT_GRID_H_
+#define MIR_SCENE_INPUT_GRID_H_
+
+#include "mir/geometry/point.h"
+#include "mir/geometry/rectangle.h"
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace mir
+{
+namespace scene
+{
+class Surface;
+
+/**
+ * Finds the topmost surface accepting input at a point without looking at
+ * every surface.
+ *
+ * Surfaces are bucketed into square cells by their input extents; a lookup
+ * only asks the surfaces in the cell under the point (and any too big to be
+ * worth bucketing) whether they accept input there.
+ *
+ * The grid is told about stacking changes and about changes to the input
+ * extents of its surfaces; it is not thread safe.
+ */
+class InputGrid
+{
+public:
+    explicit InputGrid(int cell_size = 256);
+    ~InputGrid();
+
+    /// Add surface (or move it) to the top of the given depth layer
+    void place_on_top(std::shared_ptr<Surface> const& surface, unsigned int layer);
+    /// Re-read the input extents of surface, which must have been placed
+    void update_extents(Surface const* surface);
+    void remove(Surface const* surface);
+
+    /// The topmost surface whose input area contains point, if any
+    auto surface_at(geometry::Point point) const -> std::shared_ptr<Surface>;
+
+private:
+    struct Entry
+    {
+        std::shared_ptr<Surface> surface;
+        geometry::Rectangle extents;
+        unsigned int layer;
+        std::uint64_t order;
+    };
+
+    /// Cells list their entries in stacking order (bottom to top)
+    using Cell = std::vector<Entry const*>;
+
+    auto cell_of(geometry::Point point) const -> std::int64_t;
+    void add_to_cells(Entry const& entry);
+    void remove_from_cells(Entry const& entry);
+
+    int const cell_size;
+    std::uint64_t next_order{0};
+    std::unordered_map<Surface const*, Entry> entries;
+    std::unordered_map<std::int64_t, Cell> cells;
+    /// Entries that would cover too many cells to be worth bucketing
+    Cell oversized;
+};
+}
+}
+
+#endif /* MIR_SCENE_INPUT_GRID_H_ */
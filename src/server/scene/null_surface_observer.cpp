@@ -20,6 +20,7 @@
 
 namespace ms = mir::scene;
 namespace mg = mir::graphics;
+namespace geom = mir::geometry;
 
 void ms::NullSurfaceObserver::attrib_changed(Surface const*, MirWindowAttrib, int) {}
 void ms::NullSurfaceObserver::window_resized_to(Surface const*, geometry::Size const&) {}
@@ -47,3 +48,4 @@ void ms::NullSurfaceObserver::input_consumed(Surface const*, MirEvent const*) {}
 void ms::NullSurfaceObserver::start_drag_and_drop(Surface const*, std::vector<uint8_t> const&) {}
 void ms::NullSurfaceObserver::depth_layer_set_to(Surface const*, MirDepthLayer) {}
 void ms::NullSurfaceObserver::application_id_set_to(Surface const*, std::string const&) {}
+void ms::NullSurfaceObserver::input_region_set_to(Surface const*, std::vector<geom::Rectangle> const&) {}
@@ -33,15 +33,17 @@ ms::RenderingTracker::RenderingTracker(
 {
 }
 
-void ms::RenderingTracker::rendered_in(mc::CompositorID cid)
+bool ms::RenderingTracker::rendered_in(mc::CompositorID cid)
 {
     std::lock_guard<std::mutex> lock{guard};
 
     ensure_is_active_compositor(cid);
 
-    occlusions.erase(cid);
+    auto const was_occluded = occlusions.erase(cid) > 0;
 
     configure_visibility(mir_window_visibility_exposed);
+
+    return was_occluded;
 }
 
 void ms::RenderingTracker::occluded_in(mc::CompositorID cid)
@@ -48,14 +48,14 @@ class SurfaceSceneElement : public mc::SceneElement
 {
 public:
     SurfaceSceneElement(
-        std::string name,
-        std::shared_ptr<mg::Renderable> const& renderable,
+        std::shared_ptr<mg::Renderable> renderable,
         std::shared_ptr<ms::RenderingTracker> const& tracker,
-        mc::CompositorID id)
-        : renderable_{renderable},
+        mc::CompositorID id,
+        std::atomic<std::uint64_t>* change_count)
+        : renderable_{std::move(renderable)},
           tracker{tracker},
           cid{id},
-          surface_name(name)
+          change_count{change_count}
     {
     }
 
@@ -66,7 +66,9 @@ public:
 
     void rendered() override
     {
-        tracker->rendered_in(cid);
+        // Frames held back while the surface was occluded here are pending again
+        if (tracker->rendered_in(cid))
+            change_count->fetch_add(1, std::memory_order_release);
     }
 
     void occluded() override
@@ -78,7 +80,7 @@ private:
     std::shared_ptr<mg::Renderable> const renderable_;
     std::shared_ptr<ms::RenderingTracker> const tracker;
     mc::CompositorID cid;
-    std::string const surface_name;
+    std::atomic<std::uint64_t>* const change_count;
 };
 
 //note: something different than a 2D/HWC overlay
@@ -108,14 +110,50 @@ private:
     std::shared_ptr<mg::Renderable> const renderable_;
 };
 
+/// Makes a T from arena, or the heap if arena is null
+template<typename T, typename... Args>
+auto make_from(mc::FrameArena* arena, Args&&... args) -> std::shared_ptr<T>
+{
+    if (arena)
+        return arena->make_shared<T>(std::forward<Args>(args)...);
+    else
+        return std::make_shared<T>(std::forward<Args>(args)...);
+}
+
 /**
- * A SurfaceDepthLayerObserver must not outlive the SurfaceStack it was created for
+ * A StackedSurfaceObserver must not outlive the SurfaceStack it was created for
  */
-struct SurfaceDepthLayerObserver : ms::NullSurfaceObserver
+struct StackedSurfaceObserver : ms::NullSurfaceObserver
 {
-    SurfaceDepthLayerObserver(ms::SurfaceStack* stack)
-        : stack{stack}
+    StackedSurfaceObserver(ms::SurfaceStack* stack, std::atomic<std::uint64_t>* change_count)
+        : stack{stack},
+          change_count{change_count}
+    {
+    }
+
+    void attrib_changed(ms::Surface const*, MirWindowAttrib /*attrib*/, int /*value*/) override
+    {
+        changed();
+    }
+
+    void hidden_set_to(ms::Surface const*, bool /*hide*/) override
     {
+        changed();
+    }
+
+    void frame_posted(ms::Surface const*, int /*frames_available*/, geom::Size const& /*size*/) override
+    {
+        changed();
+    }
+
+    void alpha_set_to(ms::Surface const*, float /*alpha*/) override
+    {
+        changed();
+    }
+
+    void transformation_set_to(ms::Surface const*, glm::mat4 const& /*t*/) override
+    {
+        changed();
     }
 
     void depth_layer_set_to(ms::Surface const* surface, MirDepthLayer /*z_index*/) override
@@ -124,8 +162,31 @@ struct SurfaceDepthLayerObserver : ms::NullSurfaceObserver
         stack->raise(surface);
     }
 
+    void content_resized_to(ms::Surface const* surface, geom::Size const& /*content_size*/) override
+    {
+        stack->update_input_extents(surface);
+        changed();
+    }
+
+    void moved_to(ms::Surface const* surface, geom::Point const& /*top_left*/) override
+    {
+        stack->update_input_extents(surface);
+        changed();
+    }
+
+    void input_region_set_to(ms::Surface const* surface, std::vector<geom::Rectangle> const& /*region*/) override
+    {
+        stack->update_input_extents(surface);
+    }
+
 private:
+    void changed()
+    {
+        change_count->fetch_add(1, std::memory_order_release);
+    }
+
     ms::SurfaceStack* stack;
+    std::atomic<std::uint64_t>* change_count;
 };
 
 }
@@ -133,8 +194,10 @@ private:
 ms::SurfaceStack::SurfaceStack(
     std::shared_ptr<SceneReport> const& report) :
     report{report},
+    snapshot{std::make_shared<Snapshot>()},
     scene_changed{false},
-    surface_observer{std::make_shared<SurfaceDepthLayerObserver>(this)}
+    change_count{0},
+    surface_observer{std::make_shared<StackedSurfaceObserver>(this, &change_count)}
 {
 }
 
@@ -152,60 +215,86 @@ ms::SurfaceStack::~SurfaceStack() noexcept(true)
 
 mc::SceneElementSequence ms::SurfaceStack::scene_elements_for(mc::CompositorID id)
 {
-    RecursiveReadLock lg(guard);
+    auto const current = std::atomic_load(&snapshot);
 
     scene_changed = false;
+
+    // Only a registered compositor has a frame, used only on its own thread. Any other
+    // (a screencast, say) might be on any thread, so what it's given comes from the heap
+    auto const frame_entry = current->compositor_frames.find(id);
+    auto const frame = frame_entry != current->compositor_frames.end() ? frame_entry->second.get() : nullptr;
+    auto const arena = frame ? &frame->arena : nullptr;
+
+    mg::RenderableList unregistered_renderables;
+    auto& renderables = frame ? frame->renderables : unregistered_renderables;
+
     mc::SceneElementSequence elements;
-    for (auto const& layer : surface_layers)
+    elements.reserve(frame ? frame->element_count : 0);
+
+    for (auto const& entry : current->surfaces)
     {
-        for (auto const& surface : layer)
+        if (entry.surface->visible())
         {
-            if (surface->visible())
+            if (arena)
+                entry.surface->append_renderables(id, *arena, renderables);
+            else
+                renderables = entry.surface->generate_renderables(id);
+
+            for (auto& renderable : renderables)
             {
-                for (auto& renderable : surface->generate_renderables(id))
-                {
-                    elements.emplace_back(
-                        std::make_shared<SurfaceSceneElement>(
-                            surface->name(),
-                            renderable,
-                            rendering_trackers[surface.get()],
-                            id));
-                }
+                elements.emplace_back(
+                    make_from<SurfaceSceneElement>(
+                        arena, std::move(renderable), entry.tracker, id, &change_count));
             }
+            // Keep the capacity for next time
+            renderables.clear();
         }
     }
-    for (auto const& renderable : overlays)
+    for (auto const& renderable : current->overlays)
     {
-        elements.emplace_back(std::make_shared<OverlaySceneElement>(renderable));
+        elements.emplace_back(make_from<OverlaySceneElement>(arena, renderable));
     }
+
+    if (frame)
+        frame->element_count = elements.size();
     return elements;
 }
 
 int ms::SurfaceStack::frames_pending(mc::CompositorID id) const
 {
-    RecursiveReadLock lg(guard);
+    auto const current = std::atomic_load(&snapshot);
 
     int result = scene_changed ? 1 : 0;
-    for (auto const& layer : surface_layers)
+
+    // If nothing has happened since the surfaces were last found to have no
+    // frames for this compositor, there's no need to ask them again
+    auto const frame_entry = current->compositor_frames.find(id);
+    auto const frame = frame_entry != current->compositor_frames.end() ? frame_entry->second.get() : nullptr;
+    auto const changes = change_count.load(std::memory_order_acquire);
+    if (frame && frame->changes_seen == changes && frame->surface_frames_pending == 0)
+        return result;
+
+    int surface_result = 0;
+    for (auto const& entry : current->surfaces)
     {
-        for (auto const& surface : layer)
+        if (entry.surface->visible() && entry.tracker->is_exposed_in(id))
         {
-            if (surface->visible())
-            {
-                auto const tracker = rendering_trackers.find(surface.get());
-                if (tracker != rendering_trackers.end() && tracker->second->is_exposed_in(id))
-                {
-                    // Note that we ask the surface and not a Renderable.
-                    // This is because we don't want to waste time and resources
-                    // on a snapshot till we're sure we need it...
-                    int ready = surface->buffers_ready_for_compositor(id);
-                    if (ready > result)
-                        result = ready;
-                }
-            }
+            // Note that we ask the surface and not a Renderable.
+            // This is because we don't want to waste time and resources
+            // on a snapshot till we're sure we need it...
+            int ready = entry.surface->buffers_ready_for_compositor(id);
+            if (ready > surface_result)
+                surface_result = ready;
         }
     }
-    return result;
+
+    if (frame)
+    {
+        frame->changes_seen = changes;
+        frame->surface_frames_pending = surface_result;
+    }
+
+    return std::max(result, surface_result);
 }
 
 void ms::SurfaceStack::register_compositor(mc::CompositorID cid)
@@ -213,8 +302,10 @@ void ms::SurfaceStack::register_compositor(mc::CompositorID cid)
     RecursiveWriteLock lg(guard);
 
     registered_compositors.insert(cid);
+    compositor_frames.emplace(cid, std::make_shared<CompositorFrame>());
 
     update_rendering_tracker_compositors();
+    publish_snapshot();
 }
 
 void ms::SurfaceStack::unregister_compositor(mc::CompositorID cid)
@@ -222,8 +313,10 @@ void ms::SurfaceStack::unregister_compositor(mc::CompositorID cid)
     RecursiveWriteLock lg(guard);
 
     registered_compositors.erase(cid);
+    compositor_frames.erase(cid);
 
     update_rendering_tracker_compositors();
+    publish_snapshot();
 }
 
 void ms::SurfaceStack::add_input_visualization(
@@ -232,6 +325,7 @@ void ms::SurfaceStack::add_input_visualization(
     {
         RecursiveWriteLock lg(guard);
         overlays.push_back(overlay);
+        publish_snapshot();
     }
     emit_scene_changed();
 }
@@ -248,6 +342,7 @@ void ms::SurfaceStack::remove_input_visualization(
             BOOST_THROW_EXCEPTION(std::runtime_error("Attempt to remove an overlay which was never added or which has been previously removed"));
         }
         overlays.erase(p);
+        publish_snapshot();
     }
     
     emit_scene_changed();
@@ -258,6 +353,7 @@ void ms::SurfaceStack::emit_scene_changed()
     {
         RecursiveWriteLock lg(guard);
         scene_changed = true;
+        change_count.fetch_add(1, std::memory_order_release);
     }
     observers.scene_changed();
 }
@@ -271,6 +367,7 @@ void ms::SurfaceStack::add_surface(
         insert_surface_at_top_of_depth_layer(surface);
         create_rendering_tracker_for(surface);
         surface->add_observer(surface_observer);
+        publish_snapshot();
     }
     surface->set_reception_mode(input_mode);
     observers.surface_added(surface);
@@ -293,8 +390,10 @@ void ms::SurfaceStack::remove_surface(std::weak_ptr<Surface> const& surface)
             if (surface != layer.end())
             {
                 layer.erase(surface);
+                input_grid.remove(keep_alive.get());
                 rendering_trackers.erase(keep_alive.get());
                 keep_alive->remove_observer(surface_observer);
+                publish_snapshot();
                 found_surface = true;
                 break;
             }
@@ -309,37 +408,26 @@ void ms::SurfaceStack::remove_surface(std::weak_ptr<Surface> const& surface)
     // TODO: error logging when surface not found
 }
 
-namespace
-{
-template <typename Container>
-struct InReverse {
-    Container& container;
-    auto begin() -> decltype(container.rbegin()) { return container.rbegin(); }
-    auto end() -> decltype(container.rend()) { return container.rend(); }
-};
-
-template <typename Container>
-InReverse<Container> in_reverse(Container& container) { return InReverse<Container>{container}; }
-}
-
 auto ms::SurfaceStack::surface_at(geometry::Point cursor) const
 -> std::shared_ptr<Surface>
 {
     RecursiveReadLock lg(guard);
-    for (auto const& layer : in_reverse(surface_layers))
-    {
-        for (auto const& surface : in_reverse(layer))
-        {
-            // TODO There's a lack of clarity about how the input area will
-            // TODO be maintained and whether this test will detect clicks on
-            // TODO decorations (it should) as these may be outside the area
-            // TODO known to the client.  But it works for now.
-            if (surface->input_area_contains(cursor))
-                    return surface;
-        }
-    }
+    // TODO There's a lack of clarity about how the input area will
+    // TODO be maintained and whether this test will detect clicks on
+    // TODO decorations (it should) as these may be outside the area
+    // TODO known to the client.  But it works for now.
+    return input_grid.surface_at(cursor);
+}
+
+auto ms::SurfaceStack::input_surface_at(geometry::Point point) -> std::shared_ptr<mi::Surface>
+{
+    return surface_at(point);
+}
 
-    return {};
+void ms::SurfaceStack::update_input_extents(Surface const* surface)
+{
+    RecursiveWriteLock lg(guard);
+    input_grid.update_extents(surface);
 }
 
 void ms::SurfaceStack::for_each(std::function<void(std::shared_ptr<mi::Surface> const&)> const& callback)
@@ -376,6 +464,7 @@ void ms::SurfaceStack::raise(Surface const* surface)
                 layer.erase(p);
                 insert_surface_at_top_of_depth_layer(surface_shared);
                 affected_surfaces.insert(surface_shared);
+                publish_snapshot();
                 break;
             }
         }
@@ -426,6 +515,9 @@ void ms::SurfaceStack::raise(SurfaceSet const& ss)
             if (old_layer != layer)
                 surfaces_reordered = true;
         }
+
+        if (surfaces_reordered)
+            publish_snapshot();
     }
 
     if (surfaces_reordered)
@@ -457,6 +549,27 @@ void ms::SurfaceStack::insert_surface_at_top_of_depth_layer(std::shared_ptr<Surf
     if (surface_layers.size() <= depth_index)
         surface_layers.resize(depth_index + 1);
     surface_layers[depth_index].push_back(surface);
+    input_grid.place_on_top(surface, depth_index);
+}
+
+void ms::SurfaceStack::publish_snapshot()
+{
+    auto next = std::make_shared<Snapshot>();
+
+    for (auto const& layer : surface_layers)
+    {
+        for (auto const& surface : layer)
+        {
+            auto const tracker = rendering_trackers.find(surface.get());
+            if (tracker != rendering_trackers.end())
+                next->surfaces.push_back({surface, tracker->second});
+        }
+    }
+    next->overlays = overlays;
+    next->compositor_frames = compositor_frames;
+
+    std::atomic_store(&snapshot, std::shared_ptr<Snapshot const>{std::move(next)});
+    change_count.fetch_add(1, std::memory_order_release);
 }
 
 void ms::SurfaceStack::add_observer(std::shared_ptr<ms::Observer> const& observer)
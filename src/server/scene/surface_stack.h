@@ -23,14 +23,18 @@
 #include "mir/frontend/surface_stack.h"
 
 #include "mir/compositor/scene.h"
+#include "mir/compositor/frame_arena.h"
+#include "mir/graphics/renderable.h"
 #include "mir/scene/observer.h"
 #include "mir/input/scene.h"
 #include "mir/recursive_read_write_mutex.h"
+#include "input_grid.h"
 
 #include "mir/basic_observers.h"
 #include "mir/scene/surface_observer.h"
 
 #include <atomic>
+#include <cstdint>
 #include <map>
 #include <memory>
 #include <mutex>
@@ -39,10 +43,6 @@
 
 namespace mir
 {
-namespace graphics
-{
-class Renderable;
-}
 /// Management of Surface objects. Includes the model (SurfaceStack and Surface
 /// classes) and controller (SurfaceController) elements of an MVC design.
 namespace scene
@@ -85,10 +85,12 @@ public:
 
     // From Scene
     void for_each(std::function<void(std::shared_ptr<input::Surface> const&)> const& callback) override;
+    auto input_surface_at(geometry::Point point) -> std::shared_ptr<input::Surface> override;
 
     virtual void remove_surface(std::weak_ptr<Surface> const& surface) override;
 
     void raise(Surface const* surface);
+    void update_input_extents(Surface const* surface);
     virtual void raise(std::weak_ptr<Surface> const& surface) override;
     void raise(SurfaceSet const& surfaces) override;
 
@@ -115,6 +117,8 @@ private:
     void create_rendering_tracker_for(std::shared_ptr<Surface> const&);
     void update_rendering_tracker_compositors();
     void insert_surface_at_top_of_depth_layer(std::shared_ptr<Surface> const& surface);
+    /// Replace the snapshot the compositors read (called with guard write-locked)
+    void publish_snapshot();
 
     RecursiveReadWriteMutex mutable guard;
 
@@ -128,13 +132,59 @@ private:
      * The inner vectors contain the list of surfaces on each layer (bottom to top)
      */
     std::vector<std::vector<std::shared_ptr<Surface>>> surface_layers;
+    /// The same surfaces, indexed by where they accept input
+    InputGrid input_grid;
     std::map<Surface*,std::shared_ptr<RenderingTracker>> rendering_trackers;
     std::set<compositor::CompositorID> registered_compositors;
+
+    /**
+     * What a registered compositor reuses from one frame to the next.
+     * Only the compositor's own thread touches this.
+     */
+    struct CompositorFrame
+    {
+        compositor::FrameArena arena;
+        graphics::RenderableList renderables;
+        std::size_t element_count{0};
+
+        /// The change_count when frames_pending() last looked at the surfaces...
+        std::uint64_t changes_seen{~std::uint64_t{0}};
+        /// ...and what it found
+        int surface_frames_pending{0};
+    };
+    std::map<compositor::CompositorID, std::shared_ptr<CompositorFrame>> compositor_frames;
     
     std::vector<std::shared_ptr<graphics::Renderable>> overlays;
 
+    /**
+     * An immutable copy of what the compositors need from the stack.
+     *
+     * A new snapshot is published whenever the stack changes, so that
+     * scene_elements_for() and frames_pending() never wait for guard (or
+     * hold up those changing the stack). They aren't lock-free, though: with
+     * libstdc++ the atomic shared_ptr functions briefly take a mutex from an
+     * internal pool, shared by the whole process, while copying the pointer.
+     */
+    struct Snapshot
+    {
+        struct Entry
+        {
+            std::shared_ptr<Surface> surface;
+            std::shared_ptr<RenderingTracker> tracker;
+        };
+
+        std::vector<Entry> surfaces;    ///< Bottom to top
+        std::vector<std::shared_ptr<graphics::Renderable>> overlays;
+        std::map<compositor::CompositorID, std::shared_ptr<CompositorFrame>> compositor_frames;
+    };
+    /// Only accessed through std::atomic_load() and std::atomic_store() (which lock
+    /// for the length of a pointer copy, but never contend with guard)
+    std::shared_ptr<Snapshot const> snapshot;
+
     Observers observers;
     std::atomic<bool> scene_changed;
+    /// Counts anything (frames posted, surfaces moved, ...) that might give a compositor work
+    std::atomic<std::uint64_t> change_count;
     std::shared_ptr<SurfaceObserver> surface_observer;
 };
 
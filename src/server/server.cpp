@@ -112,6 +112,7 @@ struct TemporaryCompositeEventFilter : public mi::CompositeEventFilter
     MACRO(the_buffer_stream_factory)\
     MACRO(the_compositor)\
     MACRO(the_compositor_report)\
+    MACRO(the_frame_timings)\
     MACRO(the_cursor_listener)\
     MACRO(the_cursor)\
     MACRO(the_display)\
@@ -29,6 +29,7 @@
 #include "mir/scene/session.h"
 #include "mir/scene/surface_creation_parameters.h"
 #include "mir/scene/null_surface_observer.h"
+#include "mir/graphics/buffer.h"
 #include "mir/graphics/buffer_properties.h"
 #include "mir/compositor/buffer_stream.h"
 #include "mir/frontend/buffer_stream.h"
@@ -415,7 +416,11 @@ void msd::BasicDecoration::update(
 
     for (auto const& pair : new_buffers)
     {
-        if (pair.second)
-            pair.first->submit_buffer(pair.second.value());
+        if (auto const& buffer = pair.second)
+        {
+            pair.first->submit_buffer(
+                buffer.value(),
+                geom::Rectangles{geom::Rectangle{{}, buffer.value()->size()}});
+        }
     }
 }
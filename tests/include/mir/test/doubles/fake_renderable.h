@@ -80,16 +80,44 @@ public:
         return !rectangular;
     }
 
+    void set_opaque_region(geometry::Rectangles const& region)
+    {
+        opaque = region;
+    }
+
+    geometry::Rectangles opaque_region() const override
+    {
+        return opaque;
+    }
+
     void set_buffer(std::shared_ptr<graphics::Buffer> b)
     {
         buf = b;
     }
 
+    void set_buffer(
+        std::shared_ptr<graphics::Buffer> b,
+        std::experimental::optional<geometry::Rectangles> const& damage)
+    {
+        buf = b;
+        buffer_damage = damage;
+    }
+
     std::shared_ptr<graphics::Buffer> buffer() const override
     {
         return buf;
     }
 
+    std::experimental::optional<geometry::Rectangles> buffer_damage_since(graphics::BufferID) const override
+    {
+        return buffer_damage;
+    }
+
+    void set_screen_position(geometry::Rectangle const& r)
+    {
+        rect = r;
+    }
+
     geometry::Rectangle screen_position() const override
     {
         return rect;
@@ -97,7 +125,12 @@ public:
     
     std::experimental::optional<geometry::Rectangle> clip_area() const override
     {
-        return std::experimental::optional<geometry::Rectangle>();
+        return clip;
+    }
+
+    void set_clip_area(geometry::Rectangle const& area)
+    {
+        clip = area;
     }
 
     unsigned int swap_interval() const override
@@ -110,6 +143,9 @@ private:
     mir::geometry::Rectangle rect;
     float opacity;
     bool rectangular;
+    std::experimental::optional<geometry::Rectangles> buffer_damage;
+    geometry::Rectangles opaque;
+    std::experimental::optional<geometry::Rectangle> clip;
 };
 
 } // namespace doubles
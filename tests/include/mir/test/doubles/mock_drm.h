@@ -20,20 +20,18 @@
 #define MIR_TEST_DOUBLES_MOCK_DRM_H_
 
 #include "mir_test_framework/open_wrapper.h"
+#include "mir/geometry/rectangle.h"
 
 #include <gmock/gmock.h>
 
 #include <xf86drm.h>
 #include <xf86drmMode.h>
+#include <map>
+#include <string>
 #include <unordered_map>
 
 namespace mir
 {
-namespace geometry
-{
-struct Size;
-}
-
 namespace test
 {
 namespace doubles
@@ -56,13 +54,22 @@ public:
                        std::vector<uint32_t>& possible_encoder_ids,
                        geometry::Size const& physical_size,
                        drmModeSubPixel subpixel_arrangement = DRM_MODE_SUBPIXEL_UNKNOWN);
+    void add_plane(uint32_t plane_id, uint32_t crtc_id, uint32_t possible_crtcs_mask,
+                   std::vector<uint32_t> const& formats);
+    /// Properties with the same name share an id, as they do in the kernel
+    uint32_t add_property(uint32_t object_id, char const* name, uint64_t value);
 
     void prepare();
     void reset();
 
+    drmModePlaneRes* plane_resources_ptr();
+
     drmModeCrtc* find_crtc(uint32_t id);
     drmModeEncoder* find_encoder(uint32_t id);
     drmModeConnector* find_connector(uint32_t id);
+    drmModePlane* find_plane(uint32_t id);
+    drmModeObjectProperties* find_object_properties(uint32_t object_id);
+    drmModePropertyRes* find_property(uint32_t id);
 
     enum ModePreference {NormalMode, PreferredMode};
     static drmModeModeInfo create_mode(uint16_t hdisplay, uint16_t vdisplay,
@@ -85,6 +92,21 @@ private:
     std::vector<drmModeModeInfo> modes;
     std::vector<drmModeModeInfo> modes_empty;
     std::vector<uint32_t> connector_encoder_ids;
+
+    drmModePlaneRes plane_resources;
+    std::vector<drmModePlane> planes;
+    std::vector<std::vector<uint32_t>> plane_formats;
+    std::vector<uint32_t> plane_ids;
+
+    struct ObjectProperties
+    {
+        std::vector<uint32_t> ids;
+        std::vector<uint64_t> values;
+        drmModeObjectProperties props;
+    };
+    std::unordered_map<uint32_t, ObjectProperties> object_properties;
+    std::map<std::string, drmModePropertyRes> properties;
+    uint32_t next_property_id{1000};
 };
 
 class MockDRM
@@ -123,6 +145,11 @@ public:
                                     uint32_t pixel_format, uint32_t const bo_handles[4],
                                     uint32_t const pitches[4], uint32_t const offsets[4],
                                     uint32_t *buf_id, uint32_t flags));
+    MOCK_METHOD10(drmModeAddFB2WithModifiers, int(int fd, uint32_t width, uint32_t height,
+                                                  uint32_t pixel_format, uint32_t const bo_handles[4],
+                                                  uint32_t const pitches[4], uint32_t const offsets[4],
+                                                  uint64_t const modifier[4],
+                                                  uint32_t *buf_id, uint32_t flags));
     MOCK_METHOD2(drmModeRmFB, int(int fd, uint32_t bufferId));
 
     MOCK_METHOD5(drmModePageFlip, int(int fd, uint32_t crtc_id, uint32_t fb_id,
@@ -149,6 +176,20 @@ public:
     MOCK_METHOD5(drmModeSetCursor, int (int fd, uint32_t crtcId, uint32_t bo_handle, uint32_t width, uint32_t height));
     MOCK_METHOD4(drmModeMoveCursor,int (int fd, uint32_t crtcId, int x, int y));
 
+    // drmModeSetPlane() has too many parameters to mock directly, so the
+    // destination and source are passed as rectangles (source in whole pixels)
+    MOCK_METHOD7(drmModeSetPlane, int(int fd, uint32_t plane_id, uint32_t crtc_id, uint32_t fb_id,
+                                      uint32_t flags, geometry::Rectangle const& crtc_rect,
+                                      geometry::Rectangle const& src_rect));
+
+    MOCK_METHOD0(drmModeAtomicAlloc, drmModeAtomicReqPtr());
+    MOCK_METHOD1(drmModeAtomicFree, void(drmModeAtomicReqPtr req));
+    MOCK_METHOD4(drmModeAtomicAddProperty, int(drmModeAtomicReqPtr req, uint32_t object_id,
+                                               uint32_t property_id, uint64_t value));
+    MOCK_METHOD4(drmModeAtomicCommit, int(int fd, drmModeAtomicReqPtr req, uint32_t flags, void* user_data));
+    MOCK_METHOD4(drmModeCreatePropertyBlob, int(int fd, void const* data, size_t size, uint32_t* id));
+    MOCK_METHOD2(drmModeDestroyPropertyBlob, int(int fd, uint32_t id));
+
     MOCK_METHOD2(drmSetInterfaceVersion, int (int fd, drmSetVersion* sv));
     MOCK_METHOD1(drmGetBusid, char* (int fd));
     MOCK_METHOD1(drmFreeBusid, void (const char*));
@@ -184,6 +225,17 @@ public:
         std::vector<uint32_t>& possible_encoder_ids,
         geometry::Size const& physical_size,
         drmModeSubPixel subpixel_arrangement = DRM_MODE_SUBPIXEL_UNKNOWN);
+    void add_plane(
+        char const* device,
+        uint32_t plane_id,
+        uint32_t crtc_id,
+        uint32_t possible_crtcs_mask,
+        std::vector<uint32_t> const& formats);
+    uint32_t add_property(
+        char const* device,
+        uint32_t object_id,
+        char const* name,
+        uint64_t value);
 
     void prepare(char const* device);
     void reset(char const* device);
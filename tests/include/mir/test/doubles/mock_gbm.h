@@ -81,6 +81,11 @@ public:
     MOCK_METHOD1(gbm_bo_destroy, void(struct gbm_bo *bo));
     MOCK_METHOD4(gbm_bo_import, struct gbm_bo*(struct gbm_device*, uint32_t, void*, uint32_t));
     MOCK_METHOD1(gbm_bo_get_fd, int(gbm_bo*));
+    MOCK_METHOD1(gbm_bo_get_modifier, uint64_t(gbm_bo*));
+    MOCK_METHOD1(gbm_bo_get_plane_count, int(gbm_bo*));
+    MOCK_METHOD2(gbm_bo_get_handle_for_plane, union gbm_bo_handle(gbm_bo*, int));
+    MOCK_METHOD2(gbm_bo_get_stride_for_plane, uint32_t(gbm_bo*, int));
+    MOCK_METHOD2(gbm_bo_get_offset, uint32_t(gbm_bo*, int));
 
     FakeGBMResources fake_gbm;
 
@@ -49,6 +49,8 @@ struct MockRenderable : public graphics::Renderable
 
     MOCK_CONST_METHOD0(id, ID());
     MOCK_CONST_METHOD0(buffer, std::shared_ptr<graphics::Buffer>());
+    MOCK_CONST_METHOD1(buffer_damage_since, std::experimental::optional<geometry::Rectangles>(graphics::BufferID));
+    MOCK_CONST_METHOD0(opaque_region, geometry::Rectangles());
     MOCK_CONST_METHOD0(screen_position, geometry::Rectangle());
     MOCK_CONST_METHOD0(clip_area, std::experimental::optional<geometry::Rectangle>());
     MOCK_CONST_METHOD0(alpha, float());
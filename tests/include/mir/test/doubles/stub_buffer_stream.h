@@ -61,10 +61,17 @@ public:
     int buffers_ready_for_compositor(void const*) const override { return nready; }
 
     void drop_old_buffers() override {}
-    void submit_buffer(std::shared_ptr<graphics::Buffer> const& b) override
+    void submit_buffer(std::shared_ptr<graphics::Buffer> const& b, geometry::Rectangles const&) override
     {
         if (b) ++nready;
     }
+    std::experimental::optional<geometry::Rectangles>
+        damage_between(graphics::BufferID, graphics::BufferID) const override
+    {
+        return {};
+    }
+    void set_opaque_region(geometry::Rectangles const&) override {}
+    geometry::Rectangles opaque_region() const override { return {}; }
     void with_most_recent_buffer_do(std::function<void(graphics::Buffer&)> const& fn) override
     {
         fn(*stub_compositor_buffer);
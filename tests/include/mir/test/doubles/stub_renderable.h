@@ -70,6 +70,14 @@ public:
     {
         return stub_buffer;
     }
+    std::experimental::optional<geometry::Rectangles> buffer_damage_since(graphics::BufferID) const override
+    {
+        return {};
+    }
+    geometry::Rectangles opaque_region() const override
+    {
+        return {};
+    }
     geometry::Rectangle screen_position() const override
     {
         return rect;
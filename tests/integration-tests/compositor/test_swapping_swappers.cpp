@@ -60,7 +60,7 @@ TEST_F(SwapperSwappingStress, swapper)
                     std::shared_ptr<mg::Buffer> buffer = nullptr;
                     for(auto i=0u; i < 400; i++)
                     {
-                        stream->submit_buffer(buffer);
+                        stream->submit_buffer(buffer, {});
                         std::this_thread::yield();
                     }
                     done = true;
@@ -104,7 +104,7 @@ TEST_F(SwapperSwappingStress, different_swapper_types)
                     std::shared_ptr<mg::Buffer> buffer = nullptr;
                     for(auto i=0u; i < 400; i++)
                     {
-                        stream->submit_buffer(buffer);
+                        stream->submit_buffer(buffer, {});
                         std::this_thread::yield();
                     }
                     done = true;
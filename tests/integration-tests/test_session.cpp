@@ -124,7 +124,7 @@ TEST(ApplicationSession, stress_test_take_snapshot)
         {
             for (int i = 0; i < 500; ++i)
             {
-                stream->submit_buffer(nullptr);
+                stream->submit_buffer(nullptr, {});
                 std::this_thread::sleep_for(std::chrono::microseconds{50});
             }
         }};
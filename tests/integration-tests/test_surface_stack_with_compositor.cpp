@@ -202,7 +202,7 @@ TEST_F(SurfaceStackCompositor, swapping_a_surface_that_has_been_added_triggers_a
     mt_compositor.start();
 
     stack.add_surface(stub_surface, default_params.input_mode);
-    stream->submit_buffer(stub_buffer);
+    stream->submit_buffer(stub_buffer, {});
 
     EXPECT_TRUE(stub_primary_db.has_posted_at_least(1, timeout));
     EXPECT_TRUE(stub_secondary_db.has_posted_at_least(1, timeout));
@@ -276,7 +276,7 @@ TEST_F(SurfaceStackCompositor, an_empty_scene_retriggers)
     mt_compositor.start();
 
     stack.add_surface(stub_surface, default_params.input_mode);
-    streams.front().stream->submit_buffer(stub_buffer);
+    streams.front().stream->submit_buffer(stub_buffer, {});
 
     EXPECT_TRUE(stub_primary_db.has_posted_at_least(1, timeout));
     EXPECT_TRUE(stub_secondary_db.has_posted_at_least(1, timeout));
@@ -289,7 +289,7 @@ TEST_F(SurfaceStackCompositor, an_empty_scene_retriggers)
 
 TEST_F(SurfaceStackCompositor, moving_a_surface_triggers_composition)
 {
-    streams.front().stream->submit_buffer(stub_buffer);
+    streams.front().stream->submit_buffer(stub_buffer, {});
     stack.add_surface(stub_surface, default_params.input_mode);
 
     mc::MultiThreadedCompositor mt_compositor(
@@ -308,7 +308,7 @@ TEST_F(SurfaceStackCompositor, moving_a_surface_triggers_composition)
 
 TEST_F(SurfaceStackCompositor, removing_a_surface_triggers_composition)
 {
-    streams.front().stream->submit_buffer(stub_buffer);
+    streams.front().stream->submit_buffer(stub_buffer, {});
     stack.add_surface(stub_surface, default_params.input_mode);
 
     mc::MultiThreadedCompositor mt_compositor(
@@ -328,7 +328,7 @@ TEST_F(SurfaceStackCompositor, removing_a_surface_triggers_composition)
 TEST_F(SurfaceStackCompositor, buffer_updates_trigger_composition)
 {
     stack.add_surface(stub_surface, default_params.input_mode);
-    streams.front().stream->submit_buffer(stub_buffer);
+    streams.front().stream->submit_buffer(stub_buffer, {});
 
     mc::MultiThreadedCompositor mt_compositor(
         mt::fake_shared(stub_display),
@@ -338,7 +338,7 @@ TEST_F(SurfaceStackCompositor, buffer_updates_trigger_composition)
         null_comp_report, default_delay, false);
 
     mt_compositor.start();
-    streams.front().stream->submit_buffer(stub_buffer);
+    streams.front().stream->submit_buffer(stub_buffer, {});
 
     EXPECT_TRUE(stub_primary_db.has_posted_at_least(1, timeout));
     EXPECT_TRUE(stub_secondary_db.has_posted_at_least(1, timeout));
@@ -22,6 +22,7 @@
 #include "mir/geometry/size.h"
 #include <gtest/gtest.h>
 
+#include <cstring>
 #include <stdexcept>
 #include <unistd.h>
 #include <dlfcn.h>
@@ -37,7 +38,8 @@ mtd::MockDRM* global_mock = nullptr;
 }
 
 mtd::FakeDRMResources::FakeDRMResources()
-    : pipe_fds{-1, -1}
+    : pipe_fds{-1, -1},
+      plane_resources()
 {
     /* Use the read end of a pipe as the fake DRM fd */
     if (pipe(pipe_fds) < 0 || pipe_fds[0] < 0)
@@ -99,6 +101,11 @@ drmModeRes* mtd::FakeDRMResources::resources_ptr()
     return &resources;
 }
 
+drmModePlaneRes* mtd::FakeDRMResources::plane_resources_ptr()
+{
+    return &plane_resources;
+}
+
 void mtd::FakeDRMResources::prepare()
 {
     resources.count_crtcs = crtcs.size();
@@ -115,6 +122,11 @@ void mtd::FakeDRMResources::prepare()
     for (auto const& connector: connectors)
         connector_ids.push_back(connector.connector_id);
     resources.connectors = connector_ids.data();
+
+    plane_resources.count_planes = planes.size();
+    for (auto const& plane: planes)
+        plane_ids.push_back(plane.plane_id);
+    plane_resources.planes = plane_ids.data();
 }
 
 void mtd::FakeDRMResources::reset()
@@ -128,6 +140,13 @@ void mtd::FakeDRMResources::reset()
     crtc_ids.clear();
     encoder_ids.clear();
     connector_ids.clear();
+
+    plane_resources = drmModePlaneRes();
+    planes.clear();
+    plane_formats.clear();
+    plane_ids.clear();
+    object_properties.clear();
+    properties.clear();
 }
 
 void mtd::FakeDRMResources::add_crtc(uint32_t id, drmModeModeInfo mode)
@@ -178,6 +197,42 @@ void mtd::FakeDRMResources::add_connector(uint32_t connector_id,
     connectors.push_back(connector);
 }
 
+void mtd::FakeDRMResources::add_plane(uint32_t plane_id, uint32_t crtc_id,
+                                      uint32_t possible_crtcs_mask,
+                                      std::vector<uint32_t> const& formats)
+{
+    drmModePlane plane = drmModePlane();
+
+    // Moving the vector of formats when plane_formats grows doesn't move its contents
+    plane_formats.push_back(formats);
+
+    plane.plane_id = plane_id;
+    plane.crtc_id = crtc_id;
+    plane.possible_crtcs = possible_crtcs_mask;
+    plane.formats = plane_formats.back().data();
+    plane.count_formats = plane_formats.back().size();
+
+    planes.push_back(plane);
+}
+
+uint32_t mtd::FakeDRMResources::add_property(uint32_t object_id, char const* name, uint64_t value)
+{
+    auto property = properties.find(name);
+    if (property == properties.end())
+    {
+        drmModePropertyRes res = drmModePropertyRes();
+        res.prop_id = next_property_id++;
+        strncpy(res.name, name, sizeof(res.name) - 1);
+        property = properties.emplace(name, res).first;
+    }
+
+    auto& object = object_properties[object_id];
+    object.ids.push_back(property->second.prop_id);
+    object.values.push_back(value);
+
+    return property->second.prop_id;
+}
+
 drmModeCrtc* mtd::FakeDRMResources::find_crtc(uint32_t id)
 {
     for (auto& crtc : crtcs)
@@ -208,6 +263,38 @@ drmModeConnector* mtd::FakeDRMResources::find_connector(uint32_t id)
     return nullptr;
 }
 
+drmModePlane* mtd::FakeDRMResources::find_plane(uint32_t id)
+{
+    for (auto& plane : planes)
+    {
+        if (plane.plane_id == id)
+            return &plane;
+    }
+    return nullptr;
+}
+
+drmModeObjectProperties* mtd::FakeDRMResources::find_object_properties(uint32_t object_id)
+{
+    auto const object = object_properties.find(object_id);
+    if (object == object_properties.end())
+        return nullptr;
+
+    auto& props = object->second;
+    props.props.count_props = props.ids.size();
+    props.props.props = props.ids.data();
+    props.props.prop_values = props.values.data();
+    return &props.props;
+}
+
+drmModePropertyRes* mtd::FakeDRMResources::find_property(uint32_t id)
+{
+    for (auto& property : properties)
+    {
+        if (property.second.prop_id == id)
+            return &property.second;
+    }
+    return nullptr;
+}
 
 drmModeModeInfo mtd::FakeDRMResources::create_mode(uint16_t hdisplay, uint16_t vdisplay,
                                                    uint32_t clock, uint16_t htotal,
@@ -304,8 +391,45 @@ mtd::MockDRM::MockDRM()
                     return fd_to_drm.at(fd).find_connector(connector_id);
                 }));
 
+    ON_CALL(*this, drmModeGetPlaneResources(_))
+        .WillByDefault(
+            Invoke(
+                [this](int fd)
+                {
+                    return fd_to_drm.at(fd).plane_resources_ptr();
+                }));
+
+    ON_CALL(*this, drmModeGetPlane(_, _))
+        .WillByDefault(
+            Invoke(
+                [this](int fd, uint32_t plane_id)
+                {
+                    return fd_to_drm.at(fd).find_plane(plane_id);
+                }));
+
     ON_CALL(*this, drmModeObjectGetProperties(_, _, _))
-        .WillByDefault(Return(&empty_object_props));
+        .WillByDefault(
+            Invoke(
+                [this](int fd, uint32_t object_id, uint32_t)
+                {
+                    auto const drm = fd_to_drm.find(fd);
+                    if (drm == fd_to_drm.end())
+                        return &empty_object_props;
+
+                    auto const props = drm->second.find_object_properties(object_id);
+                    return props ? props : &empty_object_props;
+                }));
+
+    ON_CALL(*this, drmModeGetProperty(_, _))
+        .WillByDefault(
+            Invoke(
+                [this](int fd, uint32_t property_id)
+                {
+                    return fd_to_drm.at(fd).find_property(property_id);
+                }));
+
+    ON_CALL(*this, drmModeAtomicAlloc())
+        .WillByDefault(Return(reinterpret_cast<drmModeAtomicReqPtr>(0xa70c)));
 
     ON_CALL(*this, drmSetInterfaceVersion(_, _))
         .WillByDefault(
@@ -380,6 +504,25 @@ void mtd::MockDRM::add_encoder(
     fake_drms[device].add_encoder(encoder_id, crtc_id, possible_crtcs_mask);
 }
 
+void mtd::MockDRM::add_plane(
+    char const* device,
+    uint32_t plane_id,
+    uint32_t crtc_id,
+    uint32_t possible_crtcs_mask,
+    std::vector<uint32_t> const& formats)
+{
+    fake_drms[device].add_plane(plane_id, crtc_id, possible_crtcs_mask, formats);
+}
+
+uint32_t mtd::MockDRM::add_property(
+    char const* device,
+    uint32_t object_id,
+    char const* name,
+    uint64_t value)
+{
+    return fake_drms[device].add_property(object_id, name, value);
+}
+
 void mtd::MockDRM::prepare(char const *device)
 {
     fake_drms[device].prepare();
@@ -651,6 +794,17 @@ int drmModeAddFB2(int fd, uint32_t width, uint32_t height,
                                       buf_id, flags);
 }
 
+int drmModeAddFB2WithModifiers(int fd, uint32_t width, uint32_t height,
+                               uint32_t pixel_format, uint32_t const bo_handles[4],
+                               uint32_t const pitches[4], uint32_t const offsets[4],
+                               uint64_t const modifier[4],
+                               uint32_t *buf_id, uint32_t flags)
+{
+    return global_mock->drmModeAddFB2WithModifiers(fd, width, height, pixel_format,
+                                                   bo_handles, pitches, offsets, modifier,
+                                                   buf_id, flags);
+}
+
 int drmModeRmFB(int fd, uint32_t bufferId)
 {
     return global_mock->drmModeRmFB(fd, bufferId);
@@ -714,6 +868,50 @@ int drmModeMoveCursor(int fd, uint32_t crtcId, int x, int y)
     return global_mock->drmModeMoveCursor(fd, crtcId, x, y);
 }
 
+int drmModeSetPlane(int fd, uint32_t plane_id, uint32_t crtc_id,
+                    uint32_t fb_id, uint32_t flags,
+                    int32_t crtc_x, int32_t crtc_y,
+                    uint32_t crtc_w, uint32_t crtc_h,
+                    uint32_t src_x, uint32_t src_y,
+                    uint32_t src_w, uint32_t src_h)
+{
+    return global_mock->drmModeSetPlane(
+        fd, plane_id, crtc_id, fb_id, flags,
+        {{crtc_x, crtc_y}, {crtc_w, crtc_h}},
+        {{src_x >> 16, src_y >> 16}, {src_w >> 16, src_h >> 16}});
+}
+
+drmModeAtomicReqPtr drmModeAtomicAlloc()
+{
+    return global_mock->drmModeAtomicAlloc();
+}
+
+void drmModeAtomicFree(drmModeAtomicReqPtr req)
+{
+    global_mock->drmModeAtomicFree(req);
+}
+
+int drmModeAtomicAddProperty(drmModeAtomicReqPtr req, uint32_t object_id,
+                             uint32_t property_id, uint64_t value)
+{
+    return global_mock->drmModeAtomicAddProperty(req, object_id, property_id, value);
+}
+
+int drmModeAtomicCommit(int fd, drmModeAtomicReqPtr req, uint32_t flags, void* user_data)
+{
+    return global_mock->drmModeAtomicCommit(fd, req, flags, user_data);
+}
+
+int drmModeCreatePropertyBlob(int fd, void const* data, size_t size, uint32_t* id)
+{
+    return global_mock->drmModeCreatePropertyBlob(fd, data, size, id);
+}
+
+int drmModeDestroyPropertyBlob(int fd, uint32_t id)
+{
+    return global_mock->drmModeDestroyPropertyBlob(fd, id);
+}
+
 int drmSetInterfaceVersion(int fd, drmSetVersion* sv)
 {
     return global_mock->drmSetInterfaceVersion(fd, sv);
@@ -20,6 +20,8 @@
 #include "mir/test/doubles/mock_gbm.h"
 #include <gtest/gtest.h>
 
+#include <drm_fourcc.h>
+
 namespace mtd=mir::test::doubles;
 
 namespace
@@ -68,6 +70,12 @@ mtd::MockGBM::MockGBM()
 
     ON_CALL(*this, gbm_bo_write(_,_,_))
     .WillByDefault(Return(0));
+
+    ON_CALL(*this, gbm_bo_get_modifier(_))
+    .WillByDefault(Return(DRM_FORMAT_MOD_INVALID));
+
+    ON_CALL(*this, gbm_bo_get_plane_count(_))
+    .WillByDefault(Return(1));
 }
 
 mtd::MockGBM::~MockGBM()
@@ -187,3 +195,28 @@ int gbm_bo_get_fd(gbm_bo* bo)
 {
     return global_mock->gbm_bo_get_fd(bo);
 }
+
+uint64_t gbm_bo_get_modifier(gbm_bo* bo)
+{
+    return global_mock->gbm_bo_get_modifier(bo);
+}
+
+int gbm_bo_get_plane_count(gbm_bo* bo)
+{
+    return global_mock->gbm_bo_get_plane_count(bo);
+}
+
+union gbm_bo_handle gbm_bo_get_handle_for_plane(gbm_bo* bo, int plane)
+{
+    return global_mock->gbm_bo_get_handle_for_plane(bo, plane);
+}
+
+uint32_t gbm_bo_get_stride_for_plane(gbm_bo* bo, int plane)
+{
+    return global_mock->gbm_bo_get_stride_for_plane(bo, plane);
+}
+
+uint32_t gbm_bo_get_offset(gbm_bo* bo, int plane)
+{
+    return global_mock->gbm_bo_get_offset(bo, plane);
+}
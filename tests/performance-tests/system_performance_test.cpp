@@ -202,4 +202,9 @@ void SystemPerformanceTest::run_server_for(std::chrono::seconds timeout)
     killer.detach();
 }
 
+void SystemPerformanceTest::signal_server(int sig)
+{
+    kill(server_pid, sig);
+}
+
 } } // namespace mir::test
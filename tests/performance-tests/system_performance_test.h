@@ -34,6 +34,7 @@ protected:
     void TearDown() override;
     void spawn_clients(std::initializer_list<std::string> clients);
     void run_server_for(std::chrono::seconds timeout);
+    void signal_server(int sig);
 
     FILE* server_output;
 private:
@@ -462,6 +462,17 @@ void basic_software_buffer_drawing(
             return buffer_;
         }
 
+        auto buffer_damage_since(mg::BufferID) const
+            -> std::experimental::optional<mir::geometry::Rectangles> override
+        {
+            return {};
+        }
+
+        auto opaque_region() const -> mir::geometry::Rectangles override
+        {
+            return {};
+        }
+
         auto screen_position() const -> mir::geometry::Rectangle override
         {
             return mir::geometry::Rectangle{top_left, buffer()->size()};
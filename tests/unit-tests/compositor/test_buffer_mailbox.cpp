@@ -0,0 +1,209 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/server/compositor/buffer_mailbox.h"
+#include "mir/test/doubles/stub_buffer.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace testing;
+namespace mtd = mir::test::doubles;
+namespace mg = mir::graphics;
+namespace mc = mir::compositor;
+
+namespace
+{
+struct BufferMailbox : Test
+{
+    BufferMailbox()
+    {
+        for(auto i = 0u; i < num_buffers; i++)
+            buffers.emplace_back(std::make_shared<mtd::StubBuffer>());
+    }
+
+    unsigned int const num_buffers{5};
+    std::vector<std::shared_ptr<mg::Buffer>> buffers;
+
+    int compositor_a{0};
+    int compositor_b{0};
+
+    mc::BufferMailbox mailbox;
+};
+}
+
+TEST_F(BufferMailbox, throws_if_no_buffers)
+{
+    EXPECT_FALSE(mailbox.buffer_ready_for(&compositor_a));
+    EXPECT_THROW({
+        mailbox.compositor_acquire(&compositor_a);
+    }, std::logic_error);
+    EXPECT_THROW({
+        mailbox.snapshot_acquire();
+    }, std::logic_error);
+}
+
+TEST_F(BufferMailbox, try_acquire_gives_null_if_no_buffers)
+{
+    EXPECT_FALSE(mailbox.try_compositor_acquire(&compositor_a));
+
+    mailbox.post(buffers[0]);
+    mailbox.take();
+
+    EXPECT_FALSE(mailbox.try_compositor_acquire(&compositor_a));
+}
+
+TEST_F(BufferMailbox, drops_all_but_the_latest_buffer)
+{
+    for(auto i = 0u; i < num_buffers; i++)
+        mailbox.post(buffers[i]);
+
+    EXPECT_THAT(mailbox.compositor_acquire(&compositor_a), Eq(buffers[4]));
+    for (int i = 0; i < 4 ; ++i)
+    {
+        EXPECT_TRUE(buffers[i].unique());
+    }
+}
+
+TEST_F(BufferMailbox, posting_same_buffer_many_times_doesnt_drop_it)
+{
+    mailbox.post(buffers[2]);
+    mailbox.post(buffers[2]);
+    mailbox.post(buffers[2]);
+
+    EXPECT_THAT(mailbox.compositor_acquire(&compositor_a), Eq(buffers[2]));
+}
+
+TEST_F(BufferMailbox, buffer_is_ready_for_each_compositor_until_it_acquires_it)
+{
+    mailbox.post(buffers[0]);
+
+    EXPECT_TRUE(mailbox.buffer_ready_for(&compositor_a));
+    EXPECT_TRUE(mailbox.buffer_ready_for(&compositor_b));
+
+    auto const a = mailbox.compositor_acquire(&compositor_a);
+
+    EXPECT_FALSE(mailbox.buffer_ready_for(&compositor_a));
+    EXPECT_TRUE(mailbox.buffer_ready_for(&compositor_b));
+
+    auto const b = mailbox.compositor_acquire(&compositor_b);
+
+    EXPECT_FALSE(mailbox.buffer_ready_for(&compositor_b));
+    EXPECT_THAT(a, Eq(b));
+
+    mailbox.post(buffers[1]);
+
+    EXPECT_TRUE(mailbox.buffer_ready_for(&compositor_a));
+    EXPECT_TRUE(mailbox.buffer_ready_for(&compositor_b));
+}
+
+TEST_F(BufferMailbox, compositor_gets_the_same_buffer_until_a_new_one_is_posted)
+{
+    mailbox.post(buffers[0]);
+
+    auto const first = mailbox.compositor_acquire(&compositor_a);
+    auto const second = mailbox.compositor_acquire(&compositor_a);
+    EXPECT_THAT(first, Eq(second));
+
+    mailbox.post(buffers[1]);
+
+    EXPECT_THAT(mailbox.compositor_acquire(&compositor_a), Eq(buffers[1]));
+}
+
+TEST_F(BufferMailbox, snapshot_does_not_consume_the_buffer)
+{
+    mailbox.post(buffers[0]);
+
+    EXPECT_THAT(mailbox.snapshot_acquire(), Eq(buffers[0]));
+    EXPECT_TRUE(mailbox.buffer_ready_for(&compositor_a));
+}
+
+TEST_F(BufferMailbox, take_empties_the_mailbox)
+{
+    mailbox.post(buffers[0]);
+    mailbox.post(buffers[1]);
+
+    EXPECT_THAT(mailbox.take(), Eq(buffers[1]));
+    EXPECT_TRUE(buffers[1].unique());
+    EXPECT_FALSE(mailbox.buffer_ready_for(&compositor_a));
+    EXPECT_FALSE(mailbox.take());
+}
+
+TEST_F(BufferMailbox, keeps_track_of_compositors_that_come_and_go)
+{
+    std::vector<int> compositors(100);
+
+    for (auto i = 0u; i != compositors.size(); ++i)
+    {
+        mailbox.post(buffers[i % num_buffers]);
+
+        // Keep one compositor around throughout
+        mailbox.compositor_acquire(&compositor_a);
+
+        mailbox.compositor_acquire(&compositors[i]);
+        EXPECT_FALSE(mailbox.buffer_ready_for(&compositors[i]));
+        EXPECT_FALSE(mailbox.buffer_ready_for(&compositor_a));
+    }
+}
+
+TEST_F(BufferMailbox, compositors_always_get_a_posted_buffer_while_posting_continues)
+{
+    unsigned int const num_compositors{3};
+    int const num_posts{10000};
+
+    std::atomic<bool> done{false};
+    std::atomic<int> bad_acquisitions{0};
+
+    mailbox.post(buffers[0]);
+
+    std::vector<int> ids(num_compositors);
+    std::vector<std::thread> compositors;
+    for (auto& id : ids)
+    {
+        compositors.emplace_back(
+            [&]
+            {
+                while (!done)
+                {
+                    auto const buffer = mailbox.compositor_acquire(&id);
+                    if (std::find(buffers.begin(), buffers.end(), buffer) == buffers.end())
+                        ++bad_acquisitions;
+                }
+            });
+    }
+
+    for (int i = 0; i != num_posts; ++i)
+        mailbox.post(buffers[i % num_buffers]);
+
+    done = true;
+    for (auto& compositor : compositors)
+        compositor.join();
+
+    EXPECT_THAT(bad_acquisitions, Eq(0));
+    EXPECT_THAT(mailbox.compositor_acquire(&compositor_a), Eq(buffers[(num_posts - 1) % num_buffers]));
+
+    // Whoever finished with each replaced buffer last released it
+    for (auto i = 0u; i != num_buffers; ++i)
+    {
+        if (i != (num_posts - 1) % num_buffers)
+            EXPECT_TRUE(buffers[i].unique());
+    }
+}
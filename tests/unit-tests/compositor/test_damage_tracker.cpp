@@ -0,0 +1,119 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/server/compositor/damage_tracker.h"
+#include "mir/test/doubles/fake_renderable.h"
+#include "mir/test/doubles/stub_buffer.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+using namespace testing;
+namespace mc = mir::compositor;
+namespace mg = mir::graphics;
+namespace geom = mir::geometry;
+namespace mtd = mir::test::doubles;
+
+namespace
+{
+struct DamageTracker : Test
+{
+    geom::Rectangle const screen{{0, 0}, {1920, 1080}};
+    std::shared_ptr<mtd::FakeRenderable> const bottom =
+        std::make_shared<mtd::FakeRenderable>(geom::Rectangle{{10, 10}, {100, 100}});
+    std::shared_ptr<mtd::FakeRenderable> const top =
+        std::make_shared<mtd::FakeRenderable>(geom::Rectangle{{50, 50}, {100, 100}});
+
+    mc::DamageTracker tracker;
+};
+}
+
+TEST_F(DamageTracker, first_frame_is_fully_damaged)
+{
+    EXPECT_THAT(tracker.damage_for({bottom, top}, screen), Eq(geom::Rectangles{screen}));
+}
+
+TEST_F(DamageTracker, unchanged_frame_has_no_damage)
+{
+    tracker.damage_for({bottom, top}, screen);
+
+    EXPECT_THAT(tracker.damage_for({bottom, top}, screen).size(), Eq(0u));
+}
+
+TEST_F(DamageTracker, new_buffer_damages_renderable_area)
+{
+    tracker.damage_for({bottom, top}, screen);
+
+    top->set_buffer(std::make_shared<mtd::StubBuffer>());
+
+    EXPECT_THAT(tracker.damage_for({bottom, top}, screen), Eq(geom::Rectangles{top->screen_position()}));
+}
+
+TEST_F(DamageTracker, new_buffer_with_known_damage_damages_only_that)
+{
+    tracker.damage_for({bottom, top}, screen);
+
+    top->set_buffer(
+        std::make_shared<mtd::StubBuffer>(geom::Size{50, 50}),
+        geom::Rectangles{{{10, 10}, {5, 5}}});
+
+    // The 50x50 buffer is drawn at twice its size
+    EXPECT_THAT(tracker.damage_for({bottom, top}, screen), Eq(geom::Rectangles{{{70, 70}, {10, 10}}}));
+}
+
+TEST_F(DamageTracker, move_damages_old_and_new_areas)
+{
+    tracker.damage_for({bottom, top}, screen);
+
+    auto const old_position = top->screen_position();
+    geom::Rectangle const new_position{{500, 500}, {100, 100}};
+    top->set_screen_position(new_position);
+
+    EXPECT_THAT(tracker.damage_for({bottom, top}, screen), Eq(geom::Rectangles{old_position, new_position}));
+}
+
+TEST_F(DamageTracker, added_and_removed_renderables_are_damaged)
+{
+    tracker.damage_for({bottom}, screen);
+
+    EXPECT_THAT(tracker.damage_for({top}, screen),
+        Eq(geom::Rectangles{bottom->screen_position(), top->screen_position()}));
+}
+
+TEST_F(DamageTracker, restacking_damages_restacked_renderables)
+{
+    tracker.damage_for({bottom, top}, screen);
+
+    EXPECT_THAT(tracker.damage_for({top, bottom}, screen),
+        Eq(geom::Rectangles{top->screen_position(), bottom->screen_position()}));
+}
+
+TEST_F(DamageTracker, damage_is_clipped_to_view_area)
+{
+    auto const offscreen = std::make_shared<mtd::FakeRenderable>(geom::Rectangle{{-50, -50}, {100, 100}});
+    tracker.damage_for({}, screen);
+
+    EXPECT_THAT(tracker.damage_for({offscreen}, screen),
+        Eq(geom::Rectangles{geom::Rectangle{{0, 0}, {50, 50}}}));
+}
+
+TEST_F(DamageTracker, view_area_change_is_fully_damaged)
+{
+    geom::Rectangle const rotated{{0, 0}, {1080, 1920}};
+    tracker.damage_for({bottom, top}, screen);
+
+    EXPECT_THAT(tracker.damage_for({bottom, top}, rotated), Eq(geom::Rectangles{rotated}));
+}
@@ -22,6 +22,7 @@
 #include "mir/compositor/scene.h"
 #include "mir/renderer/renderer.h"
 #include "mir/geometry/rectangle.h"
+#include "mir/graphics/overlay_planes.h"
 #include "mir/test/doubles/mock_renderer.h"
 #include "mir/test/fake_shared.h"
 #include "mir/test/gmock_fixes.h"
@@ -247,6 +248,33 @@ TEST_F(DefaultDisplayBufferCompositor, rotates_viewport)
     }));
 }
 
+TEST_F(DefaultDisplayBufferCompositor, damages_only_what_changed_between_frames)
+{
+    using namespace testing;
+
+    auto const old_position = small->screen_position();
+    geom::Rectangle const new_position{{500, 500}, {30, 40}};
+
+    Sequence seq;
+    EXPECT_CALL(mock_renderer, set_damage(Eq(geom::Rectangles{screen})))
+        .InSequence(seq);
+    EXPECT_CALL(mock_renderer, render(_))
+        .InSequence(seq);
+    EXPECT_CALL(mock_renderer, set_damage(Eq(geom::Rectangles{old_position, new_position})))
+        .InSequence(seq);
+    EXPECT_CALL(mock_renderer, render(_))
+        .InSequence(seq);
+
+    mc::DefaultDisplayBufferCompositor compositor(
+        display_buffer,
+        mt::fake_shared(mock_renderer),
+        mr::null_compositor_report());
+
+    compositor.composite(make_scene_elements({big, small}));
+    small->set_screen_position(new_position);
+    compositor.composite(make_scene_elements({big, small}));
+}
+
 TEST_F(DefaultDisplayBufferCompositor, optimization_toggles_seamlessly)
 {
     using namespace testing;
@@ -329,6 +357,36 @@ TEST_F(DefaultDisplayBufferCompositor, occluded_surfaces_are_not_rendered)
     }));
 }
 
+namespace
+{
+struct MockOverlayDisplayBuffer : mtd::MockDisplayBuffer, mg::OverlayPlanes
+{
+    MOCK_METHOD1(assign_overlays, mg::RenderableList(mg::RenderableList const&));
+};
+}
+
+TEST_F(DefaultDisplayBufferCompositor, renders_only_what_overlay_planes_leave)
+{
+    using namespace testing;
+    NiceMock<MockOverlayDisplayBuffer> overlay_display_buffer;
+    ON_CALL(overlay_display_buffer, transformation())
+        .WillByDefault(Return(no_transformation));
+    ON_CALL(overlay_display_buffer, view_area())
+        .WillByDefault(Return(screen));
+
+    auto const video = std::make_shared<mtd::FakeRenderable>(geom::Rectangle{{200, 200}, {640, 360}});
+
+    EXPECT_CALL(overlay_display_buffer, assign_overlays(ContainerEq(mg::RenderableList{big, video})))
+        .WillOnce(Return(mg::RenderableList{big}));
+    EXPECT_CALL(mock_renderer, render(ContainerEq(mg::RenderableList{big})));
+
+    mc::DefaultDisplayBufferCompositor compositor(
+        overlay_display_buffer,
+        mt::fake_shared(mock_renderer),
+        mr::null_compositor_report());
+    compositor.composite(make_scene_elements({big, video}));
+}
+
 namespace
 {
 struct MockSceneElement : mc::SceneElement
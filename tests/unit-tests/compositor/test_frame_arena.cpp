@@ -0,0 +1,138 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mir/compositor/frame_arena.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <vector>
+
+using namespace testing;
+namespace mc = mir::compositor;
+
+namespace
+{
+struct Tracked
+{
+    Tracked(int value, int& live) : value{value}, live{live} { ++live; }
+    ~Tracked() { --live; }
+
+    int const value;
+    int& live;
+};
+
+struct FrameArena : Test
+{
+    int live{0};
+    mc::FrameArena arena;
+};
+}
+
+TEST_F(FrameArena, makes_objects_with_the_given_arguments)
+{
+    auto const object = arena.make_shared<Tracked>(42, live);
+
+    EXPECT_THAT(object->value, Eq(42));
+    EXPECT_THAT(live, Eq(1));
+}
+
+TEST_F(FrameArena, destroys_objects_when_the_last_reference_goes)
+{
+    auto object = arena.make_shared<Tracked>(42, live);
+    auto copy = object;
+
+    object.reset();
+    EXPECT_THAT(live, Eq(1));
+
+    copy.reset();
+    EXPECT_THAT(live, Eq(0));
+}
+
+TEST_F(FrameArena, reuses_memory_once_everything_made_is_released)
+{
+    void const* first;
+    {
+        auto const object = arena.make_shared<Tracked>(1, live);
+        auto const other = arena.make_shared<Tracked>(2, live);
+        first = object.get();
+    }
+
+    auto const object = arena.make_shared<Tracked>(3, live);
+
+    EXPECT_THAT(object.get(), Eq(first));
+}
+
+TEST_F(FrameArena, does_not_reuse_memory_while_anything_made_is_alive)
+{
+    void const* first;
+    auto const other = arena.make_shared<Tracked>(1, live);
+    {
+        auto const object = arena.make_shared<Tracked>(2, live);
+        first = object.get();
+    }
+
+    auto const object = arena.make_shared<Tracked>(3, live);
+
+    EXPECT_THAT(object.get(), Ne(first));
+    EXPECT_THAT(other->value, Eq(1));
+}
+
+TEST_F(FrameArena, steady_state_frames_do_not_grow_the_arena)
+{
+    auto const frame = [this]()
+        {
+            std::vector<std::shared_ptr<Tracked>> objects;
+            for (auto i = 0; i != 5; ++i)
+            {
+                objects.push_back(arena.make_shared<Tracked>(i, live));
+            }
+        };
+
+    frame();
+    auto const capacity = arena.capacity();
+
+    for (auto i = 0; i != 10; ++i)
+    {
+        frame();
+    }
+
+    EXPECT_THAT(arena.capacity(), Eq(capacity));
+}
+
+TEST_F(FrameArena, frames_can_outgrow_the_arena)
+{
+    auto const frame = [this]()
+        {
+            std::vector<std::shared_ptr<Tracked>> objects;
+            for (auto i = 0; i != 10000; ++i)
+            {
+                objects.push_back(arena.make_shared<Tracked>(i, live));
+            }
+
+            for (auto i = 0; i != 10000; ++i)
+            {
+                EXPECT_THAT(objects[i]->value, Eq(i));
+            }
+        };
+
+    frame();
+    auto const capacity = arena.capacity();
+    frame();
+
+    EXPECT_THAT(arena.capacity(), Eq(capacity));
+    EXPECT_THAT(live, Eq(0));
+}
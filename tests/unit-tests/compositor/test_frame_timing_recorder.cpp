@@ -0,0 +1,152 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/server/compositor/frame_timing_recorder.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <sstream>
+#include <thread>
+
+using namespace testing;
+using namespace std::chrono;
+namespace mc = mir::compositor;
+namespace geom = mir::geometry;
+
+namespace
+{
+struct FrameTimingRecorder : Test
+{
+    auto frame(milliseconds snapshot, milliseconds render, milliseconds post, bool missed = false)
+        -> mc::FrameTimingRecorder::Frame
+    {
+        auto const end = start + snapshot + render + post;
+        mc::FrameTimingRecorder::Frame const result{start, end, snapshot, render, post, missed};
+        start = end;
+        return result;
+    }
+
+    steady_clock::time_point start{seconds{1}};
+    geom::Rectangle const left{{0, 0}, {1920, 1080}};
+    geom::Rectangle const right{{1920, 0}, {1280, 1024}};
+    mc::FrameTimingRecorder recorder;
+};
+}
+
+TEST_F(FrameTimingRecorder, has_no_outputs_until_asked_for_one)
+{
+    EXPECT_THAT(recorder.outputs(), IsEmpty());
+}
+
+TEST_F(FrameTimingRecorder, reports_each_output)
+{
+    recorder.output_at(left);
+    recorder.output_at(right);
+
+    auto const outputs = recorder.outputs();
+    ASSERT_THAT(outputs.size(), Eq(2u));
+    EXPECT_THAT(outputs[0].area, Eq(left));
+    EXPECT_THAT(outputs[1].area, Eq(right));
+    EXPECT_THAT(outputs[0].frames, Eq(0u));
+}
+
+TEST_F(FrameTimingRecorder, output_at_the_same_area_carries_on)
+{
+    recorder.output_at(left)->record(frame(1ms, 2ms, 3ms));
+    recorder.output_at(left)->record(frame(1ms, 2ms, 3ms));
+
+    auto const outputs = recorder.outputs();
+    ASSERT_THAT(outputs.size(), Eq(1u));
+    EXPECT_THAT(outputs[0].frames, Eq(2u));
+}
+
+TEST_F(FrameTimingRecorder, accumulates_stage_timings)
+{
+    auto const output = recorder.output_at(left);
+    output->record(frame(1ms, 4ms, 10ms));
+    output->record(frame(3ms, 2ms, 12ms));
+
+    auto const timings = recorder.outputs().front();
+    EXPECT_THAT(timings.frames, Eq(2u));
+    EXPECT_THAT(timings.scene_snapshot.total, Eq(4ms));
+    EXPECT_THAT(timings.scene_snapshot.longest, Eq(3ms));
+    EXPECT_THAT(timings.render.total, Eq(6ms));
+    EXPECT_THAT(timings.render.longest, Eq(4ms));
+    EXPECT_THAT(timings.post.total, Eq(22ms));
+    EXPECT_THAT(timings.post.longest, Eq(12ms));
+    EXPECT_THAT(timings.latency.total, Eq(32ms));
+    EXPECT_THAT(timings.latency.longest, Eq(17ms));
+    EXPECT_THAT(timings.elapsed, Eq(32ms));
+}
+
+TEST_F(FrameTimingRecorder, counts_missed_deadlines)
+{
+    auto const output = recorder.output_at(left);
+    output->record(frame(1ms, 1ms, 1ms));
+    output->record(frame(1ms, 1ms, 30ms, true));
+    output->record(frame(1ms, 1ms, 1ms));
+
+    EXPECT_THAT(recorder.outputs().front().missed_deadlines, Eq(1u));
+}
+
+TEST_F(FrameTimingRecorder, histogram_buckets_by_powers_of_two_milliseconds)
+{
+    auto const output = recorder.output_at(left);
+    for (auto const render : {0ms, 1ms, 3ms, 4ms, 20ms, 64ms, 1000ms})
+        output->record(frame(0ms, render, 0ms));
+
+    EXPECT_THAT(recorder.outputs().front().render.histogram, ElementsAre(1, 1, 1, 1, 0, 1, 0, 2));
+}
+
+TEST_F(FrameTimingRecorder, records_from_several_threads)
+{
+    int const frames_per_thread = 10000;
+    auto const output = recorder.output_at(left);
+    auto const record_frames = [&]
+        {
+            for (auto i = 0; i != frames_per_thread; ++i)
+                output->record({steady_clock::now(), steady_clock::now(), 1ms, 2ms, 3ms, false});
+        };
+
+    std::thread first{record_frames};
+    std::thread second{record_frames};
+    first.join();
+    second.join();
+
+    auto const timings = recorder.outputs().front();
+    EXPECT_THAT(timings.frames, Eq(2u * frames_per_thread));
+    EXPECT_THAT(timings.render.total, Eq(2ms * 2 * frames_per_thread));
+}
+
+TEST_F(FrameTimingRecorder, writes_json)
+{
+    recorder.output_at(left)->record(frame(1ms, 2ms, 3ms));
+    recorder.output_at(right);
+
+    std::stringstream json;
+    recorder.write_json(json);
+
+    EXPECT_THAT(json.str(), StartsWith("{\"histogram_bounds_ms\": [1, 2, 4, 8, 16, 32, 64],"));
+    EXPECT_THAT(json.str(), HasSubstr(
+        "{\"x\": 0, \"y\": 0, \"width\": 1920, \"height\": 1080, \"frames\": 1, "
+        "\"missed_deadlines\": 0, \"elapsed_ms\": 6"));
+    EXPECT_THAT(json.str(), HasSubstr(
+        "\"render\": {\"total_ms\": 2, \"mean_ms\": 2, \"max_ms\": 2, \"histogram\": [0, 0, 1, 0, 0, 0, 0, 0]}"));
+    EXPECT_THAT(json.str(), HasSubstr(
+        "{\"x\": 1920, \"y\": 0, \"width\": 1280, \"height\": 1024, \"frames\": 0"));
+    EXPECT_THAT(json.str(), EndsWith("]}\n"));
+}
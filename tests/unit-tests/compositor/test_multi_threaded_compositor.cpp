@@ -17,9 +17,11 @@
  */
 
 #include "src/server/compositor/multi_threaded_compositor.h"
+#include "src/server/compositor/frame_timing_recorder.h"
 #include "src/server/report/null_report_factory.h"
 
 #include "mir/compositor/display_listener.h"
+#include "mir/compositor/frame_deadline_listener.h"
 #include "mir/compositor/display_buffer_compositor.h"
 #include "mir/compositor/scene.h"
 #include "mir/compositor/display_buffer_compositor_factory.h"
@@ -27,6 +29,7 @@
 #include "mir/raii.h"
 
 #include "mir/test/current_thread_name.h"
+#include "mir/test/signal.h"
 #include "mir/test/doubles/null_display.h"
 #include "mir/test/doubles/null_display_buffer.h"
 #include "mir/test/doubles/mock_display_buffer.h"
@@ -93,6 +96,97 @@ private:
     std::vector<StubDisplaySyncGroup> buffers;
 };
 
+/// A display that won't be ready for another frame for a long time
+class StubDisplayWithDistantNextFrame : public mtd::NullDisplay
+{
+public:
+    void for_each_display_sync_group(std::function<void(mg::DisplaySyncGroup&)> const& f) override
+    {
+        f(group);
+    }
+
+private:
+    struct StubDisplaySyncGroup : mg::DisplaySyncGroup
+    {
+        void for_each_display_buffer(std::function<void(mg::DisplayBuffer&)> const& f) override
+        {
+            f(buffer);
+        }
+        void post() override {}
+        std::chrono::milliseconds recommended_sleep() const override
+        {
+            return std::chrono::milliseconds::zero();
+        }
+        auto next_frame_start() const -> std::chrono::steady_clock::time_point override
+        {
+            return std::chrono::steady_clock::now() + std::chrono::hours{1};
+        }
+        mtd::NullDisplayBuffer buffer;
+    };
+
+    StubDisplaySyncGroup group;
+};
+
+/// A display whose frames start when it says, are due a while after that, and take a while to post
+class StubDisplayWithFrameDeadline : public mtd::NullDisplay
+{
+public:
+    StubDisplayWithFrameDeadline(
+        std::chrono::steady_clock::time_point next_frame_start,
+        std::chrono::milliseconds time_to_deadline,
+        std::chrono::milliseconds time_to_post)
+        : group{next_frame_start, time_to_deadline, time_to_post}
+    {
+    }
+
+    void for_each_display_sync_group(std::function<void(mg::DisplaySyncGroup&)> const& f) override
+    {
+        f(group);
+    }
+
+private:
+    struct StubDisplaySyncGroup : mg::DisplaySyncGroup
+    {
+        StubDisplaySyncGroup(
+            std::chrono::steady_clock::time_point next_frame_start,
+            std::chrono::milliseconds time_to_deadline,
+            std::chrono::milliseconds time_to_post)
+            : frame_start{next_frame_start},
+              time_to_deadline{time_to_deadline},
+              time_to_post{time_to_post}
+        {
+        }
+
+        void for_each_display_buffer(std::function<void(mg::DisplayBuffer&)> const& f) override
+        {
+            f(buffer);
+        }
+        void post() override
+        {
+            std::this_thread::sleep_for(time_to_post);
+        }
+        std::chrono::milliseconds recommended_sleep() const override
+        {
+            return std::chrono::milliseconds::zero();
+        }
+        auto next_frame_start() const -> std::chrono::steady_clock::time_point override
+        {
+            return frame_start;
+        }
+        auto next_frame_deadline() const -> std::chrono::steady_clock::time_point override
+        {
+            return std::chrono::steady_clock::now() + time_to_deadline;
+        }
+
+        std::chrono::steady_clock::time_point const frame_start;
+        std::chrono::milliseconds const time_to_deadline;
+        std::chrono::milliseconds const time_to_post;
+        mtd::NullDisplayBuffer buffer;
+    };
+
+    StubDisplaySyncGroup group;
+};
+
 class StubScene : public mtd::StubScene
 {
 public:
@@ -359,6 +453,11 @@ struct MockDisplayListener : mc::DisplayListener
     MOCK_METHOD1(remove_display, void(geom::Rectangle const& /*area*/));
 };
 
+struct MockFrameDeadlineListener : mc::FrameDeadlineListener
+{
+    MOCK_METHOD1(next_frame_at, void(std::chrono::steady_clock::time_point));
+};
+
 auto const null_report = mr::null_compositor_report();
 unsigned int const composites_per_update{1};
 auto const null_display_listener = std::make_shared<StubDisplayListener>();
@@ -662,6 +761,203 @@ TEST(MultiThreadedCompositor, recommended_sleep_throttles_compositor_loop)
     compositor.stop();
 }
 
+TEST(MultiThreadedCompositor, next_frame_start_delays_the_next_frame)
+{
+    using namespace testing;
+
+    auto display = std::make_shared<StubDisplayWithDistantNextFrame>();
+    auto scene = std::make_shared<StubScene>();
+    auto factory = std::make_shared<RecordingDisplayBufferCompositorFactory>();
+    mc::MultiThreadedCompositor compositor{display, scene, factory,
+                                           null_display_listener, null_report,
+                                           default_delay, true};
+
+    compositor.start();
+
+    int const max_retries = 100;
+    int retry = 0;
+    while (retry < max_retries && !factory->check_record_count_for_each_buffer(1, 1))
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        ++retry;
+    }
+    ASSERT_LT(retry, max_retries);
+
+    scene->emit_change_event();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    EXPECT_TRUE(factory->check_record_count_for_each_buffer(1, 1, 1));
+
+    compositor.stop();
+}
+
+TEST(MultiThreadedCompositor, stopping_does_not_wait_for_next_frame_start)
+{
+    using namespace testing;
+    using namespace std::chrono;
+
+    auto display = std::make_shared<StubDisplayWithDistantNextFrame>();
+    auto scene = std::make_shared<StubScene>();
+    auto factory = std::make_shared<RecordingDisplayBufferCompositorFactory>();
+    mc::MultiThreadedCompositor compositor{display, scene, factory,
+                                           null_display_listener, null_report,
+                                           default_delay, true};
+
+    compositor.start();
+
+    int const max_retries = 100;
+    int retry = 0;
+    while (retry < max_retries && !factory->check_record_count_for_each_buffer(1, 1))
+    {
+        std::this_thread::sleep_for(milliseconds(10));
+        ++retry;
+    }
+    ASSERT_LT(retry, max_retries);
+
+    auto const stop_requested = steady_clock::now();
+    compositor.stop();
+
+    EXPECT_THAT(duration_cast<milliseconds>(steady_clock::now() - stop_requested).count(), Lt(5000));
+}
+
+TEST(MultiThreadedCompositor, records_frame_timings_for_each_output)
+{
+    using namespace testing;
+
+    std::vector<geom::Rectangle> const outputs_at{
+        {{0, 0}, {640, 480}},
+        {{640, 0}, {640, 480}},
+        {{1280, 0}, {640, 480}}};
+    unsigned int const nbuffers = outputs_at.size();
+
+    auto display = std::make_shared<mtd::StubDisplay>(outputs_at);
+    auto scene = std::make_shared<StubScene>();
+    auto factory = std::make_shared<RecordingDisplayBufferCompositorFactory>();
+    auto frame_timings = std::make_shared<mc::FrameTimingRecorder>();
+    mc::MultiThreadedCompositor compositor{display, scene, factory,
+                                           null_display_listener, null_report,
+                                           frame_timings, nullptr, default_delay, true};
+
+    compositor.start();
+
+    int const max_retries = 100;
+    int retry = 0;
+    while (retry < max_retries && !factory->check_record_count_for_each_buffer(nbuffers, 1))
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        ++retry;
+    }
+    ASSERT_LT(retry, max_retries);
+
+    compositor.stop();
+
+    auto const outputs = frame_timings->outputs();
+    ASSERT_THAT(outputs.size(), Eq(nbuffers));
+    for (auto const& output : outputs)
+    {
+        EXPECT_THAT(output.frames, Ge(1u));
+        EXPECT_THAT(output.latency.total, Ge(output.render.total));
+    }
+}
+
+TEST(MultiThreadedCompositor, frames_posted_by_their_deadline_meet_it)
+{
+    using namespace testing;
+    using namespace std::chrono;
+
+    // Like gbm-kms in clone mode, ready for the next frame as soon as one is posted
+    auto display = std::make_shared<StubDisplayWithFrameDeadline>(steady_clock::time_point{}, seconds{10}, milliseconds{0});
+    auto scene = std::make_shared<StubScene>();
+    auto factory = std::make_shared<RecordingDisplayBufferCompositorFactory>();
+    auto frame_timings = std::make_shared<mc::FrameTimingRecorder>();
+    mc::MultiThreadedCompositor compositor{display, scene, factory,
+                                           null_display_listener, null_report,
+                                           frame_timings, nullptr, default_delay, true};
+
+    compositor.start();
+
+    int const max_retries = 100;
+    int retry = 0;
+    while (retry < max_retries && !factory->check_record_count_for_each_buffer(1, 1))
+    {
+        std::this_thread::sleep_for(milliseconds(10));
+        ++retry;
+    }
+    ASSERT_LT(retry, max_retries);
+
+    compositor.stop();
+
+    auto const outputs = frame_timings->outputs();
+    ASSERT_THAT(outputs.size(), Eq(1u));
+    EXPECT_THAT(outputs.front().frames, Ge(1u));
+    EXPECT_THAT(outputs.front().missed_deadlines, Eq(0u));
+}
+
+TEST(MultiThreadedCompositor, frames_posted_after_their_deadline_miss_it)
+{
+    using namespace testing;
+    using namespace std::chrono;
+
+    // The next frame isn't due to start for a long time, but this one is late
+    auto display = std::make_shared<StubDisplayWithFrameDeadline>(
+        steady_clock::now() + hours{1}, milliseconds{1}, milliseconds{20});
+    auto scene = std::make_shared<StubScene>();
+    auto factory = std::make_shared<RecordingDisplayBufferCompositorFactory>();
+    auto frame_timings = std::make_shared<mc::FrameTimingRecorder>();
+    mc::MultiThreadedCompositor compositor{display, scene, factory,
+                                           null_display_listener, null_report,
+                                           frame_timings, nullptr, default_delay, true};
+
+    auto const frame_recorded = [&]
+        {
+            auto const outputs = frame_timings->outputs();
+            return !outputs.empty() && outputs.front().frames > 0;
+        };
+
+    compositor.start();
+
+    int const max_retries = 100;
+    int retry = 0;
+    while (retry < max_retries && !frame_recorded())
+    {
+        std::this_thread::sleep_for(milliseconds(10));
+        ++retry;
+    }
+    ASSERT_LT(retry, max_retries);
+
+    compositor.stop();
+
+    auto const outputs = frame_timings->outputs();
+    ASSERT_THAT(outputs.size(), Eq(1u));
+    EXPECT_THAT(outputs.front().frames, Eq(1u));
+    EXPECT_THAT(outputs.front().missed_deadlines, Eq(1u));
+}
+
+TEST(MultiThreadedCompositor, reports_when_the_next_frame_starts)
+{
+    using namespace testing;
+    using namespace std::chrono;
+
+    auto display = std::make_shared<StubDisplayWithDistantNextFrame>();
+    auto scene = std::make_shared<StubScene>();
+    auto factory = std::make_shared<RecordingDisplayBufferCompositorFactory>();
+    auto frame_deadlines = std::make_shared<NiceMock<MockFrameDeadlineListener>>();
+    mc::MultiThreadedCompositor compositor{display, scene, factory,
+                                           null_display_listener, null_report,
+                                           std::make_shared<mc::FrameTimingRecorder>(), frame_deadlines,
+                                           default_delay, true};
+
+    mt::Signal reported;
+    EXPECT_CALL(*frame_deadlines, next_frame_at(Gt(steady_clock::now() + minutes{59})))
+        .WillRepeatedly(InvokeWithoutArgs([&]{ reported.raise(); }));
+
+    compositor.start();
+
+    EXPECT_TRUE(reported.wait_for(seconds{5}));
+
+    compositor.stop();
+}
+
 TEST(MultiThreadedCompositor, when_no_initial_composite_is_needed_there_is_none)
 {
     using namespace testing;
@@ -18,6 +18,7 @@
 
 #include "mir/geometry/rectangle.h"
 #include "src/server/compositor/occlusion.h"
+#include "mir/compositor/frame_arena.h"
 #include "mir/test/doubles/fake_renderable.h"
 #include "mir/test/doubles/stub_scene_element.h"
 
@@ -60,6 +61,7 @@ struct OcclusionFilterTest : public Test
     }
 
     Rectangle monitor_rect;
+    FrameArena arena;
 };
 
 }
@@ -69,7 +71,7 @@ TEST_F(OcclusionFilterTest, single_window_not_occluded)
     auto window = std::make_shared<mtd::FakeRenderable>(12, 34, 56, 78);
     auto elements = scene_elements_from({window});
  
-    auto const& occlusions = filter_occlusions_from(elements, monitor_rect);
+    auto const& occlusions = filter_occlusions_from(elements, monitor_rect, arena);
 
     EXPECT_THAT(renderables_from(occlusions), IsEmpty());
     EXPECT_THAT(renderables_from(elements), ElementsAre(window));
@@ -83,7 +85,7 @@ TEST_F(OcclusionFilterTest, partially_offscreen_still_visible)
     auto bottom = std::make_shared<mtd::FakeRenderable>(200, 1000, 100, 1000);
     auto elements = scene_elements_from({left, right, top, bottom});
  
-    auto const& occlusions = filter_occlusions_from(elements, monitor_rect);
+    auto const& occlusions = filter_occlusions_from(elements, monitor_rect, arena);
 
     EXPECT_THAT(renderables_from(occlusions), IsEmpty());
     EXPECT_THAT(renderables_from(elements), ElementsAre(left, right, top, bottom));
@@ -95,7 +97,7 @@ TEST_F(OcclusionFilterTest, smaller_window_occluded)
     auto bottom = std::make_shared<mtd::FakeRenderable>(12, 12, 5, 5);
     auto elements = scene_elements_from({bottom, top});
 
-    auto const& occlusions = filter_occlusions_from(elements, monitor_rect);
+    auto const& occlusions = filter_occlusions_from(elements, monitor_rect, arena);
 
     EXPECT_THAT(renderables_from(occlusions), ElementsAre(bottom));
     EXPECT_THAT(renderables_from(elements), ElementsAre(top));
@@ -107,7 +109,7 @@ TEST_F(OcclusionFilterTest, translucent_window_occludes_nothing)
     auto bottom = std::make_shared<mtd::FakeRenderable>(Rectangle{{12, 12}, {5, 5}}, 1.0f);
     auto elements = scene_elements_from({bottom, top});
 
-    auto const& occlusions = filter_occlusions_from(elements, monitor_rect);
+    auto const& occlusions = filter_occlusions_from(elements, monitor_rect, arena);
 
     EXPECT_THAT(renderables_from(occlusions), IsEmpty());
     EXPECT_THAT(renderables_from(elements), ElementsAre(bottom, top));
@@ -119,19 +121,91 @@ TEST_F(OcclusionFilterTest, shaped_window_occludes_nothing)
     auto bottom = std::make_shared<mtd::FakeRenderable>(12, 12, 5, 5);
     auto elements = scene_elements_from({bottom, top});
 
-    auto const& occlusions = filter_occlusions_from(elements, monitor_rect);
+    auto const& occlusions = filter_occlusions_from(elements, monitor_rect, arena);
 
     EXPECT_THAT(renderables_from(occlusions), IsEmpty());
     EXPECT_THAT(renderables_from(elements), ElementsAre(bottom, top));
 }
 
+TEST_F(OcclusionFilterTest, opaque_region_of_shaped_window_occludes)
+{
+    auto top = std::make_shared<mtd::FakeRenderable>(Rectangle{{10, 10}, {20, 20}}, 1.0f, false);
+    top->set_opaque_region(Rectangles{{{12, 12}, {16, 16}}});
+    auto occluded = std::make_shared<mtd::FakeRenderable>(14, 14, 5, 5);
+    auto visible = std::make_shared<mtd::FakeRenderable>(10, 10, 5, 5);
+    auto elements = scene_elements_from({visible, occluded, top});
+
+    auto const& occlusions = filter_occlusions_from(elements, monitor_rect, arena);
+
+    EXPECT_THAT(renderables_from(occlusions), ElementsAre(occluded));
+    EXPECT_THAT(renderables_from(elements), ElementsAre(visible, top));
+}
+
+TEST_F(OcclusionFilterTest, opaque_region_of_translucent_window_occludes_nothing)
+{
+    auto top = std::make_shared<mtd::FakeRenderable>(Rectangle{{10, 10}, {20, 20}}, 0.5f, false);
+    top->set_opaque_region(Rectangles{{{10, 10}, {20, 20}}});
+    auto bottom = std::make_shared<mtd::FakeRenderable>(12, 12, 5, 5);
+    auto elements = scene_elements_from({bottom, top});
+
+    auto const& occlusions = filter_occlusions_from(elements, monitor_rect, arena);
+
+    EXPECT_THAT(renderables_from(occlusions), IsEmpty());
+    EXPECT_THAT(renderables_from(elements), ElementsAre(bottom, top));
+}
+
+TEST_F(OcclusionFilterTest, side_by_side_windows_occlude_window_beneath)
+{
+    auto left = std::make_shared<mtd::FakeRenderable>(0, 0, 100, 200);
+    auto right = std::make_shared<mtd::FakeRenderable>(100, 0, 100, 200);
+    auto bottom = std::make_shared<mtd::FakeRenderable>(50, 50, 100, 100);
+    auto elements = scene_elements_from({bottom, left, right});
+
+    auto const& occlusions = filter_occlusions_from(elements, monitor_rect, arena);
+
+    EXPECT_THAT(renderables_from(occlusions), ElementsAre(bottom));
+    EXPECT_THAT(renderables_from(elements), ElementsAre(left, right));
+}
+
+TEST_F(OcclusionFilterTest, partially_covered_window_is_clipped_to_visible_part)
+{
+    auto top = std::make_shared<mtd::FakeRenderable>(0, 0, 100, 200);
+    auto bottom = std::make_shared<mtd::FakeRenderable>(50, 50, 100, 100);
+    auto elements = scene_elements_from({bottom, top});
+
+    auto const& occlusions = filter_occlusions_from(elements, monitor_rect, arena);
+
+    EXPECT_THAT(renderables_from(occlusions), IsEmpty());
+    ASSERT_THAT(elements.size(), Eq(2u));
+    EXPECT_THAT(elements[1]->renderable(), Eq(top));
+
+    auto const clipped = elements[0]->renderable();
+    EXPECT_THAT(clipped->id(), Eq(bottom->id()));
+    EXPECT_THAT(clipped->screen_position(), Eq(bottom->screen_position()));
+    EXPECT_THAT(clipped->clip_area(), Eq(std::experimental::make_optional(Rectangle{{100, 50}, {50, 100}})));
+}
+
+TEST_F(OcclusionFilterTest, clipped_window_only_occludes_its_clip_area)
+{
+    auto top = std::make_shared<mtd::FakeRenderable>(0, 0, 200, 200);
+    top->set_clip_area({{0, 0}, {100, 200}});
+    auto occluded = std::make_shared<mtd::FakeRenderable>(10, 10, 50, 50);
+    auto visible = std::make_shared<mtd::FakeRenderable>(110, 10, 50, 50);
+    auto elements = scene_elements_from({visible, occluded, top});
+
+    auto const& occlusions = filter_occlusions_from(elements, monitor_rect, arena);
+
+    EXPECT_THAT(renderables_from(occlusions), ElementsAre(occluded));
+    EXPECT_THAT(renderables_from(elements), ElementsAre(visible, top));
+}
+
 TEST_F(OcclusionFilterTest, identical_window_occluded)
 {
     auto top = std::make_shared<mtd::FakeRenderable>(10, 10, 10, 10);
     auto bottom = std::make_shared<mtd::FakeRenderable>(10, 10, 10, 10);
     auto elements = scene_elements_from({bottom, top});
 
-    auto const& occlusions = filter_occlusions_from(elements, monitor_rect);
+    auto const& occlusions = filter_occlusions_from(elements, monitor_rect, arena);
 
     EXPECT_THAT(renderables_from(occlusions), ElementsAre(bottom));
     EXPECT_THAT(renderables_from(elements), ElementsAre(top));
@@ -143,7 +217,7 @@ TEST_F(OcclusionFilterTest, larger_window_never_occluded)
     auto bottom = std::make_shared<mtd::FakeRenderable>(9, 9, 12, 12);
     auto elements = scene_elements_from({bottom, top});
 
-    auto const& occlusions = filter_occlusions_from(elements, monitor_rect);
+    auto const& occlusions = filter_occlusions_from(elements, monitor_rect, arena);
 
     EXPECT_THAT(renderables_from(occlusions), IsEmpty());
     EXPECT_THAT(renderables_from(elements), ElementsAre(bottom, top));
@@ -158,7 +232,7 @@ TEST_F(OcclusionFilterTest, cascaded_windows_never_occluded)
 
     auto elements = scene_elements_from(renderables);
 
-    auto const& occlusions = filter_occlusions_from(elements, monitor_rect);
+    auto const& occlusions = filter_occlusions_from(elements, monitor_rect, arena);
 
     EXPECT_THAT(renderables_from(occlusions), IsEmpty());
     EXPECT_THAT(renderables_from(elements), ElementsAreArray(renderables));
@@ -181,7 +255,7 @@ TEST_F(OcclusionFilterTest, some_occluded_and_some_not)
         window0  //not occluded
     });
 
-    auto const& occlusions = filter_occlusions_from(elements, monitor_rect);
+    auto const& occlusions = filter_occlusions_from(elements, monitor_rect, arena);
 
     EXPECT_THAT(renderables_from(occlusions), ElementsAre(window3, window2, window1));
     EXPECT_THAT(renderables_from(elements), ElementsAre(window5, window4, window0));
@@ -197,7 +271,7 @@ TEST_F(OcclusionFilterTest,
         covering
     });
 
-    auto const& occlusions = filter_occlusions_from(elements, monitor_rect);
+    auto const& occlusions = filter_occlusions_from(elements, monitor_rect, arena);
 
     EXPECT_THAT(renderables_from(occlusions), ElementsAre(partially_onscreen));
     EXPECT_THAT(renderables_from(elements), ElementsAre(covering));
@@ -26,6 +26,9 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include "mir/test/gmock_fixes.h"
+
+#include <atomic>
+#include <thread>
 using namespace testing;
 namespace mf = mir::frontend;
 namespace mt = mir::test;
@@ -58,7 +61,7 @@ struct Stream : Test
 TEST_F(Stream, transitions_from_queuing_to_framedropping)
 {
     for(auto& buffer : buffers)
-        stream.submit_buffer(buffer);
+        stream.submit_buffer(buffer, {});
     stream.allow_framedropping(true);
 
     std::vector<std::shared_ptr<mg::Buffer>> cbuffers;
@@ -80,7 +83,7 @@ TEST_F(Stream, transitions_from_framedropping_to_queuing)
     stream.allow_framedropping(true);
 
     for(auto& buffer : buffers)
-        stream.submit_buffer(buffer);
+        stream.submit_buffer(buffer, {});
 
     // Only the last buffer should be owned by the stream...
     EXPECT_THAT(
@@ -89,7 +92,7 @@ TEST_F(Stream, transitions_from_framedropping_to_queuing)
 
     stream.allow_framedropping(false);
     for(auto& buffer : buffers)
-        stream.submit_buffer(buffer);
+        stream.submit_buffer(buffer, {});
 
     // All buffers should be now owned by the the stream
     EXPECT_THAT(
@@ -102,10 +105,41 @@ TEST_F(Stream, transitions_from_framedropping_to_queuing)
     EXPECT_THAT(cbuffers, SizeIs(buffers.size()));
 }
 
+TEST_F(Stream, releases_the_buffer_being_composited_after_transition_to_framedropping)
+{
+    stream.submit_buffer(buffers[0], {});
+    stream.lock_compositor_buffer(this);
+
+    stream.allow_framedropping(true);
+    stream.submit_buffer(buffers[1], {});
+
+    EXPECT_TRUE(buffers[0].unique());
+    EXPECT_THAT(stream.lock_compositor_buffer(this), Eq(buffers[1]));
+}
+
+TEST_F(Stream, gives_every_compositor_the_latest_buffer_when_dropping)
+{
+    int that{0};
+    stream.allow_framedropping(true);
+
+    stream.submit_buffer(buffers[0], {});
+    EXPECT_THAT(stream.lock_compositor_buffer(this), Eq(buffers[0]));
+
+    stream.submit_buffer(buffers[1], {});
+    stream.submit_buffer(buffers[2], {});
+
+    EXPECT_THAT(stream.buffers_ready_for_compositor(this), Eq(1));
+    EXPECT_THAT(stream.buffers_ready_for_compositor(&that), Eq(1));
+    EXPECT_THAT(stream.lock_compositor_buffer(&that), Eq(buffers[2]));
+    EXPECT_THAT(stream.lock_compositor_buffer(this), Eq(buffers[2]));
+    EXPECT_THAT(stream.buffers_ready_for_compositor(this), Eq(0));
+    EXPECT_THAT(stream.buffers_ready_for_compositor(&that), Eq(0));
+}
+
 TEST_F(Stream, indicates_buffers_ready_when_queueing)
 {
     for(auto& buffer : buffers)
-        stream.submit_buffer(buffer);
+        stream.submit_buffer(buffer, {});
 
     for(auto i = 0u; i < buffers.size(); i++)
     {
@@ -121,17 +155,40 @@ TEST_F(Stream, indicates_buffers_ready_when_dropping)
     stream.allow_framedropping(true);
 
     for(auto& buffer : buffers)
-        stream.submit_buffer(buffer);
+        stream.submit_buffer(buffer, {});
 
     EXPECT_THAT(stream.buffers_ready_for_compositor(this), Eq(1));
     stream.lock_compositor_buffer(this);
     EXPECT_THAT(stream.buffers_ready_for_compositor(this), Eq(0));
 }
 
+TEST_F(Stream, compositors_always_get_a_buffer_while_framedropping_is_toggled)
+{
+    stream.submit_buffer(buffers[0], {});
+
+    std::atomic<bool> done{false};
+    std::thread toggler{
+        [&]
+        {
+            for (auto dropping = true; !done; dropping = !dropping)
+                stream.allow_framedropping(dropping);
+        }};
+
+    for (auto i = 0; i != 10000; ++i)
+    {
+        stream.buffers_ready_for_compositor(this);
+        EXPECT_NO_THROW(
+            EXPECT_THAT(stream.lock_compositor_buffer(this), Eq(buffers[0])));
+    }
+
+    done = true;
+    toggler.join();
+}
+
 TEST_F(Stream, tracks_has_buffer)
 {
     EXPECT_FALSE(stream.has_submitted_buffer());
-    stream.submit_buffer(buffers[0]);
+    stream.submit_buffer(buffers[0], {});
     EXPECT_TRUE(stream.has_submitted_buffer());
 }
 
@@ -139,9 +196,9 @@ TEST_F(Stream, calls_frame_callback_after_scheduling_on_submissions)
 {
     int frame_count{0};
     stream.set_frame_posted_callback([&frame_count](auto) { ++frame_count;});
-    stream.submit_buffer(buffers[0]);
+    stream.submit_buffer(buffers[0], {});
     stream.set_frame_posted_callback([](auto) {});
-    stream.submit_buffer(buffers[0]);
+    stream.submit_buffer(buffers[0], {});
     EXPECT_THAT(frame_count, Eq(1));
 }
 
@@ -153,13 +210,13 @@ TEST_F(Stream, frame_callback_is_called_without_scheduling_lock)
             EXPECT_THAT(stream.buffers_ready_for_compositor(this), Eq(1));
             EXPECT_TRUE(stream.has_submitted_buffer());
         });
-    stream.submit_buffer(buffers[0]);
+    stream.submit_buffer(buffers[0], {});
 }
 
 TEST_F(Stream, flattens_queue_out_when_told_to_drop)
 {
     for(auto& buffer : buffers)
-        stream.submit_buffer(buffer);
+        stream.submit_buffer(buffer, {});
 
     EXPECT_THAT(stream.buffers_ready_for_compositor(this), Eq(1));
     stream.drop_old_buffers();
@@ -170,9 +227,9 @@ TEST_F(Stream, flattens_queue_out_when_told_to_drop)
 TEST_F(Stream, forces_a_new_buffer_when_told_to_drop_buffers)
 {
     int that{0};
-    stream.submit_buffer(buffers[0]);
-    stream.submit_buffer(buffers[1]);
-    stream.submit_buffer(buffers[2]);
+    stream.submit_buffer(buffers[0], {});
+    stream.submit_buffer(buffers[1], {});
+    stream.submit_buffer(buffers[2], {});
 
     auto a = stream.lock_compositor_buffer(this);
     stream.drop_old_buffers();
@@ -187,7 +244,7 @@ TEST_F(Stream, throws_on_nullptr_submissions)
 {
     stream.set_frame_posted_callback([](auto) { FAIL() << "frame-posted should not be called on null buffer"; });
     EXPECT_THROW({
-        stream.submit_buffer(nullptr);
+        stream.submit_buffer(nullptr, {});
     }, std::invalid_argument);
     EXPECT_FALSE(stream.has_submitted_buffer());
 }
@@ -199,7 +256,7 @@ TEST_F(Stream, reports_size)
     geom::Size new_size{333,139};
     auto new_size_buffer = std::make_shared<mtd::StubBuffer>(new_size);
     EXPECT_THAT(stream.stream_size(), Eq(initial_size));
-    stream.submit_buffer(new_size_buffer);
+    stream.submit_buffer(new_size_buffer, {});
     EXPECT_THAT(stream.stream_size(), Eq(new_size));
 }
 
@@ -211,9 +268,9 @@ TEST_F(Stream, reports_format)
 
 TEST_F(Stream, returns_buffers_to_client_when_told_to_bring_queue_up_to_date)
 {
-    stream.submit_buffer(buffers[0]);
-    stream.submit_buffer(buffers[1]);
-    stream.submit_buffer(buffers[2]);
+    stream.submit_buffer(buffers[0], {});
+    stream.submit_buffer(buffers[1], {});
+    stream.submit_buffer(buffers[2], {});
 
     // Buffers should be owned by the stream, and our test
     ASSERT_THAT(buffers[0].use_count(), Eq(2));
@@ -230,7 +287,7 @@ TEST_F(Stream, returns_buffers_to_client_when_told_to_bring_queue_up_to_date)
 
 TEST_F(Stream, stream_size_scaled)
 {
-    stream.submit_buffer(buffers[0]);
+    stream.submit_buffer(buffers[0], {});
     stream.set_scale(2.0f);
     ASSERT_THAT(stream.stream_size(), Eq(initial_size / 2));
 }
@@ -238,6 +295,51 @@ TEST_F(Stream, stream_size_scaled)
 TEST_F(Stream, stream_remembers_scale_when_buffer_added)
 {
     stream.set_scale(2.0f);
-    stream.submit_buffer(buffers[0]);
+    stream.submit_buffer(buffers[0], {});
     ASSERT_THAT(stream.stream_size(), Eq(initial_size / 2));
 }
+
+TEST_F(Stream, damage_between_buffers_is_the_union_of_submitted_damage)
+{
+    geom::Rectangle const first{{0, 0}, {4, 1}};
+    geom::Rectangle const second{{10, 1}, {2, 1}};
+
+    stream.submit_buffer(buffers[0], {});
+    stream.submit_buffer(buffers[1], geom::Rectangles{first});
+    stream.submit_buffer(buffers[2], geom::Rectangles{second});
+
+    EXPECT_THAT(stream.damage_between(buffers[0]->id(), buffers[2]->id()),
+        Eq(std::experimental::make_optional(geom::Rectangles{first, second})));
+    EXPECT_THAT(stream.damage_between(buffers[1]->id(), buffers[2]->id()),
+        Eq(std::experimental::make_optional(geom::Rectangles{second})));
+}
+
+TEST_F(Stream, submitted_damage_is_clipped_to_the_buffer)
+{
+    stream.submit_buffer(buffers[0], {});
+    stream.submit_buffer(buffers[1], geom::Rectangles{{{40, 0}, {100, 100}}});
+
+    EXPECT_THAT(stream.damage_between(buffers[0]->id(), buffers[1]->id()),
+        Eq(std::experimental::make_optional(geom::Rectangles{{{40, 0}, {4, 2}}})));
+}
+
+TEST_F(Stream, first_buffer_and_resized_buffers_are_fully_damaged)
+{
+    geom::Size const new_size{100, 50};
+    auto const resized = std::make_shared<mtd::StubBuffer>(new_size);
+
+    stream.submit_buffer(buffers[0], {});
+    stream.submit_buffer(buffers[1], {});
+    stream.submit_buffer(resized, geom::Rectangles{{{0, 0}, {1, 1}}});
+
+    EXPECT_THAT(stream.damage_between(buffers[1]->id(), resized->id()),
+        Eq(std::experimental::make_optional(geom::Rectangles{{{}, new_size}})));
+}
+
+TEST_F(Stream, damage_from_unknown_buffer_is_unknown)
+{
+    mtd::StubBuffer never_submitted;
+    stream.submit_buffer(buffers[0], {});
+
+    EXPECT_FALSE(stream.damage_between(never_submitted.id(), buffers[0]->id()));
+}
@@ -490,3 +490,115 @@ TEST(MultiplexingDispatchableTest, automatic_removals_are_threadsafe)
     
     dispatchee->trigger();
 }
+
+TEST(MultiplexingDispatchableTest, batched_dispatch_handles_every_ready_dispatchee)
+{
+    using namespace testing;
+
+    int const dispatchee_count{5};
+    int dispatch_count{0};
+
+    md::MultiplexingDispatchable dispatcher(dispatchee_count);
+    std::vector<std::shared_ptr<mt::TestDispatchable>> dispatchees;
+    for (int i = 0; i < dispatchee_count; ++i)
+    {
+        dispatchees.push_back(std::make_shared<mt::TestDispatchable>([&dispatch_count]() { ++dispatch_count; }));
+        dispatcher.add_watch(dispatchees.back());
+        dispatchees.back()->trigger();
+    }
+
+    ASSERT_TRUE(mt::fd_is_readable(dispatcher.watch_fd()));
+    dispatcher.dispatch(md::FdEvent::readable);
+
+    EXPECT_THAT(dispatch_count, Eq(dispatchee_count));
+    EXPECT_FALSE(mt::fd_is_readable(dispatcher.watch_fd()));
+}
+
+TEST(MultiplexingDispatchableTest, batched_dispatch_handles_no_more_than_its_limit)
+{
+    using namespace testing;
+
+    int dispatch_count{0};
+
+    md::MultiplexingDispatchable dispatcher(2);
+    std::vector<std::shared_ptr<mt::TestDispatchable>> dispatchees;
+    for (int i = 0; i < 3; ++i)
+    {
+        dispatchees.push_back(std::make_shared<mt::TestDispatchable>([&dispatch_count]() { ++dispatch_count; }));
+        dispatcher.add_watch(dispatchees.back());
+        dispatchees.back()->trigger();
+    }
+
+    dispatcher.dispatch(md::FdEvent::readable);
+    EXPECT_THAT(dispatch_count, Eq(2));
+
+    ASSERT_TRUE(mt::fd_is_readable(dispatcher.watch_fd()));
+    dispatcher.dispatch(md::FdEvent::readable);
+    EXPECT_THAT(dispatch_count, Eq(3));
+}
+
+TEST(MultiplexingDispatchableTest, batched_dispatch_skips_dispatchee_removed_earlier_in_the_batch)
+{
+    using namespace testing;
+
+    md::MultiplexingDispatchable dispatcher(2);
+
+    int dispatch_count{0};
+    std::shared_ptr<mt::TestDispatchable> first, second;
+    // Whichever is dispatched first removes the other
+    first = std::make_shared<mt::TestDispatchable>(
+        [&]() { ++dispatch_count; dispatcher.remove_watch(second); });
+    second = std::make_shared<mt::TestDispatchable>(
+        [&]() { ++dispatch_count; dispatcher.remove_watch(first); });
+
+    dispatcher.add_watch(first);
+    dispatcher.add_watch(second);
+    first->trigger();
+    second->trigger();
+
+    dispatcher.dispatch(md::FdEvent::readable);
+
+    EXPECT_THAT(dispatch_count, Eq(1));
+    EXPECT_FALSE(mt::fd_is_readable(dispatcher.watch_fd()));
+}
+
+TEST(MultiplexingDispatchableTest, batched_dispatch_rearms_remaining_dispatchees_when_one_throws)
+{
+    using namespace testing;
+
+    md::MultiplexingDispatchable dispatcher(2);
+
+    int dispatch_count{0};
+    bool thrown{false};
+    auto const throw_once = [&]()
+        {
+            if (!thrown)
+            {
+                thrown = true;
+                throw std::runtime_error{"dispatch failed"};
+            }
+            ++dispatch_count;
+        };
+    auto const first = std::make_shared<mt::TestDispatchable>(throw_once);
+    auto const second = std::make_shared<mt::TestDispatchable>(throw_once);
+
+    dispatcher.add_watch(first);
+    dispatcher.add_watch(second);
+    first->trigger();
+    second->trigger();
+
+    EXPECT_THROW(dispatcher.dispatch(md::FdEvent::readable), std::runtime_error);
+
+    ASSERT_TRUE(mt::fd_is_readable(dispatcher.watch_fd()));
+    dispatcher.dispatch(md::FdEvent::readable);
+
+    EXPECT_THAT(dispatch_count, Eq(1));
+}
+
+TEST(MultiplexingDispatchableTest, rejects_invalid_batch_sizes)
+{
+    EXPECT_THROW(md::MultiplexingDispatchable(0), std::invalid_argument);
+    EXPECT_THROW(
+        md::MultiplexingDispatchable(md::MultiplexingDispatchable::max_batch_size + 1),
+        std::invalid_argument);
+}
@@ -0,0 +1,150 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mir/geometry/region.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+using namespace mir::geometry;
+using namespace testing;
+
+namespace
+{
+auto contents_of(Region const& region) -> std::vector<Rectangle>
+{
+    auto const rects = region.rectangles();
+    return {std::begin(rects), std::end(rects)};
+}
+}
+
+TEST(Region, default_is_empty)
+{
+    Region const region;
+
+    EXPECT_TRUE(region.empty());
+    EXPECT_THAT(contents_of(region), IsEmpty());
+    EXPECT_THAT(region.bounding_rectangle(), Eq(Rectangle{}));
+}
+
+TEST(Region, empty_rectangle_gives_empty_region)
+{
+    EXPECT_TRUE(Region{Rectangle({10, 10}, {0, 5})}.empty());
+    EXPECT_TRUE(Region{Rectangle({10, 10}, {5, 0})}.empty());
+}
+
+TEST(Region, overlapping_rectangles_are_split_into_bands)
+{
+    Region region{Rectangle{{0, 0}, {10, 10}}};
+    region.add(Rectangle{{5, 5}, {10, 10}});
+
+    EXPECT_THAT(contents_of(region), ElementsAre(
+        Rectangle{{0, 0}, {10, 5}},
+        Rectangle{{0, 5}, {15, 5}},
+        Rectangle{{5, 10}, {10, 5}}));
+    EXPECT_THAT(region.bounding_rectangle(), Eq(Rectangle{{0, 0}, {15, 15}}));
+}
+
+TEST(Region, adjacent_rectangles_are_merged)
+{
+    Region region{Rectangle{{0, 0}, {10, 10}}};
+    region.add(Rectangle{{10, 0}, {10, 10}});
+    region.add(Rectangle{{0, 10}, {20, 10}});
+
+    EXPECT_THAT(region, Eq(Region{Rectangle{{0, 0}, {20, 20}}}));
+    EXPECT_THAT(contents_of(region), ElementsAre(Rectangle{{0, 0}, {20, 20}}));
+}
+
+TEST(Region, subtracting_a_hole_leaves_a_frame)
+{
+    Region region{Rectangle{{0, 0}, {30, 30}}};
+    region.subtract(Rectangle{{10, 10}, {10, 10}});
+
+    EXPECT_THAT(contents_of(region), ElementsAre(
+        Rectangle{{0, 0}, {30, 10}},
+        Rectangle{{0, 10}, {10, 10}},
+        Rectangle{{20, 10}, {10, 10}},
+        Rectangle{{0, 20}, {30, 10}}));
+    EXPECT_FALSE(region.contains(Point{15, 15}));
+    EXPECT_TRUE(region.contains(Point{5, 15}));
+}
+
+TEST(Region, subtracting_everything_leaves_nothing)
+{
+    Region region{Rectangle{{10, 10}, {30, 30}}};
+    region.subtract(Rectangle{{0, 0}, {20, 50}});
+    region.subtract(Rectangle{{20, 0}, {30, 50}});
+
+    EXPECT_TRUE(region.empty());
+}
+
+TEST(Region, intersection_is_the_common_part)
+{
+    Region region{Rectangles{{{0, 0}, {10, 10}}, {{20, 0}, {10, 10}}}};
+    region.intersect(Rectangle{{5, 5}, {20, 20}});
+
+    EXPECT_THAT(contents_of(region), ElementsAre(
+        Rectangle{{5, 5}, {5, 5}},
+        Rectangle{{20, 5}, {5, 5}}));
+}
+
+TEST(Region, side_by_side_rectangles_contain_rectangle_spanning_both)
+{
+    Region region{Rectangle{{0, 0}, {10, 10}}};
+    region.add(Rectangle{{10, 0}, {10, 10}});
+
+    EXPECT_TRUE(region.contains(Rectangle{{5, 2}, {10, 6}}));
+}
+
+TEST(Region, stacked_rectangles_contain_rectangle_spanning_both)
+{
+    Region region{Rectangle{{0, 0}, {10, 10}}};
+    region.add(Rectangle{{0, 10}, {20, 10}});
+
+    EXPECT_TRUE(region.contains(Rectangle{{2, 5}, {6, 10}}));
+    EXPECT_FALSE(region.contains(Rectangle{{5, 5}, {10, 10}}));
+}
+
+TEST(Region, does_not_contain_rectangle_crossing_a_gap)
+{
+    Region region{Rectangle{{0, 0}, {10, 10}}};
+    region.add(Rectangle{{11, 0}, {10, 10}});
+    region.add(Rectangle{{0, 11}, {10, 10}});
+
+    EXPECT_FALSE(region.contains(Rectangle{{5, 2}, {10, 6}}));
+    EXPECT_FALSE(region.contains(Rectangle{{2, 5}, {6, 10}}));
+    EXPECT_TRUE(region.contains(Rectangle{{2, 2}, {6, 6}}));
+}
+
+TEST(Region, contains_every_empty_rectangle)
+{
+    Region const region;
+
+    EXPECT_TRUE(region.contains(Rectangle{{2, 2}, {0, 0}}));
+}
+
+TEST(Region, equal_regions_compare_equal_whatever_their_construction)
+{
+    Region a{Rectangle{{0, 0}, {10, 20}}};
+    a.add(Rectangle{{10, 0}, {10, 20}});
+
+    Region b{Rectangle{{0, 0}, {20, 10}}};
+    b.add(Rectangle{{0, 10}, {20, 10}});
+
+    EXPECT_THAT(a, Eq(b));
+    b.subtract(Rectangle{{0, 0}, {1, 1}});
+    EXPECT_THAT(a, Ne(b));
+}
@@ -147,3 +147,16 @@ TEST_F(Tessellation, tex_coords_0_or_1_when_transformed)
     mgl::Primitive const primitive = mgl::tessellate_renderable_into_rectangle(renderable, {x, y});
     expect_tex_coords_1_or_0(primitive);
 }
+
+TEST_F(Tessellation, area_has_correct_bounding_box_and_tex_coords)
+{
+    geom::Rectangle const area{{9, 11}, {5, 10}};
+    mgl::Primitive const primitive = mgl::tessellate_renderable_into_rectangle(renderable, {}, area);
+
+    EXPECT_THAT(bounding_box(primitive), Eq(BoundingBox::from(area)));
+    for (int i = 0; i < primitive.nvertices; i++)
+    {
+        EXPECT_THAT(primitive.vertices[i].texcoord[0], AnyOf(Eq(0.5f), Eq(1.0f)));
+        EXPECT_THAT(primitive.vertices[i].texcoord[1], AnyOf(Eq(0.25f), Eq(0.75f)));
+    }
+}
@@ -0,0 +1,356 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "src/platforms/common/server/linux_dmabuf.h"
+
+#include "mir/graphics/egl_extensions.h"
+#include "mir/anonymous_shm_file.h"
+
+#include "mir/test/doubles/mock_egl.h"
+#include "mir/test/doubles/mock_gl.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <wayland-server-core.h>
+#include <drm_fourcc.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <vector>
+
+namespace mg = mir::graphics;
+namespace mgc = mir::graphics::common;
+namespace mw = mir::wayland;
+namespace mtd = mir::test::doubles;
+
+using namespace testing;
+
+namespace
+{
+uint32_t const display_id{1};
+uint32_t const registry_id{2};
+uint32_t const dmabuf_id{3};
+uint32_t const params_id{4};
+uint32_t const buffer_id{5};
+
+// The formats the fake EGL display imports, neither of which has modifiers listed
+std::vector<EGLint> const egl_formats{DRM_FORMAT_XRGB8888, DRM_FORMAT_NV12};
+
+EGLBoolean query_dma_buf_formats(EGLDisplay, EGLint max_formats, EGLint* formats, EGLint* num_formats)
+{
+    *num_formats = std::min<EGLint>(max_formats ? max_formats : egl_formats.size(), egl_formats.size());
+    if (formats)
+        std::copy_n(egl_formats.begin(), *num_formats, formats);
+    return EGL_TRUE;
+}
+
+EGLBoolean query_dma_buf_modifiers(EGLDisplay, EGLint, EGLint, EGLuint64KHR*, EGLBoolean*, EGLint* num_modifiers)
+{
+    *num_modifiers = 0;
+    return EGL_TRUE;
+}
+
+struct Event
+{
+    uint32_t object;
+    uint32_t opcode;
+    std::vector<uint32_t> args;
+};
+
+struct Request
+{
+    static uint32_t const get_registry = 1;     // wl_display
+    static uint32_t const bind = 0;             // wl_registry
+    static uint32_t const create_params = 1;    // zwp_linux_dmabuf_v1
+    static uint32_t const add = 1;              // zwp_linux_buffer_params_v1
+    static uint32_t const create = 2;
+    static uint32_t const create_immed = 3;
+};
+
+/// A client of zwp_linux_dmabuf_v1 with one zwp_linux_buffer_params_v1, talking the wire protocol
+struct LinuxDmaBuf : Test
+{
+    LinuxDmaBuf()
+        : display{wl_display_create()}
+    {
+        typedef mtd::MockEGL::generic_function_pointer_t func_ptr_t;
+        ON_CALL(mock_egl, eglQueryString(_, EGL_EXTENSIONS))
+            .WillByDefault(Return("EGL_EXT_image_dma_buf_import EGL_EXT_image_dma_buf_import_modifiers"));
+        ON_CALL(mock_egl, eglGetProcAddress(StrEq("eglQueryDmaBufFormatsEXT")))
+            .WillByDefault(Return(reinterpret_cast<func_ptr_t>(&query_dma_buf_formats)));
+        ON_CALL(mock_egl, eglGetProcAddress(StrEq("eglQueryDmaBufModifiersEXT")))
+            .WillByDefault(Return(reinterpret_cast<func_ptr_t>(&query_dma_buf_modifiers)));
+
+        dmabuf = std::make_unique<mgc::LinuxDmaBufUnstable>(
+            display,
+            dpy,
+            std::make_shared<mg::EGLExtensions>(),
+            mgc::LinuxDmaBufUnstable::ScanoutImporter{});
+
+        socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds);
+        client = wl_client_create(display, fds[0]);
+        client_destroyed.notify = [](wl_listener* listener, void*)
+            {
+                LinuxDmaBuf* self;
+                self = wl_container_of(listener, self, client_destroyed);
+                self->client = nullptr;
+            };
+        wl_client_add_destroy_listener(client, &client_destroyed);
+
+        // Our global is the only one, so it's the first name
+        request(display_id, Request::get_registry, {registry_id});
+        std::vector<uint32_t> bind_args{1};
+        append_string(bind_args, mw::LinuxDmabufV1::interface_name);
+        bind_args.insert(bind_args.end(), {3, dmabuf_id});
+        request(registry_id, Request::bind, bind_args);
+        request(dmabuf_id, Request::create_params, {params_id});
+    }
+
+    ~LinuxDmaBuf()
+    {
+        // Clients are disconnected once they've been sent a protocol error
+        if (client)
+            wl_client_destroy(client);
+        close(fds[1]);
+        dmabuf.reset();
+        wl_display_destroy(display);
+    }
+
+    static void append_string(std::vector<uint32_t>& args, char const* string)
+    {
+        auto const length = strlen(string) + 1;
+        args.push_back(length);
+        std::vector<uint32_t> words((length + 3) / 4, 0);
+        memcpy(words.data(), string, length);
+        args.insert(args.end(), words.begin(), words.end());
+    }
+
+    void request(uint32_t object, uint32_t opcode, std::vector<uint32_t> const& args, int fd = -1)
+    {
+        std::vector<uint32_t> message{object, static_cast<uint32_t>((2 + args.size()) * sizeof(uint32_t)) << 16 | opcode};
+        message.insert(message.end(), args.begin(), args.end());
+
+        iovec iov{message.data(), message.size() * sizeof(uint32_t)};
+        char control[CMSG_SPACE(sizeof(int))] = {};
+        msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        if (fd != -1)
+        {
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+            auto const cmsg = CMSG_FIRSTHDR(&msg);
+            cmsg->cmsg_level = SOL_SOCKET;
+            cmsg->cmsg_type = SCM_RIGHTS;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+            memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+        }
+
+        ASSERT_THAT(sendmsg(fds[1], &msg, 0), Eq(static_cast<ssize_t>(iov.iov_len)));
+        wl_event_loop_dispatch(wl_display_get_event_loop(display), 0);
+    }
+
+    void add(uint32_t plane_idx, uint32_t offset, uint32_t stride, uint64_t modifier = DRM_FORMAT_MOD_INVALID)
+    {
+        request(
+            params_id,
+            Request::add,
+            {plane_idx, offset, stride, static_cast<uint32_t>(modifier >> 32), static_cast<uint32_t>(modifier)},
+            dma_buf.fd());
+    }
+
+    void create(int32_t width, int32_t height, uint32_t format = DRM_FORMAT_XRGB8888)
+    {
+        request(
+            params_id,
+            Request::create,
+            {static_cast<uint32_t>(width), static_cast<uint32_t>(height), format, 0});
+    }
+
+    void create_immed(int32_t width, int32_t height, uint32_t format = DRM_FORMAT_XRGB8888)
+    {
+        request(
+            params_id,
+            Request::create_immed,
+            {buffer_id, static_cast<uint32_t>(width), static_cast<uint32_t>(height), format, 0});
+    }
+
+    /// Everything the client has been sent since last asked
+    auto events() -> std::vector<Event>
+    {
+        wl_display_flush_clients(display);
+
+        std::vector<uint32_t> words;
+        uint32_t buffer[1024];
+        ssize_t bytes;
+        while ((bytes = recv(fds[1], buffer, sizeof(buffer), MSG_DONTWAIT)) > 0)
+            words.insert(words.end(), buffer, buffer + bytes / sizeof(uint32_t));
+
+        std::vector<Event> result;
+        for (auto word = words.begin(); word + 1 < words.end();)
+        {
+            auto const size = (word[1] >> 16) / sizeof(uint32_t);
+            result.push_back({word[0], word[1] & 0xffff, {word + 2, word + size}});
+            word += size;
+        }
+        return result;
+    }
+
+    /// The code of the protocol error the client has been sent, or -1 if none
+    auto protocol_error() -> int64_t
+    {
+        for (auto const& event : events())
+        {
+            if (event.object == display_id && event.opcode == 0)
+                return event.args[1];
+        }
+        return -1;
+    }
+
+    NiceMock<mtd::MockEGL> mock_egl;
+    NiceMock<mtd::MockGL> mock_gl;
+    EGLDisplay const dpy{reinterpret_cast<void*>(0xdeebbeed)};
+    wl_display* const display;
+    std::unique_ptr<mgc::LinuxDmaBufUnstable> dmabuf;
+    int fds[2];
+    wl_client* client;
+    wl_listener client_destroyed;
+
+    // Big enough for one 64x64 plane of 32 bit pixels
+    mir::AnonymousShmFile const dma_buf{64 * 64 * 4};
+};
+
+MATCHER_P2(IsEvent, object, opcode, "")
+{
+    return arg.object == static_cast<uint32_t>(object) && arg.opcode == static_cast<uint32_t>(opcode);
+}
+
+MATCHER_P2(IsModifierEventFor, format, modifier, "")
+{
+    return arg.object == dmabuf_id &&
+        arg.opcode == mw::LinuxDmabufV1::Opcode::modifier &&
+        arg.args[0] == static_cast<uint32_t>(format) &&
+        arg.args[1] == static_cast<uint32_t>(static_cast<uint64_t>(modifier) >> 32) &&
+        arg.args[2] == static_cast<uint32_t>(modifier);
+}
+}
+
+TEST_F(LinuxDmaBuf, offers_rgb_formats_without_modifiers_but_not_yuv_ones)
+{
+    auto const offered = events();
+
+    EXPECT_THAT(offered, Contains(IsModifierEventFor(DRM_FORMAT_XRGB8888, DRM_FORMAT_MOD_INVALID)));
+    EXPECT_THAT(offered, Not(Contains(
+        Field(&Event::args, ElementsAre(static_cast<uint32_t>(DRM_FORMAT_NV12), _, _)))));
+}
+
+TEST_F(LinuxDmaBuf, creates_a_buffer_from_a_complete_set_of_planes)
+{
+    add(0, 0, 64 * 4);
+    events();
+
+    create(64, 64);
+
+    EXPECT_THAT(events(), ElementsAre(IsEvent(params_id, mw::LinuxBufferParamsV1::Opcode::created)));
+}
+
+TEST_F(LinuxDmaBuf, plane_index_out_of_range_is_an_error)
+{
+    add(4, 0, 64 * 4);
+
+    EXPECT_THAT(protocol_error(), Eq(mw::LinuxBufferParamsV1::Error::plane_idx));
+}
+
+TEST_F(LinuxDmaBuf, setting_a_plane_twice_is_an_error)
+{
+    add(0, 0, 64 * 4);
+    add(0, 0, 64 * 4);
+
+    EXPECT_THAT(protocol_error(), Eq(mw::LinuxBufferParamsV1::Error::plane_set));
+}
+
+TEST_F(LinuxDmaBuf, planes_with_different_modifiers_are_an_error)
+{
+    add(0, 0, 64 * 4, DRM_FORMAT_MOD_LINEAR);
+    add(1, 0, 64 * 4, I915_FORMAT_MOD_X_TILED);
+
+    EXPECT_THAT(protocol_error(), Eq(mw::LinuxBufferParamsV1::Error::invalid_format));
+}
+
+TEST_F(LinuxDmaBuf, creating_without_planes_is_an_error)
+{
+    create(64, 64);
+
+    EXPECT_THAT(protocol_error(), Eq(mw::LinuxBufferParamsV1::Error::incomplete));
+}
+
+TEST_F(LinuxDmaBuf, creating_with_a_gap_in_the_planes_is_an_error)
+{
+    add(0, 0, 64 * 4);
+    add(2, 0, 64 * 4);
+    create(64, 64);
+
+    EXPECT_THAT(protocol_error(), Eq(mw::LinuxBufferParamsV1::Error::incomplete));
+}
+
+TEST_F(LinuxDmaBuf, creating_with_an_unsupported_format_is_an_error)
+{
+    add(0, 0, 64 * 4);
+    create(64, 64, DRM_FORMAT_NV12);
+
+    EXPECT_THAT(protocol_error(), Eq(mw::LinuxBufferParamsV1::Error::invalid_format));
+}
+
+TEST_F(LinuxDmaBuf, offset_past_the_end_of_the_dma_buf_is_an_error)
+{
+    add(0, 64 * 4, 64 * 4);
+    create(64, 64);
+
+    EXPECT_THAT(protocol_error(), Eq(mw::LinuxBufferParamsV1::Error::out_of_bounds));
+}
+
+TEST_F(LinuxDmaBuf, stride_past_the_end_of_the_dma_buf_is_an_error)
+{
+    add(0, 0, 64 * 4 + 1);
+    create(64, 64);
+
+    EXPECT_THAT(protocol_error(), Eq(mw::LinuxBufferParamsV1::Error::out_of_bounds));
+}
+
+TEST_F(LinuxDmaBuf, create_sends_failed_if_the_import_fails)
+{
+    ON_CALL(mock_egl, eglCreateImageKHR(_, _, _, _, _)).WillByDefault(Return(EGL_NO_IMAGE_KHR));
+    add(0, 0, 64 * 4);
+    events();
+
+    create(64, 64);
+
+    EXPECT_THAT(events(), ElementsAre(IsEvent(params_id, mw::LinuxBufferParamsV1::Opcode::failed)));
+}
+
+TEST_F(LinuxDmaBuf, create_immed_is_an_error_if_the_import_fails)
+{
+    ON_CALL(mock_egl, eglCreateImageKHR(_, _, _, _, _)).WillByDefault(Return(EGL_NO_IMAGE_KHR));
+    add(0, 0, 64 * 4);
+
+    create_immed(64, 64);
+
+    EXPECT_THAT(protocol_error(), Eq(mw::LinuxBufferParamsV1::Error::invalid_wl_buffer));
+}
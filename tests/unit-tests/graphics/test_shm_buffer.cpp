@@ -17,11 +17,15 @@
  */
 
 #include "src/platforms/common/server/shm_buffer.h"
+#include "src/platforms/common/server/buffer_from_wl_shm.h"
 #include "src/platforms/common/server/egl_context_executor.h"
 #include "mir/renderer/gl/context.h"
+#include "mir/graphics/texture.h"
+#include "mir/anonymous_shm_file.h"
 
 #include "mir/test/doubles/mock_gl.h"
 #include "mir/test/doubles/mock_egl.h"
+#include "mir/test/doubles/explicit_executor.h"
 
 #include "check_gtest_version.h"
 
@@ -31,6 +35,13 @@
 #include <EGL/egl.h>
 #include <endian.h>
 #include <boost/throw_exception.hpp>
+#include <wayland-server-core.h>
+#include <wayland-server-protocol.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cstring>
+#include <future>
+#include <vector>
 
 namespace mg = mir::graphics;
 namespace mgc = mir::graphics::common;
@@ -92,6 +103,11 @@ struct PlatformlessShmBuffer : mgc::MemoryBackedShmBuffer
     {
         return nullptr;
     }
+
+    void upload_damage(geom::Rectangles const& damage)
+    {
+        upload_damage_to_texture(pixel_buffer(), stride(), damage);
+    }
 };
 
 struct ShmBufferTest : public testing::Test
@@ -145,6 +161,31 @@ TEST_F(ShmBufferTest, cant_upload_bgr_888)
     buf.bind();
 }
 
+TEST_F(ShmBufferTest, uploads_only_damaged_areas)
+{
+    PlatformlessShmBuffer buf(size, mir_pixel_format_abgr_8888, egl_delegate);
+    auto const stride = buf.stride().as_int();
+    auto const bytes_per_pixel = MIR_BYTES_PER_PIXEL(mir_pixel_format_abgr_8888);
+
+    EXPECT_CALL(mock_gl, glTexImage2D(_, _, _, _, _, _, _, _, _)).Times(0);
+    // The unpack state is also set up and restored around the upload
+    EXPECT_CALL(mock_gl, glPixelStorei(_, _)).Times(AnyNumber());
+    EXPECT_CALL(mock_gl, glPixelStorei(GL_UNPACK_ROW_LENGTH_EXT, size.width.as_int()));
+    EXPECT_CALL(mock_gl, glTexSubImage2D(
+        GL_TEXTURE_2D, 0,
+        10, 20, 30, 40,
+        GL_RGBA, GL_UNSIGNED_BYTE,
+        buf.pixel_buffer() + 20 * stride + 10 * bytes_per_pixel));
+    // Damage is clipped to the buffer
+    EXPECT_CALL(mock_gl, glTexSubImage2D(
+        GL_TEXTURE_2D, 0,
+        140, 0, 10, 5,
+        GL_RGBA, GL_UNSIGNED_BYTE,
+        buf.pixel_buffer() + 140 * bytes_per_pixel));
+
+    buf.upload_damage(geom::Rectangles{{{10, 20}, {30, 40}}, {{140, -5}, {100, 10}}});
+}
+
 struct BufferUploadDesc
 {
     geom::Size size;
@@ -362,3 +403,199 @@ TEST_F(ShmBufferTest, texture_is_destroyed_on_thread_with_current_context)
         eglMakeCurrent(dummy_dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
     }
 }
+
+TEST_F(ShmBufferTest, egl_delegate_runs_work_spawned_by_its_work)
+{
+    auto const done_promise = std::make_shared<std::promise<void>>();
+    auto const done = done_promise->get_future();
+
+    egl_delegate->spawn(
+        [delegate = egl_delegate.get(), done_promise]()
+        {
+            delegate->spawn([done_promise]() { done_promise->set_value(); });
+        });
+
+    EXPECT_THAT(done.wait_for(std::chrono::seconds{10}), Eq(std::future_status::ready));
+}
+
+namespace
+{
+/// A surface's SHM buffers, committed by a client with wl_shm
+struct WlShmBufferTest : ShmBufferTest
+{
+    WlShmBufferTest()
+        : display{wl_display_create()}
+    {
+        ON_CALL(mock_egl, eglQueryString(_, EGL_EXTENSIONS))
+            .WillByDefault(Return("EGL_KHR_fence_sync"));
+        ON_CALL(mock_egl, eglCreateSyncKHR(_, EGL_SYNC_FENCE_KHR, _))
+            .WillByDefault(Return(upload_fence));
+
+        wl_display_init_shm(display);
+        socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds);
+        client = wl_client_create(display, fds[0]);
+
+        // wl_shm is our only global, so it's the first name
+        request(display_id, 1 /* get_registry */, {registry_id});
+        std::vector<uint32_t> bind_args{1, sizeof("wl_shm")};
+        std::vector<uint32_t> name(2, 0);
+        memcpy(name.data(), "wl_shm", sizeof("wl_shm"));
+        bind_args.insert(bind_args.end(), name.begin(), name.end());
+        bind_args.insert(bind_args.end(), {1, shm_id});
+        request(registry_id, 0 /* bind */, bind_args);
+        request(shm_id, 0 /* create_pool */, {pool_id, stride * size.height.as_uint32_t()}, pixels.fd());
+    }
+
+    ~WlShmBufferTest()
+    {
+        // Send the buffer releases
+        wayland_executor->execute();
+        wl_client_destroy(client);
+        close(fds[1]);
+        wl_display_destroy(display);
+    }
+
+    void request(uint32_t object, uint32_t opcode, std::vector<uint32_t> const& args, int fd = -1)
+    {
+        std::vector<uint32_t> message{object, static_cast<uint32_t>((2 + args.size()) * sizeof(uint32_t)) << 16 | opcode};
+        message.insert(message.end(), args.begin(), args.end());
+
+        iovec iov{message.data(), message.size() * sizeof(uint32_t)};
+        char control[CMSG_SPACE(sizeof(int))] = {};
+        msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        if (fd != -1)
+        {
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+            auto const cmsg = CMSG_FIRSTHDR(&msg);
+            cmsg->cmsg_level = SOL_SOCKET;
+            cmsg->cmsg_type = SCM_RIGHTS;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+            memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+        }
+
+        ASSERT_THAT(sendmsg(fds[1], &msg, 0), Eq(static_cast<ssize_t>(iov.iov_len)));
+        wl_event_loop_dispatch(wl_display_get_event_loop(display), 0);
+    }
+
+    /// Commit a new wl_buffer, as a surface would
+    auto commit(std::shared_ptr<mg::Buffer> const& previous, geom::Rectangles const& damage)
+        -> std::shared_ptr<mg::Buffer>
+    {
+        auto const id = next_buffer_id++;
+        request(
+            pool_id,
+            0 /* create_buffer */,
+            {id, 0, size.width.as_uint32_t(), size.height.as_uint32_t(), stride, WL_SHM_FORMAT_ARGB8888});
+
+        return mg::wayland::buffer_from_wl_shm(
+            wl_client_get_object(client, id),
+            wayland_executor,
+            egl_delegate,
+            previous,
+            damage,
+            [](){});
+    }
+
+    static auto texture_of(mg::Buffer& buffer) -> mg::gl::Texture&
+    {
+        return dynamic_cast<mg::gl::Texture&>(*buffer.native_buffer_base());
+    }
+
+    EGLSyncKHR const upload_fence{reinterpret_cast<EGLSyncKHR>(0xf3c3)};
+    uint32_t const stride{size.width.as_uint32_t() * 4};
+    mir::AnonymousShmFile const pixels{stride * size.height.as_uint32_t()};
+
+    uint32_t const display_id{1};
+    uint32_t const registry_id{2};
+    uint32_t const shm_id{3};
+    uint32_t const pool_id{4};
+    uint32_t next_buffer_id{5};
+
+    std::shared_ptr<mtd::ExplicitExectutor> const wayland_executor{std::make_shared<mtd::ExplicitExectutor>()};
+    wl_display* const display;
+    int fds[2];
+    wl_client* client;
+};
+}
+
+TEST_F(WlShmBufferTest, upload_is_started_when_the_buffer_is_committed)
+{
+    std::promise<std::thread::id> upload_thread;
+    EXPECT_CALL(mock_gl, glTexImage2D(GL_TEXTURE_2D, 0, _, size.width.as_int(), size.height.as_int(), 0, _, _, _))
+        .WillOnce(InvokeWithoutArgs([&]() { upload_thread.set_value(std::this_thread::get_id()); }));
+
+    auto const buffer = commit(nullptr, {});
+
+    auto uploaded = upload_thread.get_future();
+    ASSERT_THAT(uploaded.wait_for(std::chrono::seconds{10}), Eq(std::future_status::ready));
+    EXPECT_THAT(uploaded.get(), Ne(std::this_thread::get_id()));
+}
+
+TEST_F(WlShmBufferTest, bind_waits_for_the_upload_fence_instead_of_uploading)
+{
+    EXPECT_CALL(mock_gl, glTexImage2D(_, _, _, _, _, _, _, _, _))
+        .Times(1);
+
+    auto const buffer = commit(nullptr, {});
+    wait_for_egl_thread(*egl_delegate);
+    Mock::VerifyAndClearExpectations(&mock_gl);
+
+    EXPECT_CALL(mock_egl, eglClientWaitSyncKHR(_, _, _, _))
+        .Times(AnyNumber());
+    EXPECT_CALL(mock_egl, eglDestroySyncKHR(_, _))
+        .Times(AnyNumber());
+    EXPECT_CALL(mock_gl, glTexImage2D(_, _, _, _, _, _, _, _, _))
+        .Times(0);
+    EXPECT_CALL(mock_gl, glTexSubImage2D(_, _, _, _, _, _, _, _, _))
+        .Times(0);
+    {
+        InSequence seq;
+        EXPECT_CALL(mock_egl, eglClientWaitSyncKHR(_, upload_fence, _, EGL_FOREVER_KHR))
+            .WillOnce(Return(EGL_CONDITION_SATISFIED_KHR));
+        EXPECT_CALL(mock_egl, eglDestroySyncKHR(_, upload_fence));
+    }
+
+    auto& texture = texture_of(*buffer);
+    texture.bind();
+    Mock::VerifyAndClearExpectations(&mock_egl);
+    Mock::VerifyAndClearExpectations(&mock_gl);
+
+    texture.add_syncpoint();
+}
+
+TEST_F(WlShmBufferTest, reupload_waits_for_outstanding_draws)
+{
+    EGLSyncKHR const draw_fence{reinterpret_cast<EGLSyncKHR>(0xd4a3)};
+
+    auto const first = commit(nullptr, {});
+    wait_for_egl_thread(*egl_delegate);
+
+    auto& texture = texture_of(*first);
+    texture.bind();
+
+    std::promise<void> reuploaded;
+    EXPECT_CALL(mock_egl, eglClientWaitSyncKHR(_, _, _, _))
+        .Times(AnyNumber());
+    Expectation const draws_completed =
+        EXPECT_CALL(mock_egl, eglClientWaitSyncKHR(_, draw_fence, _, EGL_FOREVER_KHR))
+            .WillOnce(Return(EGL_CONDITION_SATISFIED_KHR));
+    EXPECT_CALL(mock_gl, glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 10, 10, _, _, _))
+        .After(draws_completed)
+        .WillOnce(InvokeWithoutArgs([&]() { reuploaded.set_value(); }));
+
+    auto const second = commit(first, {{{0, 0}, {10, 10}}});
+
+    // The draws haven't been issued yet, so the texture mustn't be touched
+    auto const done = reuploaded.get_future();
+    EXPECT_THAT(done.wait_for(std::chrono::milliseconds{50}), Eq(std::future_status::timeout));
+
+    EXPECT_CALL(mock_egl, eglCreateSyncKHR(_, EGL_SYNC_FENCE_KHR, _))
+        .WillOnce(Return(draw_fence))
+        .WillRepeatedly(Return(upload_fence));
+    texture.add_syncpoint();
+
+    EXPECT_THAT(done.wait_for(std::chrono::seconds{10}), Eq(std::future_status::ready));
+}
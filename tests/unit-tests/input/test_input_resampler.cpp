@@ -0,0 +1,228 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/server/input/input_resampler.h"
+
+#include "mir/events/event_builders.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace mi = mir::input;
+namespace mev = mir::events;
+
+using namespace testing;
+using namespace std::chrono_literals;
+
+namespace
+{
+MirInputDeviceId const touchscreen{3};
+MirInputDeviceId const mouse{4};
+MirInputDeviceId const keyboard{5};
+
+std::chrono::milliseconds const latency{5};
+std::chrono::milliseconds const max_prediction{8};
+
+auto touch(std::chrono::nanoseconds time, MirTouchAction action, float x, float y = 0) -> std::shared_ptr<MirEvent>
+{
+    std::shared_ptr<MirEvent> event = mev::make_event(touchscreen, time, {}, mir_input_event_modifier_none);
+    mev::add_touch(*event, 0, action, mir_touch_tooltype_finger, x, y, 1, 1, 1, 1);
+    return event;
+}
+
+auto pointer_motion(std::chrono::nanoseconds time, float x, float dx) -> std::shared_ptr<MirEvent>
+{
+    return mev::make_event(
+        mouse, time, {}, mir_input_event_modifier_none, mir_pointer_action_motion, 0, x, 0, 0, 0, dx, 0);
+}
+
+auto time_of(std::shared_ptr<MirEvent const> const& event) -> std::chrono::nanoseconds
+{
+    return std::chrono::nanoseconds{mir_input_event_get_event_time(mir_event_get_input_event(event.get()))};
+}
+
+auto touch_x(std::shared_ptr<MirEvent const> const& event) -> float
+{
+    auto const touch = mir_input_event_get_touch_event(mir_event_get_input_event(event.get()));
+    return mir_touch_event_axis_value(touch, 0, mir_touch_axis_x);
+}
+
+auto touch_action(std::shared_ptr<MirEvent const> const& event) -> MirTouchAction
+{
+    auto const touch = mir_input_event_get_touch_event(mir_event_get_input_event(event.get()));
+    return mir_touch_event_action(touch, 0);
+}
+
+auto pointer_axis(std::shared_ptr<MirEvent const> const& event, MirPointerAxis axis) -> float
+{
+    auto const pointer = mir_input_event_get_pointer_event(mir_event_get_input_event(event.get()));
+    return mir_pointer_event_axis_value(pointer, axis);
+}
+
+struct InputResampler : Test
+{
+    InputResampler()
+    {
+        resampler.set_resampling(touchscreen, true);
+        resampler.set_resampling(mouse, true);
+    }
+
+    /// The events passed on when event is added
+    auto add(std::shared_ptr<MirEvent const> const& event, bool hold) -> mi::InputResampler::Events
+    {
+        mi::InputResampler::Events passed_on;
+        resampler.add(event, hold, [&](std::shared_ptr<MirEvent const> const& e) { passed_on.push_back(e); });
+        return passed_on;
+    }
+
+    mi::InputResampler resampler{latency, max_prediction};
+};
+}
+
+TEST_F(InputResampler, passes_on_events_from_other_devices)
+{
+    std::shared_ptr<MirEvent const> const event = mev::make_event(
+        keyboard, 100ms, {}, mir_input_event_modifier_none, mir_pointer_action_motion, 0, 1, 1, 0, 0, 1, 1);
+
+    EXPECT_THAT(add(event, true), ElementsAre(event));
+    EXPECT_FALSE(resampler.has_held_motion());
+}
+
+TEST_F(InputResampler, stops_resampling_a_device_when_asked)
+{
+    resampler.set_resampling(touchscreen, false);
+    auto const event = touch(100ms, mir_touch_action_change, 1);
+
+    EXPECT_FALSE(resampler.is_resampling(touchscreen));
+    EXPECT_THAT(add(event, true), ElementsAre(event));
+}
+
+TEST_F(InputResampler, passes_on_motion_that_is_not_held)
+{
+    auto const event = touch(100ms, mir_touch_action_change, 1);
+
+    EXPECT_THAT(add(event, false), ElementsAre(event));
+    EXPECT_FALSE(resampler.has_held_motion());
+}
+
+TEST_F(InputResampler, holds_motion_for_the_next_frame)
+{
+    EXPECT_THAT(add(touch(100ms, mir_touch_action_change, 1), true), IsEmpty());
+    EXPECT_TRUE(resampler.has_held_motion());
+}
+
+TEST_F(InputResampler, never_holds_touches_starting_or_ending)
+{
+    auto const down = touch(100ms, mir_touch_action_down, 1);
+    auto const up = touch(110ms, mir_touch_action_up, 1);
+
+    EXPECT_THAT(add(down, true), ElementsAre(down));
+    EXPECT_THAT(add(up, true), ElementsAre(up));
+    EXPECT_FALSE(resampler.has_held_motion());
+}
+
+TEST_F(InputResampler, interpolates_motion_to_the_sample_time)
+{
+    add(touch(100ms, mir_touch_action_change, 0), true);
+    add(touch(110ms, mir_touch_action_change, 10), true);
+
+    auto const events = resampler.resample_at(110ms);
+
+    ASSERT_THAT(events.size(), Eq(1u));
+    EXPECT_THAT(time_of(events[0]), Eq(std::chrono::nanoseconds{105ms}));
+    EXPECT_THAT(touch_x(events[0]), FloatEq(5));
+}
+
+TEST_F(InputResampler, holds_motion_newer_than_the_sample_time_for_the_next_frame)
+{
+    add(touch(100ms, mir_touch_action_change, 0), true);
+    add(touch(110ms, mir_touch_action_change, 10), true);
+
+    resampler.resample_at(110ms);
+
+    EXPECT_TRUE(resampler.has_held_motion());
+    EXPECT_THAT(resampler.resample_at(112ms), IsEmpty());
+}
+
+TEST_F(InputResampler, extrapolates_motion_no_further_than_half_the_sample_interval)
+{
+    add(touch(100ms, mir_touch_action_change, 0), false);
+    add(touch(110ms, mir_touch_action_change, 10), true);
+
+    auto const events = resampler.resample_at(140ms);
+
+    ASSERT_THAT(events.size(), Eq(1u));
+    EXPECT_THAT(time_of(events[0]), Eq(std::chrono::nanoseconds{115ms}));
+    EXPECT_THAT(touch_x(events[0]), FloatEq(15));
+    EXPECT_FALSE(resampler.has_held_motion());
+}
+
+TEST_F(InputResampler, extrapolates_motion_no_further_than_max_prediction)
+{
+    add(touch(100ms, mir_touch_action_change, 0), false);
+    add(touch(120ms, mir_touch_action_change, 20), true);
+
+    auto const events = resampler.resample_at(160ms);
+
+    ASSERT_THAT(events.size(), Eq(1u));
+    EXPECT_THAT(time_of(events[0]), Eq(std::chrono::nanoseconds{120ms + max_prediction}));
+    EXPECT_THAT(touch_x(events[0]), FloatEq(28));
+}
+
+TEST_F(InputResampler, does_not_extrapolate_from_stale_samples)
+{
+    add(touch(100ms, mir_touch_action_change, 0), false);
+    add(touch(150ms, mir_touch_action_change, 50), true);
+
+    auto const events = resampler.resample_at(200ms);
+
+    ASSERT_THAT(events.size(), Eq(1u));
+    EXPECT_THAT(time_of(events[0]), Eq(std::chrono::nanoseconds{150ms}));
+    EXPECT_THAT(touch_x(events[0]), FloatEq(50));
+}
+
+TEST_F(InputResampler, passes_on_held_motion_before_a_touch_ends)
+{
+    add(touch(100ms, mir_touch_action_change, 0), true);
+    add(touch(110ms, mir_touch_action_change, 10), true);
+    auto const up = touch(120ms, mir_touch_action_up, 10);
+
+    auto const events = add(up, true);
+
+    ASSERT_THAT(events.size(), Eq(2u));
+    EXPECT_THAT(touch_action(events[0]), Eq(mir_touch_action_change));
+    EXPECT_THAT(time_of(events[0]), Eq(std::chrono::nanoseconds{110ms}));
+    EXPECT_THAT(events[1], Eq(up));
+    EXPECT_FALSE(resampler.has_held_motion());
+}
+
+TEST_F(InputResampler, resampled_pointer_motion_keeps_the_relative_motion_it_stands_for)
+{
+    add(pointer_motion(100ms, 1, 1), true);
+    add(pointer_motion(104ms, 3, 2), true);
+    add(pointer_motion(108ms, 6, 3), true);
+
+    auto const events = resampler.resample_at(110ms);
+
+    ASSERT_THAT(events.size(), Eq(1u));
+    EXPECT_THAT(pointer_axis(events[0], mir_pointer_axis_x), FloatEq(3.75));
+    EXPECT_THAT(pointer_axis(events[0], mir_pointer_axis_relative_x), FloatEq(3));
+
+    auto const rest = resampler.resample_at(120ms);
+
+    ASSERT_THAT(rest.size(), Eq(1u));
+    EXPECT_THAT(pointer_axis(rest[0], mir_pointer_axis_relative_x), FloatEq(3));
+}
@@ -0,0 +1,215 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/server/input/resampling_dispatcher.h"
+
+#include "mir/events/event_builders.h"
+#include "mir/time/alarm.h"
+#include "mir/time/alarm_factory.h"
+
+#include "mir/test/doubles/advanceable_clock.h"
+#include "mir/test/doubles/mock_input_dispatcher.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace mi = mir::input;
+namespace mev = mir::events;
+namespace mtd = mir::test::doubles;
+
+using namespace testing;
+using namespace std::chrono_literals;
+
+namespace
+{
+MirInputDeviceId const touchscreen{3};
+MirInputDeviceId const keyboard{5};
+
+std::chrono::milliseconds const latency{5};
+std::chrono::milliseconds const max_prediction{8};
+
+struct MockAlarm : public mir::time::Alarm
+{
+    MOCK_METHOD0(cancel, bool());
+    MOCK_CONST_METHOD0(state, mir::time::Alarm::State());
+    MOCK_METHOD1(reschedule_in, bool(std::chrono::milliseconds));
+    MOCK_METHOD1(reschedule_for, bool(mir::time::Timestamp));
+};
+
+/// Hands out one alarm, whose callback the test calls when it goes off
+struct StubAlarmFactory : public mir::time::AlarmFactory
+{
+    std::unique_ptr<mir::time::Alarm> create_alarm(std::function<void()> const& callback) override
+    {
+        go_off = callback;
+        return std::unique_ptr<mir::time::Alarm>{alarm};
+    }
+
+    std::unique_ptr<mir::time::Alarm> create_alarm(std::unique_ptr<mir::LockableCallback>) override
+    {
+        return nullptr;
+    }
+
+    NiceMock<MockAlarm>* const alarm{new NiceMock<MockAlarm>};
+    std::function<void()> go_off;
+};
+
+MATCHER_P(TouchAt, x, "")
+{
+    auto const touch = mir_input_event_get_touch_event(mir_event_get_input_event(arg.get()));
+    return mir_touch_event_axis_value(touch, 0, mir_touch_axis_x) == x;
+}
+
+struct ResamplingDispatcher : Test
+{
+    ResamplingDispatcher()
+    {
+        dispatcher.set_resampling(touchscreen, true);
+    }
+
+    /// A touch moving to x, timestamped offset from now
+    auto touch(std::chrono::nanoseconds offset, float x) -> std::shared_ptr<MirEvent>
+    {
+        std::shared_ptr<MirEvent> event = mev::make_event(
+            touchscreen, clock->now().time_since_epoch() + offset, {}, mir_input_event_modifier_none);
+        mev::add_touch(*event, 0, mir_touch_action_change, mir_touch_tooltype_finger, x, 0, 1, 1, 1, 1);
+        return event;
+    }
+
+    std::shared_ptr<NiceMock<mtd::MockInputDispatcher>> const next_dispatcher{
+        std::make_shared<NiceMock<mtd::MockInputDispatcher>>()};
+    std::shared_ptr<StubAlarmFactory> const alarm_factory{std::make_shared<StubAlarmFactory>()};
+    MockAlarm& alarm{*alarm_factory->alarm};
+    std::shared_ptr<mtd::AdvanceableClock> const clock{std::make_shared<mtd::AdvanceableClock>()};
+
+    mi::ResamplingDispatcher dispatcher{
+        next_dispatcher,
+        alarm_factory,
+        clock,
+        mi::ResamplingDispatcher::ResampledDevices::touchscreens,
+        latency,
+        max_prediction};
+};
+}
+
+TEST_F(ResamplingDispatcher, passes_motion_straight_on_while_the_compositor_is_idle)
+{
+    std::shared_ptr<MirEvent const> const event = touch(0ms, 1);
+
+    EXPECT_CALL(*next_dispatcher, dispatch(event));
+    EXPECT_CALL(alarm, reschedule_for(_))
+        .Times(0);
+
+    dispatcher.dispatch(event);
+}
+
+TEST_F(ResamplingDispatcher, passes_motion_straight_on_once_the_expected_frame_has_passed)
+{
+    dispatcher.next_frame_at(clock->now() + 10ms);
+    clock->advance_by(20ms);
+    std::shared_ptr<MirEvent const> const event = touch(0ms, 1);
+
+    EXPECT_CALL(*next_dispatcher, dispatch(event));
+    EXPECT_CALL(alarm, reschedule_for(_))
+        .Times(0);
+
+    dispatcher.dispatch(event);
+}
+
+TEST_F(ResamplingDispatcher, passes_on_events_from_other_devices_during_a_frame)
+{
+    std::shared_ptr<MirEvent const> const event = mev::make_event(
+        keyboard, clock->now().time_since_epoch(), std::vector<uint8_t>{}, mir_keyboard_action_down, 0, 0, mir_input_event_modifier_none);
+    dispatcher.next_frame_at(clock->now() + 10ms);
+
+    EXPECT_CALL(*next_dispatcher, dispatch(event))
+        .WillOnce(Return(false));
+
+    EXPECT_FALSE(dispatcher.dispatch(event));
+}
+
+TEST_F(ResamplingDispatcher, holds_motion_until_the_upcoming_frame)
+{
+    auto const frame_start = clock->now() + 10ms;
+    dispatcher.next_frame_at(frame_start);
+
+    EXPECT_CALL(*next_dispatcher, dispatch(_))
+        .Times(0);
+    // Once for all the motion held for the frame
+    EXPECT_CALL(alarm, reschedule_for(frame_start))
+        .Times(1);
+
+    EXPECT_TRUE(dispatcher.dispatch(touch(0ms, 1)));
+    clock->advance_by(1ms);
+    EXPECT_TRUE(dispatcher.dispatch(touch(0ms, 2)));
+}
+
+TEST_F(ResamplingDispatcher, passes_on_held_motion_resampled_to_the_frame_when_the_alarm_goes_off)
+{
+    auto const frame_start = clock->now() + 10ms;
+    dispatcher.next_frame_at(frame_start);
+
+    // Sampled 2ms and 6ms from now; the frame is sampled 5ms from now
+    dispatcher.dispatch(touch(2ms, 2));
+    dispatcher.dispatch(touch(6ms, 6));
+
+    EXPECT_CALL(*next_dispatcher, dispatch(TouchAt(5.0f)));
+
+    clock->advance_by(10ms);
+    alarm_factory->go_off();
+}
+
+TEST_F(ResamplingDispatcher, reschedules_the_alarm_for_motion_newer_than_the_frame)
+{
+    auto const first_frame = clock->now() + 10ms;
+    auto const second_frame = first_frame + 16ms;
+    dispatcher.next_frame_at(first_frame);
+
+    dispatcher.dispatch(touch(2ms, 2));
+    dispatcher.dispatch(touch(8ms, 8));
+
+    clock->advance_by(10ms);
+    dispatcher.next_frame_at(second_frame);
+
+    EXPECT_CALL(*next_dispatcher, dispatch(_))
+        .Times(1);
+    EXPECT_CALL(alarm, reschedule_for(second_frame));
+
+    alarm_factory->go_off();
+}
+
+TEST_F(ResamplingDispatcher, reschedules_the_alarm_for_newer_motion_to_become_due_if_the_compositor_goes_idle)
+{
+    auto const frame_start = clock->now() + 10ms;
+    dispatcher.next_frame_at(frame_start);
+
+    dispatcher.dispatch(touch(2ms, 2));
+    dispatcher.dispatch(touch(8ms, 8));
+
+    clock->advance_by(10ms);
+
+    EXPECT_CALL(alarm, reschedule_for(clock->now() + latency));
+
+    alarm_factory->go_off();
+}
+
+TEST_F(ResamplingDispatcher, stop_cancels_the_alarm)
+{
+    EXPECT_CALL(alarm, cancel());
+    EXPECT_CALL(*next_dispatcher, stop());
+
+    dispatcher.stop();
+}
@@ -57,6 +57,12 @@ struct MockKMSOutput : public graphics::gbm::KMSOutput
         return schedule_page_flip_thunk(&fb);
     }
     MOCK_METHOD1(schedule_page_flip_thunk, bool(graphics::gbm::FBHandle const*));
+
+    bool add_page_flip(graphics::gbm::AtomicCommit& commit, graphics::gbm::FBHandle const& fb) override
+    {
+        return add_page_flip_thunk(&commit, &fb);
+    }
+    MOCK_METHOD2(add_page_flip_thunk, bool(graphics::gbm::AtomicCommit*, graphics::gbm::FBHandle const*));
     MOCK_METHOD0(wait_for_page_flip, void());
 
     MOCK_CONST_METHOD0(last_frame, graphics::Frame());
@@ -66,6 +72,10 @@ struct MockKMSOutput : public graphics::gbm::KMSOutput
     MOCK_METHOD0(clear_cursor, bool());
     MOCK_CONST_METHOD0(has_cursor, bool());
 
+    MOCK_METHOD0(overlay_planes, std::vector<graphics::gbm::OverlayPlane>());
+    MOCK_METHOD4(set_overlay, bool(
+        uint32_t, graphics::gbm::FBHandle const*, geometry::Rectangle const&, geometry::Rectangle const&));
+
     MOCK_METHOD1(set_power_mode, void(MirPowerMode));
     MOCK_METHOD1(set_gamma, void(mir::graphics::GammaCurves const&));
 
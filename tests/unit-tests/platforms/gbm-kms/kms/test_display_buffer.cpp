@@ -20,7 +20,10 @@
 #include "mir/test/doubles/null_console_services.h"
 #include "src/platforms/gbm-kms/server/kms/platform.h"
 #include "src/platforms/gbm-kms/server/kms/display_buffer.h"
+#include "src/platforms/gbm-kms/server/kms/atomic_commit.h"
+#include "src/platforms/gbm-kms/server/kms/page_flipper.h"
 #include "src/platforms/gbm-kms/include/native_buffer.h"
+#include "src/platforms/common/server/scanout_source.h"
 #include "src/server/report/null_report_factory.h"
 #include "mir/test/doubles/mock_egl.h"
 #include "mir/test/doubles/mock_gl.h"
@@ -48,6 +51,26 @@ using namespace mir::graphics;
 using namespace mir::graphics::gbm;
 using mir::report::null_display_report;
 
+namespace
+{
+struct MockPageFlipper : PageFlipper
+{
+    MOCK_METHOD3(schedule_flip, bool(uint32_t,uint32_t,uint32_t));
+    MOCK_CONST_METHOD0(supports_atomic, bool());
+    MOCK_METHOD1(schedule_atomic_flip, bool(AtomicCommit const&));
+    MOCK_METHOD1(wait_for_flip, Frame(uint32_t));
+};
+
+/// A client buffer that was imported for scanout
+struct MockScanoutBuffer : MockBuffer, mir::graphics::common::ScanoutSource
+{
+    auto scanout_buffer() const -> std::shared_ptr<mir::graphics::NativeBuffer> override
+    {
+        return native_buffer_handle();
+    }
+};
+}
+
 class MesaDisplayBufferTest : public Test
 {
 public:
@@ -55,7 +78,7 @@ public:
 
     MesaDisplayBufferTest()
         : identity(1)
-        , mock_bypassable_buffer{std::make_shared<NiceMock<MockBuffer>>()}
+        , mock_bypassable_buffer{std::make_shared<NiceMock<MockScanoutBuffer>>()}
         , mock_software_buffer{std::make_shared<NiceMock<MockBuffer>>()}
         , fake_bypassable_renderable{
              std::make_shared<FakeRenderable>(display_area)}
@@ -288,7 +311,7 @@ TEST_F(MesaDisplayBufferTest, failed_bypass_falls_back_gracefully)
 TEST_F(MesaDisplayBufferTest, skips_bypass_because_of_lagging_resize)
 {  // Another regression test for LP: #1398296
     auto fullscreen = std::make_shared<FakeRenderable>(display_area);
-    auto nonbypassable = std::make_shared<testing::NiceMock<MockBuffer>>();
+    auto nonbypassable = std::make_shared<testing::NiceMock<MockScanoutBuffer>>();
     ON_CALL(*nonbypassable, native_buffer_handle())
         .WillByDefault(Return(stub_gbm_native_buffer));
     ON_CALL(*nonbypassable, size())
@@ -445,6 +468,73 @@ TEST_F(MesaDisplayBufferTest, clone_mode_waits_for_page_flip_on_second_flip)
     db.post();
 }
 
+TEST_F(MesaDisplayBufferTest, clone_mode_flips_all_outputs_in_one_atomic_commit)
+{
+    auto const flipper = std::make_shared<NiceMock<MockPageFlipper>>();
+    auto const other_kms_output = std::make_shared<NiceMock<MockKMSOutput>>();
+    ON_CALL(*other_kms_output, fb_for(_))
+        .WillByDefault(Return(reinterpret_cast<FBHandle*>(0x12ad)));
+
+    EXPECT_CALL(*mock_kms_output, add_page_flip_thunk(_, _))
+        .WillOnce(Invoke([&](AtomicCommit* commit, FBHandle const*)
+            {
+                commit->add_flip(flipper, 1, 2);
+                return true;
+            }));
+    EXPECT_CALL(*other_kms_output, add_page_flip_thunk(_, _))
+        .WillOnce(Invoke([&](AtomicCommit* commit, FBHandle const*)
+            {
+                commit->add_flip(flipper, 3, 4);
+                return true;
+            }));
+    EXPECT_CALL(*flipper, schedule_atomic_flip(
+            Property(&AtomicCommit::flips, SizeIs(2))))
+        .WillOnce(Return(true));
+    EXPECT_CALL(*mock_kms_output, schedule_page_flip_thunk(_))
+        .Times(0);
+    EXPECT_CALL(*other_kms_output, schedule_page_flip_thunk(_))
+        .Times(0);
+
+    graphics::gbm::DisplayBuffer db(
+        graphics::gbm::BypassOption::allowed,
+        null_display_report(),
+        {mock_kms_output, other_kms_output},
+        make_output_surface(),
+        display_area,
+        identity);
+
+    db.swap_buffers();
+    db.post();
+}
+
+TEST_F(MesaDisplayBufferTest, uses_legacy_flips_unless_every_output_can_flip_atomically)
+{
+    auto const other_kms_output = std::make_shared<NiceMock<MockKMSOutput>>();
+    ON_CALL(*other_kms_output, fb_for(_))
+        .WillByDefault(Return(reinterpret_cast<FBHandle*>(0x12ad)));
+
+    ON_CALL(*mock_kms_output, add_page_flip_thunk(_, _))
+        .WillByDefault(Return(true));
+    ON_CALL(*other_kms_output, add_page_flip_thunk(_, _))
+        .WillByDefault(Return(false));
+
+    EXPECT_CALL(*mock_kms_output, schedule_page_flip_thunk(_))
+        .WillOnce(Return(true));
+    EXPECT_CALL(*other_kms_output, schedule_page_flip_thunk(_))
+        .WillOnce(Return(true));
+
+    graphics::gbm::DisplayBuffer db(
+        graphics::gbm::BypassOption::allowed,
+        null_display_report(),
+        {mock_kms_output, other_kms_output},
+        make_output_surface(),
+        display_area,
+        identity);
+
+    db.swap_buffers();
+    db.post();
+}
+
 TEST_F(MesaDisplayBufferTest, skips_bypass_because_of_incompatible_list)
 {
     graphics::RenderableList list{
@@ -466,7 +556,7 @@ TEST_F(MesaDisplayBufferTest, skips_bypass_because_of_incompatible_list)
 TEST_F(MesaDisplayBufferTest, skips_bypass_because_of_incompatible_bypass_buffer)
 {
     auto fullscreen = std::make_shared<FakeRenderable>(display_area);
-    auto nonbypassable = std::make_shared<testing::NiceMock<MockBuffer>>();
+    auto nonbypassable = std::make_shared<testing::NiceMock<MockScanoutBuffer>>();
     auto nonbypassable_gbm_native_buffer =
         std::make_shared<StubGBMNativeBuffer>(display_area.size, false);
     ON_CALL(*nonbypassable, native_buffer_handle())
@@ -503,3 +593,212 @@ TEST_F(MesaDisplayBufferTest, buffer_requiring_migration_is_ineligable_for_bypas
 
     EXPECT_FALSE(db.overlay(bypassable_list));
 }
+
+TEST_F(MesaDisplayBufferTest, puts_scanout_renderable_on_overlay_plane)
+{
+    uint32_t const plane_id{42};
+    ON_CALL(*mock_kms_output, overlay_planes())
+        .WillByDefault(Return(std::vector<OverlayPlane>{{plane_id, {GBM_FORMAT_XRGB8888}}}));
+    ON_CALL(mock_gbm, gbm_bo_get_format(_))
+        .WillByDefault(Return(GBM_FORMAT_XRGB8888));
+
+    auto const video = std::make_shared<FakeRenderable>(geometry::Rectangle{{22, 44}, {20, 10}});
+    video->set_buffer(mock_bypassable_buffer);
+    graphics::RenderableList const list{fake_software_renderable, video};
+
+    graphics::gbm::DisplayBuffer db(
+        graphics::gbm::BypassOption::allowed,
+        null_display_report(),
+        {mock_kms_output},
+        make_output_surface(),
+        display_area,
+        identity);
+
+    EXPECT_CALL(*mock_kms_output, set_overlay(
+            plane_id, NotNull(),
+            geometry::Rectangle{{0, 0}, display_area.size},
+            geometry::Rectangle{{10, 10}, {20, 10}}))
+        .WillOnce(Return(true));
+
+    EXPECT_FALSE(db.overlay(list));
+    EXPECT_THAT(db.assign_overlays(list), ElementsAre(fake_software_renderable));
+}
+
+TEST_F(MesaDisplayBufferTest, does_not_put_renderable_under_composited_one_on_overlay_plane)
+{
+    ON_CALL(*mock_kms_output, overlay_planes())
+        .WillByDefault(Return(std::vector<OverlayPlane>{{42, {GBM_FORMAT_XRGB8888}}}));
+    ON_CALL(mock_gbm, gbm_bo_get_format(_))
+        .WillByDefault(Return(GBM_FORMAT_XRGB8888));
+
+    auto const video = std::make_shared<FakeRenderable>(geometry::Rectangle{{22, 44}, {20, 10}});
+    video->set_buffer(mock_bypassable_buffer);
+    auto const popup = std::make_shared<FakeRenderable>(geometry::Rectangle{{30, 50}, {5, 5}});
+    graphics::RenderableList const list{video, popup};
+
+    graphics::gbm::DisplayBuffer db(
+        graphics::gbm::BypassOption::allowed,
+        null_display_report(),
+        {mock_kms_output},
+        make_output_surface(),
+        display_area,
+        identity);
+
+    EXPECT_CALL(*mock_kms_output, set_overlay(_, _, _, _)).Times(0);
+
+    EXPECT_THAT(db.assign_overlays(list), ElementsAre(video, popup));
+}
+
+TEST_F(MesaDisplayBufferTest, renderable_rejected_by_overlay_plane_is_composited)
+{
+    ON_CALL(*mock_kms_output, overlay_planes())
+        .WillByDefault(Return(std::vector<OverlayPlane>{{42, {GBM_FORMAT_XRGB8888}}}));
+    ON_CALL(mock_gbm, gbm_bo_get_format(_))
+        .WillByDefault(Return(GBM_FORMAT_XRGB8888));
+    ON_CALL(*mock_kms_output, set_overlay(_, _, _, _))
+        .WillByDefault(Return(false));
+
+    auto const video = std::make_shared<FakeRenderable>(geometry::Rectangle{{22, 44}, {20, 10}});
+    video->set_buffer(mock_bypassable_buffer);
+    graphics::RenderableList const list{fake_software_renderable, video};
+
+    graphics::gbm::DisplayBuffer db(
+        graphics::gbm::BypassOption::allowed,
+        null_display_report(),
+        {mock_kms_output},
+        make_output_surface(),
+        display_area,
+        identity);
+
+    EXPECT_THAT(db.assign_overlays(list), ElementsAre(fake_software_renderable, video));
+}
+
+TEST_F(MesaDisplayBufferTest, overlay_plane_is_disabled_once_unused)
+{
+    uint32_t const plane_id{42};
+    ON_CALL(*mock_kms_output, overlay_planes())
+        .WillByDefault(Return(std::vector<OverlayPlane>{{plane_id, {GBM_FORMAT_XRGB8888}}}));
+    ON_CALL(mock_gbm, gbm_bo_get_format(_))
+        .WillByDefault(Return(GBM_FORMAT_XRGB8888));
+    ON_CALL(*mock_kms_output, set_overlay(_, _, _, _))
+        .WillByDefault(Return(true));
+
+    auto const video = std::make_shared<FakeRenderable>(geometry::Rectangle{{22, 44}, {20, 10}});
+    video->set_buffer(mock_bypassable_buffer);
+
+    graphics::gbm::DisplayBuffer db(
+        graphics::gbm::BypassOption::allowed,
+        null_display_report(),
+        {mock_kms_output},
+        make_output_surface(),
+        display_area,
+        identity);
+
+    db.assign_overlays({fake_software_renderable, video});
+
+    EXPECT_CALL(*mock_kms_output, set_overlay(plane_id, IsNull(), _, _));
+    EXPECT_THAT(
+        db.assign_overlays({fake_software_renderable}),
+        ElementsAre(fake_software_renderable));
+}
+
+TEST_F(MesaDisplayBufferTest, shm_renderable_is_composited_rather_than_put_on_overlay_plane)
+{
+    ON_CALL(*mock_kms_output, overlay_planes())
+        .WillByDefault(Return(std::vector<OverlayPlane>{{42, {GBM_FORMAT_XRGB8888}}}));
+    ON_CALL(mock_gbm, gbm_bo_get_format(_))
+        .WillByDefault(Return(GBM_FORMAT_XRGB8888));
+
+    // Like a wl_shm buffer, which has no native buffer to give
+    auto const shm_buffer = std::make_shared<NiceMock<MockBuffer>>();
+    ON_CALL(*shm_buffer, size())
+        .WillByDefault(Return(geometry::Size{20, 10}));
+    ON_CALL(*shm_buffer, native_buffer_handle())
+        .WillByDefault(Throw(std::logic_error{"Attempt to get mirclient handle for Wayland Shm buffer"}));
+
+    auto const window = std::make_shared<FakeRenderable>(geometry::Rectangle{{22, 44}, {20, 10}});
+    window->set_buffer(shm_buffer);
+    graphics::RenderableList const list{fake_software_renderable, window};
+
+    graphics::gbm::DisplayBuffer db(
+        graphics::gbm::BypassOption::allowed,
+        null_display_report(),
+        {mock_kms_output},
+        make_output_surface(),
+        display_area,
+        identity);
+
+    EXPECT_CALL(*mock_kms_output, set_overlay(_, _, _, _)).Times(0);
+
+    EXPECT_NO_THROW(
+        {
+            EXPECT_FALSE(db.overlay(list));
+            EXPECT_THAT(db.assign_overlays(list), ElementsAre(fake_software_renderable, window));
+        });
+}
+
+TEST_F(MesaDisplayBufferTest, fullscreen_shm_renderable_is_not_bypassed)
+{
+    auto const shm_buffer = std::make_shared<NiceMock<MockBuffer>>();
+    ON_CALL(*shm_buffer, size())
+        .WillByDefault(Return(display_area.size));
+    ON_CALL(*shm_buffer, native_buffer_handle())
+        .WillByDefault(Throw(std::logic_error{"Attempt to get mirclient handle for Wayland Shm buffer"}));
+
+    auto const window = std::make_shared<FakeRenderable>(display_area);
+    window->set_buffer(shm_buffer);
+
+    graphics::gbm::DisplayBuffer db(
+        graphics::gbm::BypassOption::allowed,
+        null_display_report(),
+        {mock_kms_output},
+        make_output_surface(),
+        display_area,
+        identity);
+
+    EXPECT_NO_THROW(EXPECT_FALSE(db.overlay({window})));
+}
+
+TEST_F(MesaDisplayBufferTest, frame_deadline_is_half_a_refresh_after_the_next_vblank)
+{
+    using namespace std::chrono;
+
+    auto const last_flip = mir::time::PosixTimestamp::now(CLOCK_MONOTONIC) - milliseconds{5};
+    graphics::Frame frame;
+    frame.ust = last_flip;
+    ON_CALL(*mock_kms_output, last_frame())
+        .WillByDefault(Return(frame));
+
+    graphics::gbm::DisplayBuffer db(
+        graphics::gbm::BypassOption::allowed,
+        null_display_report(),
+        {mock_kms_output},
+        make_output_surface(),
+        display_area,
+        identity);
+
+    auto const refresh_interval = duration_cast<microseconds>(seconds{1}) / mock_refresh_rate;
+    auto const before = steady_clock::now();
+    auto const deadline = db.next_frame_deadline();
+    auto const after = steady_clock::now();
+
+    EXPECT_THAT(deadline, Gt(before + refresh_interval / 2));
+    EXPECT_THAT(deadline, Le(after + refresh_interval + refresh_interval / 2));
+    // Counting whole refreshes from the last flip
+    EXPECT_THAT(
+        (deadline.time_since_epoch() - last_flip.nanoseconds - refresh_interval / 2) % refresh_interval,
+        Eq(nanoseconds::zero()));
+}
+
+TEST_F(MesaDisplayBufferTest, frame_deadline_is_unknown_until_a_page_flip_completes)
+{
+    graphics::gbm::DisplayBuffer db(
+        graphics::gbm::BypassOption::allowed,
+        null_display_report(),
+        {mock_kms_output},
+        make_output_surface(),
+        display_area,
+        identity);
+
+    EXPECT_THAT(db.next_frame_deadline(), Eq(std::chrono::steady_clock::time_point::max()));
+}
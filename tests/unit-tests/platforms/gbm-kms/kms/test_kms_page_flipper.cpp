@@ -17,6 +17,7 @@
  */
 
 #include "src/platforms/gbm-kms/server/kms/kms_page_flipper.h"
+#include "src/platforms/gbm-kms/server/kms/atomic_commit.h"
 
 #include "mir/test/doubles/mock_drm.h"
 #include "mir/test/doubles/mock_display_report.h"
@@ -69,6 +70,41 @@ ACTION_P(InvokePageFlipHandler, param)
     ASSERT_EQ(1, read(arg0, &dummy, 1));
 }
 
+/// The event of an atomic commit, naming the CRTC that flipped
+ACTION_P2(InvokePageFlipHandler2, crtc_id, param)
+{
+    int const dont_care{0};
+    char dummy;
+
+    arg1->page_flip_handler2(dont_care, dont_care, dont_care, dont_care, crtc_id, *param);
+    ASSERT_EQ(1, read(arg0, &dummy, 1));
+}
+
+class AtomicKMSPageFlipperTest : public ::testing::Test
+{
+public:
+    AtomicKMSPageFlipperTest()
+        : drm_fd{open(drm_device, 0, 0)}
+    {
+        using namespace testing;
+
+        ON_CALL(mock_drm, drmGetCap(drm_fd, DRM_CAP_CRTC_IN_VBLANK_EVENT, _))
+            .WillByDefault(DoAll(SetArgPointee<2>(1), Return(0)));
+        EXPECT_CALL(mock_drm, drmSetClientCap(drm_fd, DRM_CLIENT_CAP_ATOMIC, 1))
+            .WillOnce(Return(0));
+
+        page_flipper = std::make_shared<mgg::KMSPageFlipper>(drm_fd, mt::fake_shared(report));
+    }
+
+    testing::NiceMock<mtd::MockDisplayReport> report;
+    testing::NiceMock<mtd::MockDRM> mock_drm;
+
+    char const* const drm_device = "/dev/dri/card0";
+    int const drm_fd;
+
+    std::shared_ptr<mgg::KMSPageFlipper> page_flipper;
+};
+
 }
 
 TEST_F(KMSPageFlipperTest, schedule_flip_calls_drm_page_flip)
@@ -581,3 +617,122 @@ TEST_F(KMSPageFlipperTest, threads_concurrent_page_flips_dont_deadlock)
     EXPECT_EQ(counter.count_flips(), counter.count_handle_events());
     EXPECT_TRUE(counter.no_consecutive_flips_for_same_crtc_id());
 }
+
+TEST_F(KMSPageFlipperTest, does_not_flip_atomically_unless_the_kernel_names_the_flipped_crtc)
+{
+    using namespace testing;
+
+    EXPECT_CALL(mock_drm, drmModeAtomicCommit(_, _, _, _))
+        .Times(0);
+
+    mgg::AtomicCommit commit;
+
+    EXPECT_FALSE(page_flipper.supports_atomic());
+    EXPECT_FALSE(page_flipper.schedule_atomic_flip(commit));
+}
+
+TEST_F(AtomicKMSPageFlipperTest, supports_atomic_if_the_kernel_names_the_flipped_crtc)
+{
+    EXPECT_TRUE(page_flipper->supports_atomic());
+}
+
+TEST_F(AtomicKMSPageFlipperTest, does_not_support_atomic_if_the_client_cap_is_refused)
+{
+    using namespace testing;
+
+    EXPECT_CALL(mock_drm, drmSetClientCap(drm_fd, DRM_CLIENT_CAP_ATOMIC, 1))
+        .WillOnce(Return(-EOPNOTSUPP));
+
+    mgg::KMSPageFlipper const legacy_flipper{drm_fd, mt::fake_shared(report)};
+
+    EXPECT_FALSE(legacy_flipper.supports_atomic());
+}
+
+TEST_F(AtomicKMSPageFlipperTest, schedule_atomic_flip_commits_without_blocking)
+{
+    using namespace testing;
+
+    uint32_t const crtc_id{10};
+    uint32_t const connector_id{345};
+
+    mgg::AtomicCommit commit;
+    commit.add_flip(page_flipper, crtc_id, connector_id);
+
+    EXPECT_CALL(mock_drm, drmModeAtomicCommit(
+        drm_fd, commit.request(), DRM_MODE_ATOMIC_NONBLOCK | DRM_MODE_PAGE_FLIP_EVENT, NotNull()))
+        .WillOnce(Return(0));
+    EXPECT_CALL(mock_drm, drmModePageFlip(_, _, _, _, _))
+        .Times(0);
+
+    EXPECT_TRUE(commit.schedule());
+}
+
+TEST_F(AtomicKMSPageFlipperTest, double_schedule_atomic_flip_throws)
+{
+    using namespace testing;
+
+    uint32_t const crtc_id{10};
+    uint32_t const connector_id{345};
+
+    mgg::AtomicCommit commit;
+    commit.add_flip(page_flipper, crtc_id, connector_id);
+
+    EXPECT_CALL(mock_drm, drmModeAtomicCommit(_, _, _, _))
+        .WillOnce(Return(0));
+
+    ASSERT_TRUE(commit.schedule());
+
+    EXPECT_THROW({
+        page_flipper->schedule_atomic_flip(commit);
+    }, std::logic_error);
+}
+
+TEST_F(AtomicKMSPageFlipperTest, failed_atomic_flip_is_not_waited_for)
+{
+    using namespace testing;
+
+    uint32_t const crtc_id{10};
+    uint32_t const connector_id{345};
+
+    mgg::AtomicCommit commit;
+    commit.add_flip(page_flipper, crtc_id, connector_id);
+
+    EXPECT_CALL(mock_drm, drmModeAtomicCommit(_, _, _, _))
+        .WillOnce(Return(-EBUSY));
+    EXPECT_CALL(mock_drm, drmHandleEvent(_, _))
+        .Times(0);
+
+    EXPECT_FALSE(commit.schedule());
+
+    page_flipper->wait_for_flip(crtc_id);
+}
+
+TEST_F(AtomicKMSPageFlipperTest, one_commit_flips_each_crtc_the_kernel_reports)
+{
+    using namespace testing;
+
+    uint32_t const crtc_ids[] = {10, 11};
+    uint32_t const connector_ids[] = {23, 45};
+    void* user_data{nullptr};
+
+    mgg::AtomicCommit commit;
+    commit.add_flip(page_flipper, crtc_ids[0], connector_ids[0]);
+    commit.add_flip(page_flipper, crtc_ids[1], connector_ids[1]);
+
+    EXPECT_CALL(mock_drm, drmModeAtomicCommit(drm_fd, _, _, _))
+        .WillOnce(DoAll(SaveArg<3>(&user_data), Return(0)));
+    // Each CRTC gets an event with the same data, and they may come in any order
+    EXPECT_CALL(mock_drm, drmHandleEvent(drm_fd, _))
+        .WillOnce(DoAll(InvokePageFlipHandler2(crtc_ids[1], &user_data), Return(0)))
+        .WillOnce(DoAll(InvokePageFlipHandler2(crtc_ids[0], &user_data), Return(0)));
+    EXPECT_CALL(report, report_vsync(connector_ids[0], _));
+    EXPECT_CALL(report, report_vsync(connector_ids[1], _));
+
+    ASSERT_TRUE(commit.schedule());
+
+    mock_drm.generate_event_on(drm_device);
+    mock_drm.generate_event_on(drm_device);
+
+    page_flipper->wait_for_flip(crtc_ids[0]);
+    page_flipper->wait_for_flip(crtc_ids[1]);
+}
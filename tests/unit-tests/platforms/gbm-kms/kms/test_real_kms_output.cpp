@@ -18,6 +18,7 @@
 
 #include "src/platforms/gbm-kms/server/kms/real_kms_output.h"
 #include "src/platforms/gbm-kms/server/kms/page_flipper.h"
+#include "src/platforms/gbm-kms/server/kms/atomic_commit.h"
 #include "mir/fatal.h"
 
 #include "mir/test/fake_shared.h"
@@ -25,10 +26,13 @@
 #include "mir/test/doubles/mock_drm.h"
 #include "mir/test/doubles/mock_gbm.h"
 
+#include <map>
 #include <stdexcept>
+#include <string>
 
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
+#include <drm_fourcc.h>
 #include <fcntl.h>
 
 namespace mg = mir::graphics;
@@ -46,6 +50,8 @@ class NullPageFlipper : public mgg::PageFlipper
 {
 public:
     bool schedule_flip(uint32_t,uint32_t,uint32_t) override { return true; }
+    bool supports_atomic() const override { return false; }
+    bool schedule_atomic_flip(mgg::AtomicCommit const&) override { return false; }
     mg::Frame wait_for_flip(uint32_t) override { return {}; }
 };
 
@@ -53,6 +59,8 @@ class MockPageFlipper : public mgg::PageFlipper
 {
 public:
     MOCK_METHOD3(schedule_flip, bool(uint32_t,uint32_t,uint32_t));
+    MOCK_CONST_METHOD0(supports_atomic, bool());
+    MOCK_METHOD1(schedule_atomic_flip, bool(mgg::AtomicCommit const&));
     MOCK_METHOD1(wait_for_flip, mg::Frame(uint32_t));
 };
 
@@ -148,6 +156,62 @@ public:
         mock_drm.prepare(drm_device);
     }
 
+    /// A connected CRTC with a primary and an overlay plane, driven by atomic KMS
+    void setup_atomic_outputs_connected_crtc()
+    {
+        uint32_t const possible_crtcs_mask{0x1};
+
+        mock_drm.reset(drm_device);
+
+        mock_drm.add_crtc(
+            drm_device,
+            crtc_ids[0],
+            drmModeModeInfo());
+        mock_drm.add_encoder(
+            drm_device,
+            encoder_ids[0],
+            crtc_ids[0],
+            possible_crtcs_mask);
+        mock_drm.add_connector(
+            drm_device,
+            connector_ids[0],
+            DRM_MODE_CONNECTOR_VGA,
+            DRM_MODE_CONNECTED,
+            encoder_ids[0],
+            modes,
+            possible_encoder_ids1,
+            geom::Size());
+
+        mock_drm.add_plane(drm_device, primary_plane_id, crtc_ids[0], possible_crtcs_mask, {DRM_FORMAT_XRGB8888});
+        mock_drm.add_plane(drm_device, overlay_plane_id, 0, possible_crtcs_mask, {DRM_FORMAT_ARGB8888});
+        add_plane_properties(primary_plane_id, DRM_PLANE_TYPE_PRIMARY);
+        add_plane_properties(overlay_plane_id, DRM_PLANE_TYPE_OVERLAY);
+
+        add_property(crtc_ids[0], "MODE_ID");
+        add_property(crtc_ids[0], "ACTIVE");
+        add_property(connector_ids[0], "CRTC_ID");
+
+        mock_drm.prepare(drm_device);
+
+        EXPECT_CALL(mock_page_flipper, supports_atomic())
+            .WillRepeatedly(Return(true));
+    }
+
+    void add_plane_properties(uint32_t plane_id, uint64_t type)
+    {
+        add_property(plane_id, "type", type);
+        for (auto const name : {"FB_ID", "CRTC_ID", "SRC_X", "SRC_Y", "SRC_W", "SRC_H",
+                                "CRTC_X", "CRTC_Y", "CRTC_W", "CRTC_H"})
+        {
+            add_property(plane_id, name);
+        }
+    }
+
+    void add_property(uint32_t object_id, char const* name, uint64_t value = 0)
+    {
+        property_ids[name] = mock_drm.add_property(drm_device, object_id, name, value);
+    }
+
     void append_fb_id(uint32_t fb_id)
     {
         EXPECT_CALL(mock_drm, drmModeAddFB2(_,_,_,_,_,_,_,_,_))
@@ -173,8 +237,18 @@ public:
     std::vector<uint32_t> const connector_ids;
     std::vector<uint32_t> possible_encoder_ids1;
     std::vector<uint32_t> possible_encoder_ids2;
+
+    std::vector<drmModeModeInfo> modes{
+        mtd::FakeDRMResources::create_mode(1920, 1080, 138500, 2080, 1111, mtd::FakeDRMResources::PreferredMode)};
+    uint32_t const primary_plane_id{40};
+    uint32_t const overlay_plane_id{41};
+    std::map<std::string, uint32_t> property_ids;
 };
 
+MATCHER_P(IsOverlayPlane, id, "")
+{
+    return arg.id == id;
+}
 }
 
 TEST_F(RealKMSOutputTest, operations_use_existing_crtc)
@@ -548,3 +622,436 @@ TEST_F(RealKMSOutputTest, drm_set_gamma_failure_does_not_throw)
 
     EXPECT_NO_THROW(output.set_gamma(gamma););
 }
+
+#ifndef MIR_NO_GBM_MODIFIERS
+TEST_F(RealKMSOutputTest, fb_for_bo_with_explicit_modifier_passes_modifier_to_kms)
+{
+    using namespace testing;
+
+    uint64_t const modifier{0x0100000000000001};
+    uint32_t const fb_id{68};
+
+    setup_outputs_connected_crtc();
+
+    mgg::RealKMSOutput output{
+        drm_fd,
+        mg::kms::get_connector(drm_fd, connector_ids[0]),
+        mt::fake_shared(mock_page_flipper)};
+
+    ON_CALL(mock_gbm, gbm_bo_get_modifier(fake_bo))
+        .WillByDefault(Return(modifier));
+
+    EXPECT_CALL(mock_drm, drmModeAddFB2WithModifiers(drm_fd, _, _, _, _, _, _, Pointee(modifier), _, DRM_MODE_FB_MODIFIERS))
+        .WillOnce(DoAll(SetArgPointee<8>(fb_id), Return(0)));
+    EXPECT_CALL(mock_drm, drmModeAddFB2(_,_,_,_,_,_,_,_,_))
+        .Times(0);
+
+    EXPECT_CALL(mock_drm, drmModeSetCrtc(_, crtc_ids[0], fb_id, _, _, Pointee(connector_ids[0]), _, _))
+        .Times(1);
+
+    auto fb = output.fb_for(fake_bo);
+
+    ASSERT_THAT(fb, NotNull());
+    EXPECT_TRUE(output.set_crtc(*fb));
+}
+
+TEST_F(RealKMSOutputTest, fb_for_linear_bo_falls_back_to_implicit_layout_if_kms_rejects_modifier)
+{
+    using namespace testing;
+
+    uint32_t const fb_id{69};
+
+    setup_outputs_connected_crtc();
+
+    mgg::RealKMSOutput output{
+        drm_fd,
+        mg::kms::get_connector(drm_fd, connector_ids[0]),
+        mt::fake_shared(mock_page_flipper)};
+
+    ON_CALL(mock_gbm, gbm_bo_get_modifier(fake_bo))
+        .WillByDefault(Return(DRM_FORMAT_MOD_LINEAR));
+
+    EXPECT_CALL(mock_drm, drmModeAddFB2WithModifiers(_,_,_,_,_,_,_,_,_,_))
+        .WillOnce(Return(-EINVAL));
+    append_fb_id(fb_id);
+
+    EXPECT_CALL(mock_drm, drmModeSetCrtc(_, crtc_ids[0], fb_id, _, _, Pointee(connector_ids[0]), _, _))
+        .Times(1);
+
+    auto fb = output.fb_for(fake_bo);
+
+    ASSERT_THAT(fb, NotNull());
+    EXPECT_TRUE(output.set_crtc(*fb));
+}
+
+TEST_F(RealKMSOutputTest, fb_for_tiled_bo_fails_if_kms_rejects_modifier)
+{
+    using namespace testing;
+
+    uint64_t const y_tiled{0x0100000000000002};
+
+    setup_outputs_connected_crtc();
+
+    mgg::RealKMSOutput output{
+        drm_fd,
+        mg::kms::get_connector(drm_fd, connector_ids[0]),
+        mt::fake_shared(mock_page_flipper)};
+
+    ON_CALL(mock_gbm, gbm_bo_get_modifier(fake_bo))
+        .WillByDefault(Return(y_tiled));
+
+    EXPECT_CALL(mock_drm, drmModeAddFB2WithModifiers(_,_,_,_,_,_,_,_,_,_))
+        .WillOnce(Return(-EINVAL));
+    EXPECT_CALL(mock_drm, drmModeAddFB2(_,_,_,_,_,_,_,_,_))
+        .Times(0);
+
+    EXPECT_THAT(output.fb_for(fake_bo), IsNull());
+}
+#endif
+
+TEST_F(RealKMSOutputTest, has_no_overlay_planes_without_atomic_kms)
+{
+    using namespace testing;
+
+    uint32_t const fb_id{70};
+
+    setup_atomic_outputs_connected_crtc();
+    append_fb_id(fb_id);
+
+    mgg::RealKMSOutput output{
+        drm_fd,
+        mg::kms::get_connector(drm_fd, connector_ids[0]),
+        mt::fake_shared(null_page_flipper)};
+
+    auto fb = output.fb_for(fake_bo);
+    ASSERT_TRUE(output.set_crtc(*fb));
+
+    // Legacy KMS would change the plane immediately, tearing
+    EXPECT_CALL(mock_drm, drmModeSetPlane(_,_,_,_,_,_,_))
+        .Times(0);
+    EXPECT_CALL(mock_drm, drmModeAtomicCommit(_,_,_,_))
+        .Times(0);
+
+    EXPECT_THAT(output.overlay_planes(), IsEmpty());
+    EXPECT_FALSE(output.set_overlay(overlay_plane_id, fb, {{0, 0}, {64, 64}}, {{10, 10}, {64, 64}}));
+}
+
+TEST_F(RealKMSOutputTest, lists_overlay_planes_with_atomic_kms)
+{
+    using namespace testing;
+
+    setup_atomic_outputs_connected_crtc();
+
+    mgg::RealKMSOutput output{
+        drm_fd,
+        mg::kms::get_connector(drm_fd, connector_ids[0]),
+        mt::fake_shared(mock_page_flipper)};
+
+    auto const planes = output.overlay_planes();
+
+    ASSERT_THAT(planes, ElementsAre(IsOverlayPlane(overlay_plane_id)));
+    EXPECT_THAT(planes[0].formats, ElementsAre(DRM_FORMAT_ARGB8888));
+}
+
+TEST_F(RealKMSOutputTest, overlay_is_only_test_committed_until_the_next_page_flip)
+{
+    using namespace testing;
+
+    uint32_t const primary_fb_id{71};
+    uint32_t const overlay_fb_id{72};
+
+    setup_atomic_outputs_connected_crtc();
+    EXPECT_CALL(mock_drm, drmModeAddFB2(_,_,_,_,_,_,_,_,_))
+        .WillOnce(DoAll(SetArgPointee<7>(primary_fb_id), Return(0)))
+        .WillOnce(DoAll(SetArgPointee<7>(overlay_fb_id), Return(0)));
+
+    mgg::RealKMSOutput output{
+        drm_fd,
+        mg::kms::get_connector(drm_fd, connector_ids[0]),
+        mt::fake_shared(mock_page_flipper)};
+
+    auto const primary_fb = output.fb_for(fake_bo);
+    auto const overlay_fb = output.fb_for(fake_bo);
+    ASSERT_TRUE(output.set_crtc(*primary_fb));
+
+    EXPECT_CALL(mock_drm, drmModeAtomicCommit(drm_fd, _, DRM_MODE_ATOMIC_TEST_ONLY, _))
+        .WillOnce(Return(0));
+    EXPECT_CALL(mock_drm, drmModeAtomicCommit(drm_fd, _, Ne(DRM_MODE_ATOMIC_TEST_ONLY), _))
+        .Times(0);
+    EXPECT_CALL(mock_drm, drmModeSetPlane(_,_,_,_,_,_,_))
+        .Times(0);
+
+    EXPECT_TRUE(output.set_overlay(overlay_plane_id, overlay_fb, {{0, 0}, {64, 32}}, {{10, 20}, {128, 64}}));
+    Mock::VerifyAndClearExpectations(&mock_drm);
+
+    // The flip takes the overlay with it
+    EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, _, _, _))
+        .Times(AnyNumber());
+    EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, overlay_plane_id, property_ids["FB_ID"], overlay_fb_id));
+    EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, overlay_plane_id, property_ids["CRTC_ID"], crtc_ids[0]));
+    EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, overlay_plane_id, property_ids["SRC_W"], 64u << 16));
+    EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, overlay_plane_id, property_ids["SRC_H"], 32u << 16));
+    EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, overlay_plane_id, property_ids["CRTC_X"], 10));
+    EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, overlay_plane_id, property_ids["CRTC_Y"], 20));
+    EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, overlay_plane_id, property_ids["CRTC_W"], 128));
+    EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, overlay_plane_id, property_ids["CRTC_H"], 64));
+
+    mgg::AtomicCommit commit;
+    EXPECT_TRUE(output.add_page_flip(commit, *primary_fb));
+}
+
+TEST_F(RealKMSOutputTest, overlay_rejected_by_the_test_commit_is_not_flipped)
+{
+    using namespace testing;
+
+    uint32_t const primary_fb_id{73};
+    uint32_t const overlay_fb_id{74};
+
+    setup_atomic_outputs_connected_crtc();
+    EXPECT_CALL(mock_drm, drmModeAddFB2(_,_,_,_,_,_,_,_,_))
+        .WillOnce(DoAll(SetArgPointee<7>(primary_fb_id), Return(0)))
+        .WillOnce(DoAll(SetArgPointee<7>(overlay_fb_id), Return(0)));
+
+    mgg::RealKMSOutput output{
+        drm_fd,
+        mg::kms::get_connector(drm_fd, connector_ids[0]),
+        mt::fake_shared(mock_page_flipper)};
+
+    auto const primary_fb = output.fb_for(fake_bo);
+    auto const overlay_fb = output.fb_for(fake_bo);
+    ASSERT_TRUE(output.set_crtc(*primary_fb));
+
+    EXPECT_CALL(mock_drm, drmModeAtomicCommit(drm_fd, _, DRM_MODE_ATOMIC_TEST_ONLY, _))
+        .WillOnce(Return(-EINVAL));
+
+    EXPECT_FALSE(output.set_overlay(overlay_plane_id, overlay_fb, {{0, 0}, {64, 32}}, {{10, 20}, {128, 64}}));
+
+    EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, _, _, _))
+        .Times(AnyNumber());
+    EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, overlay_plane_id, _, _))
+        .Times(0);
+
+    mgg::AtomicCommit commit;
+    EXPECT_TRUE(output.add_page_flip(commit, *primary_fb));
+}
+
+TEST_F(RealKMSOutputTest, cleared_overlay_is_switched_off_by_the_next_page_flip_only)
+{
+    using namespace testing;
+
+    uint32_t const primary_fb_id{75};
+    uint32_t const overlay_fb_id{76};
+
+    setup_atomic_outputs_connected_crtc();
+    EXPECT_CALL(mock_drm, drmModeAddFB2(_,_,_,_,_,_,_,_,_))
+        .WillOnce(DoAll(SetArgPointee<7>(primary_fb_id), Return(0)))
+        .WillOnce(DoAll(SetArgPointee<7>(overlay_fb_id), Return(0)));
+
+    mgg::RealKMSOutput output{
+        drm_fd,
+        mg::kms::get_connector(drm_fd, connector_ids[0]),
+        mt::fake_shared(mock_page_flipper)};
+
+    auto const primary_fb = output.fb_for(fake_bo);
+    auto const overlay_fb = output.fb_for(fake_bo);
+    ASSERT_TRUE(output.set_crtc(*primary_fb));
+    ASSERT_TRUE(output.set_overlay(overlay_plane_id, overlay_fb, {{0, 0}, {64, 32}}, {{10, 20}, {128, 64}}));
+    {
+        mgg::AtomicCommit commit;
+        ASSERT_TRUE(output.add_page_flip(commit, *primary_fb));
+    }
+
+    EXPECT_CALL(mock_drm, drmModeAtomicCommit(_,_,_,_))
+        .Times(0);
+    EXPECT_TRUE(output.set_overlay(overlay_plane_id, nullptr, {}, {}));
+    Mock::VerifyAndClearExpectations(&mock_drm);
+
+    EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, _, _, _))
+        .Times(AnyNumber());
+    EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, overlay_plane_id, property_ids["FB_ID"], 0));
+    EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, overlay_plane_id, property_ids["CRTC_ID"], 0));
+    {
+        mgg::AtomicCommit commit;
+        EXPECT_TRUE(output.add_page_flip(commit, *primary_fb));
+    }
+    Mock::VerifyAndClearExpectations(&mock_drm);
+
+    // Once off, the plane is free for other CRTCs to use
+    EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, _, _, _))
+        .Times(AnyNumber());
+    EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, overlay_plane_id, _, _))
+        .Times(0);
+    {
+        mgg::AtomicCommit commit;
+        EXPECT_TRUE(output.add_page_flip(commit, *primary_fb));
+    }
+}
+
+TEST_F(RealKMSOutputTest, set_crtc_modesets_atomically_with_atomic_kms)
+{
+    using namespace testing;
+
+    uint32_t const fb_id{77};
+    uint32_t const mode_blob_id{90};
+
+    setup_atomic_outputs_connected_crtc();
+    append_fb_id(fb_id);
+
+    mgg::RealKMSOutput output{
+        drm_fd,
+        mg::kms::get_connector(drm_fd, connector_ids[0]),
+        mt::fake_shared(mock_page_flipper)};
+
+    auto const fb = output.fb_for(fake_bo);
+
+    EXPECT_CALL(mock_drm, drmModeCreatePropertyBlob(drm_fd, _, sizeof(drmModeModeInfo), _))
+        .WillOnce(DoAll(SetArgPointee<3>(mode_blob_id), Return(0)));
+    EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, _, _, _))
+        .Times(AnyNumber());
+    EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, crtc_ids[0], property_ids["MODE_ID"], mode_blob_id));
+    EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, crtc_ids[0], property_ids["ACTIVE"], 1));
+    EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, connector_ids[0], property_ids["CRTC_ID"], crtc_ids[0]));
+    EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, primary_plane_id, property_ids["FB_ID"], fb_id));
+    EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, primary_plane_id, property_ids["CRTC_ID"], crtc_ids[0]));
+    EXPECT_CALL(mock_drm, drmModeAtomicCommit(drm_fd, _, DRM_MODE_ATOMIC_ALLOW_MODESET, nullptr))
+        .WillOnce(Return(0));
+    EXPECT_CALL(mock_drm, drmModeSetCrtc(_,_,_,_,_,_,_,_))
+        .Times(0);
+    EXPECT_CALL(mock_drm, drmModeDestroyPropertyBlob(_, _))
+        .Times(0);
+
+    EXPECT_TRUE(output.set_crtc(*fb));
+    // The output restores the saved CRTC when it is destroyed
+    Mock::VerifyAndClearExpectations(&mock_drm);
+}
+
+TEST_F(RealKMSOutputTest, set_crtc_releases_the_previous_mode_blob)
+{
+    using namespace testing;
+
+    uint32_t const fb_id{78};
+    uint32_t const first_blob_id{91};
+    uint32_t const second_blob_id{92};
+
+    setup_atomic_outputs_connected_crtc();
+    append_fb_id(fb_id);
+
+    mgg::RealKMSOutput output{
+        drm_fd,
+        mg::kms::get_connector(drm_fd, connector_ids[0]),
+        mt::fake_shared(mock_page_flipper)};
+
+    auto const fb = output.fb_for(fake_bo);
+
+    EXPECT_CALL(mock_drm, drmModeCreatePropertyBlob(drm_fd, _, _, _))
+        .WillOnce(DoAll(SetArgPointee<3>(first_blob_id), Return(0)))
+        .WillOnce(DoAll(SetArgPointee<3>(second_blob_id), Return(0)));
+
+    ASSERT_TRUE(output.set_crtc(*fb));
+
+    EXPECT_CALL(mock_drm, drmModeDestroyPropertyBlob(drm_fd, first_blob_id));
+    EXPECT_CALL(mock_drm, drmModeDestroyPropertyBlob(drm_fd, second_blob_id))
+        .Times(0);
+
+    EXPECT_TRUE(output.set_crtc(*fb));
+    // The output restores the saved CRTC when it is destroyed
+    Mock::VerifyAndClearExpectations(&mock_drm);
+}
+
+TEST_F(RealKMSOutputTest, set_crtc_falls_back_to_legacy_modeset_if_atomic_commit_fails)
+{
+    using namespace testing;
+
+    uint32_t const fb_id{79};
+    uint32_t const mode_blob_id{93};
+
+    setup_atomic_outputs_connected_crtc();
+    append_fb_id(fb_id);
+
+    mgg::RealKMSOutput output{
+        drm_fd,
+        mg::kms::get_connector(drm_fd, connector_ids[0]),
+        mt::fake_shared(mock_page_flipper)};
+
+    auto const fb = output.fb_for(fake_bo);
+
+    EXPECT_CALL(mock_drm, drmModeCreatePropertyBlob(drm_fd, _, _, _))
+        .WillOnce(DoAll(SetArgPointee<3>(mode_blob_id), Return(0)));
+    EXPECT_CALL(mock_drm, drmModeAtomicCommit(drm_fd, _, DRM_MODE_ATOMIC_ALLOW_MODESET, _))
+        .WillOnce(Return(-EINVAL));
+    EXPECT_CALL(mock_drm, drmModeDestroyPropertyBlob(drm_fd, mode_blob_id));
+    EXPECT_CALL(mock_drm, drmModeSetCrtc(drm_fd, crtc_ids[0], fb_id, _, _, Pointee(connector_ids[0]), 1, _))
+        .WillOnce(Return(0));
+
+    EXPECT_TRUE(output.set_crtc(*fb));
+    // The output restores the saved CRTC when it is destroyed
+    Mock::VerifyAndClearExpectations(&mock_drm);
+}
+
+TEST_F(RealKMSOutputTest, add_page_flip_sets_the_primary_plane_and_flips_the_crtc)
+{
+    using namespace testing;
+
+    uint32_t const fb_id{80};
+
+    setup_atomic_outputs_connected_crtc();
+    append_fb_id(fb_id);
+
+    mgg::RealKMSOutput output{
+        drm_fd,
+        mg::kms::get_connector(drm_fd, connector_ids[0]),
+        mt::fake_shared(mock_page_flipper)};
+
+    auto const fb = output.fb_for(fake_bo);
+    ASSERT_TRUE(output.set_crtc(*fb));
+
+    EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, _, _, _))
+        .Times(AnyNumber());
+    EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, primary_plane_id, property_ids["FB_ID"], fb_id));
+    EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, primary_plane_id, property_ids["CRTC_ID"], crtc_ids[0]));
+    EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, primary_plane_id, property_ids["SRC_X"], 0));
+    EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, primary_plane_id, property_ids["SRC_Y"], 0));
+    EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, primary_plane_id, property_ids["SRC_W"], 1920u << 16));
+    EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, primary_plane_id, property_ids["SRC_H"], 1080u << 16));
+    EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, primary_plane_id, property_ids["CRTC_X"], 0));
+    EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, primary_plane_id, property_ids["CRTC_Y"], 0));
+    EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, primary_plane_id, property_ids["CRTC_W"], 1920));
+    EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, primary_plane_id, property_ids["CRTC_H"], 1080));
+    // Flips are committed together by the caller
+    EXPECT_CALL(mock_drm, drmModeAtomicCommit(_,_,_,_))
+        .Times(0);
+    EXPECT_CALL(mock_page_flipper, schedule_flip(_,_,_))
+        .Times(0);
+
+    mgg::AtomicCommit commit;
+    EXPECT_TRUE(output.add_page_flip(commit, *fb));
+
+    EXPECT_THAT(commit.flips(), ElementsAre(AllOf(
+        Field(&mgg::FlipTarget::crtc_id, crtc_ids[0]),
+        Field(&mgg::FlipTarget::connector_id, connector_ids[0]))));
+}
+
+TEST_F(RealKMSOutputTest, add_page_flip_fails_without_atomic_kms)
+{
+    using namespace testing;
+
+    uint32_t const fb_id{81};
+
+    setup_atomic_outputs_connected_crtc();
+    append_fb_id(fb_id);
+
+    mgg::RealKMSOutput output{
+        drm_fd,
+        mg::kms::get_connector(drm_fd, connector_ids[0]),
+        mt::fake_shared(null_page_flipper)};
+
+    auto const fb = output.fb_for(fake_bo);
+    ASSERT_TRUE(output.set_crtc(*fb));
+
+    EXPECT_CALL(mock_drm, drmModeAtomicAddProperty(_, _, _, _))
+        .Times(0);
+
+    mgg::AtomicCommit commit;
+    EXPECT_FALSE(output.add_page_flip(commit, *fb));
+    EXPECT_THAT(commit.flips(), IsEmpty());
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/platforms/gbm-kms/server/kms/render_time_predictor.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace mgg = mir::graphics::gbm;
+
+using namespace testing;
+using namespace std::chrono;
+
+namespace
+{
+auto const fallback = microseconds{50000};
+auto const base_margin = microseconds{1000};
+
+void record_frames(mgg::RenderTimePredictor& predictor, int frames, microseconds render_time)
+{
+    for (int i = 0; i != frames; ++i)
+        predictor.record(render_time);
+}
+}
+
+TEST(RenderTimePredictor, uses_fallback_until_enough_frames_are_measured)
+{
+    mgg::RenderTimePredictor predictor{fallback};
+    EXPECT_THAT(predictor.predicted_render_time(), Eq(fallback));
+
+    record_frames(predictor, 3, microseconds{2000});
+    EXPECT_THAT(predictor.predicted_render_time(), Eq(fallback));
+
+    record_frames(predictor, 20, microseconds{2000});
+    EXPECT_THAT(predictor.predicted_render_time(), Eq(microseconds{2000} + base_margin));
+}
+
+TEST(RenderTimePredictor, ignores_the_odd_slow_frame)
+{
+    mgg::RenderTimePredictor predictor{fallback};
+
+    record_frames(predictor, 61, microseconds{2000});
+    record_frames(predictor, 2, microseconds{14000});
+
+    EXPECT_THAT(predictor.predicted_render_time(), Eq(microseconds{2000} + base_margin));
+}
+
+TEST(RenderTimePredictor, allows_for_frequently_slow_frames)
+{
+    mgg::RenderTimePredictor predictor{fallback};
+
+    record_frames(predictor, 54, microseconds{2000});
+    record_frames(predictor, 10, microseconds{14000});
+
+    EXPECT_THAT(predictor.predicted_render_time(), Eq(microseconds{14000} + base_margin));
+}
+
+TEST(RenderTimePredictor, follows_changing_render_times)
+{
+    mgg::RenderTimePredictor predictor{fallback};
+
+    record_frames(predictor, 64, microseconds{9000});
+    record_frames(predictor, 64, microseconds{3000});
+
+    EXPECT_THAT(predictor.predicted_render_time(), Eq(microseconds{3000} + base_margin));
+}
+
+TEST(RenderTimePredictor, missed_deadlines_add_margin_until_frames_make_it_again)
+{
+    mgg::RenderTimePredictor predictor{fallback};
+    record_frames(predictor, 10, microseconds{3000});
+
+    predictor.missed_deadline();
+    predictor.missed_deadline();
+    auto const cautious = predictor.predicted_render_time();
+    EXPECT_THAT(cautious, Gt(microseconds{3000} + base_margin));
+
+    record_frames(predictor, 600, microseconds{3000});
+    EXPECT_THAT(predictor.predicted_render_time(), Eq(microseconds{3000} + base_margin));
+}
@@ -206,6 +206,52 @@ TEST_F(GLRenderer, uses_premultiplied_src_alpha_for_rgba_surfaces)
     renderer.render(renderable_list);
 }
 
+TEST_F(GLRenderer, draws_opaque_region_of_rgba_surfaces_without_blending)
+{
+    EXPECT_CALL(*renderable, shaped()).WillOnce(Return(true));
+    EXPECT_CALL(*renderable, screen_position())
+        .WillRepeatedly(Return(mir::geometry::Rectangle{{0, 0}, {30, 40}}));
+    EXPECT_CALL(*renderable, opaque_region())
+        .WillRepeatedly(Return(mir::geometry::Rectangles{{{5, 5}, {20, 30}}}));
+    EXPECT_CALL(*renderable, transformation()).WillRepeatedly(Return(glm::mat4(1)));
+
+    // One opaque rectangle, then the four translucent ones around it in one draw
+    EXPECT_CALL(mock_gl, glDisable(GL_BLEND));
+    EXPECT_CALL(mock_gl, glEnable(GL_BLEND)).Times(1);
+    EXPECT_CALL(mock_gl, glDrawArrays(GL_TRIANGLES, 0, 6));
+    EXPECT_CALL(mock_gl, glDrawArrays(GL_TRIANGLES, 6, 24));
+
+    mrg::Renderer renderer(display_buffer);
+    renderer.render(renderable_list);
+}
+
+TEST_F(GLRenderer, uploads_vertices_of_all_renderables_once_per_frame)
+{
+    renderable_list.push_back(renderable);
+    renderable_list.push_back(renderable);
+
+    EXPECT_CALL(mock_gl, glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(3 * 6 * sizeof(mgl::Vertex)), _, GL_STREAM_DRAW));
+    EXPECT_CALL(mock_gl, glDrawArrays(GL_TRIANGLES, 0, 6));
+    EXPECT_CALL(mock_gl, glDrawArrays(GL_TRIANGLES, 6, 6));
+    EXPECT_CALL(mock_gl, glDrawArrays(GL_TRIANGLES, 12, 6));
+
+    mrg::Renderer renderer(display_buffer);
+    renderer.render(renderable_list);
+}
+
+TEST_F(GLRenderer, only_changes_gl_state_between_renderables_when_needed)
+{
+    renderable_list.push_back(renderable);
+    renderable_list.push_back(renderable);
+
+    EXPECT_CALL(mock_gl, glUseProgram(_)).Times(1);
+    EXPECT_CALL(mock_gl, glDisable(GL_BLEND)).Times(1);
+    EXPECT_CALL(mock_gl, glVertexAttribPointer(_, _, _, _, _, _)).Times(2);
+
+    mrg::Renderer renderer(display_buffer);
+    renderer.render(renderable_list);
+}
+
 TEST_F(GLRenderer, avoids_src_alpha_for_rgbx_blending)  // LP: #1423462
 {
     EXPECT_CALL(*renderable, alpha()).WillRepeatedly(Return(0.5f));
@@ -316,6 +362,122 @@ TEST_F(GLRenderer, dont_set_scissor_test_when_unnecessary)
 }
 
 
+TEST_F(GLRenderer, scissors_to_damage_when_back_buffer_age_is_known)
+{
+    mir::geometry::Rectangle const view_area{{0,0}, {1920,1080}};
+
+    ON_CALL(mock_egl, eglQueryString(_,EGL_EXTENSIONS))
+        .WillByDefault(Return("EGL_EXT_buffer_age"));
+    ON_CALL(mock_egl, eglQuerySurface(_,_,EGL_WIDTH,_))
+        .WillByDefault(DoAll(SetArgPointee<3>(1920), Return(EGL_TRUE)));
+    ON_CALL(mock_egl, eglQuerySurface(_,_,EGL_HEIGHT,_))
+        .WillByDefault(DoAll(SetArgPointee<3>(1080), Return(EGL_TRUE)));
+    ON_CALL(mock_egl, eglQuerySurface(_,_,EGL_BUFFER_AGE_EXT,_))
+        .WillByDefault(DoAll(SetArgPointee<3>(1), Return(EGL_TRUE)));
+    ON_CALL(mock_display_buffer, view_area())
+        .WillByDefault(Return(view_area));
+
+    mrg::Renderer renderer(mock_display_buffer);
+    renderer.render(renderable_list);   // The first frame is always in full
+    renderer.set_damage(mir::geometry::Rectangles{mir::geometry::Rectangle{{10, 20}, {30, 40}}});
+
+    EXPECT_CALL(mock_gl, glEnable(GL_SCISSOR_TEST));
+    EXPECT_CALL(mock_gl, glScissor(10, 1020, 30, 40));
+    EXPECT_CALL(mock_gl, glDisable(GL_SCISSOR_TEST));
+
+    renderer.render(renderable_list);
+}
+
+TEST_F(GLRenderer, repaints_everything_after_being_suspended)
+{
+    mir::geometry::Rectangle const view_area{{0,0}, {1920,1080}};
+    mir::geometry::Rectangles const damage{mir::geometry::Rectangle{{10, 20}, {30, 40}}};
+
+    ON_CALL(mock_egl, eglQueryString(_,EGL_EXTENSIONS))
+        .WillByDefault(Return("EGL_EXT_buffer_age"));
+    ON_CALL(mock_egl, eglQuerySurface(_,_,EGL_WIDTH,_))
+        .WillByDefault(DoAll(SetArgPointee<3>(1920), Return(EGL_TRUE)));
+    ON_CALL(mock_egl, eglQuerySurface(_,_,EGL_HEIGHT,_))
+        .WillByDefault(DoAll(SetArgPointee<3>(1080), Return(EGL_TRUE)));
+    ON_CALL(mock_egl, eglQuerySurface(_,_,EGL_BUFFER_AGE_EXT,_))
+        .WillByDefault(DoAll(SetArgPointee<3>(1), Return(EGL_TRUE)));
+    ON_CALL(mock_display_buffer, view_area())
+        .WillByDefault(Return(view_area));
+
+    mrg::Renderer renderer(mock_display_buffer);
+    renderer.render(renderable_list);
+    renderer.set_damage(damage);
+    renderer.render(renderable_list);
+
+    // The back buffer is still one swap old, but a bypassed frame was shown
+    renderer.suspend();
+    renderer.set_damage(damage);
+
+    EXPECT_CALL(mock_gl, glEnable(GL_SCISSOR_TEST)).Times(0);
+    EXPECT_CALL(mock_gl, glScissor(_, _, _, _)).Times(0);
+
+    renderer.render(renderable_list);
+    testing::Mock::VerifyAndClearExpectations(&mock_gl);
+
+    renderer.set_damage(damage);
+
+    EXPECT_CALL(mock_gl, glEnable(GL_SCISSOR_TEST));
+    EXPECT_CALL(mock_gl, glScissor(10, 1020, 30, 40));
+
+    renderer.render(renderable_list);
+}
+
+TEST_F(GLRenderer, repaints_everything_when_back_buffer_predates_last_full_frame)
+{
+    mir::geometry::Rectangle const view_area{{0,0}, {1920,1080}};
+    mir::geometry::Rectangles const damage{mir::geometry::Rectangle{{10, 20}, {30, 40}}};
+
+    ON_CALL(mock_egl, eglQueryString(_,EGL_EXTENSIONS))
+        .WillByDefault(Return("EGL_EXT_buffer_age"));
+    ON_CALL(mock_egl, eglQuerySurface(_,_,EGL_WIDTH,_))
+        .WillByDefault(DoAll(SetArgPointee<3>(1920), Return(EGL_TRUE)));
+    ON_CALL(mock_egl, eglQuerySurface(_,_,EGL_HEIGHT,_))
+        .WillByDefault(DoAll(SetArgPointee<3>(1080), Return(EGL_TRUE)));
+    ON_CALL(mock_egl, eglQuerySurface(_,_,EGL_BUFFER_AGE_EXT,_))
+        .WillByDefault(DoAll(SetArgPointee<3>(2), Return(EGL_TRUE)));
+    ON_CALL(mock_display_buffer, view_area())
+        .WillByDefault(Return(view_area));
+
+    mrg::Renderer renderer(mock_display_buffer);
+    renderer.set_damage(damage);
+    renderer.render(renderable_list);
+    renderer.set_damage(damage);
+
+    EXPECT_CALL(mock_gl, glEnable(GL_SCISSOR_TEST)).Times(0);
+    EXPECT_CALL(mock_gl, glScissor(_, _, _, _)).Times(0);
+
+    renderer.render(renderable_list);
+}
+
+TEST_F(GLRenderer, repaints_everything_when_back_buffer_age_is_unknown)
+{
+    mir::geometry::Rectangle const view_area{{0,0}, {1920,1080}};
+
+    ON_CALL(mock_egl, eglQueryString(_,EGL_EXTENSIONS))
+        .WillByDefault(Return("EGL_EXT_buffer_age"));
+    ON_CALL(mock_egl, eglQuerySurface(_,_,EGL_WIDTH,_))
+        .WillByDefault(DoAll(SetArgPointee<3>(1920), Return(EGL_TRUE)));
+    ON_CALL(mock_egl, eglQuerySurface(_,_,EGL_HEIGHT,_))
+        .WillByDefault(DoAll(SetArgPointee<3>(1080), Return(EGL_TRUE)));
+    ON_CALL(mock_egl, eglQuerySurface(_,_,EGL_BUFFER_AGE_EXT,_))
+        .WillByDefault(DoAll(SetArgPointee<3>(0), Return(EGL_TRUE)));
+    ON_CALL(mock_display_buffer, view_area())
+        .WillByDefault(Return(view_area));
+
+    mrg::Renderer renderer(mock_display_buffer);
+    renderer.set_damage(mir::geometry::Rectangles{mir::geometry::Rectangle{{10, 20}, {30, 40}}});
+
+    EXPECT_CALL(mock_gl, glEnable(GL_SCISSOR_TEST)).Times(0);
+    EXPECT_CALL(mock_gl, glScissor(_, _, _, _)).Times(0);
+
+    renderer.render(renderable_list);
+}
+
 TEST_F(GLRenderer, unchanged_viewport_avoids_gl_calls)
 {
     int const screen_width = 1920;
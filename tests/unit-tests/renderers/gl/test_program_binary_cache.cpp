@@ -0,0 +1,205 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/renderers/gl/program_binary_cache.h"
+#include "mir_test_framework/temporary_environment_value.h"
+
+#include <boost/filesystem.hpp>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <fstream>
+#include <system_error>
+
+using namespace testing;
+namespace mrg = mir::renderer::gl;
+namespace mtf = mir_test_framework;
+namespace fs = boost::filesystem;
+
+namespace
+{
+struct ProgramBinaryCache : Test
+{
+    ProgramBinaryCache()
+    {
+        char name[] = "/tmp/mir_program_cache_XXXXXX";
+        if (mkdtemp(name) == nullptr)
+        {
+            throw std::system_error{errno, std::system_category(), "Failed to create temporary directory"};
+        }
+        temporary_directory = name;
+    }
+
+    ~ProgramBinaryCache()
+    {
+        boost::system::error_code ignored;
+        fs::remove_all(temporary_directory, ignored);
+    }
+
+    auto cache_files() const -> std::vector<fs::path>
+    {
+        std::vector<fs::path> files;
+        for (fs::recursive_directory_iterator i{temporary_directory}, end; i != end; ++i)
+        {
+            if (fs::is_regular_file(i->path()))
+                files.push_back(i->path());
+        }
+        return files;
+    }
+
+    std::string temporary_directory;
+    std::string const key{"vendor\nrenderer\nversion\nvertex source\0fragment source", 53};
+    mrg::ProgramBinaryCache::Binary const binary{0x1234, {'b', 'i', 'n', 'a', 'r', 'y'}};
+};
+
+MATCHER_P(BinaryEq, expected, "")
+{
+    return arg.format == expected.format && arg.data == expected.data;
+}
+}
+
+TEST_F(ProgramBinaryCache, loads_what_was_stored)
+{
+    mrg::ProgramBinaryCache const cache{temporary_directory};
+
+    cache.store(key, binary);
+
+    auto const loaded = cache.load(key);
+    ASSERT_TRUE(loaded);
+    EXPECT_THAT(*loaded, BinaryEq(binary));
+}
+
+TEST_F(ProgramBinaryCache, loads_what_another_instance_stored)
+{
+    mrg::ProgramBinaryCache{temporary_directory}.store(key, binary);
+
+    auto const loaded = mrg::ProgramBinaryCache{temporary_directory}.load(key);
+    ASSERT_TRUE(loaded);
+    EXPECT_THAT(*loaded, BinaryEq(binary));
+}
+
+TEST_F(ProgramBinaryCache, misses_for_a_different_key)
+{
+    mrg::ProgramBinaryCache const cache{temporary_directory};
+
+    cache.store(key, binary);
+
+    EXPECT_FALSE(cache.load(key + " (changed)"));
+}
+
+TEST_F(ProgramBinaryCache, creates_missing_directories)
+{
+    mrg::ProgramBinaryCache const cache{temporary_directory + "/mir/gl-programs"};
+
+    cache.store(key, binary);
+
+    EXPECT_TRUE(cache.load(key));
+}
+
+TEST_F(ProgramBinaryCache, later_store_replaces_entry)
+{
+    mrg::ProgramBinaryCache const cache{temporary_directory};
+    mrg::ProgramBinaryCache::Binary const newer{0x5678, {'n', 'e', 'w', 'e', 'r'}};
+
+    cache.store(key, binary);
+    cache.store(key, newer);
+
+    auto const loaded = cache.load(key);
+    ASSERT_TRUE(loaded);
+    EXPECT_THAT(*loaded, BinaryEq(newer));
+    EXPECT_THAT(cache_files().size(), Eq(1u));
+}
+
+TEST_F(ProgramBinaryCache, discarded_entry_is_not_loaded)
+{
+    mrg::ProgramBinaryCache const cache{temporary_directory};
+
+    cache.store(key, binary);
+    cache.discard(key);
+
+    EXPECT_FALSE(cache.load(key));
+    EXPECT_THAT(cache_files(), IsEmpty());
+}
+
+TEST_F(ProgramBinaryCache, ignores_truncated_entry)
+{
+    mrg::ProgramBinaryCache const cache{temporary_directory};
+    cache.store(key, binary);
+
+    auto const files = cache_files();
+    ASSERT_THAT(files.size(), Eq(1u));
+    fs::resize_file(files.front(), fs::file_size(files.front()) - 1);
+
+    EXPECT_FALSE(cache.load(key));
+}
+
+TEST_F(ProgramBinaryCache, ignores_entry_with_trailing_garbage)
+{
+    mrg::ProgramBinaryCache const cache{temporary_directory};
+    cache.store(key, binary);
+
+    auto const files = cache_files();
+    ASSERT_THAT(files.size(), Eq(1u));
+    std::ofstream{files.front().string(), std::ios::binary | std::ios::app} << "garbage";
+
+    EXPECT_FALSE(cache.load(key));
+}
+
+TEST_F(ProgramBinaryCache, ignores_file_that_is_not_an_entry)
+{
+    mrg::ProgramBinaryCache const cache{temporary_directory};
+    cache.store(key, binary);
+
+    auto const files = cache_files();
+    ASSERT_THAT(files.size(), Eq(1u));
+    std::ofstream{files.front().string(), std::ios::binary | std::ios::trunc} << "not a program binary";
+
+    EXPECT_FALSE(cache.load(key));
+}
+
+TEST_F(ProgramBinaryCache, store_to_unwritable_directory_is_harmless)
+{
+    mrg::ProgramBinaryCache const cache{"/proc/mir-program-cache"};
+
+    cache.store(key, binary);
+
+    EXPECT_FALSE(cache.load(key));
+}
+
+TEST_F(ProgramBinaryCache, without_a_directory_caches_nothing)
+{
+    mrg::ProgramBinaryCache const cache{""};
+
+    cache.store(key, binary);
+
+    EXPECT_FALSE(cache.load(key));
+}
+
+TEST_F(ProgramBinaryCache, default_directory_is_under_xdg_cache_home)
+{
+    mtf::TemporaryEnvironmentValue const cache_home{"XDG_CACHE_HOME", "/xdg/cache"};
+
+    EXPECT_THAT(mrg::ProgramBinaryCache::default_directory(), Eq("/xdg/cache/mir/gl-programs"));
+}
+
+TEST_F(ProgramBinaryCache, default_directory_falls_back_to_home)
+{
+    mtf::TemporaryEnvironmentValue const cache_home{"XDG_CACHE_HOME", nullptr};
+    mtf::TemporaryEnvironmentValue const home{"HOME", "/home/user"};
+
+    EXPECT_THAT(mrg::ProgramBinaryCache::default_directory(), Eq("/home/user/.cache/mir/gl-programs"));
+}
@@ -1230,6 +1230,48 @@ TEST_F(BasicSurfaceTest, adds_buffer_streams)
 
 }
 
+TEST_F(BasicSurfaceTest, opaque_region_of_stream_is_in_screen_coordinates)
+{
+    using namespace testing;
+    geom::Size const size{40, 30};
+    ON_CALL(*mock_buffer_stream, stream_size())
+        .WillByDefault(Return(size));
+    ON_CALL(*mock_buffer_stream, opaque_region())
+        .WillByDefault(Return(geom::Rectangles{{{1, 1}, {5, 5}}, {{35, 25}, {10, 10}}}));
+
+    std::list<ms::StreamInfo> streams = {
+        { mock_buffer_stream, {0,0}, {} },
+    };
+    surface.set_streams(streams);
+
+    auto renderables = surface.generate_renderables(this);
+    ASSERT_THAT(renderables.size(), Eq(1));
+    EXPECT_THAT(
+        renderables[0]->opaque_region(),
+        Eq(geom::Rectangles{
+            {rect.top_left + geom::Displacement{1, 1}, {5, 5}},
+            {rect.top_left + geom::Displacement{35, 25}, {5, 5}}}));
+}
+
+TEST_F(BasicSurfaceTest, opaque_region_of_scaled_stream_is_ignored)
+{
+    using namespace testing;
+    geom::Size const size{40, 30};
+    ON_CALL(*mock_buffer_stream, stream_size())
+        .WillByDefault(Return(size));
+    ON_CALL(*mock_buffer_stream, opaque_region())
+        .WillByDefault(Return(geom::Rectangles{{{0, 0}, size}}));
+
+    std::list<ms::StreamInfo> streams = {
+        { mock_buffer_stream, {0,0}, geom::Size{80, 60} },
+    };
+    surface.set_streams(streams);
+
+    auto renderables = surface.generate_renderables(this);
+    ASSERT_THAT(renderables.size(), Eq(1));
+    EXPECT_THAT(renderables[0]->opaque_region(), Eq(geom::Rectangles{}));
+}
+
 TEST_F(BasicSurfaceTest, moving_surface_repositions_all_associated_streams)
 {
     using namespace testing;
@@ -0,0 +1,169 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/server/scene/input_grid.h"
+#include "mir/test/doubles/stub_surface.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+using namespace testing;
+namespace ms = mir::scene;
+namespace geom = mir::geometry;
+namespace mtd = mir::test::doubles;
+
+namespace
+{
+struct RectangularSurface : mtd::StubSurface
+{
+    explicit RectangularSurface(geom::Rectangle const& area)
+        : area{area}
+    {
+    }
+
+    bool input_area_contains(geom::Point const& point) const override
+    {
+        ++lookups;
+        return area.contains(point);
+    }
+
+    auto input_extents() const -> geom::Rectangle override { return area; }
+
+    geom::Rectangle area;
+    mutable int lookups{0};
+};
+
+struct InputGrid : Test
+{
+    std::shared_ptr<RectangularSurface> surface_at(int x, int y, int width, int height)
+    {
+        return std::make_shared<RectangularSurface>(geom::Rectangle{{x, y}, {width, height}});
+    }
+
+    mir::scene::InputGrid grid{100};
+};
+}
+
+TEST_F(InputGrid, finds_nothing_when_empty)
+{
+    EXPECT_THAT(grid.surface_at({10, 10}), IsNull());
+}
+
+TEST_F(InputGrid, finds_topmost_surface_containing_point)
+{
+    auto const lower = surface_at(0, 0, 300, 300);
+    auto const upper = surface_at(150, 150, 300, 300);
+
+    grid.place_on_top(lower, 0);
+    grid.place_on_top(upper, 0);
+
+    EXPECT_THAT(grid.surface_at({50, 50}), Eq(lower));
+    EXPECT_THAT(grid.surface_at({200, 200}), Eq(upper));
+    EXPECT_THAT(grid.surface_at({400, 400}), Eq(upper));
+    EXPECT_THAT(grid.surface_at({500, 500}), IsNull());
+}
+
+TEST_F(InputGrid, higher_layers_are_above_lower_ones)
+{
+    auto const in_higher_layer = surface_at(0, 0, 200, 200);
+    auto const in_lower_layer = surface_at(0, 0, 200, 200);
+
+    grid.place_on_top(in_higher_layer, 1);
+    grid.place_on_top(in_lower_layer, 0);
+
+    EXPECT_THAT(grid.surface_at({50, 50}), Eq(in_higher_layer));
+}
+
+TEST_F(InputGrid, placing_again_raises_surface)
+{
+    auto const first = surface_at(0, 0, 200, 200);
+    auto const second = surface_at(0, 0, 200, 200);
+
+    grid.place_on_top(first, 0);
+    grid.place_on_top(second, 0);
+    ASSERT_THAT(grid.surface_at({50, 50}), Eq(second));
+
+    grid.place_on_top(first, 0);
+    EXPECT_THAT(grid.surface_at({50, 50}), Eq(first));
+}
+
+TEST_F(InputGrid, follows_surface_when_extents_are_updated)
+{
+    auto const surface = surface_at(0, 0, 50, 50);
+    grid.place_on_top(surface, 0);
+
+    surface->area = {{1000, 1000}, {50, 50}};
+    grid.update_extents(surface.get());
+
+    EXPECT_THAT(grid.surface_at({10, 10}), IsNull());
+    EXPECT_THAT(grid.surface_at({1010, 1010}), Eq(surface));
+}
+
+TEST_F(InputGrid, finds_nothing_after_removal)
+{
+    auto const surface = surface_at(0, 0, 50, 50);
+    grid.place_on_top(surface, 0);
+
+    grid.remove(surface.get());
+
+    EXPECT_THAT(grid.surface_at({10, 10}), IsNull());
+}
+
+TEST_F(InputGrid, handles_negative_coordinates)
+{
+    auto const left = surface_at(-150, -150, 100, 100);
+    auto const right = surface_at(0, 0, 100, 100);
+
+    grid.place_on_top(left, 0);
+    grid.place_on_top(right, 0);
+
+    EXPECT_THAT(grid.surface_at({-100, -100}), Eq(left));
+    EXPECT_THAT(grid.surface_at({-1, -1}), IsNull());
+    EXPECT_THAT(grid.surface_at({0, 0}), Eq(right));
+}
+
+TEST_F(InputGrid, orders_oversized_surfaces_with_the_rest)
+{
+    auto const below_background = surface_at(0, 0, 50, 50);
+    auto const background = surface_at(-10000, -10000, 20000, 20000);
+    auto const above_background = surface_at(100, 100, 50, 50);
+
+    grid.place_on_top(below_background, 0);
+    grid.place_on_top(background, 0);
+    grid.place_on_top(above_background, 0);
+
+    EXPECT_THAT(grid.surface_at({10, 10}), Eq(background));
+    EXPECT_THAT(grid.surface_at({110, 110}), Eq(above_background));
+    EXPECT_THAT(grid.surface_at({5000, -5000}), Eq(background));
+}
+
+TEST_F(InputGrid, only_asks_surfaces_near_the_point)
+{
+    std::vector<std::shared_ptr<RectangularSurface>> surfaces;
+    for (int i = 0; i != 100; ++i)
+    {
+        surfaces.push_back(surface_at(i * 100, 0, 100, 100));
+        grid.place_on_top(surfaces.back(), 0);
+    }
+
+    EXPECT_THAT(grid.surface_at({5050, 50}), Eq(surfaces[50]));
+
+    int total_lookups{0};
+    for (auto const& surface : surfaces)
+        total_lookups += surface->lookups;
+
+    EXPECT_THAT(total_lookups, Eq(1));
+}
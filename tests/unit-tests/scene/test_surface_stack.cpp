@@ -55,7 +55,7 @@ namespace
 
 void post_a_frame(mc::BufferStream& s)
 {
-    s.submit_buffer(std::make_shared<mtd::StubBuffer>());
+    s.submit_buffer(std::make_shared<mtd::StubBuffer>(), {});
 }
 
 MATCHER_P(SurfaceWithInputReceptionMode, mode, "")
@@ -342,6 +342,55 @@ TEST_F(SurfaceStack, scene_doesnt_count_pending_frames_from_partially_exposed_su
     EXPECT_EQ(0, stack.frames_pending(comp2));
 }
 
+TEST_F(SurfaceStack, scene_counts_pending_frames_from_surfaces_exposed_again)
+{
+    using namespace testing;
+
+    ms::SurfaceStack stack{report};
+    stack.register_compositor(this);
+    auto stream = std::make_shared<mtd::StubBufferStream>();
+    auto surface = std::make_shared<ms::BasicSurface>(
+        nullptr /* session */,
+        std::string("stub"),
+        geom::Rectangle{{},{}},
+        mir_pointer_unconfined,
+        std::list<ms::StreamInfo> { { stream, {}, {} } },
+        std::shared_ptr<mg::CursorImage>(),
+        report);
+
+    stack.add_surface(surface, default_params.input_mode);
+    post_a_frame(*stream);
+    post_a_frame(*stream);
+    post_a_frame(*stream);
+
+    for (auto const& elem : stack.scene_elements_for(this))
+        elem->occluded();
+
+    EXPECT_EQ(0, stack.frames_pending(this));
+
+    for (auto const& elem : stack.scene_elements_for(this))
+        elem->rendered();
+
+    EXPECT_EQ(3, stack.frames_pending(this));
+}
+
+TEST_F(SurfaceStack, scene_elements_are_unaffected_by_later_changes_to_the_stack)
+{
+    using namespace testing;
+
+    stack.add_surface(stub_surface1, default_params.input_mode);
+
+    auto const elements = stack.scene_elements_for(compositor_id);
+
+    stack.add_surface(stub_surface2, default_params.input_mode);
+    stack.remove_surface(stub_surface1);
+
+    EXPECT_THAT(elements, ElementsAre(SceneElementForStream(stub_buffer_stream1)));
+    EXPECT_THAT(
+        stack.scene_elements_for(compositor_id),
+        ElementsAre(SceneElementForStream(stub_buffer_stream2)));
+}
+
 TEST_F(SurfaceStack, surfaces_are_emitted_by_layer)
 {
     using namespace testing;
@@ -0,0 +1,116 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mir/events/block_pool.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <cstring>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace mev = mir::events;
+using namespace testing;
+
+namespace
+{
+struct BlockPool : Test
+{
+    std::uint32_t const capacity{8};
+    mev::BlockPool pool{100, capacity};
+};
+}
+
+TEST_F(BlockPool, blocks_are_big_enough_and_aligned)
+{
+    EXPECT_THAT(pool.block_size(), Ge(100u));
+
+    auto const block = pool.allocate();
+    ASSERT_THAT(block, NotNull());
+    EXPECT_THAT(reinterpret_cast<std::uintptr_t>(block) % alignof(std::max_align_t), Eq(0u));
+    EXPECT_TRUE(pool.owns(block));
+}
+
+TEST_F(BlockPool, hands_out_distinct_blocks_until_exhausted)
+{
+    std::set<void*> blocks;
+    for (auto i = 0u; i != capacity; ++i)
+    {
+        auto const block = pool.allocate();
+        ASSERT_THAT(block, NotNull());
+        memset(block, 0xff, pool.block_size());
+        blocks.insert(block);
+    }
+
+    EXPECT_THAT(blocks.size(), Eq(capacity));
+    EXPECT_THAT(pool.allocate(), IsNull());
+}
+
+TEST_F(BlockPool, reuses_released_blocks)
+{
+    std::vector<void*> blocks;
+    for (auto i = 0u; i != capacity; ++i)
+        blocks.push_back(pool.allocate());
+
+    pool.release(blocks[3]);
+
+    EXPECT_THAT(pool.allocate(), Eq(blocks[3]));
+}
+
+TEST_F(BlockPool, does_not_own_other_memory)
+{
+    int on_the_stack;
+    auto const on_the_heap = std::make_unique<char[]>(pool.block_size());
+
+    EXPECT_FALSE(pool.owns(&on_the_stack));
+    EXPECT_FALSE(pool.owns(on_the_heap.get()));
+}
+
+TEST_F(BlockPool, never_hands_out_a_block_twice_across_threads)
+{
+    mev::BlockPool shared_pool{sizeof(int), 4};
+    std::atomic<int> clashes{0};
+
+    auto const churn = [&]
+        {
+            for (auto i = 0; i != 100000; ++i)
+            {
+                if (auto const block = static_cast<std::atomic<int>*>(shared_pool.allocate()))
+                {
+                    if (block->exchange(1) != 0)
+                        ++clashes;
+                    block->store(0);
+                    shared_pool.release(block);
+                }
+            }
+        };
+
+    std::vector<void*> blocks;
+    for (auto i = 0; i != 4; ++i)
+        blocks.push_back(new (shared_pool.allocate()) std::atomic<int>{0});
+    for (auto const block : blocks)
+        shared_pool.release(block);
+
+    std::vector<std::thread> threads;
+    for (auto i = 0; i != 4; ++i)
+        threads.emplace_back(churn);
+    for (auto& thread : threads)
+        thread.join();
+
+    EXPECT_THAT(clashes, Eq(0));
+}
@@ -0,0 +1,179 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mir/events/event_builders.h"
+#include "mir/events/event.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <linux/input.h>
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mev = mir::events;
+using namespace testing;
+using namespace std::chrono_literals;
+
+namespace
+{
+// More than the pool MirEvents are allocated from holds
+auto const more_events_than_pooled = 1000;
+
+auto pointer_event(MirInputDeviceId device, float x) -> mir::EventUPtr
+{
+    return mev::make_event(
+        device, 1s, {}, mir_input_event_modifier_none, mir_pointer_action_motion, 0, x, 2*x, 0, 0, 1, 1);
+}
+
+auto device_of(MirEvent const& event) -> MirInputDeviceId
+{
+    return mir_input_event_get_device_id(mir_event_get_input_event(&event));
+}
+
+auto axis_of(MirEvent const& event, MirPointerAxis axis) -> float
+{
+    return mir_pointer_event_axis_value(
+        mir_input_event_get_pointer_event(mir_event_get_input_event(&event)), axis);
+}
+
+/// A device state event with a message too big for a MirEvent's inline segment
+auto event_with_many_keys_pressed(std::vector<uint32_t> const& pressed_keys) -> mir::EventUPtr
+{
+    return mev::make_event(
+        1s, mir_pointer_button_primary, mir_input_event_modifier_none, 3, 4,
+        {mev::InputDeviceState{MirInputDeviceId{5}, pressed_keys, 0}});
+}
+
+void expect_keys_pressed(MirEvent const& event, std::vector<uint32_t> const& pressed_keys)
+{
+    ASSERT_THAT(mir_event_get_type(&event), Eq(mir_event_type_input_device_state));
+    auto const state = mir_event_get_input_device_state_event(&event);
+
+    ASSERT_THAT(mir_input_device_state_event_device_count(state), Eq(1u));
+    ASSERT_THAT(mir_input_device_state_event_device_pressed_keys_count(state, 0), Eq(pressed_keys.size()));
+    for (auto i = 0u; i != pressed_keys.size(); ++i)
+        EXPECT_THAT(mir_input_device_state_event_device_pressed_keys_for_index(state, 0, i), Eq(pressed_keys[i]));
+}
+}
+
+TEST(EventPool, events_stay_intact_when_the_pool_is_exhausted)
+{
+    std::vector<mir::EventUPtr> events;
+    for (auto i = 0; i != more_events_than_pooled; ++i)
+        events.push_back(pointer_event(MirInputDeviceId{7}, i));
+
+    for (auto i = 0; i != more_events_than_pooled; ++i)
+    {
+        EXPECT_THAT(axis_of(*events[i], mir_pointer_axis_x), Eq(i));
+        EXPECT_THAT(axis_of(*events[i], mir_pointer_axis_y), Eq(2*i));
+    }
+
+    // Frees both pooled and heap allocated events
+    events.clear();
+
+    auto const event = pointer_event(MirInputDeviceId{7}, 42);
+    EXPECT_THAT(axis_of(*event, mir_pointer_axis_x), Eq(42));
+}
+
+TEST(EventPool, events_can_be_freed_on_another_thread_than_they_were_made_on)
+{
+    auto const producers = 2;
+    auto const events_per_producer = 20000;
+
+    std::mutex mutex;
+    std::deque<mir::EventUPtr> queue;
+    std::atomic<int> consumed{0};
+    std::atomic<int> corrupted{0};
+
+    auto const produce = [&](MirInputDeviceId device)
+        {
+            for (auto i = 0; i != events_per_producer; ++i)
+            {
+                auto event = pointer_event(device, i);
+                std::lock_guard<std::mutex> lock{mutex};
+                queue.push_back(std::move(event));
+            }
+        };
+
+    auto const consume = [&]
+        {
+            while (consumed < producers * events_per_producer)
+            {
+                mir::EventUPtr event{nullptr, [](MirEvent*){}};
+                {
+                    std::lock_guard<std::mutex> lock{mutex};
+                    if (queue.empty())
+                        continue;
+                    event = std::move(queue.front());
+                    queue.pop_front();
+                }
+
+                // An event sharing its memory with another would have been overwritten
+                auto const x = axis_of(*event, mir_pointer_axis_x);
+                if (device_of(*event) < 1 || device_of(*event) > producers || axis_of(*event, mir_pointer_axis_y) != 2*x)
+                    ++corrupted;
+
+                event.reset();
+                ++consumed;
+            }
+        };
+
+    std::vector<std::thread> threads;
+    for (auto i = 1; i <= producers; ++i)
+        threads.emplace_back(produce, MirInputDeviceId{i});
+    threads.emplace_back(consume);
+    threads.emplace_back(consume);
+    for (auto& thread : threads)
+        thread.join();
+
+    EXPECT_THAT(consumed, Eq(producers * events_per_producer));
+    EXPECT_THAT(corrupted, Eq(0));
+}
+
+TEST(EventPool, serialized_events_deserialize_to_the_same_event)
+{
+    auto const event = pointer_event(MirInputDeviceId{7}, 12);
+
+    auto const deserialized = MirEvent::deserialize(MirEvent::serialize(event.get()));
+
+    ASSERT_THAT(mir_event_get_type(deserialized.get()), Eq(mir_event_type_input));
+    EXPECT_THAT(device_of(*deserialized), Eq(MirInputDeviceId{7}));
+    EXPECT_THAT(axis_of(*deserialized, mir_pointer_axis_x), Eq(12));
+    EXPECT_THAT(axis_of(*deserialized, mir_pointer_axis_y), Eq(24));
+    EXPECT_THAT(axis_of(*deserialized, mir_pointer_axis_relative_x), Eq(1));
+    EXPECT_THAT(MirEvent::serialize(deserialized.get()), Eq(MirEvent::serialize(event.get())));
+}
+
+TEST(EventPool, events_too_big_for_their_inline_segment_serialize_and_copy)
+{
+    std::vector<uint32_t> pressed_keys;
+    for (auto i = 0u; i != 1000; ++i)
+        pressed_keys.push_back(KEY_A + i % 26);
+
+    auto const event = event_with_many_keys_pressed(pressed_keys);
+    expect_keys_pressed(*event, pressed_keys);
+
+    auto const deserialized = MirEvent::deserialize(MirEvent::serialize(event.get()));
+    expect_keys_pressed(*deserialized, pressed_keys);
+
+    auto const clone = mev::clone_event(*deserialized);
+    expect_keys_pressed(*clone, pressed_keys);
+}
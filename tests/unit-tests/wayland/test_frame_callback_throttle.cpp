@@ -0,0 +1,221 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/server/frontend_wayland/frame_callback_throttle.h"
+
+#include "mir/scene/surface_observer.h"
+#include "mir/test/doubles/stub_surface.h"
+#include "mir/test/doubles/explicit_executor.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <wayland-server-core.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace mf = mir::frontend;
+namespace ms = mir::scene;
+namespace mtd = mir::test::doubles;
+
+using namespace testing;
+using namespace std::chrono;
+using namespace std::chrono_literals;
+
+namespace
+{
+milliseconds const interval{20};
+
+struct ObservableSurface : mtd::StubSurface
+{
+    bool visible() const override { return !hidden; }
+    MirWindowState state() const override { return window_state; }
+
+    int query(MirWindowAttrib attrib) const override
+    {
+        return attrib == mir_window_attrib_visibility ? visibility : 0;
+    }
+
+    void add_observer(std::shared_ptr<ms::SurfaceObserver> const& observer) override
+    {
+        observers.push_back(observer);
+    }
+
+    void remove_observer(std::weak_ptr<ms::SurfaceObserver> const& observer) override
+    {
+        auto const removed = observer.lock();
+        observers.erase(std::remove(begin(observers), end(observers), removed), end(observers));
+    }
+
+    void set_visibility(MirWindowVisibility new_visibility)
+    {
+        visibility = new_visibility;
+        for (auto const& observer : std::vector<std::shared_ptr<ms::SurfaceObserver>>{observers})
+            observer->attrib_changed(this, mir_window_attrib_visibility, visibility);
+    }
+
+    bool hidden{false};
+    MirWindowState window_state{mir_window_state_restored};
+    MirWindowVisibility visibility{mir_window_visibility_exposed};
+    std::vector<std::shared_ptr<ms::SurfaceObserver>> observers;
+};
+
+struct FrameCallbackThrottle : Test
+{
+    FrameCallbackThrottle()
+        : loop{wl_event_loop_create()}
+    {
+    }
+
+    ~FrameCallbackThrottle()
+    {
+        throttle.reset();
+        wl_event_loop_destroy(loop);
+    }
+
+    auto make_throttle(nanoseconds interval) -> std::unique_ptr<mf::FrameCallbackThrottle>
+    {
+        return std::make_unique<mf::FrameCallbackThrottle>(loop, executor, interval, [this]{ ++callbacks_sent; });
+    }
+
+    /// Runs the Wayland event loop for up to timeout, or until a timer goes off
+    void dispatch_for(milliseconds timeout)
+    {
+        wl_event_loop_dispatch(loop, timeout.count());
+    }
+
+    wl_event_loop* const loop;
+    std::shared_ptr<mtd::ExplicitExectutor> const executor{std::make_shared<mtd::ExplicitExectutor>()};
+    std::shared_ptr<ObservableSurface> const surface{std::make_shared<ObservableSurface>()};
+    std::unique_ptr<mf::FrameCallbackThrottle> throttle{make_throttle(interval)};
+    int callbacks_sent{0};
+};
+}
+
+TEST_F(FrameCallbackThrottle, sends_callbacks_at_once_for_a_surface_in_sight)
+{
+    throttle->request(surface);
+    throttle->request(surface);
+
+    EXPECT_THAT(callbacks_sent, Eq(2));
+    EXPECT_THAT(surface->observers, IsEmpty());
+}
+
+TEST_F(FrameCallbackThrottle, sends_callbacks_at_once_without_a_surface)
+{
+    throttle->request(nullptr);
+
+    EXPECT_THAT(callbacks_sent, Eq(1));
+}
+
+TEST_F(FrameCallbackThrottle, sends_callbacks_for_a_surface_out_of_sight_once_per_interval)
+{
+    surface->set_visibility(mir_window_visibility_occluded);
+
+    throttle->request(surface);
+    EXPECT_THAT(callbacks_sent, Eq(1));
+
+    auto const first_sent = steady_clock::now();
+    throttle->request(surface);
+    EXPECT_THAT(callbacks_sent, Eq(1));
+
+    dispatch_for(1s);
+
+    EXPECT_THAT(callbacks_sent, Eq(2));
+    // The timer has millisecond resolution, so may round the remaining wait down
+    EXPECT_THAT(steady_clock::now() - first_sent, Ge(interval - 1ms));
+}
+
+TEST_F(FrameCallbackThrottle, holds_back_callbacks_of_hidden_and_minimized_surfaces)
+{
+    throttle->request(surface);
+    surface->hidden = true;
+    throttle->request(surface);
+    EXPECT_THAT(callbacks_sent, Eq(1));
+
+    throttle.reset();
+    throttle = make_throttle(interval);
+    surface->hidden = false;
+    surface->window_state = mir_window_state_minimized;
+    throttle->request(surface);
+    throttle->request(surface);
+    EXPECT_THAT(callbacks_sent, Eq(2));
+}
+
+TEST_F(FrameCallbackThrottle, sends_held_back_callbacks_when_the_surface_comes_into_sight)
+{
+    surface->set_visibility(mir_window_visibility_occluded);
+    throttle->request(surface);
+    throttle->request(surface);
+    ASSERT_THAT(callbacks_sent, Eq(1));
+
+    surface->set_visibility(mir_window_visibility_exposed);
+
+    // The surface may tell its observers on any thread, so they only pass it on
+    EXPECT_THAT(callbacks_sent, Eq(1));
+    executor->execute();
+    EXPECT_THAT(callbacks_sent, Eq(2));
+    EXPECT_THAT(surface->observers, IsEmpty());
+}
+
+TEST_F(FrameCallbackThrottle, does_not_send_callbacks_twice_when_the_timer_and_the_surface_race)
+{
+    surface->set_visibility(mir_window_visibility_occluded);
+    throttle->request(surface);
+    throttle->request(surface);
+
+    surface->set_visibility(mir_window_visibility_exposed);
+    dispatch_for(1s);
+    executor->execute();
+
+    EXPECT_THAT(callbacks_sent, Eq(2));
+}
+
+TEST_F(FrameCallbackThrottle, with_a_zero_interval_sends_no_callbacks_out_of_sight)
+{
+    throttle = make_throttle(0ns);
+    surface->set_visibility(mir_window_visibility_occluded);
+
+    throttle->request(surface);
+    dispatch_for(4*interval);
+
+    EXPECT_THAT(callbacks_sent, Eq(0));
+
+    surface->set_visibility(mir_window_visibility_exposed);
+    executor->execute();
+
+    EXPECT_THAT(callbacks_sent, Eq(1));
+}
+
+TEST_F(FrameCallbackThrottle, sends_nothing_once_destroyed_while_waiting)
+{
+    surface->set_visibility(mir_window_visibility_occluded);
+    throttle->request(surface);
+    throttle->request(surface);
+    ASSERT_THAT(callbacks_sent, Eq(1));
+
+    // Work already queued on the Wayland thread outlives the throttle
+    surface->set_visibility(mir_window_visibility_exposed);
+    throttle.reset();
+
+    EXPECT_THAT(surface->observers, IsEmpty());
+
+    executor->execute();
+    dispatch_for(2*interval);
+
+    EXPECT_THAT(callbacks_sent, Eq(1));
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/server/frontend_wayland/keymap_cache.h"
+
+#include <xkbcommon/xkbcommon.h>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace mf = mir::frontend;
+namespace mi = mir::input;
+
+using namespace testing;
+
+namespace
+{
+struct KeymapCache : Test
+{
+    static auto contents_of(mf::KeymapCache::CompiledKeymap const& keymap) -> std::string
+    {
+        auto const fd = keymap.fd();
+        auto const mapping = mmap(nullptr, keymap.size(), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED)
+            return {};
+
+        std::string const result{static_cast<char const*>(mapping), keymap.size()};
+        munmap(mapping, keymap.size());
+        return result;
+    }
+
+    static auto text_of(mf::KeymapCache::CompiledKeymap const& keymap) -> std::string
+    {
+        auto const text = xkb_keymap_get_as_string(keymap.keymap(), XKB_KEYMAP_FORMAT_TEXT_V1);
+        std::string const result{text};
+        free(text);
+        return result;
+    }
+
+    mi::Keymap const us{"pc105", "us", "", ""};
+    mi::Keymap const gb{"pc105", "gb", "", ""};
+    mf::KeymapCache cache;
+};
+}
+
+TEST_F(KeymapCache, compiles_keymap_once)
+{
+    auto const first = cache.keymap_for(us);
+    auto const second = cache.keymap_for(mi::Keymap{us});
+
+    EXPECT_THAT(second, Eq(first));
+}
+
+TEST_F(KeymapCache, compiles_different_keymaps_separately)
+{
+    auto const first = cache.keymap_for(us);
+    auto const second = cache.keymap_for(gb);
+
+    EXPECT_THAT(second, Ne(first));
+    EXPECT_THAT(second->names, Eq(gb));
+}
+
+TEST_F(KeymapCache, keeps_keymaps_in_use)
+{
+    auto const first = cache.keymap_for(us);
+    cache.keymap_for(gb);
+
+    EXPECT_THAT(cache.keymap_for(us), Eq(first));
+}
+
+TEST_F(KeymapCache, file_holds_keymap_text)
+{
+    auto const keymap = cache.keymap_for(us);
+
+    EXPECT_THAT(contents_of(*keymap), Eq(text_of(*keymap)));
+}
+
+TEST_F(KeymapCache, every_client_is_sent_the_same_read_only_file)
+{
+    auto const keymap = cache.keymap_for(us);
+    if (!keymap->is_shared())
+        return; // The kernel doesn't support sealing memfds
+
+    auto const fd = keymap->fd();
+    EXPECT_THAT(int{keymap->fd()}, Eq(int{fd}));
+
+    auto const seals = fcntl(fd, F_GET_SEALS);
+    EXPECT_THAT(seals & F_SEAL_WRITE, Ne(0));
+    EXPECT_THAT(seals & F_SEAL_SHRINK, Ne(0));
+    EXPECT_THAT(seals & F_SEAL_SEAL, Ne(0));
+
+    EXPECT_THAT(mmap(nullptr, keymap->size(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0), Eq(MAP_FAILED));
+    EXPECT_THAT(ftruncate(fd, 0), Ne(0));
+}
+
+TEST_F(KeymapCache, throws_for_keymap_that_does_not_compile)
+{
+    EXPECT_THROW(cache.keymap_for(mi::Keymap{"pc105", "no-such-layout", "", ""}), std::runtime_error);
+}
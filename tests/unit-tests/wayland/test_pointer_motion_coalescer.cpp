@@ -0,0 +1,255 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/server/frontend_wayland/pointer_motion_coalescer.h"
+
+#include "mir/events/event_builders.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <wayland-server-core.h>
+
+using namespace testing;
+using namespace std::chrono_literals;
+namespace mf = mir::frontend;
+namespace mev = mir::events;
+
+namespace
+{
+MirInputDeviceId const mouse{7};
+MirInputDeviceId const touchscreen{8};
+
+struct Dispatched
+{
+    MirPointerAction action;
+    MirPointerButtons buttons;
+    float x, y;
+    float dx, dy;
+    float vscroll;
+};
+
+struct PointerMotionCoalescer : Test
+{
+    ~PointerMotionCoalescer()
+    {
+        coalescer.stop();
+        wl_event_loop_destroy(loop);
+    }
+
+    PointerMotionCoalescer()
+    {
+        coalescer.set_dispatch([this](MirInputEvent const* event)
+            {
+                ASSERT_THAT(mir_input_event_get_type(event), Eq(mir_input_event_type_pointer));
+                auto const pointer = mir_input_event_get_pointer_event(event);
+                dispatched.push_back({
+                    mir_pointer_event_action(pointer),
+                    mir_pointer_event_buttons(pointer),
+                    mir_pointer_event_axis_value(pointer, mir_pointer_axis_x),
+                    mir_pointer_event_axis_value(pointer, mir_pointer_axis_y),
+                    mir_pointer_event_axis_value(pointer, mir_pointer_axis_relative_x),
+                    mir_pointer_event_axis_value(pointer, mir_pointer_axis_relative_y),
+                    mir_pointer_event_axis_value(pointer, mir_pointer_axis_vscroll)});
+            });
+    }
+
+    auto pointer(
+        MirPointerAction action,
+        MirPointerButtons buttons,
+        float x, float y,
+        float dx = 0, float dy = 0,
+        float vscroll = 0) -> std::shared_ptr<MirEvent>
+    {
+        time += 1ms;
+        return mev::make_event(mouse, time, {}, mir_input_event_modifier_none, action, buttons, x, y, 0, vscroll, dx, dy);
+    }
+
+    auto motion(float x, float y, float dx = 0, float dy = 0) -> std::shared_ptr<MirEvent>
+    {
+        return pointer(mir_pointer_action_motion, 0, x, y, dx, dy);
+    }
+
+    std::chrono::nanoseconds time{1s};
+    std::chrono::milliseconds const max_hold{50};
+    wl_event_loop* const loop{wl_event_loop_create()};
+    mf::PointerMotionCoalescer coalescer{loop, max_hold};
+    std::vector<Dispatched> dispatched;
+};
+}
+
+TEST_F(PointerMotionCoalescer, dispatches_motion_as_soon_as_an_idle_client_can_take_it)
+{
+    EXPECT_TRUE(coalescer.add(motion(10, 20)));
+
+    coalescer.flush();
+
+    ASSERT_THAT(dispatched.size(), Eq(1u));
+    EXPECT_THAT(dispatched[0].x, Eq(10));
+    EXPECT_THAT(dispatched[0].y, Eq(20));
+}
+
+TEST_F(PointerMotionCoalescer, merges_motion_that_arrives_before_the_flush)
+{
+    EXPECT_TRUE(coalescer.add(motion(10, 20, 1, 2)));
+    EXPECT_FALSE(coalescer.add(motion(11, 22, 1, 2)));
+    EXPECT_FALSE(coalescer.add(motion(13, 25, 2, 3)));
+
+    coalescer.flush();
+
+    ASSERT_THAT(dispatched.size(), Eq(1u));
+    EXPECT_THAT(dispatched[0].x, Eq(13));
+    EXPECT_THAT(dispatched[0].y, Eq(25));
+    EXPECT_THAT(dispatched[0].dx, Eq(4));
+    EXPECT_THAT(dispatched[0].dy, Eq(7));
+}
+
+TEST_F(PointerMotionCoalescer, accumulates_scrolling)
+{
+    coalescer.add(pointer(mir_pointer_action_motion, 0, 10, 20, 0, 0, 1));
+    coalescer.add(pointer(mir_pointer_action_motion, 0, 10, 20, 0, 0, 2));
+
+    coalescer.flush();
+
+    ASSERT_THAT(dispatched.size(), Eq(1u));
+    EXPECT_THAT(dispatched[0].vscroll, Eq(3));
+}
+
+TEST_F(PointerMotionCoalescer, holds_motion_back_while_the_client_draws_a_frame)
+{
+    coalescer.frame_requested();
+
+    EXPECT_TRUE(coalescer.add(motion(10, 20, 1, 1)));
+    EXPECT_FALSE(coalescer.add(motion(12, 21, 2, 1)));
+    coalescer.flush();
+    EXPECT_THAT(dispatched, IsEmpty());
+
+    coalescer.frame_done();
+
+    ASSERT_THAT(dispatched.size(), Eq(1u));
+    EXPECT_THAT(dispatched[0].x, Eq(12));
+    EXPECT_THAT(dispatched[0].dx, Eq(3));
+}
+
+TEST_F(PointerMotionCoalescer, dispatches_motion_at_once_after_the_frame_is_done)
+{
+    coalescer.frame_requested();
+    coalescer.frame_done();
+
+    EXPECT_TRUE(coalescer.add(motion(10, 20)));
+}
+
+TEST_F(PointerMotionCoalescer, buttons_are_dispatched_at_once_after_the_motion_before_them)
+{
+    coalescer.frame_requested();
+
+    EXPECT_TRUE(coalescer.add(motion(10, 20)));
+    coalescer.flush();
+    EXPECT_FALSE(coalescer.add(motion(11, 20)));
+    EXPECT_TRUE(coalescer.add(pointer(mir_pointer_action_button_down, mir_pointer_button_primary, 11, 20)));
+    EXPECT_FALSE(coalescer.add(pointer(mir_pointer_action_motion, mir_pointer_button_primary, 12, 20)));
+
+    coalescer.flush();
+
+    ASSERT_THAT(dispatched.size(), Eq(2u));
+    EXPECT_THAT(dispatched[0].action, Eq(mir_pointer_action_motion));
+    EXPECT_THAT(dispatched[0].x, Eq(11));
+    EXPECT_THAT(dispatched[1].action, Eq(mir_pointer_action_button_down));
+
+    coalescer.frame_done();
+
+    ASSERT_THAT(dispatched.size(), Eq(3u));
+    EXPECT_THAT(dispatched[2].action, Eq(mir_pointer_action_motion));
+    EXPECT_THAT(dispatched[2].x, Eq(12));
+}
+
+TEST_F(PointerMotionCoalescer, does_not_merge_motion_with_different_buttons_held)
+{
+    coalescer.add(motion(10, 20));
+    coalescer.add(pointer(mir_pointer_action_motion, mir_pointer_button_secondary, 11, 20));
+
+    coalescer.flush();
+
+    ASSERT_THAT(dispatched.size(), Eq(2u));
+    EXPECT_THAT(dispatched[0].buttons, Eq(0u));
+    EXPECT_THAT(dispatched[1].buttons, Eq(mir_pointer_button_secondary));
+}
+
+TEST_F(PointerMotionCoalescer, stops_holding_motion_back_after_max_hold)
+{
+    coalescer.frame_requested();
+
+    EXPECT_TRUE(coalescer.add(motion(10, 20)));
+    coalescer.flush();
+    time += max_hold;
+    EXPECT_TRUE(coalescer.add(motion(11, 20)));
+
+    coalescer.flush();
+
+    ASSERT_THAT(dispatched.size(), Eq(1u));
+    EXPECT_THAT(dispatched[0].x, Eq(11));
+}
+
+TEST_F(PointerMotionCoalescer, dispatches_held_motion_after_max_hold_without_more_input)
+{
+    coalescer.frame_requested();
+
+    EXPECT_TRUE(coalescer.add(motion(10, 20)));
+    coalescer.flush();
+    ASSERT_THAT(dispatched, IsEmpty());
+
+    auto const held_from = std::chrono::steady_clock::now();
+    wl_event_loop_dispatch(loop, 1000);
+
+    ASSERT_THAT(dispatched.size(), Eq(1u));
+    EXPECT_THAT(dispatched[0].x, Eq(10));
+    EXPECT_THAT(std::chrono::steady_clock::now() - held_from, Ge(max_hold));
+}
+
+TEST_F(PointerMotionCoalescer, stops_timing_the_hold_once_the_frame_is_done)
+{
+    coalescer.frame_requested();
+    coalescer.add(motion(10, 20));
+    coalescer.flush();
+    coalescer.frame_done();
+    ASSERT_THAT(dispatched.size(), Eq(1u));
+
+    wl_event_loop_dispatch(loop, 2*max_hold.count());
+
+    EXPECT_THAT(dispatched.size(), Eq(1u));
+}
+
+TEST_F(PointerMotionCoalescer, never_merges_touches)
+{
+    std::vector<int> touch_counts;
+    coalescer.set_dispatch([&](MirInputEvent const* event)
+        {
+            ASSERT_THAT(mir_input_event_get_type(event), Eq(mir_input_event_type_touch));
+            touch_counts.push_back(mir_touch_event_point_count(mir_input_event_get_touch_event(event)));
+        });
+
+    coalescer.frame_requested();
+    for (auto i = 0; i != 3; ++i)
+    {
+        std::shared_ptr<MirEvent> touch = mev::make_event(touchscreen, time, {}, mir_input_event_modifier_none);
+        mev::add_touch(*touch, 0, mir_touch_action_change, mir_touch_tooltype_finger, 10 + i, 20, 1, 1, 1, 1);
+        coalescer.add(touch);
+    }
+
+    coalescer.flush();
+
+    EXPECT_THAT(touch_counts.size(), Eq(3u));
+}
@@ -0,0 +1,229 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/server/frontend_wayland/presentation_tracker.h"
+
+#include "mir/test/doubles/null_display.h"
+#include "mir/test/doubles/stub_display_configuration.h"
+#include "mir/test/doubles/advanceable_clock.h"
+#include "mir/geometry/rectangle.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <wayland-server-core.h>
+
+#include <map>
+
+namespace mf = mir::frontend;
+namespace mg = mir::graphics;
+namespace mtd = mir::test::doubles;
+namespace geom = mir::geometry;
+
+using namespace testing;
+using namespace std::chrono;
+using namespace std::chrono_literals;
+
+namespace
+{
+mg::DisplayConfigurationOutputId const left_output{1};
+mg::DisplayConfigurationOutputId const right_output{2};
+
+// The outputs of StubDisplayConfig run at 60Hz
+nanoseconds const refresh{static_cast<int64_t>(1e9 / 60)};
+
+struct StubFrameDisplay : mtd::NullDisplay
+{
+    mg::Frame last_frame_on(unsigned output_id) const override
+    {
+        auto const frame = frames.find(output_id);
+        return frame != frames.end() ? frame->second : mg::Frame{};
+    }
+
+    std::map<unsigned, mg::Frame> frames;
+};
+
+struct MockFeedback : mf::PresentationTracker::Feedback
+{
+    MOCK_CONST_METHOD0(destroyed, bool());
+    MOCK_METHOD4(presented, void(mg::DisplayConfigurationOutputId, nanoseconds, nanoseconds, uint64_t));
+    MOCK_METHOD0(discarded, void());
+};
+
+struct PresentationTracker : Test
+{
+    PresentationTracker()
+        : loop{wl_event_loop_create()}
+    {
+        tracker = std::make_unique<mf::PresentationTracker>(
+            loop,
+            display,
+            [this](std::function<void(mg::DisplayConfigurationOutput const&)> const& f)
+            {
+                config.for_each_output(f);
+            },
+            clock);
+    }
+
+    ~PresentationTracker()
+    {
+        tracker.reset();
+        wl_event_loop_destroy(loop);
+    }
+
+    void show_frame(mg::DisplayConfigurationOutputId output, int64_t msc, nanoseconds ust)
+    {
+        display->frames[output.as_value()] = mg::Frame{msc, mir::time::PosixTimestamp{CLOCK_MONOTONIC, ust}};
+    }
+
+    /// The compositor takes the content update, and the Wayland thread hears of it straight away
+    void consume(geom::Rectangle const& extents)
+    {
+        tracker->consumed(feedback, extents, tracker->frame_sampler()());
+    }
+
+    /// Waits for the tracker to look at the frames shown
+    void wait_for_check()
+    {
+        wl_event_loop_dispatch(loop, 100);
+    }
+
+    geom::Rectangle const on_left{{10, 10}, {100, 100}};
+
+    wl_event_loop* const loop;
+    std::shared_ptr<StubFrameDisplay> const display{std::make_shared<StubFrameDisplay>()};
+    mtd::StubDisplayConfig const config{{{{0, 0}, {640, 480}}, {{640, 0}, {640, 480}}}};
+    std::shared_ptr<mtd::AdvanceableClock> const clock{std::make_shared<mtd::AdvanceableClock>()};
+    std::shared_ptr<NiceMock<MockFeedback>> const feedback{std::make_shared<NiceMock<MockFeedback>>()};
+    std::unique_ptr<mf::PresentationTracker> tracker;
+};
+}
+
+TEST_F(PresentationTracker, presents_with_the_first_frame_after_being_consumed)
+{
+    show_frame(left_output, 10, 1000ms);
+    consume(on_left);
+    show_frame(left_output, 11, 1016ms);
+
+    EXPECT_CALL(*feedback, presented(left_output, nanoseconds{1016ms}, refresh, 11u));
+    EXPECT_CALL(*feedback, discarded()).Times(0);
+
+    wait_for_check();
+}
+
+TEST_F(PresentationTracker, works_back_to_the_presentation_time_if_frames_were_shown_since)
+{
+    show_frame(left_output, 10, 1000ms);
+    consume(on_left);
+    show_frame(left_output, 13, 1050ms);
+
+    EXPECT_CALL(*feedback, presented(left_output, nanoseconds{1050ms} - 2*refresh, refresh, 11u));
+
+    wait_for_check();
+}
+
+TEST_F(PresentationTracker, counts_from_the_frame_shown_when_the_compositor_took_the_update)
+{
+    show_frame(left_output, 10, 1000ms);
+    auto const shown_before = tracker->frame_sampler()();
+    show_frame(left_output, 11, 1016ms);
+    tracker->consumed(feedback, on_left, shown_before);
+
+    EXPECT_CALL(*feedback, presented(left_output, nanoseconds{1016ms}, refresh, 11u));
+
+    wait_for_check();
+}
+
+TEST_F(PresentationTracker, frame_sampler_can_be_used_after_the_tracker_is_gone)
+{
+    show_frame(left_output, 10, 1000ms);
+    auto const sample_frames = tracker->frame_sampler();
+    tracker.reset();
+
+    EXPECT_THAT(sample_frames(), Contains(std::make_pair(left_output, int64_t{10})));
+}
+
+TEST_F(PresentationTracker, waits_for_a_new_frame)
+{
+    show_frame(left_output, 10, 1000ms);
+    consume(on_left);
+
+    EXPECT_CALL(*feedback, presented(_, _, _, _)).Times(0);
+    EXPECT_CALL(*feedback, discarded()).Times(0);
+
+    wait_for_check();
+    Mock::VerifyAndClearExpectations(feedback.get());
+
+    show_frame(left_output, 11, 1016ms);
+
+    EXPECT_CALL(*feedback, presented(left_output, nanoseconds{1016ms}, refresh, 11u));
+
+    wait_for_check();
+}
+
+TEST_F(PresentationTracker, presents_when_next_checked_if_the_platform_does_not_count_frames)
+{
+    consume(on_left);
+
+    EXPECT_CALL(*feedback, presented(left_output, clock->now().time_since_epoch(), refresh, 0u));
+
+    wait_for_check();
+}
+
+TEST_F(PresentationTracker, discards_if_no_new_frame_is_shown_for_a_second)
+{
+    show_frame(left_output, 10, 1000ms);
+    consume(on_left);
+    clock->advance_by(1001ms);
+
+    EXPECT_CALL(*feedback, presented(_, _, _, _)).Times(0);
+    EXPECT_CALL(*feedback, discarded());
+
+    wait_for_check();
+}
+
+TEST_F(PresentationTracker, is_synchronized_to_the_output_showing_most_of_the_surface)
+{
+    show_frame(left_output, 10, 1000ms);
+    show_frame(right_output, 20, 1004ms);
+    consume({{600, 0}, {200, 100}});
+    show_frame(left_output, 11, 1016ms);
+    show_frame(right_output, 21, 1020ms);
+
+    EXPECT_CALL(*feedback, presented(right_output, nanoseconds{1020ms}, refresh, 21u));
+
+    wait_for_check();
+}
+
+TEST_F(PresentationTracker, discards_immediately_if_on_no_output)
+{
+    EXPECT_CALL(*feedback, discarded());
+
+    consume({{5000, 5000}, {100, 100}});
+}
+
+TEST_F(PresentationTracker, says_nothing_once_feedback_is_destroyed)
+{
+    show_frame(left_output, 10, 1000ms);
+    consume(on_left);
+    show_frame(left_output, 11, 1016ms);
+    ON_CALL(*feedback, destroyed()).WillByDefault(Return(true));
+
+    EXPECT_CALL(*feedback, presented(_, _, _, _)).Times(0);
+    EXPECT_CALL(*feedback, discarded()).Times(0);
+
+    wait_for_check();
+}
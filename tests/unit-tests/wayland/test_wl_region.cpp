@@ -0,0 +1,140 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/server/frontend_wayland/wl_region.h"
+
+#include "mir/geometry/region.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <wayland-server-core.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace mf = mir::frontend;
+namespace mw = mir::wayland;
+namespace geom = mir::geometry;
+
+using namespace testing;
+
+namespace mir
+{
+namespace wayland
+{
+extern struct wl_interface const wl_region_interface_data;
+}
+}
+
+namespace
+{
+uint32_t const region_id{2};
+
+struct Opcode
+{
+    static uint32_t const add = 1;
+    static uint32_t const subtract = 2;
+};
+
+/// A client's wl_region, built by writing its requests to the server as a client would
+struct WlRegion : Test
+{
+    WlRegion()
+        : display{wl_display_create()}
+    {
+        socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds);
+        client = wl_client_create(display, fds[0]);
+        region = new mf::WlRegion{wl_resource_create(client, &mw::wl_region_interface_data, 1, region_id)};
+    }
+
+    ~WlRegion()
+    {
+        wl_client_destroy(client);
+        close(fds[1]);
+        wl_display_destroy(display);
+    }
+
+    void request(uint32_t opcode, int32_t x, int32_t y, int32_t width, int32_t height)
+    {
+        uint32_t const size = 6 * sizeof(uint32_t);
+        uint32_t const message[]{
+            region_id,
+            size << 16 | opcode,
+            static_cast<uint32_t>(x), static_cast<uint32_t>(y),
+            static_cast<uint32_t>(width), static_cast<uint32_t>(height)};
+
+        ASSERT_THAT(write(fds[1], message, sizeof(message)), Eq(static_cast<ssize_t>(sizeof(message))));
+        wl_event_loop_dispatch(wl_display_get_event_loop(display), 0);
+    }
+
+    auto committed() -> geom::Region
+    {
+        geom::Rectangles rects;
+        for (auto const& rect : region->rectangle_vector())
+            rects.add(rect);
+        return geom::Region{rects};
+    }
+
+    wl_display* const display;
+    int fds[2];
+    wl_client* client;
+    mf::WlRegion* region;
+};
+}
+
+TEST_F(WlRegion, is_the_union_of_the_rectangles_added)
+{
+    request(Opcode::add, 0, 0, 100, 100);
+    request(Opcode::add, 50, 50, 100, 100);
+
+    geom::Region expected{geom::Rectangle{{0, 0}, {100, 100}}};
+    expected.add(geom::Rectangle{{50, 50}, {100, 100}});
+    EXPECT_THAT(committed(), Eq(expected));
+}
+
+TEST_F(WlRegion, excludes_the_rectangles_subtracted)
+{
+    // An opaque region without the rounded corners of a window
+    request(Opcode::add, 0, 0, 100, 100);
+    request(Opcode::subtract, 0, 0, 8, 8);
+    request(Opcode::subtract, 92, 0, 8, 8);
+
+    auto const opaque = committed();
+    EXPECT_FALSE(opaque.contains(geom::Rectangle{{0, 0}, {8, 8}}));
+    EXPECT_FALSE(opaque.contains(geom::Point{95, 3}));
+    EXPECT_TRUE(opaque.contains(geom::Rectangle{{8, 0}, {84, 8}}));
+    EXPECT_TRUE(opaque.contains(geom::Rectangle{{0, 8}, {100, 92}}));
+}
+
+TEST_F(WlRegion, adding_after_subtracting_adds_back)
+{
+    request(Opcode::add, 0, 0, 100, 100);
+    request(Opcode::subtract, 0, 0, 50, 50);
+    request(Opcode::add, 0, 0, 10, 10);
+
+    auto const opaque = committed();
+    EXPECT_TRUE(opaque.contains(geom::Rectangle{{0, 0}, {10, 10}}));
+    EXPECT_FALSE(opaque.contains(geom::Point{20, 20}));
+}
+
+TEST_F(WlRegion, subtracting_everything_leaves_nothing)
+{
+    request(Opcode::add, 10, 10, 100, 100);
+    request(Opcode::subtract, 0, 0, 200, 200);
+
+    EXPECT_THAT(region->rectangle_vector(), IsEmpty());
+}